@@ -17,6 +17,7 @@
     Copyright 2017-2020 Telegram Systems LLP
 */
 #include "td/utils/crypto.h"
+#include "td/utils/Metrics.h"
 #include "td/utils/Random.h"
 
 #include "adnl-local-id.h"
@@ -41,8 +42,12 @@ AdnlAddressList AdnlLocalId::get_addr_list() const {
 }
 
 void AdnlLocalId::receive(td::IPAddress addr, td::BufferSlice data) {
+  // time from the receipt of a packet to its decryption, including the wait in the keyring queue
+  static auto &decrypt_us = td::get_metric<td::MetricHistogram>("adnl_in_decrypt_us");
   auto P = td::PromiseCreator::lambda(
-      [peer_table = peer_table_, dst = short_id_, addr, id = print_id()](td::Result<AdnlPacket> R) {
+      [peer_table = peer_table_, dst = short_id_, addr, id = print_id(),
+       timer = td::MetricTimer(decrypt_us)](td::Result<AdnlPacket> R) mutable {
+        timer.reset();
         if (R.is_error()) {
           VLOG(ADNL_WARNING) << id << ": dropping IN message: cannot decrypt: " << R.move_as_error();
         } else {
@@ -27,8 +27,56 @@ namespace ton {
 
 namespace adnl {
 
-td::actor::ActorOwn<AdnlNetworkManager> AdnlNetworkManager::create(td::uint16 port) {
-  return td::actor::create_actor<AdnlNetworkManagerImpl>("NetworkManager", port);
+td::actor::ActorOwn<AdnlNetworkManager> AdnlNetworkManager::create(td::uint16 port, td::uint32 receive_sockets) {
+  return td::actor::create_actor<AdnlNetworkManagerImpl>("NetworkManager", port, receive_sockets);
+}
+
+namespace {
+
+bool check_udp_message(const td::UdpMessage &message) {
+  AdnlNetworkManager::PrintId id;
+  if (message.error.is_error()) {
+    VLOG(ADNL_WARNING) << id << ": dropping ERROR message: " << message.error;
+    return false;
+  }
+  if (message.data.size() < 32) {
+    VLOG(ADNL_WARNING) << id << ": received too small packet of size " << message.data.size();
+    return false;
+  }
+  if (message.data.size() >= AdnlNetworkManager::get_mtu() + 128) {
+    VLOG(ADNL_NOTICE) << id << ": received huge packet of size " << message.data.size();
+  }
+  return true;
+}
+
+}  // namespace
+
+void AdnlUdpReceiver::update(std::shared_ptr<AdnlNetworkManager::Callback> callback, bool has_in_desc,
+                             AdnlCategoryMask cat_mask, bool allow_proxy) {
+  callback_ = std::move(callback);
+  has_in_desc_ = has_in_desc;
+  cat_mask_ = cat_mask;
+  allow_proxy_ = allow_proxy;
+}
+
+void AdnlUdpReceiver::receive_udp_message(td::UdpMessage message) {
+  if (allow_proxy_) {
+    td::actor::send_closure(manager_, &AdnlNetworkManagerImpl::receive_udp_message, std::move(message), socket_idx_);
+    return;
+  }
+  if (!callback_) {
+    LOG(ERROR) << AdnlNetworkManager::PrintId{} << ": dropping IN message [?->?]: peer table unitialized";
+    return;
+  }
+  if (!check_udp_message(message)) {
+    return;
+  }
+  if (!has_in_desc_) {
+    VLOG(ADNL_WARNING) << AdnlNetworkManager::PrintId{} << ": received bad packet to proxy-only listenung port";
+    return;
+  }
+  VLOG(ADNL_EXTRA_DEBUG) << AdnlNetworkManager::PrintId{} << ": received message of size " << message.data.size();
+  callback_->receive_packet(message.address, cat_mask_, std::move(message.data));
 }
 
 AdnlNetworkManagerImpl::OutDesc *AdnlNetworkManagerImpl::choose_out_iface(td::uint8 cat, td::uint32 priority) {
@@ -68,14 +116,60 @@ size_t AdnlNetworkManagerImpl::add_listening_udp_port(td::uint16 port) {
     }
   };
 
+  class ReceiverCallback : public td::UdpServer::Callback {
+   public:
+    ReceiverCallback(td::actor::ActorId<AdnlUdpReceiver> receiver) : receiver_(std::move(receiver)) {
+    }
+
+   private:
+    td::actor::ActorId<AdnlUdpReceiver> receiver_;
+    void on_udp_message(td::UdpMessage udp_message) override {
+      td::actor::send_closure_later(receiver_, &AdnlUdpReceiver::receive_udp_message, std::move(udp_message));
+    }
+  };
+
   auto idx = udp_sockets_.size();
-  auto X = td::UdpServer::create("udp server", port, std::make_unique<Callback>(actor_shared(this), idx));
-  X.ensure();
+  if (receive_sockets_ == 1) {
+    auto X = td::UdpServer::create("udp server", port, std::make_unique<Callback>(actor_shared(this), idx));
+    X.ensure();
+    port_2_socket_[port] = idx;
+    udp_sockets_.push_back(UdpSocketDesc{port, X.move_as_ok()});
+    return idx;
+  }
+
+  std::vector<td::actor::ActorOwn<AdnlUdpReceiver>> receivers;
+  std::vector<td::actor::ActorOwn<td::UdpServer>> servers;
+  for (td::uint32 i = 0; i < receive_sockets_; i++) {
+    auto receiver = td::actor::create_actor<AdnlUdpReceiver>(PSLICE() << "udp receiver" << port << "." << i,
+                                                             actor_id(this), idx);
+    auto X = td::UdpServer::create(PSLICE() << "udp server" << port << "." << i, port,
+                                   std::make_unique<ReceiverCallback>(receiver.get()), true);
+    X.ensure();
+    receivers.push_back(std::move(receiver));
+    servers.push_back(X.move_as_ok());
+  }
+  VLOG(ADNL_INFO) << this << ": listening on port " << port << " with " << receive_sockets_ << " sockets";
   port_2_socket_[port] = idx;
-  udp_sockets_.push_back(UdpSocketDesc{port, X.move_as_ok()});
+  udp_sockets_.push_back(UdpSocketDesc{port, std::move(servers[0])});
+  auto &socket = udp_sockets_.back();
+  for (size_t i = 1; i < servers.size(); i++) {
+    socket.extra_servers.push_back(std::move(servers[i]));
+  }
+  socket.receivers = std::move(receivers);
+  update_receivers(idx);
   return idx;
 }
 
+void AdnlNetworkManagerImpl::update_receivers(size_t socket_idx) {
+  CHECK(socket_idx < udp_sockets_.size());
+  auto &socket = udp_sockets_[socket_idx];
+  bool has_in_desc = socket.in_desc != std::numeric_limits<size_t>::max();
+  auto cat_mask = has_in_desc ? in_desc_[socket.in_desc].cat_mask : AdnlCategoryMask{};
+  for (auto &receiver : socket.receivers) {
+    td::actor::send_closure(receiver, &AdnlUdpReceiver::update, callback_, has_in_desc, cat_mask, socket.allow_proxy);
+  }
+}
+
 void AdnlNetworkManagerImpl::add_self_addr(td::IPAddress addr, AdnlCategoryMask cat_mask, td::uint32 priority) {
   auto port = td::narrow_cast<td::uint16>(addr.get_port());
   size_t idx = add_listening_udp_port(port);
@@ -113,17 +207,9 @@ void AdnlNetworkManagerImpl::receive_udp_message(td::UdpMessage message, size_t
     LOG(ERROR) << this << ": dropping IN message [?->?]: peer table unitialized";
     return;
   }
-  if (message.error.is_error()) {
-    VLOG(ADNL_WARNING) << this << ": dropping ERROR message: " << message.error;
-    return;
-  }
-  if (message.data.size() < 32) {
-    VLOG(ADNL_WARNING) << this << ": received too small proxy packet of size " << message.data.size();
+  if (!check_udp_message(message)) {
     return;
   }
-  if (message.data.size() >= get_mtu() + 128) {
-    VLOG(ADNL_NOTICE) << this << ": received huge packet of size " << message.data.size();
-  }
   CHECK(idx < udp_sockets_.size());
   auto &socket = udp_sockets_[idx];
   AdnlCategoryMask cat_mask;
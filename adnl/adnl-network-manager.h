@@ -60,9 +60,12 @@ class AdnlNetworkManager : public td::actor::Actor {
    public:
     virtual ~Callback() = default;
     //virtual void receive_packet(td::IPAddress addr, ConnHandle conn_handle, td::BufferSlice data) = 0;
+    // may be called concurrently from several actors if the ports are opened with several receiving sockets
     virtual void receive_packet(td::IPAddress addr, AdnlCategoryMask cat_mask, td::BufferSlice data) = 0;
   };
-  static td::actor::ActorOwn<AdnlNetworkManager> create(td::uint16 out_port);
+  // with receive_sockets > 1 every listening port is opened that many times with SO_REUSEPORT,
+  // and packets received by each socket are processed by a separate actor
+  static td::actor::ActorOwn<AdnlNetworkManager> create(td::uint16 out_port, td::uint32 receive_sockets = 1);
 
   virtual ~AdnlNetworkManager() = default;
 
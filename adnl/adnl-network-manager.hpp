@@ -38,6 +38,28 @@ namespace ton {
 namespace adnl {
 
 class AdnlPeerTable;
+class AdnlNetworkManagerImpl;
+
+// processes packets received by one of the sockets of a port opened with SO_REUSEPORT, so that several sockets
+// of the same port are served in parallel; packets to ports with proxies are passed to the network manager
+class AdnlUdpReceiver : public td::actor::Actor {
+ public:
+  AdnlUdpReceiver(td::actor::ActorId<AdnlNetworkManagerImpl> manager, size_t socket_idx)
+      : manager_(std::move(manager)), socket_idx_(socket_idx) {
+  }
+
+  void update(std::shared_ptr<AdnlNetworkManager::Callback> callback, bool has_in_desc, AdnlCategoryMask cat_mask,
+              bool allow_proxy);
+  void receive_udp_message(td::UdpMessage message);
+
+ private:
+  td::actor::ActorId<AdnlNetworkManagerImpl> manager_;
+  size_t socket_idx_;
+  std::shared_ptr<AdnlNetworkManager::Callback> callback_;
+  bool has_in_desc_{false};
+  AdnlCategoryMask cat_mask_;
+  bool allow_proxy_{false};
+};
 
 class AdnlNetworkManagerImpl : public AdnlNetworkManager {
  public:
@@ -94,15 +116,22 @@ class AdnlNetworkManagerImpl : public AdnlNetworkManager {
     td::actor::ActorOwn<td::UdpServer> server;
     size_t in_desc{std::numeric_limits<size_t>::max()};
     bool allow_proxy{false};
+    // other sockets bound to the same port, only with receive_sockets_ > 1
+    std::vector<td::actor::ActorOwn<td::UdpServer>> extra_servers;
+    std::vector<td::actor::ActorOwn<AdnlUdpReceiver>> receivers;
   };
 
   OutDesc *choose_out_iface(td::uint8 cat, td::uint32 priority);
 
-  AdnlNetworkManagerImpl(td::uint16 out_udp_port) : out_udp_port_(out_udp_port) {
+  AdnlNetworkManagerImpl(td::uint16 out_udp_port, td::uint32 receive_sockets)
+      : out_udp_port_(out_udp_port), receive_sockets_(std::max<td::uint32>(receive_sockets, 1)) {
   }
 
   void install_callback(std::unique_ptr<Callback> callback) override {
     callback_ = std::move(callback);
+    for (size_t idx = 0; idx < udp_sockets_.size(); idx++) {
+      update_receivers(idx);
+    }
   }
 
   void alarm() override;
@@ -114,6 +143,7 @@ class AdnlNetworkManagerImpl : public AdnlNetworkManager {
     for (size_t idx = 0; idx < in_desc_.size(); idx++) {
       if (in_desc_[idx] == desc) {
         in_desc_[idx].cat_mask |= desc.cat_mask;
+        update_receivers(socket_idx);
         return;
       }
     }
@@ -125,6 +155,7 @@ class AdnlNetworkManagerImpl : public AdnlNetworkManager {
       udp_sockets_[socket_idx].in_desc = in_desc_.size();
     }
     in_desc_.push_back(std::move(desc));
+    update_receivers(socket_idx);
   }
 
   void add_self_addr(td::IPAddress addr, AdnlCategoryMask cat_mask, td::uint32 priority) override;
@@ -142,11 +173,12 @@ class AdnlNetworkManagerImpl : public AdnlNetworkManager {
   }
 
   size_t add_listening_udp_port(td::uint16 port);
+  void update_receivers(size_t socket_idx);
   void receive_udp_message(td::UdpMessage message, size_t idx);
   void proxy_register(OutDesc &desc);
 
  private:
-  std::unique_ptr<Callback> callback_;
+  std::shared_ptr<Callback> callback_;
 
   std::map<td::uint32, std::vector<OutDesc>> out_desc_;
   std::vector<InDesc> in_desc_;
@@ -161,6 +193,7 @@ class AdnlNetworkManagerImpl : public AdnlNetworkManager {
   std::map<AdnlNodeIdShort, td::uint8> adnl_id_2_cat_;
 
   td::uint16 out_udp_port_;
+  td::uint32 receive_sockets_;
 };
 
 }  // namespace adnl
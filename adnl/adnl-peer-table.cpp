@@ -23,6 +23,7 @@
 
 #include "td/utils/tl_storers.h"
 #include "td/utils/crypto.h"
+#include "td/utils/Metrics.h"
 #include "td/utils/tl_parsers.h"
 #include "td/utils/Random.h"
 #include "td/db/RocksDb.h"
@@ -50,38 +51,68 @@ td::actor::ActorOwn<Adnl> Adnl::create(std::string db, td::actor::ActorId<keyrin
   return td::actor::ActorOwn<Adnl>(td::actor::create_actor<AdnlPeerTableImpl>("PeerTable", db, keyring));
 }
 
-void AdnlPeerTableImpl::receive_packet(td::IPAddress addr, AdnlCategoryMask cat_mask, td::BufferSlice data) {
+void AdnlInboundRoutes::Routes::receive_packet(td::IPAddress addr, AdnlCategoryMask cat_mask,
+                                               td::BufferSlice data) const {
+  AdnlPeerTableImpl::PrintId id;
+  static auto &packets_metric = td::get_metric<td::MetricCounter>("adnl_in_packets_total");
+  static auto &bytes_metric = td::get_metric<td::MetricCounter>("adnl_in_bytes_total");
+  static auto &dropped_metric = td::get_metric<td::MetricCounter>("adnl_in_dropped_total");
+  packets_metric.add();
+  bytes_metric.add(static_cast<td::int64>(data.size()));
   if (data.size() < 32) {
-    VLOG(ADNL_WARNING) << this << ": dropping IN message [?->?]: message too short: len=" << data.size();
+    VLOG(ADNL_WARNING) << id << ": dropping IN message [?->?]: message too short: len=" << data.size();
+    dropped_metric.add();
     return;
   }
 
   AdnlNodeIdShort dst{data.as_slice().truncate(32)};
   data.confirm_read(32);
 
-  auto it = local_ids_.find(dst);
-  if (it != local_ids_.end()) {
-    if (!cat_mask.test(it->second.cat)) {
-      VLOG(ADNL_WARNING) << this << ": dropping IN message [?->" << dst << "]: category mismatch";
+  auto it = local_ids->find(dst);
+  if (it != local_ids->end()) {
+    if (!cat_mask.test(it->second.second)) {
+      VLOG(ADNL_WARNING) << id << ": dropping IN message [?->" << dst << "]: category mismatch";
+      dropped_metric.add();
       return;
     }
-    td::actor::send_closure(it->second.local_id, &AdnlLocalId::receive, addr, std::move(data));
+    td::actor::send_closure(it->second.first, &AdnlLocalId::receive, addr, std::move(data));
     return;
   }
 
   AdnlChannelIdShort dst_chan_id{dst.pubkey_hash()};
-  auto it2 = channels_.find(dst_chan_id);
-  if (it2 != channels_.end()) {
+  auto &channels_shard = *channels[AdnlInboundRoutes::get_channel_shard(dst_chan_id)];
+  auto it2 = channels_shard.find(dst_chan_id);
+  if (it2 != channels_shard.end()) {
     if (!cat_mask.test(it2->second.second)) {
-      VLOG(ADNL_WARNING) << this << ": dropping IN message to channel [?->" << dst << "]: category mismatch";
+      VLOG(ADNL_WARNING) << id << ": dropping IN message to channel [?->" << dst << "]: category mismatch";
+      dropped_metric.add();
       return;
     }
     td::actor::send_closure(it2->second.first, &AdnlChannel::receive, addr, std::move(data));
     return;
   }
 
-  VLOG(ADNL_DEBUG) << this << ": dropping IN message [?->" << dst << "]: unknown dst " << dst
+  VLOG(ADNL_DEBUG) << id << ": dropping IN message [?->" << dst << "]: unknown dst " << dst
                    << " (len=" << (data.size() + 32) << ")";
+  dropped_metric.add();
+}
+
+void AdnlPeerTableImpl::receive_packet(td::IPAddress addr, AdnlCategoryMask cat_mask, td::BufferSlice data) {
+  inbound_routes_->get()->receive_packet(addr, std::move(cat_mask), std::move(data));
+}
+
+void AdnlPeerTableImpl::update_inbound_routes() {
+  // copies only pointers to the maps, the maps themselves are shared with the previous snapshot
+  inbound_routes_->set(std::make_shared<AdnlInboundRoutes::Routes>(routes_));
+}
+
+void AdnlPeerTableImpl::update_local_id_routes() {
+  auto local_ids = std::make_shared<AdnlInboundRoutes::LocalIds>();
+  for (auto &local_id : local_ids_) {
+    local_ids->emplace(local_id.first, std::make_pair(local_id.second.local_id.get(), local_id.second.cat));
+  }
+  routes_.local_ids = std::move(local_ids);
+  update_inbound_routes();
 }
 
 void AdnlPeerTableImpl::receive_decrypted_packet(AdnlNodeIdShort dst, AdnlPacket packet) {
@@ -210,6 +241,7 @@ void AdnlPeerTableImpl::add_id_ex(AdnlNodeIdFull id, AdnlAddressList addr_list,
       if (!network_manager_.empty()) {
         td::actor::send_closure(network_manager_, &AdnlNetworkManager::set_local_id_category, a, cat);
       }
+      update_local_id_routes();
     }
     td::actor::send_closure(it->second.local_id, &AdnlLocalId::update_address_list, std::move(addr_list));
   } else {
@@ -220,12 +252,14 @@ void AdnlPeerTableImpl::add_id_ex(AdnlNodeIdFull id, AdnlAddressList addr_list,
     if (!network_manager_.empty()) {
       td::actor::send_closure(network_manager_, &AdnlNetworkManager::set_local_id_category, a, cat);
     }
+    update_local_id_routes();
   }
 }
 
 void AdnlPeerTableImpl::del_id(AdnlNodeIdShort id, td::Promise<td::Unit> promise) {
   VLOG(ADNL_INFO) << "adnl: deleting local id " << id;
   local_ids_.erase(id);
+  update_local_id_routes();
   promise.set_value(td::Unit());
 }
 
@@ -261,16 +295,16 @@ void AdnlPeerTableImpl::register_network_manager(td::actor::ActorId<AdnlNetworkM
   class Cb : public AdnlNetworkManager::Callback {
    public:
     void receive_packet(td::IPAddress addr, AdnlCategoryMask cat_mask, td::BufferSlice data) override {
-      td::actor::send_closure(id_, &AdnlPeerTableImpl::receive_packet, addr, std::move(cat_mask), std::move(data));
+      routes_->get()->receive_packet(addr, std::move(cat_mask), std::move(data));
     }
-    Cb(td::actor::ActorId<AdnlPeerTableImpl> id) : id_(id) {
+    Cb(std::shared_ptr<AdnlInboundRoutes> routes) : routes_(std::move(routes)) {
     }
 
    private:
-    td::actor::ActorId<AdnlPeerTableImpl> id_;
+    std::shared_ptr<AdnlInboundRoutes> routes_;
   };
 
-  auto cb = std::make_unique<Cb>(actor_id(this));
+  auto cb = std::make_unique<Cb>(inbound_routes_);
   td::actor::send_closure(network_manager_, &AdnlNetworkManager::install_callback, std::move(cb));
 
   for (auto &id : local_ids_) {
@@ -300,13 +334,21 @@ void AdnlPeerTableImpl::register_channel(AdnlChannelIdShort id, AdnlNodeIdShort
                                          td::actor::ActorId<AdnlChannel> channel) {
   auto it = local_ids_.find(local_id);
   auto cat = (it != local_ids_.end()) ? it->second.cat : 255;
-  auto success = channels_.emplace(id, std::make_pair(channel, cat)).second;
+  auto &shard = routes_.channels[AdnlInboundRoutes::get_channel_shard(id)];
+  auto channels = std::make_shared<AdnlInboundRoutes::Channels>(*shard);
+  auto success = channels->emplace(id, std::make_pair(channel, cat)).second;
   CHECK(success);
+  shard = std::move(channels);
+  update_inbound_routes();
 }
 
 void AdnlPeerTableImpl::unregister_channel(AdnlChannelIdShort id) {
-  auto erased = channels_.erase(id);
+  auto &shard = routes_.channels[AdnlInboundRoutes::get_channel_shard(id)];
+  auto channels = std::make_shared<AdnlInboundRoutes::Channels>(*shard);
+  auto erased = channels->erase(id);
   CHECK(erased == 1);
+  shard = std::move(channels);
+  update_inbound_routes();
 }
 
 void AdnlPeerTableImpl::start_up() {
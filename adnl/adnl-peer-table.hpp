@@ -18,7 +18,10 @@
 */
 #pragma once
 
+#include <array>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 
 #include "adnl-peer-table.h"
@@ -36,6 +39,45 @@ namespace ton {
 
 namespace adnl {
 
+// destinations of inbound packets; the peer table publishes a new snapshot whenever local ids or channels change,
+// and the network manager callback dispatches packets by it directly, possibly from several receiving actors at once
+class AdnlInboundRoutes {
+ public:
+  using LocalIds = std::map<AdnlNodeIdShort, std::pair<td::actor::ActorId<AdnlLocalId>, td::uint8>>;
+  using Channels = std::map<AdnlChannelIdShort, std::pair<td::actor::ActorId<AdnlChannel>, td::uint8>>;
+
+  // channels are split into shards shared between snapshots, so that a new channel copies only its own shard
+  static constexpr size_t channel_shards = 64;
+  static size_t get_channel_shard(const AdnlChannelIdShort &id) {
+    return id.as_slice().ubegin()[0] % channel_shards;
+  }
+
+  struct Routes {
+    std::shared_ptr<const LocalIds> local_ids = std::make_shared<LocalIds>();
+    std::array<std::shared_ptr<const Channels>, channel_shards> channels;
+
+    Routes() {
+      for (auto &shard : channels) {
+        shard = std::make_shared<Channels>();
+      }
+    }
+    void receive_packet(td::IPAddress addr, AdnlCategoryMask cat_mask, td::BufferSlice data) const;
+  };
+
+  // called for every received packet, so it takes no lock
+  std::shared_ptr<const Routes> get() const {
+    return std::atomic_load(&routes_);
+  }
+  void set(std::shared_ptr<const Routes> routes) {
+    std::lock_guard<std::mutex> guard(writer_mutex_);
+    std::atomic_store(&routes_, std::move(routes));
+  }
+
+ private:
+  std::mutex writer_mutex_;
+  std::shared_ptr<const Routes> routes_ = std::make_shared<Routes>();
+};
+
 class AdnlPeerTableImpl : public AdnlPeerTable {
  public:
   AdnlPeerTableImpl(std::string db_root, td::actor::ActorId<keyring::Keyring> keyring);
@@ -121,10 +163,14 @@ class AdnlPeerTableImpl : public AdnlPeerTable {
   td::actor::ActorOwn<AdnlStaticNodesManager> static_nodes_manager_;
 
   void deliver_one_message(AdnlNodeIdShort src, AdnlNodeIdShort dst, AdnlMessage message);
+  void update_inbound_routes();
+  void update_local_id_routes();
 
   std::map<AdnlNodeIdShort, td::actor::ActorOwn<AdnlPeer>> peers_;
   std::map<AdnlNodeIdShort, LocalIdInfo> local_ids_;
-  std::map<AdnlChannelIdShort, std::pair<td::actor::ActorId<AdnlChannel>, td::uint8>> channels_;
+  // master copy of the routes published to inbound_routes_
+  AdnlInboundRoutes::Routes routes_;
+  std::shared_ptr<AdnlInboundRoutes> inbound_routes_ = std::make_shared<AdnlInboundRoutes>();
 
   td::actor::ActorOwn<AdnlDb> db_;
 
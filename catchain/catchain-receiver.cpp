@@ -20,7 +20,9 @@
 #include "td/actor/PromiseFuture.h"
 #include "td/utils/Random.h"
 #include "td/db/RocksDb.h"
+#include "td/db/BinlogKeyValue.h"
 #include "td/utils/port/path.h"
+#include "td/utils/port/Stat.h"
 #include "td/utils/overloaded.h"
 #include "common/delay.h"
 
@@ -533,9 +535,14 @@ void CatChainReceiverImpl::start_up() {
   CHECK(root_block_);
 
   if (!opts_.debug_disable_db) {
-    std::shared_ptr<td::KeyValue> kv = std::make_shared<td::RocksDb>(
-        td::RocksDb::open(db_root_ + "/catchainreceiver" + db_suffix_ + td::base64url_encode(as_slice(incarnation_)))
-            .move_as_ok());
+    std::shared_ptr<td::KeyValue> kv;
+    auto name = db_name();
+    if (td::stat(name).is_ok()) {
+      // the session was started by a version which kept catchain blocks in RocksDB
+      kv = std::make_shared<td::RocksDb>(td::RocksDb::open(name).move_as_ok());
+    } else {
+      kv = std::make_shared<td::BinlogKeyValue>(td::BinlogKeyValue::open(name + ".binlog").move_as_ok());
+    }
     db_ = DbType{std::move(kv)};
 
     auto P = td::PromiseCreator::lambda([SelfId = actor_id(this)](td::Result<DbType::GetResult> R) {
@@ -639,6 +646,12 @@ void CatChainReceiverImpl::read_block_from_db(CatChainBlockHash id, td::BufferSl
   }
 }
 
+// ===========================================================================================
+//
+std::string CatChainReceiverImpl::db_name() const {
+  return db_root_ + "/catchainreceiver" + db_suffix_ + td::base64url_encode(as_slice(incarnation_));
+}
+
 // ===========================================================================================
 //
 void CatChainReceiverImpl::read_db() {
@@ -1156,8 +1169,15 @@ static void destroy_db(std::string name, td::uint32 attempt) {
 // ===========================================================================================
 //
 void CatChainReceiverImpl::destroy() {
-  auto name = db_root_ + "/catchainreceiver" + db_suffix_ + td::base64url_encode(as_slice(incarnation_));
-  delay_action([name]() { destroy_db(name, 0); }, td::Timestamp::in(1.0));
+  auto name = db_name();
+  delay_action(
+      [name]() {
+        td::BinlogKeyValue::destroy(name + ".binlog").ignore();
+        if (td::stat(name).is_ok()) {
+          destroy_db(name, 0);
+        }
+      },
+      td::Timestamp::in(1.0));
   stop();
 }
 
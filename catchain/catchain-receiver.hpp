@@ -128,6 +128,7 @@ class CatChainReceiverImpl : public CatChainReceiver {
   void alarm() override;
   void start_up() override;
   void tear_down() override;
+  std::string db_name() const;
   void read_db();
   void read_db_from(CatChainBlockHash id);
   void read_block_from_db(CatChainBlockHash id, td::BufferSlice data);
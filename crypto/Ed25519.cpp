@@ -41,6 +41,13 @@
 
 #endif
 
+#include "td/utils/BigNum.h"
+#include "td/utils/crypto.h"
+#include "td/utils/Random.h"
+
+#include <algorithm>
+#include <cstring>
+
 namespace td {
 
 Ed25519::PublicKey::PublicKey(SecureString octet_string) : octet_string_(std::move(octet_string)) {
@@ -397,6 +404,128 @@ int Ed25519::version() {
 
 #endif
 
+Ed25519::PreparedPublicKey::PreparedPublicKey(Slice octet_string) : public_key_(SecureString(octet_string)) {
+  if (octet_string.size() != PublicKey::LENGTH) {
+    return;
+  }
+  std::memcpy(octet_string_, octet_string.ubegin(), PublicKey::LENGTH);
+  // keys with a small order component would make the cofactored combined check more permissive than
+  // verify_signature(), so their signatures are always checked one by one
+  can_batch_ = crypto::Ed25519::batch::decode_point(neg_point_, octet_string_) &&
+               crypto::Ed25519::batch::is_torsion_free(neg_point_);
+  if (can_batch_) {
+    crypto::Ed25519::batch::negate_point(neg_point_);
+  }
+}
+
+namespace detail {
+
+static BigNum bignum_from_le(Slice le) {
+  auto be = le.str();
+  std::reverse(be.begin(), be.end());
+  return BigNum::from_binary(be);
+}
+
+static void bignum_to_le(const BigNum &x, unsigned char le[32]) {
+  auto be = x.to_binary(32);
+  std::reverse_copy(be.begin(), be.end(), le);
+}
+
+}  // namespace detail
+
+// marks the entries verified by the combined check; on failure nothing is marked
+void Ed25519::verify_batch_combined(Span<BatchEntry> entries, std::vector<bool> &verified) {
+  constexpr size_t min_batch_size = 4;
+  using namespace crypto::Ed25519::batch;
+  if (entries.size() < min_batch_size || !is_supported()) {
+    return;
+  }
+  BigNumContext context;
+  auto order = BigNum::from_hex("1000000000000000000000000000000014def9dea2f79cd65812631a5cf5d3ed").move_as_ok();
+  BigNum base_scalar;
+  base_scalar.set_value(0);
+
+  std::vector<size_t> indices;
+  std::vector<Point> r_points;
+  std::vector<std::array<unsigned char, 32>> scalars;
+  r_points.reserve(entries.size());
+  scalars.reserve(entries.size() * 2 + 1);
+  std::string random(entries.size() * 16, '\0');
+  Random::secure_bytes(random);
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    auto &entry = entries[i];
+    auto public_key = entry.public_key;
+    if (!public_key->can_batch_ || entry.signature.size() != 64) {
+      continue;
+    }
+    // as for public keys, an R with a small order component would pass the cofactored check,
+    // so such signatures are left to verify_signature(), which rejects them
+    Point r_point;
+    if (!decode_point(r_point, entry.signature.ubegin()) || !is_torsion_free(r_point)) {
+      continue;
+    }
+    auto s = detail::bignum_from_le(entry.signature.substr(32));
+    if (BigNum::compare(s, order) >= 0) {
+      continue;
+    }
+    negate_point(r_point);
+    r_points.push_back(r_point);
+    indices.push_back(i);
+
+    // h = SHA512(R || A || M) mod l
+    std::string hash_input;
+    hash_input.reserve(64 + entry.data.size());
+    hash_input.append(entry.signature.begin(), 32);
+    hash_input.append(reinterpret_cast<const char *>(public_key->octet_string_), PublicKey::LENGTH);
+    hash_input.append(entry.data.begin(), entry.data.size());
+    auto hash = detail::bignum_from_le(sha512(hash_input));
+    BigNum h;
+    BigNum::div(nullptr, &h, hash, order, context);
+
+    // the signature contributes z * (s * B - R - h * A) with a random 128-bit z
+    auto z = detail::bignum_from_le(Slice(random).substr(i * 16, 16));
+    BigNum t;
+    BigNum::mod_mul(t, z, s, order, context);
+    BigNum::mod_add(base_scalar, base_scalar, t, order, context);
+    BigNum::mod_mul(t, z, h, order, context);
+    scalars.emplace_back();
+    detail::bignum_to_le(z, scalars.back().data());
+    scalars.emplace_back();
+    detail::bignum_to_le(t, scalars.back().data());
+  }
+  if (indices.size() < min_batch_size) {
+    return;
+  }
+  scalars.emplace_back();
+  detail::bignum_to_le(base_scalar, scalars.back().data());
+
+  std::vector<Term> terms;
+  terms.reserve(scalars.size());
+  for (size_t j = 0; j < indices.size(); j++) {
+    terms.push_back(Term{&r_points[j], scalars[2 * j].data()});
+    terms.push_back(Term{&entries[indices[j]].public_key->neg_point_, scalars[2 * j + 1].data()});
+  }
+  terms.push_back(Term{&base_point(), scalars.back().data()});
+  if (!is_zero_combination(terms, true)) {
+    return;
+  }
+  for (auto i : indices) {
+    verified[i] = true;
+  }
+}
+
+Status Ed25519::verify_batch(Span<BatchEntry> entries) {
+  std::vector<bool> verified(entries.size(), false);
+  verify_batch_combined(entries, verified);
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (!verified[i]) {
+      TRY_STATUS(entries[i].public_key->get_public_key().verify_signature(entries[i].data, entries[i].signature));
+    }
+  }
+  return Status::OK();
+}
+
 }  // namespace td
 
 #endif
@@ -20,8 +20,11 @@
 
 #include "td/utils/common.h"
 #include "td/utils/SharedSlice.h"
+#include "td/utils/Span.h"
 #include "td/utils/Status.h"
 
+#include "crypto/ellcurve/Ed25519Batch.h"
+
 #if TD_HAVE_OPENSSL
 
 namespace td {
@@ -62,11 +65,43 @@ class Ed25519 {
     SecureString octet_string_;
   };
 
+  // public key decoded in advance, for repeated use in verify_batch()
+  class PreparedPublicKey {
+   public:
+    explicit PreparedPublicKey(Slice octet_string);
+
+    const PublicKey &get_public_key() const {
+      return public_key_;
+    }
+
+   private:
+    friend class Ed25519;
+    PublicKey public_key_;
+    unsigned char octet_string_[PublicKey::LENGTH];
+    bool can_batch_{false};
+    crypto::Ed25519::batch::Point neg_point_;
+  };
+
+  struct BatchEntry {
+    const PreparedPublicKey *public_key;
+    Slice data;
+    Slice signature;
+  };
+
+  // Checks all signatures with one random linear combination. If the combined check fails, the signatures are
+  // checked one by one and the error for the first wrong one is returned.
+  // The combined check is cofactored, so signatures whose public key or R has a small order component
+  // are left out of it and checked one by one; the result is always the same as of verify_signature().
+  static Status verify_batch(Span<BatchEntry> entries);
+
   static Result<PrivateKey> generate_private_key();
 
   static Result<SecureString> compute_shared_secret(const PublicKey &public_key, const PrivateKey &private_key);
 
   static int version();
+
+ private:
+  static void verify_batch_combined(Span<BatchEntry> entries, std::vector<bool> &verified);
 };
 
 }  // namespace td
@@ -110,6 +110,76 @@ td::Result<std::unique_ptr<ConfigInfo>> ConfigInfo::extract_config(Ref<vm::Cell>
   return std::move(config);
 }
 
+ConfigInfoCache& ConfigInfoCache::get_default() {
+  static ConfigInfoCache cache;
+  return cache;
+}
+
+td::Result<std::shared_ptr<const ConfigInfo>> ConfigInfoCache::extract_config(Ref<vm::Cell> mc_state_root,
+                                                                              const ton::BlockIdExt& block_id,
+                                                                              int mode) {
+  if (mc_state_root.is_null()) {
+    return td::Status::Error("configuration state root cell is null");
+  }
+  bool cacheable = !mc_state_root->get_virtualization();
+  td::Bits256 root_hash = mc_state_root->get_hash().bits();
+  int cached_mode = 0;
+  if (cacheable) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    drop_expired();
+    auto it = std::find_if(entries_.begin(), entries_.end(), [&](const Entry& e) { return e.root_hash == root_hash; });
+    if (it != entries_.end() && (!block_id.is_valid() || it->config->block_id == block_id)) {
+      if ((it->config->mode & mode) == mode) {
+        auto config = it->config;
+        it->expires_at = td::Timestamp::in(max_age_);
+        std::rotate(it, it + 1, entries_.end());
+        return std::move(config);
+      }
+      cached_mode = it->config->mode;
+    }
+  }
+  TRY_RESULT(config, ConfigInfo::extract_config(std::move(mc_state_root), mode | cached_mode));
+  if (block_id.is_valid() && !config->set_block_id_ext(block_id)) {
+    return td::Status::Error(PSLICE() << "masterchain state does not belong to block " << block_id.to_str());
+  }
+  config->compute_dict_roots();
+  std::shared_ptr<const ConfigInfo> res = std::move(config);
+  if (cacheable) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = std::find_if(entries_.begin(), entries_.end(), [&](const Entry& e) { return e.root_hash == root_hash; });
+    if (it != entries_.end()) {
+      entries_.erase(it);
+    } else if (entries_.size() >= max_size_) {
+      entries_.erase(entries_.begin());
+    }
+    entries_.push_back(Entry{root_hash, res, td::Timestamp::in(max_age_)});
+  }
+  return std::move(res);
+}
+
+void ConfigInfoCache::drop_expired() {
+  entries_.erase(
+      std::remove_if(entries_.begin(), entries_.end(), [](const Entry& e) { return e.expires_at.is_in_past(); }),
+      entries_.end());
+}
+
+void ConfigInfoCache::clear() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  entries_.clear();
+}
+
+void ConfigInfo::compute_dict_roots() const {
+  Config::compute_dict_roots();
+  get_root_csr();
+  std::initializer_list<const vm::DictionaryBase*> dicts = {shard_hashes_dict.get(), libraries_dict_.get(),
+                                                            accounts_dict.get(), prev_blocks_dict_.get()};
+  for (auto dict : dicts) {
+    if (dict) {
+      dict->get_root();
+    }
+  }
+}
+
 ConfigInfo::ConfigInfo(Ref<vm::Cell> mc_state_root, int _mode) : Config(_mode), state_root(std::move(mc_state_root)) {
   block_id.root_hash.set_zero();
   block_id.file_hash.set_zero();
@@ -549,6 +619,14 @@ void ConfigInfo::cleanup() {
   }
 }
 
+void Config::compute_dict_roots() const {
+  for (const vm::DictionaryBase* dict : {config_dict.get(), workchains_dict_.get(), special_smc_dict.get()}) {
+    if (dict) {
+      dict->get_root();
+    }
+  }
+}
+
 Ref<vm::Cell> Config::get_config_param(int idx) const {
   if (!config_dict) {
     return {};
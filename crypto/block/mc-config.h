@@ -24,12 +24,14 @@
 #include "ton/ton-shard.h"
 #include "common/bitstring.h"
 #include "block.h"
+#include "td/utils/Time.h"
 
 #include <vector>
 #include <limits>
 #include <map>
 #include <set>
 #include <cstring>
+#include <mutex>
 
 namespace block {
 using td::Ref;
@@ -517,6 +519,8 @@ class Config {
   }
   Ref<vm::Cell> get_config_param(int idx) const;
   Ref<vm::Cell> get_config_param(int idx, int idx2) const;
+  // roots of dictionaries are computed lazily by const methods, this must be done before sharing between threads
+  void compute_dict_roots() const;
   Ref<vm::Cell> operator[](int idx) const {
     return get_config_param(idx);
   }
@@ -655,6 +659,7 @@ class ConfigInfo : public Config, public ShardConfig {
 
  public:
   bool set_block_id_ext(const ton::BlockIdExt& block_id_ext);
+  void compute_dict_roots() const;
   bool rotated_all_shards() const {
     return nx_cc_updated;
   }
@@ -710,4 +715,37 @@ class ConfigInfo : public Config, public ShardConfig {
   void cleanup();
 };
 
+/*
+ * unpacked configurations of recently used masterchain states, shared by all their users
+ * an entry is keyed by the hash of the state root and is unpacked with the union of all modes requested for it so far,
+ * so the returned object may contain more than requested
+ * roots of Merkle proofs (virtualized cells) are unpacked every time: they may lack cells present in the full state;
+ * for the same reason roots created by vm::MerkleProofBuilder must not be passed here at all
+ * an entry keeps its state root alive, so entries unused for max_age seconds are dropped
+ */
+class ConfigInfoCache {
+ public:
+  explicit ConfigInfoCache(size_t max_size = 4, double max_age = 60.0) : max_size_(max_size), max_age_(max_age) {
+  }
+  static ConfigInfoCache& get_default();
+
+  // block_id, if valid, must be the id of the block of this state; it is set into the returned object
+  td::Result<std::shared_ptr<const ConfigInfo>> extract_config(Ref<vm::Cell> mc_state_root,
+                                                               const ton::BlockIdExt& block_id, int mode = 0);
+  void clear();
+
+ private:
+  struct Entry {
+    td::Bits256 root_hash;
+    std::shared_ptr<const ConfigInfo> config;
+    td::Timestamp expires_at;
+  };
+  std::mutex mutex_;
+  std::vector<Entry> entries_;  // the most recently used is the last
+  size_t max_size_;
+  double max_age_;
+
+  void drop_expired();
+};
+
 }  // namespace block
@@ -0,0 +1,521 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#include "ellcurve/Ed25519Batch.h"
+
+#include <cstring>
+
+namespace crypto {
+namespace Ed25519 {
+namespace batch {
+
+#if TD_HAVE_INT128
+
+namespace {
+
+using td::uint64;
+typedef unsigned __int128 uint128;
+typedef FieldElement fe;
+
+const uint64 mask51 = (1ULL << 51) - 1;
+
+// order of the prime subgroup, little endian
+const unsigned char group_order[32] = {0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7,
+                                       0xa2, 0xde, 0xf9, 0xde, 0x14, 0,    0,    0,    0,    0,    0,
+                                       0,    0,    0,    0,    0,    0,    0,    0,    0,    0x10};
+
+uint64 load64(const unsigned char *s) {
+  uint64 r = 0;
+  for (int i = 7; i >= 0; i--) {
+    r = (r << 8) | s[i];
+  }
+  return r;
+}
+
+void store64(unsigned char *s, uint64 x) {
+  for (int i = 0; i < 8; i++) {
+    s[i] = static_cast<unsigned char>(x >> (8 * i));
+  }
+}
+
+void fe_set(fe &h, uint64 x) {
+  h.v[0] = x;
+  h.v[1] = h.v[2] = h.v[3] = h.v[4] = 0;
+}
+
+void fe_carry(fe &h) {
+  uint64 c;
+  c = h.v[0] >> 51, h.v[0] &= mask51, h.v[1] += c;
+  c = h.v[1] >> 51, h.v[1] &= mask51, h.v[2] += c;
+  c = h.v[2] >> 51, h.v[2] &= mask51, h.v[3] += c;
+  c = h.v[3] >> 51, h.v[3] &= mask51, h.v[4] += c;
+  c = h.v[4] >> 51, h.v[4] &= mask51, h.v[0] += 19 * c;
+}
+
+void fe_add(fe &h, const fe &f, const fe &g) {
+  for (int i = 0; i < 5; i++) {
+    h.v[i] = f.v[i] + g.v[i];
+  }
+  fe_carry(h);
+}
+
+// adds 4p before subtracting to stay positive; inputs are always carried, so their limbs are below 2^52
+void fe_sub(fe &h, const fe &f, const fe &g) {
+  h.v[0] = f.v[0] + 0x1fffffffffffb4ULL - g.v[0];
+  for (int i = 1; i < 5; i++) {
+    h.v[i] = f.v[i] + 0x1ffffffffffffcULL - g.v[i];
+  }
+  fe_carry(h);
+}
+
+void fe_neg(fe &h, const fe &f) {
+  fe zero;
+  fe_set(zero, 0);
+  fe_sub(h, zero, f);
+}
+
+void fe_reduce_wide(fe &h, uint128 r0, uint128 r1, uint128 r2, uint128 r3, uint128 r4) {
+  r1 += static_cast<uint64>(r0 >> 51);
+  r2 += static_cast<uint64>(r1 >> 51);
+  r3 += static_cast<uint64>(r2 >> 51);
+  r4 += static_cast<uint64>(r3 >> 51);
+  uint128 t = static_cast<uint128>(static_cast<uint64>(r4 >> 51)) * 19 + (static_cast<uint64>(r0) & mask51);
+  h.v[0] = static_cast<uint64>(t) & mask51;
+  h.v[1] = (static_cast<uint64>(r1) & mask51) + static_cast<uint64>(t >> 51);
+  h.v[2] = static_cast<uint64>(r2) & mask51;
+  h.v[3] = static_cast<uint64>(r3) & mask51;
+  h.v[4] = static_cast<uint64>(r4) & mask51;
+}
+
+void fe_mul(fe &h, const fe &f, const fe &g) {
+  uint64 f0 = f.v[0], f1 = f.v[1], f2 = f.v[2], f3 = f.v[3], f4 = f.v[4];
+  uint64 g0 = g.v[0], g1 = g.v[1], g2 = g.v[2], g3 = g.v[3], g4 = g.v[4];
+  uint64 g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4;
+  uint128 r0 = (uint128)f0 * g0 + (uint128)f1 * g4_19 + (uint128)f2 * g3_19 + (uint128)f3 * g2_19 + (uint128)f4 * g1_19;
+  uint128 r1 = (uint128)f0 * g1 + (uint128)f1 * g0 + (uint128)f2 * g4_19 + (uint128)f3 * g3_19 + (uint128)f4 * g2_19;
+  uint128 r2 = (uint128)f0 * g2 + (uint128)f1 * g1 + (uint128)f2 * g0 + (uint128)f3 * g4_19 + (uint128)f4 * g3_19;
+  uint128 r3 = (uint128)f0 * g3 + (uint128)f1 * g2 + (uint128)f2 * g1 + (uint128)f3 * g0 + (uint128)f4 * g4_19;
+  uint128 r4 = (uint128)f0 * g4 + (uint128)f1 * g3 + (uint128)f2 * g2 + (uint128)f3 * g1 + (uint128)f4 * g0;
+  fe_reduce_wide(h, r0, r1, r2, r3, r4);
+}
+
+void fe_sq(fe &h, const fe &f) {
+  uint64 f0 = f.v[0], f1 = f.v[1], f2 = f.v[2], f3 = f.v[3], f4 = f.v[4];
+  uint64 f0_2 = 2 * f0, f1_2 = 2 * f1, f1_38 = 38 * f1, f2_38 = 38 * f2, f3_38 = 38 * f3, f3_19 = 19 * f3,
+         f4_19 = 19 * f4;
+  uint128 r0 = (uint128)f0 * f0 + (uint128)f1_38 * f4 + (uint128)f2_38 * f3;
+  uint128 r1 = (uint128)f0_2 * f1 + (uint128)f2_38 * f4 + (uint128)f3_19 * f3;
+  uint128 r2 = (uint128)f0_2 * f2 + (uint128)f1 * f1 + (uint128)f3_38 * f4;
+  uint128 r3 = (uint128)f0_2 * f3 + (uint128)f1_2 * f2 + (uint128)f4_19 * f4;
+  uint128 r4 = (uint128)f0_2 * f4 + (uint128)f1_2 * f3 + (uint128)f2 * f2;
+  fe_reduce_wide(h, r0, r1, r2, r3, r4);
+}
+
+void fe_sqn(fe &h, const fe &f, int n) {
+  fe_sq(h, f);
+  while (--n > 0) {
+    fe_sq(h, h);
+  }
+}
+
+void fe_frombytes(fe &h, const unsigned char s[32]) {
+  h.v[0] = load64(s) & mask51;
+  h.v[1] = (load64(s + 6) >> 3) & mask51;
+  h.v[2] = (load64(s + 12) >> 6) & mask51;
+  h.v[3] = (load64(s + 19) >> 1) & mask51;
+  h.v[4] = (load64(s + 24) >> 12) & mask51;
+}
+
+void fe_tobytes(unsigned char s[32], const fe &f) {
+  fe h = f;
+  fe_carry(h);
+  fe_carry(h);
+  // now h < 2^255 + 19; q = 1 iff h >= p
+  uint64 q = (h.v[0] + 19) >> 51;
+  q = (h.v[1] + q) >> 51;
+  q = (h.v[2] + q) >> 51;
+  q = (h.v[3] + q) >> 51;
+  q = (h.v[4] + q) >> 51;
+  h.v[0] += 19 * q;
+  h.v[1] += h.v[0] >> 51, h.v[0] &= mask51;
+  h.v[2] += h.v[1] >> 51, h.v[1] &= mask51;
+  h.v[3] += h.v[2] >> 51, h.v[2] &= mask51;
+  h.v[4] += h.v[3] >> 51, h.v[3] &= mask51;
+  h.v[4] &= mask51;
+  store64(s, h.v[0] | (h.v[1] << 51));
+  store64(s + 8, (h.v[1] >> 13) | (h.v[2] << 38));
+  store64(s + 16, (h.v[2] >> 26) | (h.v[3] << 25));
+  store64(s + 24, (h.v[3] >> 39) | (h.v[4] << 12));
+}
+
+bool fe_is_zero(const fe &f) {
+  unsigned char s[32];
+  fe_tobytes(s, f);
+  unsigned char acc = 0;
+  for (auto c : s) {
+    acc |= c;
+  }
+  return !acc;
+}
+
+bool fe_is_negative(const fe &f) {
+  unsigned char s[32];
+  fe_tobytes(s, f);
+  return s[0] & 1;
+}
+
+bool fe_equal(const fe &f, const fe &g) {
+  fe d;
+  fe_sub(d, f, g);
+  return fe_is_zero(d);
+}
+
+// z^(2^250 - 1), also returns z^11 in z11
+void fe_pow2_250_1(fe &h, fe &z11, const fe &z) {
+  fe t0, t1, t2;
+  fe_sq(t0, z);         // 2
+  fe_sqn(t1, t0, 2);    // 8
+  fe_mul(t1, z, t1);    // 9
+  fe_mul(z11, t0, t1);  // 11
+  fe_sq(t0, z11);       // 22
+  fe_mul(t0, t1, t0);   // 2^5 - 1
+  fe_sqn(t1, t0, 5);    // 2^10 - 2^5
+  fe_mul(t0, t1, t0);   // 2^10 - 1
+  fe_sqn(t1, t0, 10);   // 2^20 - 2^10
+  fe_mul(t1, t1, t0);   // 2^20 - 1
+  fe_sqn(t2, t1, 20);   // 2^40 - 2^20
+  fe_mul(t1, t2, t1);   // 2^40 - 1
+  fe_sqn(t1, t1, 10);   // 2^50 - 2^10
+  fe_mul(t0, t1, t0);   // 2^50 - 1
+  fe_sqn(t1, t0, 50);   // 2^100 - 2^50
+  fe_mul(t1, t1, t0);   // 2^100 - 1
+  fe_sqn(t2, t1, 100);  // 2^200 - 2^100
+  fe_mul(t1, t2, t1);   // 2^200 - 1
+  fe_sqn(t1, t1, 50);   // 2^250 - 2^50
+  fe_mul(h, t1, t0);    // 2^250 - 1
+}
+
+// z^(p - 2) = z^(2^255 - 21)
+void fe_invert(fe &h, const fe &z) {
+  fe t, z11;
+  fe_pow2_250_1(t, z11, z);
+  fe_sqn(t, t, 5);
+  fe_mul(h, t, z11);
+}
+
+// z^((p - 5) / 8) = z^(2^252 - 3)
+void fe_pow22523(fe &h, const fe &z) {
+  fe t, z11;
+  fe_pow2_250_1(t, z11, z);
+  fe_sqn(t, t, 2);
+  fe_mul(h, t, z);
+}
+
+struct Constants {
+  fe one, d, d2, sqrtm1;
+  Point base;
+};
+
+struct Cached {
+  fe YplusX, YminusX, Z2, T2d;
+};
+
+const Constants &constants();
+
+void set_neutral(Point &P) {
+  fe_set(P.X, 0);
+  fe_set(P.Y, 1);
+  fe_set(P.Z, 1);
+  fe_set(P.T, 0);
+}
+
+bool is_neutral(const Point &P) {
+  return fe_is_zero(P.X) && fe_equal(P.Y, P.Z);
+}
+
+void to_cached(Cached &c, const Point &P) {
+  fe_add(c.YplusX, P.Y, P.X);
+  fe_sub(c.YminusX, P.Y, P.X);
+  fe_add(c.Z2, P.Z, P.Z);
+  fe_mul(c.T2d, P.T, constants().d2);
+}
+
+// R = P + Q, complete for all inputs
+void add_cached(Point &R, const Point &P, const Cached &Q, bool subtract = false) {
+  fe a, b, c, d, e, f, g, h;
+  fe_sub(a, P.Y, P.X);
+  fe_mul(a, a, subtract ? Q.YplusX : Q.YminusX);
+  fe_add(b, P.Y, P.X);
+  fe_mul(b, b, subtract ? Q.YminusX : Q.YplusX);
+  fe_mul(c, P.T, Q.T2d);
+  fe_mul(d, P.Z, Q.Z2);
+  fe_sub(e, b, a);
+  fe_add(h, b, a);
+  if (subtract) {
+    fe_add(f, d, c);
+    fe_sub(g, d, c);
+  } else {
+    fe_sub(f, d, c);
+    fe_add(g, d, c);
+  }
+  fe_mul(R.X, e, f);
+  fe_mul(R.Y, g, h);
+  fe_mul(R.T, e, h);
+  fe_mul(R.Z, f, g);
+}
+
+void double_point(Point &R, const Point &P) {
+  fe a, b, c, e, f, g, h;
+  fe_sq(a, P.X);
+  fe_sq(b, P.Y);
+  fe_sq(c, P.Z);
+  fe_add(c, c, c);
+  fe_add(h, a, b);
+  fe_add(e, P.X, P.Y);
+  fe_sq(e, e);
+  fe_sub(e, h, e);
+  fe_sub(g, a, b);
+  fe_add(f, c, g);
+  fe_mul(R.X, e, f);
+  fe_mul(R.Y, g, h);
+  fe_mul(R.T, e, h);
+  fe_mul(R.Z, f, g);
+}
+
+bool decode_point_with(Point &P, const unsigned char s[32], const fe &d, const fe &sqrtm1) {
+  fe y, u, v, v3, x, vxx, chk;
+  fe_frombytes(y, s);
+  unsigned char enc[32];
+  fe_tobytes(enc, y);
+  if (std::memcmp(enc, s, 31) || enc[31] != (s[31] & 0x7f)) {
+    return false;
+  }
+  fe one;
+  fe_set(one, 1);
+  fe_sq(u, y);
+  fe_mul(v, u, d);
+  fe_sub(u, u, one);  // y^2 - 1
+  fe_add(v, v, one);  // d y^2 + 1
+  fe_sq(v3, v);
+  fe_mul(v3, v3, v);  // v^3
+  fe_sq(x, v3);
+  fe_mul(x, x, v);
+  fe_mul(x, x, u);  // u v^7
+  fe_pow22523(x, x);
+  fe_mul(x, x, v3);
+  fe_mul(x, x, u);  // u v^3 (u v^7)^((p - 5) / 8)
+  fe_sq(vxx, x);
+  fe_mul(vxx, vxx, v);
+  fe_sub(chk, vxx, u);
+  if (!fe_is_zero(chk)) {
+    fe_add(chk, vxx, u);
+    if (!fe_is_zero(chk)) {
+      return false;
+    }
+    fe_mul(x, x, sqrtm1);
+  }
+  bool sign = s[31] >> 7;
+  if (sign && fe_is_zero(x)) {
+    return false;
+  }
+  if (fe_is_negative(x) != sign) {
+    fe_neg(x, x);
+  }
+  P.X = x;
+  P.Y = y;
+  fe_set(P.Z, 1);
+  fe_mul(P.T, x, y);
+  return true;
+}
+
+Constants make_constants() {
+  Constants c;
+  fe t;
+  fe_set(c.one, 1);
+  // d = -121665 / 121666
+  fe_set(t, 121666);
+  fe_invert(t, t);
+  fe_set(c.d, 121665);
+  fe_mul(c.d, c.d, t);
+  fe_neg(c.d, c.d);
+  fe_add(c.d2, c.d, c.d);
+  // sqrt(-1) = 2^((p - 1) / 4), (p - 1) / 4 = 2^253 - 5
+  fe two;
+  fe_set(two, 2);
+  fe_set(c.sqrtm1, 1);
+  for (int i = 252; i >= 0; i--) {
+    fe_sq(c.sqrtm1, c.sqrtm1);
+    if (i != 2) {
+      fe_mul(c.sqrtm1, c.sqrtm1, two);
+    }
+  }
+  // base point: y = 4 / 5, x even
+  fe_set(t, 5);
+  fe_invert(t, t);
+  fe_set(two, 4);
+  fe_mul(t, t, two);
+  unsigned char enc[32];
+  fe_tobytes(enc, t);
+  bool ok = decode_point_with(c.base, enc, c.d, c.sqrtm1);
+  (void)ok;
+  return c;
+}
+
+const Constants &constants() {
+  static const Constants c = make_constants();
+  return c;
+}
+
+// signed sliding window recoding, digits are odd and lie in [-15, 15]
+void slide(signed char r[256], const unsigned char a[32]) {
+  for (int i = 0; i < 256; i++) {
+    r[i] = static_cast<signed char>(1 & (a[i >> 3] >> (i & 7)));
+  }
+  for (int i = 0; i < 256; i++) {
+    if (!r[i]) {
+      continue;
+    }
+    for (int b = 1; b <= 6 && i + b < 256; b++) {
+      if (!r[i + b]) {
+        continue;
+      }
+      if (r[i] + (r[i + b] << b) <= 15) {
+        r[i] = static_cast<signed char>(r[i] + (r[i + b] << b));
+        r[i + b] = 0;
+      } else if (r[i] - (r[i + b] << b) >= -15) {
+        r[i] = static_cast<signed char>(r[i] - (r[i + b] << b));
+        for (int k = i + b; k < 256; k++) {
+          if (!r[k]) {
+            r[k] = 1;
+            break;
+          }
+          r[k] = 0;
+        }
+      } else {
+        break;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+bool is_supported() {
+  return true;
+}
+
+bool decode_point(Point &P, const unsigned char s[32]) {
+  auto &c = constants();
+  return decode_point_with(P, s, c.d, c.sqrtm1);
+}
+
+void negate_point(Point &P) {
+  fe_neg(P.X, P.X);
+  fe_neg(P.T, P.T);
+}
+
+bool is_torsion_free(const Point &P) {
+  return is_zero_combination({{&P, group_order}}, false);
+}
+
+bool is_zero_combination(const std::vector<Term> &terms, bool clear_cofactor) {
+  auto n = terms.size();
+  // interleaved sliding windows (Straus): one shared chain of doublings, tables of odd multiples 1P, 3P, ..., 15P
+  std::vector<signed char> digits(n * 256);
+  std::vector<Cached> tables(n * 8);
+  int top = -1;
+  for (std::size_t j = 0; j < n; j++) {
+    if (terms[j].scalar[31] >= 0x20) {
+      return false;
+    }
+    signed char *r = &digits[j * 256];
+    slide(r, terms[j].scalar);
+    for (int i = 255; i > top; i--) {
+      if (r[i]) {
+        top = i;
+        break;
+      }
+    }
+    const Point &P = *terms[j].point;
+    Cached *table = &tables[j * 8];
+    Point P2, cur = P;
+    Cached c2;
+    double_point(P2, P);
+    to_cached(c2, P2);
+    to_cached(table[0], P);
+    for (int k = 1; k < 8; k++) {
+      add_cached(cur, cur, c2);
+      to_cached(table[k], cur);
+    }
+  }
+  Point R;
+  set_neutral(R);
+  for (int i = top; i >= 0; i--) {
+    double_point(R, R);
+    for (std::size_t j = 0; j < n; j++) {
+      int d = digits[j * 256 + i];
+      if (d > 0) {
+        add_cached(R, R, tables[j * 8 + d / 2]);
+      } else if (d < 0) {
+        add_cached(R, R, tables[j * 8 + (-d) / 2], true);
+      }
+    }
+  }
+  if (clear_cofactor) {
+    double_point(R, R);
+    double_point(R, R);
+    double_point(R, R);
+  }
+  return is_neutral(R);
+}
+
+const Point &base_point() {
+  return constants().base;
+}
+
+#else
+
+bool is_supported() {
+  return false;
+}
+
+bool decode_point(Point &P, const unsigned char s[32]) {
+  return false;
+}
+
+void negate_point(Point &P) {
+}
+
+bool is_torsion_free(const Point &P) {
+  return false;
+}
+
+bool is_zero_combination(const std::vector<Term> &terms, bool clear_cofactor) {
+  return false;
+}
+
+const Point &base_point() {
+  static const Point P{};
+  return P;
+}
+
+#endif
+
+}  // namespace batch
+}  // namespace Ed25519
+}  // namespace crypto
@@ -0,0 +1,61 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#pragma once
+#include "td/utils/int_types.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace crypto {
+namespace Ed25519 {
+namespace batch {
+
+// Variable-time arithmetic on the Ed25519 curve used for batch signature verification.
+// Field elements are stored as five 51-bit limbs, points in extended twisted Edwards coordinates.
+// Everything here works with public data only.
+
+struct FieldElement {
+  td::uint64 v[5];
+};
+
+struct Point {
+  FieldElement X, Y, Z, T;
+};
+
+// false if this build has no 128-bit integer arithmetic; all other functions then fail
+bool is_supported();
+
+const Point &base_point();
+// decodes a canonically encoded point
+bool decode_point(Point &P, const unsigned char s[32]);
+void negate_point(Point &P);
+// checks that P lies in the prime order subgroup
+bool is_torsion_free(const Point &P);
+
+struct Term {
+  const Point *point;
+  const unsigned char *scalar;  // 32 bytes, little endian, less than 2^253
+};
+
+// checks that sum(scalar_i * P_i) (multiplied by the cofactor if clear_cofactor is set) is the neutral element
+bool is_zero_combination(const std::vector<Term> &terms, bool clear_cofactor);
+
+}  // namespace batch
+}  // namespace Ed25519
+}  // namespace crypto
@@ -17,14 +17,19 @@
     Copyright 2017-2020 Telegram Systems LLP
 */
 #include "crypto/Ed25519.h"
+#include "crypto/ellcurve/TwEdwards.h"
+#include "openssl/digest.hpp"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/tests.h"
 #include "td/utils/JsonBuilder.h"
+#include "td/utils/Time.h"
 
 #include "wycheproof.h"
 
+#include <cstring>
 #include <string>
 #include <utility>
 
@@ -147,8 +152,147 @@ TEST(Crypto, ed25519) {
 */
 }
 
+struct BatchSamples {
+  std::vector<td::Ed25519::PreparedPublicKey> keys;
+  std::vector<std::string> messages;
+  std::vector<td::SecureString> signatures;
+
+  explicit BatchSamples(int n) {
+    keys.reserve(n);
+    for (int i = 0; i < n; i++) {
+      auto private_key = td::Ed25519::generate_private_key().move_as_ok();
+      keys.emplace_back(private_key.get_public_key().move_as_ok().as_octet_string());
+      messages.push_back(PSTRING() << "message " << i);
+      signatures.push_back(private_key.sign(messages.back()).move_as_ok());
+    }
+  }
+
+  std::vector<td::Ed25519::BatchEntry> entries() const {
+    std::vector<td::Ed25519::BatchEntry> res;
+    for (size_t i = 0; i < keys.size(); i++) {
+      res.push_back({&keys[i], messages[i], signatures[i]});
+    }
+    return res;
+  }
+};
+
+TEST(Crypto, ed25519_batch) {
+  using namespace crypto::Ed25519::batch;
+  ASSERT_TRUE(is_torsion_free(base_point()));
+  // (0, -1) has order 2
+  unsigned char minus_one[32] = {0xec};
+  std::memset(minus_one + 1, 0xff, 30);
+  minus_one[31] = 0x7f;
+  Point P;
+  ASSERT_TRUE(decode_point(P, minus_one));
+  ASSERT_TRUE(!is_torsion_free(P));
+  // y = p is not a canonical encoding of 0
+  minus_one[0] = 0xed;
+  ASSERT_TRUE(!decode_point(P, minus_one));
+
+  BatchSamples samples(32);
+  td::Ed25519::verify_batch(samples.entries()).ensure();
+  for (size_t i : {0, 13, 31}) {
+    for (size_t byte : {0, 40}) {
+      auto entries = samples.entries();
+      auto signature = samples.signatures[i].copy();
+      signature.as_mutable_slice()[byte] ^= 1;
+      entries[i].signature = signature;
+      td::Ed25519::verify_batch(entries).ensure_error();
+    }
+    auto entries = samples.entries();
+    entries[i].data = "another message";
+    td::Ed25519::verify_batch(entries).ensure_error();
+    entries = samples.entries();
+    entries[i].public_key = &samples.keys[(i + 1) % samples.keys.size()];
+    td::Ed25519::verify_batch(entries).ensure_error();
+  }
+}
+
+// R = r * B + T with T of order 2 satisfies the cofactored equation, but not the one checked by verify_signature()
+TEST(Crypto, ed25519_batch_small_order_r) {
+  auto &E = ellcurve::Ed25519();
+  const auto &L = E.get_ell();
+  unsigned char random[64];
+  td::Random::secure_bytes(td::MutableSlice(random, sizeof(random)));
+  arith::Bignum a, r;
+  a.import_lsb(random, 32);
+  a %= L;
+  r.import_lsb(random + 32, 32);
+  r %= L;
+  unsigned char public_key[32];
+  CHECK(E.power_gen(a).export_point(public_key));
+  td::Ed25519::PreparedPublicKey key(td::Slice(public_key, sizeof(public_key)));
+
+  unsigned char minus_one[32] = {0xec};
+  std::memset(minus_one + 1, 0xff, 30);
+  minus_one[31] = 0x7f;
+  bool ok = false;
+  auto T = E.import_point(minus_one, ok);
+  CHECK(ok);
+
+  std::string message = "small order R";
+  auto sign = [&](bool add_torsion) {
+    std::string signature(64, '\0');
+    auto *sig = reinterpret_cast<unsigned char *>(&signature[0]);
+    auto R = E.power_gen(r);
+    if (add_torsion) {
+      R = E.add_points(R, T);
+    }
+    CHECK(R.export_point(sig));
+    unsigned char hash[64];
+    digest::SHA512 hasher(sig, 32);
+    hasher.feed(public_key, sizeof(public_key));
+    hasher.feed(message.data(), message.size());
+    hasher.extract(hash);
+    arith::Bignum S;
+    S.import_lsb(hash, 64);
+    S %= L;
+    S *= a;
+    S += r;
+    S %= L;
+    S.export_lsb(sig + 32, 32);
+    return signature;
+  };
+
+  BatchSamples samples(7);
+  for (bool add_torsion : {false, true}) {
+    auto signature = sign(add_torsion);
+    ASSERT_EQ(!add_torsion, key.get_public_key().verify_signature(message, signature).is_ok());
+    std::vector<td::Ed25519::BatchEntry> single{{&key, message, signature}};
+    ASSERT_EQ(!add_torsion, td::Ed25519::verify_batch(single).is_ok());
+    for (size_t pos : {0, 3, 7}) {
+      auto entries = samples.entries();
+      entries.insert(entries.begin() + pos, {&key, message, signature});
+      ASSERT_EQ(!add_torsion, td::Ed25519::verify_batch(entries).is_ok());
+    }
+  }
+}
+
+TEST(Crypto, BenchEd25519Batch) {
+  BatchSamples samples(100);
+  auto entries = samples.entries();
+  const int iterations = 20;
+  auto start = td::Time::now();
+  for (int i = 0; i < iterations; i++) {
+    for (auto &entry : entries) {
+      entry.public_key->get_public_key().verify_signature(entry.data, entry.signature).ensure();
+    }
+  }
+  auto single = td::Time::now() - start;
+  start = td::Time::now();
+  for (int i = 0; i < iterations; i++) {
+    td::Ed25519::verify_batch(entries).ensure();
+  }
+  auto batch = td::Time::now() - start;
+  LOG(ERROR) << "verify " << entries.size() << " signatures: one by one " << single / iterations * 1e3
+             << "ms, batch " << batch / iterations * 1e3 << "ms";
+}
+
 TEST(Crypto, wycheproof) {
   std::vector<std::pair<std::string, std::string>> bad_tests;
+  std::vector<std::string> batch_mismatch;
+  BatchSamples samples(4);
   auto json_str = wycheproof_ed25519();
   auto value = td::json_decode(json_str).move_as_ok();
   auto &root = value.get_object();
@@ -174,6 +318,7 @@ TEST(Crypto, wycheproof) {
     auto sk_str = td::get_json_object_string_field(key_o.get_object(), "sk", false).move_as_ok();
     auto pk_str = td::get_json_object_string_field(key_o.get_object(), "pk", false).move_as_ok();
     auto pk = td::Ed25519::PublicKey(td::SecureString(from_hex(pk_str)));
+    auto prepared_pk = td::Ed25519::PreparedPublicKey(from_hex(pk_str));
     auto sk = td::Ed25519::PrivateKey(td::SecureString(from_hex(sk_str)));
     CHECK(sk.get_public_key().move_as_ok().as_octet_string().as_slice() == pk.as_octet_string().as_slice());
 
@@ -195,8 +340,16 @@ TEST(Crypto, wycheproof) {
       if (result != has_result) {
         bad_tests.push_back({id, comment});
       }
+      auto entries = samples.entries();
+      entries.push_back({&prepared_pk, msg, sig});
+      if (td::Ed25519::verify_batch(entries).is_ok() != pk.verify_signature(msg, sig).is_ok()) {
+        batch_mismatch.push_back(id);
+      }
     }
   }
+  if (!batch_mismatch.empty()) {
+    LOG(FATAL) << "batch verification mismatch: " << td::format::as_array(batch_mismatch);
+  }
   if (bad_tests.empty()) {
     return;
   }
@@ -25,6 +25,7 @@
 #include "vm/cells/MerkleUpdate.h"
 #include "vm/db/CellStorage.h"
 #include "vm/db/CellHashTable.h"
+#include "vm/db/CellCache.h"
 #include "vm/db/TonDb.h"
 #include "vm/db/StaticBagOfCellsDb.h"
 
@@ -568,6 +569,49 @@ TEST(Cell, MerkleProofCombine) {
   }
 };
 
+TEST(Cell, UsageTreeLoadRecorder) {
+  td::Random::Xorshift128plus rnd{123};
+  for (int t = 0; t < 100; t++) {
+    auto cell = gen_random_cell(rnd.fast(1, 1000), rnd, true);
+    std::vector<CellExplorer::Exploration> explorations;
+    for (int i = 0; i < 3; i++) {
+      explorations.push_back(CellExplorer::random_explore(cell, rnd));
+    }
+
+    Ref<Cell> expected;
+    {
+      auto usage_tree = std::make_shared<CellUsageTree>();
+      auto usage_cell = UsageCell::create(cell, usage_tree->root_ptr());
+      CellExplorer::explore(usage_cell, explorations[0].ops);
+      CellExplorer::explore(usage_cell, explorations[2].ops);
+      expected = MerkleProof::generate(cell, usage_tree.get());
+    }
+
+    // explore concurrently with recorded loads, then apply only two of the logs
+    auto usage_tree = std::make_shared<CellUsageTree>();
+    auto usage_cell = UsageCell::create(cell, usage_tree->root_ptr());
+    std::vector<CellUsageTree::LoadLog> logs(explorations.size());
+    std::vector<std::string> exploration_logs(explorations.size());
+    std::vector<td::thread> threads;
+    for (std::size_t i = 0; i < explorations.size(); i++) {
+      threads.emplace_back([&, i] {
+        CellUsageTree::LoadRecorder recorder{usage_tree.get(), logs[i]};
+        exploration_logs[i] = CellExplorer::explore(usage_cell, explorations[i].ops).log;
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    for (std::size_t i = 0; i < explorations.size(); i++) {
+      ASSERT_EQ(explorations[i].log, exploration_logs[i]);
+    }
+    usage_tree->apply(logs[2]);
+    usage_tree->apply(logs[0]);
+    auto proof = MerkleProof::generate(cell, usage_tree.get());
+    ASSERT_EQ(expected->get_hash(), proof->get_hash());
+  }
+}
+
 int X = 20;
 Ref<Cell> gen_random_cell(int size, Ref<Cell> from, td::Random::Xorshift128plus &rnd,
                           bool with_prunned_branches = true) {
@@ -762,6 +806,68 @@ TEST(TonDb, BocMultipleRoots) {
   }
 };
 
+TEST(TonDb, BocSerializeToFile) {
+  td::Random::Xorshift128plus rnd{123};
+  std::string path = "boc_serialize_to_file";
+  SCOPE_EXIT {
+    td::unlink(path).ignore();
+  };
+  for (int t = 0; t < 100; t++) {
+    // the last cell is large enough to be flushed in several chunks
+    auto cell = gen_random_cell(t + 1 == 100 ? 30000 : rnd.fast(1, 1000), rnd);
+    auto mode = get_random_serialization_mode(rnd);
+    auto serialized = serialize_boc(cell, mode);
+
+    auto fd = td::FileFd::open(path, td::FileFd::Write | td::FileFd::Create | td::FileFd::Truncate).move_as_ok();
+    vm::std_boc_serialize_to_file(std::move(cell), fd, mode).ensure();
+    fd.close();
+
+    ASSERT_EQ(serialized, td::read_file_str(path).move_as_ok());
+  }
+};
+
+TEST(TonDb, BocSerializeToFileLazy) {
+  td::Random::Xorshift128plus rnd{123};
+  std::string path = "boc_serialize_to_file_lazy";
+  SCOPE_EXIT {
+    td::unlink(path).ignore();
+  };
+  for (int t = 0; t < 20; t++) {
+    auto kv = std::make_shared<td::MemoryKeyValue>();
+    auto dboc = DynamicBagOfCellsDb::create();
+    dboc->set_loader(std::make_unique<CellLoader>(kv));
+    auto cell = gen_random_cell(rnd.fast(1, 1000), rnd);
+    dboc->inc(cell);
+    dboc->prepare_commit();
+    {
+      CellStorer cell_storer(*kv);
+      dboc->commit(cell_storer);
+    }
+    auto mode = get_random_serialization_mode(rnd);
+    auto serialized = serialize_boc(cell, mode);
+
+    CellLoader loader(kv);
+    int loads = 0;
+    auto load_cell = [&](td::Slice hash) {
+      loads++;
+      return loader.load_detached(hash);
+    };
+    auto fd = td::FileFd::open(path, td::FileFd::Write | td::FileFd::Create | td::FileFd::Truncate).move_as_ok();
+    vm::std_boc_serialize_to_file_lazy(cell, load_cell, fd, mode).ensure();
+    fd.close();
+    ASSERT_EQ(serialized, td::read_file_str(path).move_as_ok());
+    // every cell is loaded once to build the bag and once more to write it
+    ASSERT_EQ(2 * kv->count("").move_as_ok(), static_cast<size_t>(loads));
+
+    // a cell missing in the db fails the serialization
+    auto bad_fd = td::FileFd::open(path, td::FileFd::Write | td::FileFd::Create | td::FileFd::Truncate).move_as_ok();
+    ASSERT_TRUE(vm::std_boc_serialize_to_file_lazy(
+                    cell, [](td::Slice) -> td::Result<Ref<DataCell>> { return td::Status::Error("not found"); },
+                    bad_fd, mode)
+                    .is_error());
+  }
+};
+
 TEST(TonDb, DynamicBoc) {
   td::Random::Xorshift128plus rnd{123};
   std::string old_root_hash;
@@ -893,6 +999,122 @@ TEST(TonDb, DynamicBoc2) {
   ASSERT_EQ(0u, kv->count("").ok());
 }
 
+TEST(TonDb, DynamicBocCellCache) {
+  td::Random::Xorshift128plus rnd{123};
+  std::string old_root_hash;
+  std::string old_root_serialization;
+  auto kv = std::make_shared<td::MemoryKeyValue>();
+  auto cell_cache = std::make_shared<CellCache>(1 << 20);
+  auto dboc = DynamicBagOfCellsDb::create(cell_cache);
+  auto set_loader = [&] {
+    dboc->set_loader(std::make_unique<CellLoader>(kv));
+    // the writer moves the cache to the snapshot after its commit
+    cell_cache->set_loader(std::make_shared<CellLoader>(kv));
+  };
+  set_loader();
+
+  // roots are loaded bypassing the cache, their children are loaded through it
+  auto kept_child = gen_random_cell(3, rnd);
+  auto kept_root = CellBuilder().store_ref(kept_child).finalize();
+  auto kept_root_hash = kept_root->get_hash().as_slice().str();
+  dboc->inc(kept_root);
+  for (int t = 100; t >= 0; t--) {
+    Ref<Cell> old_root;
+    if (!old_root_hash.empty()) {
+      // second reader over the same db must be served from the shared cache
+      std::vector<std::unique_ptr<DynamicBagOfCellsDb>> readers;
+      for (int i = 0; i < 2; i++) {
+        readers.push_back(DynamicBagOfCellsDb::create(cell_cache));
+        readers.back()->set_loader(std::make_unique<CellLoader>(kv));
+      }
+      for (auto &reader : readers) {
+        old_root = reader->load_cell(old_root_hash).move_as_ok();
+        ASSERT_EQ(old_root_serialization, serialize_boc(old_root));
+      }
+      ASSERT_TRUE(cell_cache->get_stats().memory <= (1 << 20));
+
+      // cached cells survive snapshot swaps
+      if (t != 99) {
+        ASSERT_TRUE(cell_cache->get(kept_child->get_hash().as_slice()).not_null());
+      }
+      ASSERT_EQ(serialize_boc(kept_root), serialize_boc(readers[0]->load_cell(kept_root_hash).move_as_ok()));
+    }
+
+    auto cell = gen_random_cell(rnd.fast(1, 1000), rnd);
+    old_root_hash = cell->get_hash().as_slice().str();
+    old_root_serialization = serialize_boc(cell);
+
+    dboc->dec(old_root);
+    if (t != 0) {
+      dboc->inc(cell);
+    } else {
+      dboc->dec(kept_root);
+    }
+    dboc->prepare_commit();
+    {
+      CellStorer cell_storer(*kv);
+      dboc->commit(cell_storer);
+    }
+    set_loader();
+    if (old_root.not_null()) {
+      // cells erased by the commit are dropped from the cache
+      CellSlice cs(NoVm(), old_root);
+      for (unsigned i = 0; i < cs.size_refs(); i++) {
+        auto hash = cs.prefetch_ref(i)->get_hash();
+        std::string value;
+        if (kv->get(hash.as_slice(), value).move_as_ok() == td::KeyValue::GetStatus::NotFound) {
+          ASSERT_TRUE(cell_cache->get(hash.as_slice()).is_null());
+        }
+      }
+    }
+  }
+  ASSERT_EQ(0u, kv->count("").ok());
+
+  auto stats = cell_cache->get_stats();
+  ASSERT_TRUE(stats.hits > 0);
+  ASSERT_TRUE(stats.misses > 0);
+  ASSERT_EQ(0u, stats.size);
+  ASSERT_EQ(0u, stats.memory);
+}
+
+TEST(TonDb, DynamicBocCellCachePrefetch) {
+  td::Random::Xorshift128plus rnd{123};
+  auto kv = std::make_shared<td::MemoryKeyValue>();
+  auto cell_cache = std::make_shared<CellCache>(1 << 20);
+  auto dboc = DynamicBagOfCellsDb::create(cell_cache);
+  dboc->set_loader(std::make_unique<CellLoader>(kv));
+
+  std::vector<Ref<Cell>> grandchildren;
+  CellBuilder child_cb;
+  for (int i = 0; i < 3; i++) {
+    grandchildren.push_back(CellBuilder().store_long(rnd(), 64).finalize());
+    child_cb.store_ref(grandchildren.back());
+  }
+  auto root = CellBuilder().store_ref(child_cb.finalize()).finalize();
+  dboc->inc(root);
+  dboc->prepare_commit();
+  {
+    CellStorer cell_storer(*kv);
+    dboc->commit(cell_storer);
+  }
+  cell_cache->set_loader(std::make_shared<CellLoader>(kv));
+
+  auto reader = DynamicBagOfCellsDb::create(cell_cache);
+  reader->set_loader(std::make_unique<CellLoader>(kv));
+  auto loaded_root = reader->load_cell(root->get_hash().as_slice()).move_as_ok();
+  auto loaded_child = CellSlice(NoVm(), loaded_root).prefetch_ref(0);
+  ASSERT_EQ(3u, CellSlice(NoVm(), loaded_child).size_refs());
+  // the grandchildren were read together with the child
+  ASSERT_EQ(1u, cell_cache->get_stats().misses);
+  for (auto &cell : grandchildren) {
+    ASSERT_TRUE(cell_cache->contains(cell->get_hash().as_slice()));
+  }
+  ASSERT_EQ(serialize_boc(root), serialize_boc(loaded_root));
+  auto stats = cell_cache->get_stats();
+  ASSERT_EQ(1u, stats.misses);
+  ASSERT_EQ(3u, stats.hits);
+}
+
 template <class BocDeserializerT>
 td::Status test_boc_deserializer(std::vector<Ref<Cell>> cells, int mode) {
   auto total_data_cells_before = vm::DataCell::get_total_data_cells();
@@ -1364,6 +1586,82 @@ TEST(Cell, MerkleUpdateArray) {
   check_merkle_update(root, arr.root(), update);
 }
 
+auto gen_array_update(const std::vector<td::uint64> &data, size_t changes, td::Random::Xorshift128plus &rnd) {
+  CompactArray arr(data);
+  auto root = arr.root();
+  auto usage_tree = std::make_shared<CellUsageTree>();
+  auto usage_cell = UsageCell::create(root, usage_tree->root_ptr());
+  arr = CompactArray(data.size(), usage_cell);
+  for (size_t i = 0; i < changes; i++) {
+    arr.set(rnd.fast(0, static_cast<int>(data.size()) - 1), rnd());
+  }
+  auto update = MerkleUpdate::generate(usage_cell, arr.root(), usage_tree.get());
+  return std::make_tuple(root, arr.root(), update);
+}
+
+TEST(Cell, MerkleUpdateParallel) {
+  td::Random::Xorshift128plus rnd{123};
+  for (size_t changes : {1, 10, 1000}) {
+    std::vector<td::uint64> data(1 << 14);
+    for (auto &x : data) {
+      x = rnd();
+    }
+    Ref<Cell> A, B, AB;
+    std::tie(A, B, AB) = gen_array_update(data, changes, rnd);
+    for (int threads : {1, 2, 5}) {
+      MerkleUpdate::validate(AB, threads).ensure();
+      auto got_B = MerkleUpdate::apply(A, AB, threads);
+      ASSERT_EQ(B->get_hash(), got_B->get_hash());
+    }
+
+    // update_to of another update refers to cells unknown to update_from, the same error must be reported
+    Ref<Cell> other_AB;
+    std::tie(std::ignore, std::ignore, other_AB) = gen_array_update(data, changes, rnd);
+    auto bad_update = CellBuilder::create_merkle_update(CellSlice(NoVm(), AB).prefetch_ref(0),
+                                                        CellSlice(NoVm(), other_AB).prefetch_ref(1));
+    auto expected_error = MerkleUpdate::validate(bad_update).move_as_error().to_string();
+    for (int threads : {2, 5}) {
+      ASSERT_EQ(expected_error, MerkleUpdate::validate(bad_update, threads).move_as_error().to_string());
+      ASSERT_TRUE(MerkleUpdate::apply(A, bad_update, threads).is_null());
+    }
+  }
+}
+
+class BenchMerkleUpdateApply : public td::Benchmark {
+ public:
+  explicit BenchMerkleUpdateApply(int threads) : threads_(threads) {
+    td::Random::Xorshift128plus rnd{123};
+    std::vector<td::uint64> data(array_size);
+    for (auto &x : data) {
+      x = rnd();
+    }
+    std::tie(from_, to_, update_) = gen_array_update(data, changes, rnd);
+  }
+  std::string get_description() const override {
+    return PSTRING() << "BenchMerkleUpdateApply threads=" << threads_;
+  }
+
+  void run(int n) override {
+    for (int i = 0; i < n; i++) {
+      MerkleUpdate::validate(update_, threads_).ensure();
+      auto to = MerkleUpdate::apply(from_, update_, threads_);
+      CHECK(to->get_hash() == to_->get_hash());
+    }
+  }
+
+ private:
+  static constexpr size_t array_size = 1 << 20;
+  static constexpr size_t changes = 1 << 13;
+  int threads_;
+  Ref<Cell> from_, to_, update_;
+};
+
+TEST(TonDb, BenchMerkleUpdateApply) {
+  for (int threads : {1, 4, 8}) {
+    td::bench(BenchMerkleUpdateApply(threads));
+  }
+}
+
 TEST(Cell, MerkleUpdateCombineArray) {
   size_t n = 1 << 10;
   std::vector<td::uint64> data;
@@ -1495,6 +1793,62 @@ class BenchBocSerializerSerialize : public td::Benchmark {
   vm::BagOfCells boc;
 };
 
+class BenchBocDeserializerParallel : public td::Benchmark {
+ public:
+  explicit BenchBocDeserializerParallel(int threads) : threads_(threads) {
+    std::vector<td::uint64> v(array_size);
+    td::Random::Xorshift128plus rnd{123};
+    for (auto &x : v) {
+      x = rnd();
+    }
+    vm::CompactArray arr(v);
+    root_hash_ = arr.root()->get_hash();
+    serialization_ = td::BufferSlice(vm::serialize_boc(arr.root(), 31));
+  }
+  std::string get_description() const override {
+    return PSTRING() << "BenchBocDeserializerParallel threads=" << threads_;
+  }
+
+  void run(int n) override {
+    for (int i = 0; i < n; i++) {
+      vm::BagOfCells boc;
+      boc.deserialize(serialization_.as_slice(), 1, threads_).ensure();
+      CHECK(boc.get_root_cell()->get_hash() == root_hash_);
+    }
+  }
+
+ private:
+  static constexpr td::uint32 array_size = 1 << 20;
+  int threads_;
+  vm::Cell::Hash root_hash_;
+  td::BufferSlice serialization_;
+};
+
+TEST(TonDb, BocDeserializerParallel) {
+  td::Random::Xorshift128plus rnd{123};
+  for (int t = 0; t < 4; t++) {
+    std::vector<td::uint64> v(rnd.fast(1 << 13, 1 << 15));
+    for (auto &x : v) {
+      x = rnd();
+    }
+    vm::CompactArray arr(v);
+    for (auto mode : vm::get_serialization_modes()) {
+      auto serialized = vm::serialize_boc(arr.root(), mode);
+      for (int threads : {1, 2, 5}) {
+        vm::BagOfCells boc;
+        boc.deserialize(td::Slice(serialized), 1, threads).ensure();
+        ASSERT_EQ(arr.root()->get_hash(), boc.get_root_cell()->get_hash());
+      }
+    }
+  }
+}
+
+TEST(TonDb, BenchBocDeserializerParallel) {
+  for (int threads : {1, 4, 8}) {
+    td::bench(BenchBocDeserializerParallel(threads));
+  }
+}
+
 struct BenchBocDeserializerConfig {
   enum BlobType { File, Memory, FileMemoryMap, RocksDb } blob_type;
   int k{100};
@@ -26,6 +26,7 @@
 #include "td/utils/tests.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/Timer.h"
 
 std::string run_vm(td::Ref<vm::Cell> cell) {
   vm::init_op_cp0();
@@ -448,3 +449,149 @@ RETALT
 )A";
   test_run_vm(fift::compile_asm(test1).move_as_ok());
 }
+
+TEST(VM, small_int_overflow) {
+  vm::init_op_cp0();
+  // results just outside of 64 bits must be computed exactly by the generic code
+  std::vector<std::pair<std::string, std::string>> tests = {
+      {"9223372036854775807 INT INC", "9223372036854775808"},
+      {"-9223372036854775808 INT DEC", "-9223372036854775809"},
+      {"-9223372036854775808 INT NEGATE", "9223372036854775808"},
+      {"9223372036854775807 INT 9223372036854775807 INT ADD", "18446744073709551614"},
+      {"-9223372036854775808 INT 1 INT SUB", "-9223372036854775809"},
+      {"1 INT -9223372036854775808 INT SUBR", "-9223372036854775809"},
+      {"4294967296 INT 4294967296 INT MUL", "18446744073709551616"},
+      {"2147483647 INT -2147483647 INT MUL", "-4611686014132420609"},
+      {"9223372036854775807 INT 100 ADDCONST", "9223372036854775907"},
+      {"9223372036854775807 INT -100 MULCONST", "-922337203685477580700"},
+      {"-9223372036854775808 INT 9223372036854775807 INT LESS", "-1"},
+      {"-5 INT 10 GTINT", "0"},
+      {"x{FFFFFFFFFFFFFFFF} PUSHSLICE 64 PLDU", "18446744073709551615"},
+      {"x{FFFFFFFFFFFFFFFF} PUSHSLICE 64 PLDI", "-1"},
+      {"x{FFFFFFFFFFFFFFFF} PUSHSLICE 63 LDU DROP", "9223372036854775807"},
+  };
+  for (auto &test : tests) {
+    auto code = fift::compile_asm(" " + test.first).move_as_ok();
+    td::Ref<vm::Stack> stack{true};
+    auto res = vm::run_vm_code(vm::load_cell_slice_ref(code), stack, 0, nullptr, vm::VmLog::Null());
+    ASSERT_EQ(0, res);
+    ASSERT_EQ(1, stack->depth());
+    ASSERT_EQ(test.second, dec_string(stack.write().pop_int()));
+  }
+}
+
+// Instruction mixes modelled on the hot paths of wallet (message parsing), elector (dictionary
+// updates and lookups) and config (parameter lookups) contracts
+static const std::vector<std::pair<std::string, std::string>> &get_dispatch_bench_programs() {
+  static const std::vector<std::pair<std::string, std::string>> programs = {{"wallet", R"A(
+0 INT
+1000 INT
+REPEAT:<{
+  DUP DUP NEWC 32 STU 64 STU
+  ENDC CTOS
+  32 LDU
+  64 LDU
+  ENDS
+  s2 PUSH EQUAL
+  33 THROWIFNOT
+  OVER EQUAL
+  34 THROWIFNOT
+  INC
+}>
+DROP
+)A"},
+                                                                            {"elector", R"A(
+NEWDICT
+0 INT
+256 INT
+REPEAT:<{
+  DUP NEWC 64 STU
+  OVER
+  s3 PUSH
+  32 INT
+  DICTUSETB
+  s2 POP
+  INC
+}>
+DROP
+0 INT
+0 INT
+256 INT
+REPEAT:<{
+  DUP
+  s3 PUSH
+  32 INT
+  DICTUGET
+  35 THROWIFNOT
+  64 LDU
+  ENDS
+  ROT
+  ADD
+  SWAP
+  INC
+}>
+DROP
+32640 INT
+EQUAL
+36 THROWIFNOT
+DROP
+)A"},
+                                                                            {"config", R"A(
+NEWDICT
+0 INT
+32 INT
+REPEAT:<{
+  DUP DUP NEWC 32 STU 64 STU
+  ENDC
+  OVER
+  s3 PUSH
+  32 INT
+  DICTISETREF
+  s2 POP
+  INC
+}>
+DROP
+0 INT
+0 INT
+1000 INT
+REPEAT:<{
+  DUP 31 INT AND
+  s3 PUSH
+  32 INT
+  DICTIGETREF
+  37 THROWIFNOT
+  CTOS
+  32 LDU
+  64 LDU
+  ENDS
+  ADD
+  ROT
+  ADD
+  SWAP
+  INC
+}>
+2DROP
+DROP
+)A"}};
+  return programs;
+}
+
+TEST(VM, BenchDispatch) {
+  vm::init_op_cp0();
+  for (auto &program : get_dispatch_bench_programs()) {
+    auto code = fift::compile_asm(program.second).move_as_ok();
+    long long total_steps = 0;
+    int runs = 0;
+    td::Timer timer;
+    while (timer.elapsed() < 1.0) {
+      td::Ref<vm::Stack> stack{true};
+      long long steps = 0;
+      auto res = vm::run_vm_code(vm::load_cell_slice_ref(code), stack, 0, nullptr, vm::VmLog::Null(), &steps);
+      ASSERT_EQ(0, res);
+      total_steps += steps;
+      runs++;
+    }
+    LOG(ERROR) << "VM dispatch benchmark [" << program.first << "]: " << runs << " runs, "
+               << static_cast<long long>(static_cast<double>(total_steps) / timer.elapsed()) << " instructions/s";
+  }
+}
@@ -17,6 +17,7 @@
     Copyright 2017-2020 Telegram Systems LLP
 */
 #include <functional>
+#include <limits>
 #include "vm/arithops.h"
 #include "vm/log.h"
 #include "vm/opctable.h"
@@ -28,6 +29,56 @@
 
 namespace vm {
 
+namespace {
+// Fast paths for integers stored inline in stack entries. The result is computed in 64 bits only when it
+// is guaranteed to fit; otherwise the stack is left untouched and the generic BigInt256 code is used.
+bool small_add(long long x, long long y, long long& z) {
+  if (y > 0 ? x > std::numeric_limits<long long>::max() - y : x < std::numeric_limits<long long>::min() - y) {
+    return false;
+  }
+  z = x + y;
+  return true;
+}
+
+bool small_sub(long long x, long long y, long long& z) {
+  if (y < 0 ? x > std::numeric_limits<long long>::max() + y : x < std::numeric_limits<long long>::min() + y) {
+    return false;
+  }
+  z = x - y;
+  return true;
+}
+
+bool small_mul(long long x, long long y, long long& z) {
+  const long long lim = 1LL << 31;
+  if (x <= -lim || x >= lim || y <= -lim || y >= lim) {
+    return false;
+  }
+  z = x * y;
+  return true;
+}
+
+template <class F>
+bool try_small_unary(Stack& stack, F&& func) {
+  long long x, z;
+  if (!stack[0].get_small_int(x) || !func(x, z)) {
+    return false;
+  }
+  stack[0].set_small_int(z);
+  return true;
+}
+
+template <class F>
+bool try_small_binary(Stack& stack, F&& func) {
+  long long x, y, z;
+  if (!stack[1].get_small_int(x) || !stack[0].get_small_int(y) || !func(x, y, z)) {
+    return false;
+  }
+  stack.pop_many(1);
+  stack[0].set_small_int(z);
+  return true;
+}
+}  // namespace
+
 int exec_push_tinyint4(VmState* st, unsigned args) {
   int x = (int)((args + 5) & 15) - 5;
   Stack& stack = st->get_stack();
@@ -163,6 +214,9 @@ int exec_add(VmState* st, bool quiet) {
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute ADD";
   stack.check_underflow(2);
+  if (try_small_binary(stack, small_add)) {
+    return 0;
+  }
   auto y = stack.pop_int();
   stack.push_int_quiet(stack.pop_int() + std::move(y), quiet);
   return 0;
@@ -172,6 +226,9 @@ int exec_sub(VmState* st, bool quiet) {
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute SUB";
   stack.check_underflow(2);
+  if (try_small_binary(stack, small_sub)) {
+    return 0;
+  }
   auto y = stack.pop_int();
   stack.push_int_quiet(stack.pop_int() - std::move(y), quiet);
   return 0;
@@ -181,6 +238,9 @@ int exec_subr(VmState* st, bool quiet) {
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute SUBR";
   stack.check_underflow(2);
+  if (try_small_binary(stack, [](long long x, long long y, long long& z) { return small_sub(y, x, z); })) {
+    return 0;
+  }
   auto y = stack.pop_int();
   stack.push_int_quiet(std::move(y) - stack.pop_int(), quiet);
   return 0;
@@ -190,6 +250,9 @@ int exec_negate(VmState* st, bool quiet) {
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute NEGATE";
   stack.check_underflow(1);
+  if (try_small_unary(stack, [](long long x, long long& z) { return small_sub(0, x, z); })) {
+    return 0;
+  }
   stack.push_int_quiet(-stack.pop_int(), quiet);
   return 0;
 }
@@ -198,6 +261,9 @@ int exec_inc(VmState* st, bool quiet) {
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute INC";
   stack.check_underflow(1);
+  if (try_small_unary(stack, [](long long x, long long& z) { return small_add(x, 1, z); })) {
+    return 0;
+  }
   stack.push_int_quiet(stack.pop_int() + 1, quiet);
   return 0;
 }
@@ -206,6 +272,9 @@ int exec_dec(VmState* st, bool quiet) {
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute DEC";
   stack.check_underflow(1);
+  if (try_small_unary(stack, [](long long x, long long& z) { return small_sub(x, 1, z); })) {
+    return 0;
+  }
   stack.push_int_quiet(stack.pop_int() - 1, quiet);
   return 0;
 }
@@ -215,6 +284,9 @@ int exec_add_tinyint8(VmState* st, unsigned args, bool quiet) {
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute ADDINT " << x;
   stack.check_underflow(1);
+  if (try_small_unary(stack, [x](long long y, long long& z) { return small_add(y, x, z); })) {
+    return 0;
+  }
   stack.push_int_quiet(stack.pop_int() + x, quiet);
   return 0;
 }
@@ -224,6 +296,9 @@ int exec_mul_tinyint8(VmState* st, unsigned args, bool quiet) {
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute MULINT " << x;
   stack.check_underflow(1);
+  if (try_small_unary(stack, [x](long long y, long long& z) { return small_mul(y, x, z); })) {
+    return 0;
+  }
   stack.push_int_quiet(stack.pop_int() * x, quiet);
   return 0;
 }
@@ -232,6 +307,9 @@ int exec_mul(VmState* st, bool quiet) {
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute MUL";
   stack.check_underflow(2);
+  if (try_small_binary(stack, small_mul)) {
+    return 0;
+  }
   auto y = stack.pop_int();
   stack.push_int_quiet(stack.pop_int() * std::move(y), quiet);
   return 0;
@@ -838,6 +916,12 @@ int exec_sgn(VmState* st, int mode, bool quiet, const char* name) {
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute " << name;
   stack.check_underflow(1);
+  if (try_small_unary(stack, [mode](long long x, long long& z) {
+        z = ((mode >> (4 + (x > 0) * 4 - (x < 0) * 4)) & 15) - 8;
+        return true;
+      })) {
+    return 0;
+  }
   auto x = stack.pop_int();
   if (!x->is_valid()) {
     stack.push_int_quiet(std::move(x), quiet);
@@ -852,6 +936,12 @@ int exec_cmp(VmState* st, int mode, bool quiet, const char* name) {
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute " << name;
   stack.check_underflow(2);
+  if (try_small_binary(stack, [mode](long long x, long long y, long long& z) {
+        z = ((mode >> (4 + (x > y) * 4 - (x < y) * 4)) & 15) - 8;
+        return true;
+      })) {
+    return 0;
+  }
   auto y = stack.pop_int();
   auto x = stack.pop_int();
   if (!x->is_valid() || !y->is_valid()) {
@@ -868,6 +958,12 @@ int exec_cmp_int(VmState* st, unsigned args, int mode, bool quiet, const char* n
   Stack& stack = st->get_stack();
   VM_LOG(st) << "execute " << name << "INT " << y;
   stack.check_underflow(1);
+  if (try_small_unary(stack, [mode, y](long long x, long long& z) {
+        z = ((mode >> (4 + (x > y) * 4 - (x < y) * 4)) & 15) - 8;
+        return true;
+      })) {
+    return 0;
+  }
   auto x = stack.pop_int();
   if (!x->is_valid()) {
     stack.push_int_quiet(std::move(x), quiet);
@@ -19,6 +19,9 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
 #include "vm/boc.h"
 #include "vm/cells.h"
 #include "vm/cellslice.h"
@@ -26,6 +29,8 @@
 #include "td/utils/Slice-decl.h"
 #include "td/utils/format.h"
 #include "td/utils/crypto.h"
+#include "td/utils/misc.h"
+#include "td/utils/parallel_for.h"
 
 namespace vm {
 using td::Ref;
@@ -85,8 +90,8 @@ td::Result<int> CellSerializationInfo::get_bits(td::Slice cell) const {
 }
 
 // TODO: check usage when result is empty
-td::Result<Ref<DataCell>> CellSerializationInfo::create_data_cell(td::Slice cell_slice,
-                                                                  td::Span<Ref<Cell>> refs) const {
+td::Result<Ref<DataCell>> CellSerializationInfo::create_data_cell(td::Slice cell_slice, td::Span<Ref<Cell>> refs,
+                                                                  td::Sha256Batch* hash_batch) const {
   CellBuilder cb;
   TRY_RESULT(bits, get_bits(cell_slice));
   cb.store_bits(cell_slice.ubegin() + data_offset, bits);
@@ -94,7 +99,7 @@ td::Result<Ref<DataCell>> CellSerializationInfo::create_data_cell(td::Slice cell
   for (int k = 0; k < refs_cnt; k++) {
     cb.store_ref(std::move(refs[k]));
   }
-  TRY_RESULT(res, cb.finalize_novm_nothrow(special));
+  TRY_RESULT(res, cb.finalize_novm_nothrow(special, with_hashes ? nullptr : hash_batch));
   CHECK(!res.is_null());
   if (res->is_special() != special) {
     return td::Status::Error("is_special mismatch");
@@ -232,14 +237,61 @@ td::Result<int> BagOfCells::import_cell(td::Ref<vm::Cell> cell, int depth) {
     sum_child_wt += cell_list_[refs[i]].wt;
     ++int_refs;
   }
-  DCHECK(cell_list_.size() == static_cast<std::size_t>(cell_count));
   auto dc = cs.move_as_loaded_cell().data_cell;
+  auto idx = add_cell_info(dc, refs, sum_child_wt);
+  cell_list_[idx].dc_ref = std::move(dc);
+  return idx;
+}
+
+td::Status BagOfCells::import_cells_lazy(LoadCell load_cell) {
+  cells_clear();
+  load_cell_ = std::move(load_cell);
+  for (auto& root : roots) {
+    TRY_RESULT(idx, import_cell_lazy(root.cell->get_hash(), 0));
+    root.idx = idx;
+  }
+  reorder_cells();
+  CHECK(cell_count != 0);
+  return td::Status::OK();
+}
+
+td::Result<int> BagOfCells::import_cell_lazy(const Cell::Hash& hash, int depth) {
+  if (depth > max_depth) {
+    return td::Status::Error("error while importing a cell into a bag of cells: cell depth too large");
+  }
+  auto it = cells.find(hash);
+  if (it != cells.end()) {
+    auto pos = it->second;
+    cell_list_[pos].should_cache = true;
+    return pos;
+  }
+  auto r_dc = load_cell_(hash.as_slice());
+  if (r_dc.is_error()) {
+    return td::Status::Error("error while importing a cell into a bag of cells: " + r_dc.move_as_error().to_string());
+  }
+  auto dc = r_dc.move_as_ok();
+  std::array<int, 4> refs{-1};
+  unsigned sum_child_wt = 1;
+  for (unsigned i = 0; i < dc->size_refs(); i++) {
+    TRY_RESULT(ref, import_cell_lazy(dc->get_ref(i)->get_hash(), depth + 1));
+    refs[i] = ref;
+    sum_child_wt += cell_list_[refs[i]].wt;
+    ++int_refs;
+  }
+  auto idx = add_cell_info(dc, refs, sum_child_wt);
+  cell_list_[idx].hash = hash;
+  return idx;
+}
+
+int BagOfCells::add_cell_info(const Ref<DataCell>& dc, const std::array<int, 4>& refs, unsigned sum_child_wt) {
+  DCHECK(cell_list_.size() == static_cast<std::size_t>(cell_count));
   auto res = cells.emplace(dc->get_hash(), cell_count);
   DCHECK(res.second);
-  cell_list_.emplace_back(dc, dc->size_refs(), refs);
+  cell_list_.emplace_back(Ref<DataCell>{}, dc->size_refs(), refs);
   CellInfo& dc_info = cell_list_.back();
   dc_info.hcnt = static_cast<unsigned char>(dc->get_level_mask().get_hashes_count());
   dc_info.wt = static_cast<unsigned char>(std::min(0xffU, sum_child_wt));
+  dc_info.data_size = static_cast<unsigned char>(dc->get_serialized_size());
   dc_info.new_idx = -1;
   data_bytes += dc->get_serialized_size();
   return cell_count++;
@@ -474,16 +526,126 @@ std::string BagOfCells::extract_string() const {
   return std::string{serialized.data(), serialized.data() + serialized.size()};
 }
 
-void BagOfCells::store_uint(unsigned long long value, unsigned bytes) {
-  unsigned char* ptr = store_ptr += bytes;
-  store_chk();
-  while (bytes) {
-    *--ptr = value & 0xff;
-    value >>= 8;
-    --bytes;
+namespace {
+class BufferWriter {
+ public:
+  BufferWriter(unsigned char* store_start, unsigned char* store_end)
+      : store_start_(store_start), store_ptr_(store_start), store_end_(store_end) {
   }
-  DCHECK(!bytes);
-}
+
+  std::size_t position() const {
+    return store_ptr_ - store_start_;
+  }
+  std::size_t remaining() const {
+    return store_end_ - store_ptr_;
+  }
+  void chk() const {
+    DCHECK(store_ptr_ <= store_end_);
+  }
+  bool empty() const {
+    return store_ptr_ == store_end_;
+  }
+  void store_uint(unsigned long long value, unsigned bytes) {
+    unsigned char* ptr = store_ptr_ += bytes;
+    chk();
+    while (bytes) {
+      *--ptr = value & 0xff;
+      value >>= 8;
+      --bytes;
+    }
+    DCHECK(!bytes);
+  }
+  void store_bytes(const unsigned char* data, std::size_t size) {
+    std::memcpy(store_ptr_, data, size);
+    store_ptr_ += size;
+    chk();
+  }
+  unsigned get_crc32() const {
+    return td::crc32c(td::Slice{store_start_, store_ptr_});
+  }
+
+ private:
+  unsigned char* store_start_;
+  unsigned char* store_ptr_;
+  unsigned char* store_end_;
+};
+
+// Writes a bag of cells into a file through a bounded buffer, so that only the cell index
+// has to be kept in memory while serializing huge bags of cells (e.g. persistent states)
+class FileWriter {
+ public:
+  FileWriter(td::FileFd& fd, std::size_t expected_size)
+      : fd_(fd)
+      , expected_size_(expected_size)
+      , buffer_(std::make_unique<unsigned char[]>(buffer_size))
+      , writer_(buffer_.get(), buffer_.get() + buffer_size) {
+  }
+
+  std::size_t position() const {
+    return flushed_size_ + writer_.position();
+  }
+  std::size_t remaining() const {
+    return expected_size_ - position();
+  }
+  void chk() const {
+    DCHECK(position() <= expected_size_);
+  }
+  bool empty() const {
+    return remaining() == 0;
+  }
+  void store_uint(unsigned long long value, unsigned bytes) {
+    flush_if_needed(bytes);
+    writer_.store_uint(value, bytes);
+  }
+  void store_bytes(const unsigned char* data, std::size_t size) {
+    flush_if_needed(size);
+    writer_.store_bytes(data, size);
+  }
+  unsigned get_crc32() {
+    flush();
+    return current_crc32_;
+  }
+  td::Status finalize() {
+    flush();
+    return std::move(res_);
+  }
+
+ private:
+  static constexpr std::size_t buffer_size = 1 << 20;
+
+  void flush_if_needed(std::size_t size) {
+    DCHECK(size <= buffer_size);
+    if (writer_.remaining() < size) {
+      flush();
+    }
+  }
+  void flush() {
+    auto data = td::Slice{buffer_.get(), writer_.position()};
+    if (data.empty()) {
+      return;
+    }
+    current_crc32_ = td::crc32c_extend(current_crc32_, data);
+    flushed_size_ += data.size();
+    writer_ = BufferWriter(buffer_.get(), buffer_.get() + buffer_size);
+    while (res_.is_ok() && !data.empty()) {
+      auto r_written = fd_.write(data);
+      if (r_written.is_error()) {
+        res_ = r_written.move_as_error();
+      } else {
+        data.remove_prefix(r_written.ok());
+      }
+    }
+  }
+
+  td::FileFd& fd_;
+  std::size_t expected_size_;
+  std::size_t flushed_size_{0};
+  unsigned current_crc32_{0};
+  std::unique_ptr<unsigned char[]> buffer_;
+  BufferWriter writer_;
+  td::Status res_;
+};
+}  // namespace
 
 //serialized_boc#672fb0ac has_idx:(## 1) has_crc32c:(## 1)
 //  has_cache_bits:(## 1) flags:(## 2) { flags = 0 }
@@ -496,13 +658,12 @@ void BagOfCells::store_uint(unsigned long long value, unsigned bytes) {
 //  index:(cells * ##(off_bytes * 8))
 //  cell_data:(tot_cells_size * [ uint8 ])
 //  = BagOfCells;
-std::size_t BagOfCells::serialize_to(unsigned char* buffer, std::size_t buff_size, int mode) {
-  std::size_t size_est = estimate_serialized_size(mode);
-  if (!size_est || size_est > buff_size) {
-    return 0;
-  }
-  init_store(buffer, buffer + size_est);
-  store_uint(info.magic, 4);
+template <typename WriterT>
+std::size_t BagOfCells::serialize_to_impl(WriterT& writer, int mode) {
+  auto store_ref = [&](unsigned long long value) { writer.store_uint(value, info.ref_byte_size); };
+  auto store_offset = [&](unsigned long long value) { writer.store_uint(value, info.offset_byte_size); };
+
+  writer.store_uint(info.magic, 4);
 
   td::uint8 byte{0};
   if (info.has_index) {
@@ -519,9 +680,9 @@ std::size_t BagOfCells::serialize_to(unsigned char* buffer, std::size_t buff_siz
     return 0;
   }
   byte |= static_cast<td::uint8>(info.ref_byte_size);
-  store_uint(byte, 1);
+  writer.store_uint(byte, 1);
 
-  store_uint(info.offset_byte_size, 1);
+  writer.store_uint(info.offset_byte_size, 1);
   store_ref(cell_count);
   store_ref(root_count);
   store_ref(0);
@@ -531,17 +692,18 @@ std::size_t BagOfCells::serialize_to(unsigned char* buffer, std::size_t buff_siz
     DCHECK(k >= 0 && k < cell_count);
     store_ref(k);
   }
-  DCHECK(store_ptr - buffer == (long long)info.index_offset);
+  DCHECK(writer.position() == info.index_offset);
   DCHECK((unsigned)cell_count == cell_list_.size());
   if (info.has_index) {
     std::size_t offs = 0;
     for (int i = cell_count - 1; i >= 0; --i) {
-      const Ref<DataCell>& dc = cell_list_[i].dc_ref;
-      bool with_hash = (mode & Mode::WithIntHashes) && !cell_list_[i].wt;
-      if (cell_list_[i].is_root_cell && (mode & Mode::WithTopHash)) {
+      const auto& dc_info = cell_list_[i];
+      bool with_hash = (mode & Mode::WithIntHashes) && !dc_info.wt;
+      if (dc_info.is_root_cell && (mode & Mode::WithTopHash)) {
         with_hash = true;
       }
-      offs += dc->get_serialized_size(with_hash) + dc->size_refs() * info.ref_byte_size;
+      offs += dc_info.data_size + (with_hash ? dc_info.hcnt * (Cell::hash_bytes + Cell::depth_bytes) : 0) +
+              dc_info.ref_num * info.ref_byte_size;
       auto fixed_offset = offs;
       if (info.has_cache_bits) {
         fixed_offset = offs * 2 + cell_list_[i].should_cache;
@@ -550,18 +712,26 @@ std::size_t BagOfCells::serialize_to(unsigned char* buffer, std::size_t buff_siz
     }
     DCHECK(offs == info.data_size);
   }
-  DCHECK(store_ptr - buffer == (long long)info.data_offset);
-  unsigned char* keep_ptr = store_ptr;
+  DCHECK(writer.position() == info.data_offset);
+  std::size_t keep_position = writer.position();
+  unsigned char cell_buff[DataCell::max_serialized_bytes];
   for (int i = 0; i < cell_count; ++i) {
     const auto& dc_info = cell_list_[cell_count - 1 - i];
-    const Ref<DataCell>& dc = dc_info.dc_ref;
+    Ref<DataCell> dc = dc_info.dc_ref;
+    if (dc.is_null()) {
+      auto r_dc = load_cell_(dc_info.hash.as_slice());
+      if (r_dc.is_error()) {
+        load_error_ = r_dc.move_as_error_prefix("error while serializing a bag of cells: ");
+        return 0;
+      }
+      dc = r_dc.move_as_ok();
+    }
     bool with_hash = (mode & Mode::WithIntHashes) && !dc_info.wt;
     if (dc_info.is_root_cell && (mode & Mode::WithTopHash)) {
       with_hash = true;
     }
-    int s = dc->serialize(store_ptr, 256, with_hash);
-    store_ptr += s;
-    store_chk();
+    int s = dc->serialize(cell_buff, sizeof(cell_buff), with_hash);
+    writer.store_bytes(cell_buff, s);
     DCHECK(dc->size_refs() == dc_info.ref_num);
     // std::cerr << (dc_info.is_special() ? '*' : ' ') << i << '<' << (int)dc_info.wt << ">:";
     for (unsigned j = 0; j < dc_info.ref_num; ++j) {
@@ -572,16 +742,41 @@ std::size_t BagOfCells::serialize_to(unsigned char* buffer, std::size_t buff_siz
     }
     // std::cerr << std::endl;
   }
-  store_chk();
-  DCHECK(store_ptr - keep_ptr == (long long)info.data_size);
-  DCHECK(store_end - store_ptr == (info.has_crc32c ? 4 : 0));
+  writer.chk();
+  DCHECK(writer.position() - keep_position == info.data_size);
+  DCHECK(writer.remaining() == (info.has_crc32c ? 4 : 0));
   if (info.has_crc32c) {
-    // compute crc32c of buffer .. store_ptr
-    unsigned crc = td::crc32c(td::Slice{buffer, store_ptr});
-    store_uint(td::bswap32(crc), 4);
+    unsigned crc = writer.get_crc32();
+    writer.store_uint(td::bswap32(crc), 4);
+  }
+  DCHECK(writer.empty());
+  return writer.position();
+}
+
+std::size_t BagOfCells::serialize_to(unsigned char* buffer, std::size_t buff_size, int mode) {
+  std::size_t size_est = estimate_serialized_size(mode);
+  if (!size_est || size_est > buff_size) {
+    return 0;
+  }
+  BufferWriter writer(buffer, buffer + size_est);
+  return serialize_to_impl(writer, mode);
+}
+
+td::Status BagOfCells::serialize_to_file(td::FileFd& fd, int mode) {
+  std::size_t size_est = estimate_serialized_size(mode);
+  if (!size_est) {
+    return td::Status::Error("no cells to serialize to this bag of cells");
+  }
+  FileWriter writer(fd, size_est);
+  std::size_t s = serialize_to_impl(writer, mode);
+  if (load_error_.is_error()) {
+    return std::move(load_error_);
+  }
+  TRY_STATUS(writer.finalize());
+  if (s != size_est) {
+    return td::Status::Error("error while serializing a bag of cells: actual serialized size differs from estimated");
   }
-  DCHECK(store_empty());
-  return store_ptr - buffer;
+  return td::Status::OK();
 }
 
 unsigned long long BagOfCells::Info::read_int(const unsigned char* ptr, unsigned bytes) {
@@ -715,9 +910,25 @@ td::Result<td::Slice> BagOfCells::get_cell_slice(int idx, td::Slice data) {
   return data.substr(offs, td::narrow_cast<size_t>(offs_end - offs));
 }
 
+td::Result<int> BagOfCells::get_cell_ref_idx(int idx, td::Slice cell_slice, const CellSerializationInfo& cell_info,
+                                             int k) {
+  int ref_idx = (int)info.read_ref(cell_slice.ubegin() + cell_info.refs_offset + k * info.ref_byte_size);
+  if (ref_idx <= idx) {
+    return td::Status::Error(PSLICE() << "bag-of-cells error: reference #" << k << " of cell #" << idx
+                                      << " is to cell #" << ref_idx << " with smaller index");
+  }
+  if (ref_idx >= cell_count) {
+    return td::Status::Error(PSLICE() << "bag-of-cells error: reference #" << k << " of cell #" << idx
+                                      << " is to non-existent cell #" << ref_idx << ", only " << cell_count
+                                      << " cells are defined");
+  }
+  return ref_idx;
+}
+
 td::Result<td::Ref<vm::DataCell>> BagOfCells::deserialize_cell(int idx, td::Slice cells_slice,
                                                                td::Span<td::Ref<DataCell>> cells_span,
-                                                               std::vector<td::uint8>* cell_should_cache) {
+                                                               std::vector<td::uint8>* cell_should_cache,
+                                                               td::Sha256Batch* hash_batch) {
   TRY_RESULT(cell_slice, get_cell_slice(idx, cells_slice));
   std::array<td::Ref<Cell>, 4> refs_buf;
 
@@ -729,16 +940,7 @@ td::Result<td::Ref<vm::DataCell>> BagOfCells::deserialize_cell(int idx, td::Slic
 
   auto refs = td::MutableSpan<td::Ref<Cell>>(refs_buf).substr(0, cell_info.refs_cnt);
   for (int k = 0; k < cell_info.refs_cnt; k++) {
-    int ref_idx = (int)info.read_ref(cell_slice.ubegin() + cell_info.refs_offset + k * info.ref_byte_size);
-    if (ref_idx <= idx) {
-      return td::Status::Error(PSLICE() << "bag-of-cells error: reference #" << k << " of cell #" << idx
-                                        << " is to cell #" << ref_idx << " with smaller index");
-    }
-    if (ref_idx >= cell_count) {
-      return td::Status::Error(PSLICE() << "bag-of-cells error: reference #" << k << " of cell #" << idx
-                                        << " is to non-existent cell #" << ref_idx << ", only " << cell_count
-                                        << " cells are defined");
-    }
+    TRY_RESULT(ref_idx, get_cell_ref_idx(idx, cell_slice, cell_info, k));
     refs[k] = cells_span[cell_count - ref_idx - 1];
     if (cell_should_cache) {
       auto& cnt = (*cell_should_cache)[ref_idx];
@@ -748,10 +950,101 @@ td::Result<td::Ref<vm::DataCell>> BagOfCells::deserialize_cell(int idx, td::Slic
     }
   }
 
-  return cell_info.create_data_cell(cell_slice, refs);
+  return cell_info.create_data_cell(cell_slice, refs, hash_batch);
 }
 
-td::Result<long long> BagOfCells::deserialize(const td::Slice& data, int max_roots) {
+// Cells are split into dependency levels: a cell's level is greater than the levels of all its children,
+// so the cells of one level can be created independently of each other, and their hashes computed in batches.
+// Small levels are processed on the current thread, large ones are split between worker threads.
+td::Status BagOfCells::deserialize_cells_parallel(td::Slice cells_slice, std::vector<Ref<DataCell>>& cell_list,
+                                                  std::vector<td::uint8>* cell_should_cache, int threads) {
+  constexpr size_t min_parallel_level_size = 1 << 12;
+  constexpr size_t chunk_size = 1 << 8;
+
+  std::vector<int> cell_level(cell_count, 0);
+  std::vector<int> level_size;
+  for (int idx = cell_count - 1; idx >= 0; idx--) {
+    TRY_RESULT(cell_slice, get_cell_slice(idx, cells_slice));
+    CellSerializationInfo cell_info;
+    TRY_STATUS(cell_info.init(cell_slice, info.ref_byte_size));
+    int level = 0;
+    for (int k = 0; k < cell_info.refs_cnt; k++) {
+      TRY_RESULT(ref_idx, get_cell_ref_idx(idx, cell_slice, cell_info, k));
+      level = std::max(level, cell_level[ref_idx] + 1);
+      if (cell_should_cache) {
+        auto& cnt = (*cell_should_cache)[ref_idx];
+        if (cnt < 2) {
+          cnt++;
+        }
+      }
+    }
+    cell_level[idx] = level;
+    if (level_size.size() <= static_cast<size_t>(level)) {
+      level_size.resize(level + 1, 0);
+    }
+    level_size[level]++;
+  }
+
+  std::vector<size_t> level_begin(level_size.size() + 1, 0);
+  for (size_t level = 0; level < level_size.size(); level++) {
+    level_begin[level + 1] = level_begin[level] + level_size[level];
+  }
+  std::vector<int> order(cell_count);
+  {
+    auto pos = level_begin;
+    for (int idx = cell_count - 1; idx >= 0; idx--) {
+      order[pos[cell_level[idx]]++] = idx;
+    }
+  }
+  td::reset_to_empty(cell_level);
+
+  cell_list.resize(cell_count);
+  auto create_cells = [&](size_t begin, size_t end) -> td::Status {
+    td::Sha256Batch hash_batch;
+    for (size_t i = begin; i < end; i++) {
+      int idx = order[i];
+      auto r_cell = deserialize_cell(idx, cells_slice, cell_list, nullptr, &hash_batch);
+      if (r_cell.is_error()) {
+        // some of the pending hashes may belong to already destroyed cells
+        hash_batch.clear();
+        return td::Status::Error(PSLICE() << "invalid bag-of-cells failed to deserialize cell #" << idx << " "
+                                          << r_cell.error());
+      }
+      cell_list[cell_count - 1 - idx] = r_cell.move_as_ok();
+    }
+    hash_batch.flush();
+    return td::Status::OK();
+  };
+
+  for (size_t level = 0; level < level_size.size(); level++) {
+    size_t begin = level_begin[level];
+    size_t end = level_begin[level + 1];
+    if (end - begin < min_parallel_level_size) {
+      TRY_STATUS(create_cells(begin, end));
+      continue;
+    }
+    size_t chunks = (end - begin + chunk_size - 1) / chunk_size;
+    std::vector<td::Status> results(chunks);
+    std::atomic<bool> failed{false};
+    td::parallel_for(chunks, threads, [&](size_t chunk) {
+      if (failed.load(std::memory_order_relaxed)) {
+        return;
+      }
+      size_t chunk_begin = begin + chunk * chunk_size;
+      auto status = create_cells(chunk_begin, std::min(chunk_begin + chunk_size, end));
+      if (status.is_error()) {
+        results[chunk] = std::move(status);
+        failed.store(true, std::memory_order_relaxed);
+      }
+    });
+    for (auto& status : results) {
+      TRY_STATUS(std::move(status));
+    }
+  }
+  return td::Status::OK();
+}
+
+td::Result<long long> BagOfCells::deserialize(const td::Slice& data, int max_roots, int threads) {
   clear();
   long long size_est = info.parse_serialized_header(data);
   //LOG(INFO) << "estimated size " << size_est << ", true size " << data.size();
@@ -834,18 +1127,22 @@ td::Result<long long> BagOfCells::deserialize(const td::Slice& data, int max_roo
   }
   auto cells_slice = data.substr(info.data_offset, info.data_size);
   std::vector<Ref<DataCell>> cell_list;
-  cell_list.reserve(cell_count);
-  std::array<td::Ref<Cell>, 4> refs_buf;
-  for (int i = 0; i < cell_count; i++) {
-    // reconstruct cell with index cell_count - 1 - i
-    int idx = cell_count - 1 - i;
-    auto r_cell = deserialize_cell(idx, cells_slice, cell_list, info.has_cache_bits ? &cell_should_cache : nullptr);
-    if (r_cell.is_error()) {
-      return td::Status::Error(PSLICE() << "invalid bag-of-cells failed to deserialize cell #" << idx << " "
-                                        << r_cell.error());
+  if (threads > 1) {
+    TRY_STATUS(deserialize_cells_parallel(cells_slice, cell_list, info.has_cache_bits ? &cell_should_cache : nullptr,
+                                          threads));
+  } else {
+    cell_list.reserve(cell_count);
+    for (int i = 0; i < cell_count; i++) {
+      // reconstruct cell with index cell_count - 1 - i
+      int idx = cell_count - 1 - i;
+      auto r_cell = deserialize_cell(idx, cells_slice, cell_list, info.has_cache_bits ? &cell_should_cache : nullptr);
+      if (r_cell.is_error()) {
+        return td::Status::Error(PSLICE() << "invalid bag-of-cells failed to deserialize cell #" << idx << " "
+                                          << r_cell.error());
+      }
+      cell_list.push_back(r_cell.move_as_ok());
+      DCHECK(cell_list.back().not_null());
     }
-    cell_list.push_back(r_cell.move_as_ok());
-    DCHECK(cell_list.back().not_null());
   }
   if (info.has_cache_bits) {
     for (int idx = 0; idx < cell_count; idx++) {
@@ -907,12 +1204,12 @@ unsigned long long BagOfCells::get_idx_entry_raw(int index) {
  * 
  */
 
-td::Result<Ref<Cell>> std_boc_deserialize(td::Slice data, bool can_be_empty) {
+td::Result<Ref<Cell>> std_boc_deserialize(td::Slice data, bool can_be_empty, int threads) {
   if (data.empty() && can_be_empty) {
     return Ref<Cell>();
   }
   BagOfCells boc;
-  auto res = boc.deserialize(data, 1);
+  auto res = boc.deserialize(data, 1, threads);
   if (res.is_error()) {
     return res.move_as_error();
   }
@@ -966,6 +1263,26 @@ td::Result<td::BufferSlice> std_boc_serialize(Ref<Cell> root, int mode) {
   return boc.serialize_to_slice(mode);
 }
 
+td::Status std_boc_serialize_to_file(Ref<Cell> root, td::FileFd& fd, int mode) {
+  if (root.is_null()) {
+    return td::Status::Error("cannot serialize a null cell reference into a bag of cells");
+  }
+  BagOfCells boc;
+  boc.add_root(std::move(root));
+  TRY_STATUS(boc.import_cells());
+  return boc.serialize_to_file(fd, mode);
+}
+
+td::Status std_boc_serialize_to_file_lazy(Ref<Cell> root, BagOfCells::LoadCell load_cell, td::FileFd& fd, int mode) {
+  if (root.is_null()) {
+    return td::Status::Error("cannot serialize a null cell reference into a bag of cells");
+  }
+  BagOfCells boc;
+  boc.add_root(std::move(root));
+  TRY_STATUS(boc.import_cells_lazy(std::move(load_cell)));
+  return boc.serialize_to_file(fd, mode);
+}
+
 td::Result<td::BufferSlice> std_boc_serialize_multi(std::vector<Ref<Cell>> roots, int mode) {
   if (roots.empty()) {
     return td::BufferSlice{};
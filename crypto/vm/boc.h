@@ -17,12 +17,14 @@
     Copyright 2017-2020 Telegram Systems LLP
 */
 #pragma once
+#include <functional>
 #include <set>
 #include "vm/cells.h"
 #include "td/utils/Status.h"
 #include "td/utils/buffer.h"
 #include "td/utils/HashMap.h"
 #include "td/utils/HashSet.h"
+#include "td/utils/port/FileFd.h"
 
 namespace vm {
 using td::Ref;
@@ -164,7 +166,9 @@ struct CellSerializationInfo {
   td::Status init(td::uint8 d1, td::uint8 d2, int ref_byte_size);
   td::Result<int> get_bits(td::Slice cell) const;
 
-  td::Result<Ref<DataCell>> create_data_cell(td::Slice data, td::Span<Ref<Cell>> refs) const;
+  // see DataCell::create() about hash_batch; it is not used for cells serialized with hashes
+  td::Result<Ref<DataCell>> create_data_cell(td::Slice data, td::Span<Ref<Cell>> refs,
+                                             td::Sha256Batch* hash_batch = nullptr) const;
 };
 
 class BagOfCells {
@@ -216,15 +220,15 @@ class BagOfCells {
   int max_depth{1024};
   Info info;
   unsigned long long data_bytes{0};
-  unsigned char* store_ptr{nullptr};
-  unsigned char* store_end{nullptr};
   td::HashMap<Hash, int> cells;
   struct CellInfo {
-    Ref<DataCell> dc_ref;
+    Ref<DataCell> dc_ref;  // null if the cells are imported with import_cells_lazy()
+    Cell::Hash hash;       // set only by import_cells_lazy()
     std::array<int, 4> ref_idx;
     unsigned char ref_num;
     unsigned char wt;
     unsigned char hcnt;
+    unsigned char data_size{0};  // serialized size of the cell without hashes and references
     int new_idx;
     bool should_cache{false};
     bool is_root_cell{false};
@@ -261,15 +265,21 @@ class BagOfCells {
   int add_roots(const std::vector<td::Ref<vm::Cell>>& add_roots);
   int add_root(td::Ref<vm::Cell> add_root);
   td::Status import_cells() TD_WARN_UNUSED_RESULT;
+  // loads a cell by its representation hash
+  using LoadCell = std::function<td::Result<Ref<DataCell>>(td::Slice hash)>;
+  // keeps only the hashes and the layout of the cells, which are loaded again with load_cell when serialized;
+  // so serialize_to_file() of a big bag loaded from a cell db needs no memory for the cells themselves
+  td::Status import_cells_lazy(LoadCell load_cell) TD_WARN_UNUSED_RESULT;
   BagOfCells() = default;
   std::size_t estimate_serialized_size(int mode = 0);
   BagOfCells& serialize(int mode = 0);
   std::string serialize_to_string(int mode = 0);
   td::Result<td::BufferSlice> serialize_to_slice(int mode = 0);
   std::size_t serialize_to(unsigned char* buffer, std::size_t buff_size, int mode = 0);
+  td::Status serialize_to_file(td::FileFd& fd, int mode = 0);
   std::string extract_string() const;
 
-  td::Result<long long> deserialize(const td::Slice& data, int max_roots = default_max_roots);
+  td::Result<long long> deserialize(const td::Slice& data, int max_roots = default_max_roots, int threads = 1);
   td::Result<long long> deserialize(const unsigned char* buffer, std::size_t buff_size,
                                     int max_roots = default_max_roots) {
     return deserialize(td::Slice{buffer, buff_size}, max_roots);
@@ -286,7 +296,11 @@ class BagOfCells {
 
  private:
   int rv_idx;
+  LoadCell load_cell_;
+  td::Status load_error_;
   td::Result<int> import_cell(td::Ref<vm::Cell> cell, int depth);
+  td::Result<int> import_cell_lazy(const Cell::Hash& hash, int depth);
+  int add_cell_info(const Ref<DataCell>& dc, const std::array<int, 4>& refs, unsigned sum_child_wt);
   void cells_clear() {
     cell_count = 0;
     int_refs = 0;
@@ -295,35 +309,27 @@ class BagOfCells {
     cell_list_.clear();
   }
   td::uint64 compute_sizes(int mode, int& r_size, int& o_size);
-  void init_store(unsigned char* from, unsigned char* to) {
-    store_ptr = from;
-    store_end = to;
-  }
-  void store_chk() const {
-    DCHECK(store_ptr <= store_end);
-  }
-  bool store_empty() const {
-    return store_ptr == store_end;
-  }
-  void store_uint(unsigned long long value, unsigned bytes);
-  void store_ref(unsigned long long value) {
-    store_uint(value, info.ref_byte_size);
-  }
-  void store_offset(unsigned long long value) {
-    store_uint(value, info.offset_byte_size);
-  }
+  template <typename WriterT>
+  std::size_t serialize_to_impl(WriterT& writer, int mode);
   void reorder_cells();
   int revisit(int cell_idx, int force = 0);
   unsigned long long get_idx_entry_raw(int index);
   unsigned long long get_idx_entry(int index);
   bool get_cache_entry(int index);
   td::Result<td::Slice> get_cell_slice(int index, td::Slice data);
+  td::Result<int> get_cell_ref_idx(int idx, td::Slice cell_slice, const CellSerializationInfo& cell_info, int k);
   td::Result<td::Ref<vm::DataCell>> deserialize_cell(int index, td::Slice data, td::Span<td::Ref<DataCell>> cells,
-                                                     std::vector<td::uint8>* cell_should_cache);
+                                                     std::vector<td::uint8>* cell_should_cache,
+                                                     td::Sha256Batch* hash_batch = nullptr);
+  td::Status deserialize_cells_parallel(td::Slice cells_slice, std::vector<Ref<DataCell>>& cell_list,
+                                        std::vector<td::uint8>* cell_should_cache, int threads);
 };
 
-td::Result<Ref<Cell>> std_boc_deserialize(td::Slice data, bool can_be_empty = false);
+td::Result<Ref<Cell>> std_boc_deserialize(td::Slice data, bool can_be_empty = false, int threads = 1);
 td::Result<td::BufferSlice> std_boc_serialize(Ref<Cell> root, int mode = 0);
+td::Status std_boc_serialize_to_file(Ref<Cell> root, td::FileFd& fd, int mode = 0);
+td::Status std_boc_serialize_to_file_lazy(Ref<Cell> root, BagOfCells::LoadCell load_cell, td::FileFd& fd,
+                                          int mode = 0);
 
 td::Result<std::vector<Ref<Cell>>> std_boc_deserialize_multi(td::Slice data,
                                                              int max_roots = BagOfCells::default_max_roots);
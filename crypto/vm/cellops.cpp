@@ -919,7 +919,17 @@ int exec_load_int_common(Stack& stack, unsigned bits, unsigned mode) {
     return 0;
   }
   bool sgnd = !(mode & 1);
-  if (mode & 2) {
+  if (bits < 64 || (sgnd && bits == 64)) {
+    // fits into an inline stack integer
+    long long value = sgnd ? cs->prefetch_long(bits) : static_cast<long long>(cs->prefetch_ulong(bits));
+    if (mode & 2) {
+      stack.push_smallint(value);
+    } else {
+      cs.write().advance(bits);
+      stack.push_smallint(value);
+      stack.push_cellslice(std::move(cs));
+    }
+  } else if (mode & 2) {
     stack.push_int(cs->prefetch_int256(bits, sgnd));
   } else {
     stack.push_int(cs.write().fetch_int256(bits, sgnd));
@@ -67,8 +67,8 @@ Ref<DataCell> CellBuilder::finalize_copy(bool special) const {
   return cell;
 }
 
-td::Result<Ref<DataCell>> CellBuilder::finalize_novm_nothrow(bool special) {
-  auto res = DataCell::create(data, size(), td::mutable_span(refs.data(), size_refs()), special);
+td::Result<Ref<DataCell>> CellBuilder::finalize_novm_nothrow(bool special, td::Sha256Batch* hash_batch) {
+  auto res = DataCell::create(data, size(), td::mutable_span(refs.data(), size_refs()), special, hash_batch);
   bits = refs_cnt = 0;
   return res;
 }
@@ -177,7 +177,8 @@ class CellBuilder : public td::CntObject {
   Ref<DataCell> finalize_copy(bool special = false) const;
   Ref<DataCell> finalize(bool special = false);
   Ref<DataCell> finalize_novm(bool special = false);
-  td::Result<Ref<DataCell>> finalize_novm_nothrow(bool special = false);
+  // see DataCell::create() about hash_batch
+  td::Result<Ref<DataCell>> finalize_novm_nothrow(bool special = false, td::Sha256Batch* hash_batch = nullptr);
   bool finalize_to(Ref<Cell>& res, bool special = false) {
     return (res = finalize(special)).not_null();
   }
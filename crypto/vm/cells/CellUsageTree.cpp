@@ -18,7 +18,13 @@
 */
 #include "vm/cells/CellUsageTree.h"
 
+#include "td/utils/port/thread_local.h"
+
 namespace vm {
+namespace {
+TD_THREAD_LOCAL CellUsageTree::LoadRecorder* current_recorder;
+}  // namespace
+
 //
 // CellUsageTree::NodePtr
 //
@@ -58,6 +64,18 @@ bool CellUsageTree::NodePtr::mark_path(CellUsageTree* master_tree) const {
   return true;
 }
 
+//
+// CellUsageTree::LoadRecorder
+//
+CellUsageTree::LoadRecorder::LoadRecorder(CellUsageTree* tree, LoadLog& log)
+    : tree_(tree), log_(log), prev_(current_recorder) {
+  current_recorder = this;
+}
+
+CellUsageTree::LoadRecorder::~LoadRecorder() {
+  current_recorder = prev_;
+}
+
 //
 // CellUsageTree
 //
@@ -111,12 +129,37 @@ void CellUsageTree::set_use_mark_for_is_loaded(bool use_mark) {
   use_mark_ = use_mark;
 }
 
+void CellUsageTree::apply(const LoadLog& log) {
+  for (auto node_id : log.loaded) {
+    nodes_[node_id].is_loaded = true;
+  }
+}
+
+CellUsageTree::LoadRecorder* CellUsageTree::get_recorder() {
+  auto recorder = current_recorder;
+  while (recorder && recorder->tree_ != this) {
+    recorder = recorder->prev_;
+  }
+  return recorder;
+}
+
 void CellUsageTree::on_load(NodeId node_id) {
+  if (current_recorder) {
+    auto recorder = get_recorder();
+    if (recorder) {
+      recorder->log_.loaded.push_back(node_id);
+      return;
+    }
+  }
   nodes_[node_id].is_loaded = true;
 }
 
 CellUsageTree::NodeId CellUsageTree::create_child(NodeId node_id, unsigned ref_id) {
   DCHECK(ref_id < CellTraits::max_refs);
+  std::unique_lock<std::mutex> guard;
+  if (current_recorder && get_recorder()) {
+    guard = std::unique_lock<std::mutex>(mutex_);
+  }
   NodeId res = nodes_[node_id].children[ref_id];
   if (res) {
     return res;
@@ -23,6 +23,9 @@
 #include "td/utils/int_types.h"
 #include "td/utils/logging.h"
 
+#include <mutex>
+#include <vector>
+
 namespace vm {
 class CellUsageTree : public std::enable_shared_from_this<CellUsageTree> {
  public:
@@ -48,6 +51,28 @@ class CellUsageTree : public std::enable_shared_from_this<CellUsageTree> {
     NodeId node_id_{0};
   };
 
+  // Loads of speculative work, recorded by a LoadRecorder and applied to the tree later (or dropped)
+  struct LoadLog {
+    std::vector<NodeId> loaded;
+  };
+
+  // While alive, loads made through `tree` by the current thread are appended to `log` instead of being applied.
+  // Creation of new nodes is serialized meanwhile, so several threads with their own recorders may share a tree,
+  // provided no other thread accesses it.
+  class LoadRecorder {
+   public:
+    LoadRecorder(CellUsageTree* tree, LoadLog& log);
+    LoadRecorder(const LoadRecorder&) = delete;
+    LoadRecorder& operator=(const LoadRecorder&) = delete;
+    ~LoadRecorder();
+
+   private:
+    friend class CellUsageTree;
+    CellUsageTree* tree_;
+    LoadLog& log_;
+    LoadRecorder* prev_;
+  };
+
   NodePtr root_ptr();
   NodeId root_id() const;
   bool is_loaded(NodeId node_id) const;
@@ -58,6 +83,7 @@ class CellUsageTree : public std::enable_shared_from_this<CellUsageTree> {
   NodeId get_child(NodeId node_id, unsigned ref_id);
   void set_use_mark_for_is_loaded(bool use_mark = true);
   NodeId create_child(NodeId node_id, unsigned ref_id);
+  void apply(const LoadLog& log);
 
  private:
   struct Node {
@@ -68,7 +94,9 @@ class CellUsageTree : public std::enable_shared_from_this<CellUsageTree> {
   };
   bool use_mark_{false};
   std::vector<Node> nodes_{2};
+  std::mutex mutex_;
 
+  LoadRecorder* get_recorder();
   void on_load(NodeId node_id);
   NodeId create_node(NodeId parent);
 };
@@ -61,7 +61,7 @@ DataCell::SpecialType DataCell::special_type() const {
 }
 
 td::Result<Ref<DataCell>> DataCell::create(td::ConstBitPtr data, unsigned bits, td::MutableSpan<Ref<Cell>> refs,
-                                           bool special) {
+                                           bool special, td::Sha256Batch* hash_batch) {
   for (auto& ref : refs) {
     if (ref.is_null()) {
       return td::Status::Error("Has null cell reference");
@@ -224,22 +224,21 @@ td::Result<Ref<DataCell>> DataCell::create(td::ConstBitPtr data, unsigned bits,
     if (hash_i < hash_i_offset) {
       continue;
     }
-    unsigned char tmp[2];
-    tmp[0] = info.d1(level_mask.apply(level_i));
-    tmp[1] = info.d2();
-
-    static TD_THREAD_LOCAL digest::SHA256* hasher;
-    td::init_thread_local<digest::SHA256>(hasher);
-    hasher->reset();
-
-    hasher->feed(td::Slice(tmp, 2));
+    // representation: d1, d2, data or the hash of the previous level, depths and hashes of the children
+    unsigned char repr[2 + max_bytes + max_refs * (depth_bytes + hash_bytes)];
+    size_t repr_size = 0;
+    repr[repr_size++] = info.d1(level_mask.apply(level_i));
+    repr[repr_size++] = info.d2();
 
     if (hash_i == hash_i_offset) {
       DCHECK(level_i == 0 || type == SpecialType::PrunnedBranch);
-      hasher->feed(td::Slice(data_ptr, (bits + 7) >> 3));
+      auto data_bytes = (bits + 7) >> 3;
+      std::memcpy(repr + repr_size, data_ptr, data_bytes);
+      repr_size += data_bytes;
     } else {
       DCHECK(level_i != 0 && type != SpecialType::PrunnedBranch);
-      hasher->feed(hashes_ptr[hash_i - hash_i_offset - 1].as_slice());
+      std::memcpy(repr + repr_size, hashes_ptr[hash_i - hash_i_offset - 1].as_slice().ubegin(), hash_bytes);
+      repr_size += hash_bytes;
     }
 
     auto dest_i = hash_i - hash_i_offset;
@@ -255,9 +254,8 @@ td::Result<Ref<DataCell>> DataCell::create(td::ConstBitPtr data, unsigned bits,
       }
 
       // add depth into hash
-      td::uint8 child_depth_buf[depth_bytes];
-      store_depth(child_depth_buf, child_depth);
-      hasher->feed(td::Slice(child_depth_buf, depth_bytes));
+      store_depth(repr + repr_size, child_depth);
+      repr_size += depth_bytes;
 
       depth = std::max(depth, child_depth);
     }
@@ -272,11 +270,21 @@ td::Result<Ref<DataCell>> DataCell::create(td::ConstBitPtr data, unsigned bits,
     // children hash
     for (int i = 0; i < info.refs_count_; i++) {
       if (type == SpecialType::MerkleProof || type == SpecialType::MerkleUpdate) {
-        hasher->feed(refs_ptr[i]->get_hash(level_i + 1).as_slice());
+        std::memcpy(repr + repr_size, refs_ptr[i]->get_hash(level_i + 1).as_slice().ubegin(), hash_bytes);
       } else {
-        hasher->feed(refs_ptr[i]->get_hash(level_i).as_slice());
+        std::memcpy(repr + repr_size, refs_ptr[i]->get_hash(level_i).as_slice().ubegin(), hash_bytes);
       }
+      repr_size += hash_bytes;
     }
+
+    if (hash_batch != nullptr && hash_count == 1) {
+      hash_batch->add(td::Slice(repr, repr_size), hashes_ptr[dest_i].as_slice());
+      continue;
+    }
+    static TD_THREAD_LOCAL digest::SHA256* hasher;
+    td::init_thread_local<digest::SHA256>(hasher);
+    hasher->reset();
+    hasher->feed(td::Slice(repr, repr_size));
     auto extracted_size = hasher->extract(hashes_ptr[dest_i].as_slice());
     DCHECK(extracted_size == hash_bytes);
   }
@@ -19,6 +19,7 @@
 #pragma once
 #include "vm/cells/Cell.h"
 
+#include "td/utils/Sha256Batch.h"
 #include "td/utils/Span.h"
 
 #include "td/utils/ThreadSafeCounter.h"
@@ -202,8 +203,10 @@ class DataCell : public Cell {
 
   friend class CellBuilder;
   static td::Result<Ref<DataCell>> create(td::ConstBitPtr data, unsigned bits, td::Span<Ref<Cell>> refs, bool special);
+  // if hash_batch is given, the hash of a cell with a single hash is only added to it,
+  // and the cell must not be used before hash_batch->flush()
   static td::Result<Ref<DataCell>> create(td::ConstBitPtr data, unsigned bits, td::MutableSpan<Ref<Cell>> refs,
-                                          bool special);
+                                          bool special, td::Sha256Batch* hash_batch = nullptr);
 };
 
 std::ostream& operator<<(std::ostream& os, const DataCell& c);
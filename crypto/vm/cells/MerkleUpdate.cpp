@@ -21,18 +21,106 @@
 
 #include "td/utils/HashMap.h"
 #include "td/utils/HashSet.h"
+#include "td/utils/parallel_for.h"
 
 namespace vm {
 namespace detail {
+// roots of large update trees are split into independent subtrees, so that apply and validate may run on several threads
+constexpr size_t min_subtrees_per_thread = 16;
+constexpr int max_split_depth = 16;
+
+struct Subtree {
+  Ref<Cell> cell;
+  // the cell of the original tree with the same hash as cell, if the original tree is traversed along
+  Ref<Cell> original;
+  int merkle_depth;
+};
+
+// Traverses the top levels of the tree of root breadth-first until there are at least min_count distinct subtrees
+// below them, calls visit_top for all traversed cells and returns the subtrees in the order of traversal.
+// Cells without references (including prunned branches) are never returned as subtrees, so narrow updates
+// are split into few subtrees.
+template <class F>
+std::vector<Subtree> split_tree(Subtree root, size_t min_count, F &&visit_top) {
+  using Key = std::pair<Cell::Hash, int>;
+  td::HashSet<Key> seen;
+  std::vector<Subtree> subtrees;
+  subtrees.push_back(std::move(root));
+  for (int depth = 0; depth < max_split_depth && !subtrees.empty() && subtrees.size() < min_count; depth++) {
+    std::vector<Subtree> next;
+    for (auto &subtree : subtrees) {
+      visit_top(subtree);
+      CellSlice cs(NoVm(), subtree.cell);
+      if (cs.special_type() == Cell::SpecialType::PrunnedBranch) {
+        continue;
+      }
+      int child_merkle_depth = cs.child_merkle_depth(subtree.merkle_depth);
+      CellSlice cs_original;
+      if (subtree.original.not_null()) {
+        cs_original = CellSlice(NoVm(), subtree.original);
+      }
+      for (unsigned i = 0; i < cs.size_refs(); i++) {
+        Subtree child{cs.prefetch_ref(i), subtree.original.not_null() ? cs_original.prefetch_ref(i) : Ref<Cell>(),
+                      child_merkle_depth};
+        if (!seen.emplace(child.cell->get_hash(), child_merkle_depth).second) {
+          continue;
+        }
+        if (CellSlice(NoVm(), child.cell).size_refs() == 0) {
+          // leaves and prunned branches are not worth a task
+          visit_top(child);
+          continue;
+        }
+        next.push_back(std::move(child));
+      }
+    }
+    subtrees = std::move(next);
+  }
+  return subtrees;
+}
+
 class MerkleUpdateApply {
  public:
   Ref<Cell> apply(Ref<Cell> from, Ref<Cell> update_from, Ref<Cell> update_to, td::uint32 from_level,
-                  td::uint32 to_level) {
+                  td::uint32 to_level, int threads) {
     if (from_level != from->get_level()) {
       return {};
     }
-    dfs_both(from, update_from, from_level);
-    return dfs(update_to, to_level);
+    if (threads <= 1) {
+      dfs_both(from, update_from, from_level, known_cells_);
+      return dfs(update_to, to_level, ready_cells_);
+    }
+    size_t min_count = threads * min_subtrees_per_thread;
+
+    // cells of subtrees are collected separately and merged in the order of subtrees, so the result does not depend
+    // on the scheduling of the threads
+    auto from_subtrees =
+        split_tree(Subtree{update_from, from, static_cast<int>(from_level)}, min_count, [&](const Subtree &top) {
+          known_cells_.emplace(top.original->get_hash(top.merkle_depth), top.original);
+        });
+    std::vector<td::HashMap<Cell::Hash, Ref<Cell>>> known_cells(from_subtrees.size());
+    td::parallel_for(from_subtrees.size(), threads, [&](size_t i) {
+      auto &subtree = from_subtrees[i];
+      dfs_both(subtree.original, subtree.cell, subtree.merkle_depth, known_cells[i]);
+    });
+    for (auto &cells : known_cells) {
+      for (auto &it : cells) {
+        known_cells_.emplace(it.first, std::move(it.second));
+      }
+    }
+
+    // the new cells of subtrees are created in parallel, and then the top of the tree is created from them
+    auto to_subtrees = split_tree(Subtree{update_to, {}, static_cast<int>(to_level)}, min_count, [](const Subtree &) {});
+    std::vector<Ref<Cell>> new_subtrees(to_subtrees.size());
+    td::parallel_for(to_subtrees.size(), threads, [&](size_t i) {
+      td::HashMap<Key, Ref<Cell>> ready_cells;
+      new_subtrees[i] = dfs(to_subtrees[i].cell, to_subtrees[i].merkle_depth, ready_cells);
+    });
+    for (size_t i = 0; i < to_subtrees.size(); i++) {
+      // a failed subtree is stored too, so that the failure is reported when the top of the tree reaches it
+      ready_cells_.emplace(Key{to_subtrees[i].cell->get_hash(), to_subtrees[i].merkle_depth},
+                           std::move(new_subtrees[i]));
+    }
+    return dfs(update_to, to_level, ready_cells_);
   }
 
  private:
@@ -40,9 +128,10 @@ class MerkleUpdateApply {
   td::HashMap<Cell::Hash, Ref<Cell>> known_cells_;
   td::HashMap<Key, Ref<Cell>> ready_cells_;
 
-  void dfs_both(Ref<Cell> original, Ref<Cell> update_from, int merkle_depth) {
+  void dfs_both(Ref<Cell> original, Ref<Cell> update_from, int merkle_depth,
+                td::HashMap<Cell::Hash, Ref<Cell>> &known_cells) {
     CellSlice cs_update_from(NoVm(), update_from);
-    known_cells_.emplace(original->get_hash(merkle_depth), original);
+    known_cells.emplace(original->get_hash(merkle_depth), original);
     if (cs_update_from.special_type() == Cell::SpecialType::PrunnedBranch) {
       return;
     }
@@ -50,11 +139,11 @@ class MerkleUpdateApply {
 
     CellSlice cs_original(NoVm(), original);
     for (unsigned i = 0; i < cs_original.size_refs(); i++) {
-      dfs_both(cs_original.prefetch_ref(i), cs_update_from.prefetch_ref(i), child_merkle_depth);
+      dfs_both(cs_original.prefetch_ref(i), cs_update_from.prefetch_ref(i), child_merkle_depth, known_cells);
     }
   }
 
-  Ref<Cell> dfs(Ref<Cell> cell, int merkle_depth) {
+  Ref<Cell> dfs(Ref<Cell> cell, int merkle_depth, td::HashMap<Key, Ref<Cell>> &ready_cells) {
     CellSlice cs(NoVm(), cell);
     if (cs.special_type() == Cell::SpecialType::PrunnedBranch) {
       if ((int)cell->get_level() == merkle_depth + 1) {
@@ -68,8 +157,8 @@ class MerkleUpdateApply {
     }
     Key key{cell->get_hash(), merkle_depth};
     {
-      auto it = ready_cells_.find(key);
-      if (it != ready_cells_.end()) {
+      auto it = ready_cells.find(key);
+      if (it != ready_cells.end()) {
         return it->second;
       }
     }
@@ -79,23 +168,53 @@ class MerkleUpdateApply {
     CellBuilder cb;
     cb.store_bits(cs.fetch_bits(cs.size()));
     for (unsigned i = 0; i < cs.size_refs(); i++) {
-      auto ref = dfs(cs.prefetch_ref(i), child_merkle_depth);
+      auto ref = dfs(cs.prefetch_ref(i), child_merkle_depth, ready_cells);
       if (ref.is_null()) {
         return {};
       }
       cb.store_ref(std::move(ref));
     }
     auto res = cb.finalize(cs.is_special());
-    ready_cells_.emplace(key, res);
+    ready_cells.emplace(key, res);
     return res;
   }
 };
 
 class MerkleUpdateValidator {
  public:
-  td::Status validate(Ref<Cell> update_from, Ref<Cell> update_to, td::uint32 from_level, td::uint32 to_level) {
-    dfs_from(update_from, from_level);
-    return dfs_to(update_to, to_level);
+  td::Status validate(Ref<Cell> update_from, Ref<Cell> update_to, td::uint32 from_level, td::uint32 to_level,
+                      int threads) {
+    if (threads <= 1) {
+      dfs_from(update_from, from_level, known_cells_, visited_from_);
+      return dfs_to(update_to, to_level, visited_to_);
+    }
+    size_t min_count = threads * min_subtrees_per_thread;
+
+    auto from_subtrees =
+        split_tree(Subtree{update_from, {}, static_cast<int>(from_level)}, min_count,
+                   [&](const Subtree &top) { known_cells_.insert(top.cell->get_hash(top.merkle_depth)); });
+    std::vector<td::HashSet<Cell::Hash>> known_cells(from_subtrees.size());
+    td::parallel_for(from_subtrees.size(), threads, [&](size_t i) {
+      td::HashSet<Key> visited;
+      dfs_from(from_subtrees[i].cell, from_subtrees[i].merkle_depth, known_cells[i], visited);
+    });
+    for (auto &cells : known_cells) {
+      known_cells_.insert(cells.begin(), cells.end());
+    }
+
+    // the subtrees are checked in parallel, and then the top of the tree is checked in the same order
+    // as by the sequential validation, so that the same error is returned
+    auto to_subtrees = split_tree(Subtree{update_to, {}, static_cast<int>(to_level)}, min_count, [](const Subtree &) {});
+    std::vector<td::Status> statuses(to_subtrees.size());
+    td::parallel_for(to_subtrees.size(), threads, [&](size_t i) {
+      td::HashSet<Key> visited;
+      statuses[i] = dfs_to(to_subtrees[i].cell, to_subtrees[i].merkle_depth, visited);
+    });
+    for (size_t i = 0; i < to_subtrees.size(); i++) {
+      subtree_statuses_.emplace(Key{to_subtrees[i].cell->get_hash(), to_subtrees[i].merkle_depth},
+                                std::move(statuses[i]));
+    }
+    return dfs_to(update_to, to_level, visited_to_);
   }
 
  private:
@@ -103,26 +222,33 @@ class MerkleUpdateValidator {
   using Key = std::pair<Cell::Hash, int>;
   td::HashSet<Key> visited_from_;
   td::HashSet<Key> visited_to_;
+  td::HashMap<Key, td::Status> subtree_statuses_;
 
-  void dfs_from(Ref<Cell> cell, int merkle_depth) {
-    if (!visited_from_.emplace(cell->get_hash(), merkle_depth).second) {
+  void dfs_from(Ref<Cell> cell, int merkle_depth, td::HashSet<Cell::Hash> &known_cells, td::HashSet<Key> &visited) {
+    if (!visited.emplace(cell->get_hash(), merkle_depth).second) {
       return;
     }
     CellSlice cs(NoVm(), cell);
-    known_cells_.insert(cell->get_hash(merkle_depth));
+    known_cells.insert(cell->get_hash(merkle_depth));
     if (cs.special_type() == Cell::SpecialType::PrunnedBranch) {
       return;
     }
     int child_merkle_depth = cs.child_merkle_depth(merkle_depth);
     for (unsigned i = 0; i < cs.size_refs(); i++) {
-      dfs_from(cs.prefetch_ref(i), child_merkle_depth);
+      dfs_from(cs.prefetch_ref(i), child_merkle_depth, known_cells, visited);
     }
   }
 
-  td::Status dfs_to(Ref<Cell> cell, int merkle_depth) {
-    if (!visited_to_.emplace(cell->get_hash(), merkle_depth).second) {
+  td::Status dfs_to(Ref<Cell> cell, int merkle_depth, td::HashSet<Key> &visited) {
+    if (!visited.emplace(cell->get_hash(), merkle_depth).second) {
       return td::Status::OK();
     }
+    if (!subtree_statuses_.empty()) {
+      auto it = subtree_statuses_.find(Key{cell->get_hash(), merkle_depth});
+      if (it != subtree_statuses_.end()) {
+        return it->second.clone();
+      }
+    }
     CellSlice cs(NoVm(), cell);
     if (cs.special_type() == Cell::SpecialType::PrunnedBranch) {
       if ((int)cell->get_level() == merkle_depth + 1) {
@@ -136,7 +262,7 @@ class MerkleUpdateValidator {
     int child_merkle_depth = cs.child_merkle_depth(merkle_depth);
 
     for (unsigned i = 0; i < cs.size_refs(); i++) {
-      TRY_STATUS(dfs_to(cs.prefetch_ref(i), child_merkle_depth));
+      TRY_STATUS(dfs_to(cs.prefetch_ref(i), child_merkle_depth, visited));
     }
     return td::Status::OK();
   }
@@ -158,7 +284,7 @@ td::Status MerkleUpdate::may_apply(Ref<Cell> from, Ref<Cell> update) {
   return td::Status::OK();
 }
 
-Ref<Cell> MerkleUpdate::apply(Ref<Cell> from, Ref<Cell> update) {
+Ref<Cell> MerkleUpdate::apply(Ref<Cell> from, Ref<Cell> update, int threads) {
   if (update->get_level() != 0 || from->get_level() != 0) {
     return {};
   }
@@ -168,17 +294,18 @@ Ref<Cell> MerkleUpdate::apply(Ref<Cell> from, Ref<Cell> update) {
   }
   auto update_from = cs.fetch_ref();
   auto update_to = cs.fetch_ref();
-  return apply_raw(std::move(from), std::move(update_from), std::move(update_to), 0, 0);
+  return apply_raw(std::move(from), std::move(update_from), std::move(update_to), 0, 0, threads);
 }
 
 Ref<Cell> MerkleUpdate::apply_raw(Ref<Cell> from, Ref<Cell> update_from, Ref<Cell> update_to, td::uint32 from_level,
-                                  td::uint32 to_level) {
+                                  td::uint32 to_level, int threads) {
   if (from->get_hash(from_level) != update_from->get_hash(from_level)) {
     LOG(DEBUG) << "invalid Merkle update: expected old value hash = " << update_from->get_hash(from_level).to_hex()
                << ", applied to value with hash = " << from->get_hash(from_level).to_hex();
     return {};
   }
-  return detail::MerkleUpdateApply().apply(from, std::move(update_from), std::move(update_to), from_level, to_level);
+  return detail::MerkleUpdateApply().apply(from, std::move(update_from), std::move(update_to), from_level, to_level,
+                                           threads);
 }
 
 std::pair<Ref<Cell>, Ref<Cell>> MerkleUpdate::generate_raw(Ref<Cell> from, Ref<Cell> to, CellUsageTree *usage_tree) {
@@ -197,11 +324,12 @@ std::pair<Ref<Cell>, Ref<Cell>> MerkleUpdate::generate_raw(Ref<Cell> from, Ref<C
 }
 
 td::Status MerkleUpdate::validate_raw(Ref<Cell> update_from, Ref<Cell> update_to, td::uint32 from_level,
-                                      td::uint32 to_level) {
-  return detail::MerkleUpdateValidator().validate(std::move(update_from), std::move(update_to), from_level, to_level);
+                                      td::uint32 to_level, int threads) {
+  return detail::MerkleUpdateValidator().validate(std::move(update_from), std::move(update_to), from_level, to_level,
+                                                  threads);
 }
 
-td::Status MerkleUpdate::validate(Ref<Cell> update) {
+td::Status MerkleUpdate::validate(Ref<Cell> update, int threads) {
   if (update->get_level() != 0) {
     return td::Status::Error("nonzero level");
   }
@@ -211,7 +339,7 @@ td::Status MerkleUpdate::validate(Ref<Cell> update) {
   }
   auto update_from = cs.fetch_ref();
   auto update_to = cs.fetch_ref();
-  return validate_raw(std::move(update_from), std::move(update_to), 0, 0);
+  return validate_raw(std::move(update_from), std::move(update_to), 0, 0, threads);
 }
 
 Ref<Cell> MerkleUpdate::generate(Ref<Cell> from, Ref<Cell> to, CellUsageTree *usage_tree) {
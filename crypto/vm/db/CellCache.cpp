@@ -0,0 +1,137 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#include "vm/db/CellCache.h"
+
+namespace vm {
+
+CellCache::CellCache(size_t max_memory) : max_shard_memory_(td::max<size_t>(max_memory / shards_count, 1)) {
+}
+
+size_t CellCache::cell_memory(const DataCell &cell) {
+  // the entry with its hash table node, the cell and its children, which are usually ExtCells with hashes only
+  return sizeof(Entry) + sizeof(CellHash) + 2 * sizeof(void *) + sizeof(DataCell) + cell.get_serialized_size(true) +
+         cell.size_refs() * (sizeof(DataCell) + Cell::hash_bytes + Cell::depth_bytes);
+}
+
+size_t CellCache::get_shard_id(td::Slice hash) {
+  CHECK(hash.size() == Cell::hash_bytes);
+  // first bytes of the hash are already used by std::hash<CellHash>
+  return hash.ubegin()[Cell::hash_bytes - 1] % shards_count;
+}
+
+CellCache::Shard &CellCache::get_shard(td::Slice hash) {
+  return shards_[get_shard_id(hash)];
+}
+
+Ref<DataCell> CellCache::get(td::Slice hash) {
+  auto &shard = get_shard(hash);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  auto it = shard.map.find(CellHash::from_slice(hash));
+  if (it == shard.map.end()) {
+    shard.misses++;
+    return {};
+  }
+  shard.hits++;
+  it->second->remove();
+  shard.lru.put(it->second.get());
+  return it->second->cell;
+}
+
+bool CellCache::contains(td::Slice hash) const {
+  auto &shard = shards_[get_shard_id(hash)];
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  return shard.map.count(CellHash::from_slice(hash)) != 0;
+}
+
+void CellCache::put(Ref<DataCell> cell, td::uint64 generation) {
+  CHECK(cell.not_null());
+  auto hash = cell->get_hash();
+  auto &shard = get_shard(hash.as_slice());
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  // checked under the lock: set_loader() starts a new generation before it erases cells
+  if (generation != generation_.load(std::memory_order_acquire)) {
+    return;
+  }
+  auto &entry = shard.map[hash];
+  if (!entry) {
+    entry = std::make_unique<Entry>();
+    entry->memory = cell_memory(*cell);
+    entry->cell = std::move(cell);
+    shard.memory += entry->memory;
+  }
+  entry->remove();
+  shard.lru.put(entry.get());
+  while (shard.memory > max_shard_memory_ && !shard.lru.empty()) {
+    auto to_remove = Entry::from_list_node(shard.lru.get());
+    CHECK(to_remove);
+    shard.memory -= to_remove->memory;
+    shard.map.erase(to_remove->cell->get_hash());
+    shard.evictions++;
+  }
+}
+
+void CellCache::erase(td::Slice hash) {
+  auto &shard = get_shard(hash);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  auto it = shard.map.find(CellHash::from_slice(hash));
+  if (it != shard.map.end()) {
+    shard.memory -= it->second->memory;
+    shard.map.erase(it);
+  }
+}
+
+void CellCache::erase_on_next_loader(td::Slice hash) {
+  std::lock_guard<std::mutex> guard(loader_mutex_);
+  erased_cells_.push_back(CellHash::from_slice(hash));
+}
+
+void CellCache::set_loader(std::shared_ptr<CellLoader> loader) {
+  std::vector<CellHash> erased_cells;
+  {
+    std::lock_guard<std::mutex> guard(loader_mutex_);
+    loader_ = std::move(loader);
+    generation_.fetch_add(1, std::memory_order_acq_rel);
+    erased_cells = std::move(erased_cells_);
+    erased_cells_.clear();
+  }
+  // loads started before the swap may still find erased cells, but can't put them back with the old generation
+  for (auto &hash : erased_cells) {
+    erase(hash.as_slice());
+  }
+}
+
+std::pair<std::shared_ptr<CellLoader>, td::uint64> CellCache::get_loader() const {
+  std::lock_guard<std::mutex> guard(loader_mutex_);
+  return {loader_, generation_.load(std::memory_order_acquire)};
+}
+
+CellCache::Stats CellCache::get_stats() const {
+  Stats res;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    res.hits += shard.hits;
+    res.misses += shard.misses;
+    res.evictions += shard.evictions;
+    res.size += shard.map.size();
+    res.memory += shard.memory;
+  }
+  return res;
+}
+
+}  // namespace vm
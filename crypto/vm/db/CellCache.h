@@ -0,0 +1,102 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#pragma once
+#include "vm/cells.h"
+
+#include "td/utils/List.h"
+#include "td/utils/Slice.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vm {
+class CellLoader;
+
+// Thread-safe cache of cells loaded from a cell db, shared by all bags of cells over this db, bounded by memory.
+// Cells are loaded through the latest snapshot of the db, which the writer sets after every commit; children of
+// cached cells load through the latest snapshot too, so cached cells survive snapshot swaps without keeping old
+// snapshots alive. Cells erased by a commit are dropped from the cache when the snapshot after that commit is set.
+class CellCache {
+ public:
+  struct Stats {
+    td::uint64 hits{0};
+    td::uint64 misses{0};
+    td::uint64 evictions{0};
+    size_t size{0};
+    size_t memory{0};
+  };
+
+  explicit CellCache(size_t max_memory);
+
+  Ref<DataCell> get(td::Slice hash);
+  // doesn't count as a hit or a miss
+  bool contains(td::Slice hash) const;
+  // cells loaded through a loader of an older generation are not cached
+  void put(Ref<DataCell> cell, td::uint64 generation);
+  // the cell is being erased from the db; it is dropped when the next loader is set
+  void erase_on_next_loader(td::Slice hash);
+  // called by the writer with a snapshot taken after each commit
+  void set_loader(std::shared_ptr<CellLoader> loader);
+  // the latest loader with its generation; null until the first set_loader
+  std::pair<std::shared_ptr<CellLoader>, td::uint64> get_loader() const;
+
+  Stats get_stats() const;
+
+ private:
+  static constexpr size_t shards_count = 64;
+
+  struct Entry : public td::ListNode {
+    Ref<DataCell> cell;
+    size_t memory{0};
+    static Entry *from_list_node(td::ListNode *node) {
+      return static_cast<Entry *>(node);
+    }
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<CellHash, std::unique_ptr<Entry>> map;
+    td::ListNode lru;
+    size_t memory{0};
+    td::uint64 hits{0};
+    td::uint64 misses{0};
+    td::uint64 evictions{0};
+  };
+
+  size_t max_shard_memory_;
+  std::atomic<td::uint64> generation_{0};
+
+  mutable std::mutex loader_mutex_;
+  std::shared_ptr<CellLoader> loader_;
+  std::vector<CellHash> erased_cells_;
+
+  std::array<Shard, shards_count> shards_;
+
+  static size_t get_shard_id(td::Slice hash);
+  Shard &get_shard(td::Slice hash);
+  void erase(td::Slice hash);
+  static size_t cell_memory(const DataCell &cell);
+};
+
+}  // namespace vm
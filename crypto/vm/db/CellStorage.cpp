@@ -19,6 +19,7 @@
 #include "vm/db/CellStorage.h"
 #include "vm/db/DynamicBagOfCellsDb.h"
 #include "vm/boc.h"
+#include "vm/cells/PrunnedCell.h"
 #include "td/utils/base64.h"
 #include "td/utils/tl_parsers.h"
 #include "td/utils/tl_helpers.h"
@@ -128,14 +129,52 @@ CellLoader::CellLoader(std::shared_ptr<KeyValueReader> reader) : reader_(std::mo
 
 td::Result<CellLoader::LoadResult> CellLoader::load(td::Slice hash, bool need_data, ExtCellCreator &ext_cell_creator) {
   //LOG(ERROR) << "Storage: load cell " << hash.size() << " " << td::base64_encode(hash);
-  LoadResult res;
   std::string serialized;
   TRY_RESULT(get_status, reader_->get(hash, serialized));
   if (get_status != KeyValue::GetStatus::Ok) {
     DCHECK(get_status == KeyValue::GetStatus::NotFound);
-    return res;
+    return LoadResult{};
+  }
+  return parse(serialized, need_data, ext_cell_creator);
+}
+
+td::Result<std::vector<CellLoader::LoadResult>> CellLoader::load_multi(td::Span<td::Slice> hashes, bool need_data,
+                                                                       ExtCellCreator &ext_cell_creator) {
+  std::vector<std::string> serialized;
+  TRY_RESULT(get_statuses, reader_->get_multi(hashes, serialized));
+  std::vector<LoadResult> res;
+  res.reserve(hashes.size());
+  for (size_t i = 0; i < hashes.size(); i++) {
+    if (get_statuses[i] != KeyValue::GetStatus::Ok) {
+      DCHECK(get_statuses[i] == KeyValue::GetStatus::NotFound);
+      res.emplace_back();
+      continue;
+    }
+    TRY_RESULT(load_result, parse(serialized[i], need_data, ext_cell_creator));
+    res.push_back(std::move(load_result));
   }
+  return std::move(res);
+}
 
+td::Result<Ref<DataCell>> CellLoader::load_detached(td::Slice hash) {
+  class PrunnedCellCreator : public ExtCellCreator {
+   public:
+    td::Result<Ref<Cell>> ext_cell(Cell::LevelMask level_mask, td::Slice hash, td::Slice depth) override {
+      TRY_RESULT(cell, PrunnedCell<td::Unit>::create(PrunnedCellInfo{level_mask, hash, depth}, td::Unit()));
+      return std::move(cell);
+    }
+  };
+  PrunnedCellCreator ext_cell_creator;
+  TRY_RESULT(load_result, load(hash, true, ext_cell_creator));
+  if (load_result.status != LoadResult::Ok) {
+    return td::Status::Error("cell not found in the cell db");
+  }
+  return std::move(load_result.cell());
+}
+
+td::Result<CellLoader::LoadResult> CellLoader::parse(td::Slice serialized, bool need_data,
+                                                     ExtCellCreator &ext_cell_creator) {
+  LoadResult res;
   res.status = LoadResult::Ok;
 
   RefcntCellParser refcnt_cell(need_data);
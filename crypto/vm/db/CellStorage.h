@@ -22,6 +22,7 @@
 #include "vm/cells.h"
 
 #include "td/utils/Slice.h"
+#include "td/utils/Span.h"
 #include "td/utils/Status.h"
 
 namespace vm {
@@ -48,8 +49,16 @@ class CellLoader {
   };
   CellLoader(std::shared_ptr<KeyValueReader> reader);
   td::Result<LoadResult> load(td::Slice hash, bool need_data, ExtCellCreator &ext_cell_creator);
+  // loads all cells with one KeyValueReader::get_multi call
+  td::Result<std::vector<LoadResult>> load_multi(td::Span<td::Slice> hashes, bool need_data,
+                                                 ExtCellCreator &ext_cell_creator);
+  // loads a cell with its children kept as pruned cells: only their hashes are known, and the result
+  // refers neither to the loader nor to other loaded cells
+  td::Result<Ref<DataCell>> load_detached(td::Slice hash);
 
  private:
+  static td::Result<LoadResult> parse(td::Slice serialized, bool need_data, ExtCellCreator &ext_cell_creator);
+
   std::shared_ptr<KeyValueReader> reader_;
 };
 
@@ -19,6 +19,7 @@
 #include "vm/db/DynamicBagOfCellsDb.h"
 #include "vm/db/CellStorage.h"
 #include "vm/db/CellHashTable.h"
+#include "vm/db/CellCache.h"
 
 #include "vm/cells/ExtCell.h"
 
@@ -28,6 +29,11 @@
 
 #include "vm/cellslice.h"
 
+#include <algorithm>
+#include <array>
+#include <map>
+#include <set>
+
 namespace vm {
 namespace {
 
@@ -50,6 +56,83 @@ class DynamicBocCellLoader {
 
 using DynamicBocExtCell = ExtCell<DynamicBocExtCellExtra, DynamicBocCellLoader>;
 
+// Loads cells through the latest snapshot of the CellCache, so cached cells don't refer to any particular snapshot
+class CachedCellReader : public CellDbReader,
+                         private ExtCellCreator,
+                         public std::enable_shared_from_this<CachedCellReader> {
+ public:
+  explicit CachedCellReader(std::weak_ptr<CellCache> cell_cache) : cell_cache_(std::move(cell_cache)) {
+  }
+
+  td::Result<Ref<Cell>> ext_cell(Cell::LevelMask level_mask, td::Slice hash, td::Slice depth) override {
+    TRY_RESULT(ext_cell, DynamicBocExtCell::create(PrunnedCellInfo{level_mask, hash, depth},
+                                                   DynamicBocExtCellExtra{shared_from_this()}));
+    return std::move(ext_cell);
+  }
+
+  td::Result<Ref<DataCell>> load_cell(td::Slice hash) override {
+    TRY_RESULT(cell, load_cached_cell(hash));
+    if (cell.is_null()) {
+      // the cell was erased by a GC after its parent had been cached
+      return td::Status::Error("cell is not in the latest snapshot of the cell db");
+    }
+    return std::move(cell);
+  }
+
+  // returns null if there is no such cell in the latest snapshot
+  td::Result<Ref<DataCell>> load_cached_cell(td::Slice hash) {
+    auto cell_cache = cell_cache_.lock();
+    if (!cell_cache) {
+      return Ref<DataCell>();
+    }
+    auto cell = cell_cache->get(hash);
+    if (cell.not_null()) {
+      return std::move(cell);
+    }
+    auto loader = cell_cache->get_loader();
+    if (!loader.first) {
+      return Ref<DataCell>();
+    }
+    TRY_RESULT(load_result, loader.first->load(hash, true, *this));
+    if (load_result.status != CellLoader::LoadResult::Ok) {
+      return Ref<DataCell>();
+    }
+    cell_cache->put(load_result.cell(), loader.second);
+    prefetch_children(*cell_cache, *loader.first, loader.second, *load_result.cell());
+    return std::move(load_result.cell());
+  }
+
+ private:
+  // children are usually needed soon after their parent, so they are loaded into the cache with one batched read
+  void prefetch_children(CellCache &cell_cache, CellLoader &loader, td::uint64 generation, const DataCell &cell) {
+    std::array<Cell::Hash, Cell::max_refs> hashes;
+    std::array<td::Slice, Cell::max_refs> keys;
+    size_t keys_size = 0;
+    for (unsigned i = 0; i < cell.size_refs(); i++) {
+      hashes[keys_size] = cell.get_ref(i)->get_hash();
+      if (!cell_cache.contains(hashes[keys_size].as_slice())) {
+        keys[keys_size] = hashes[keys_size].as_slice();
+        keys_size++;
+      }
+    }
+    if (keys_size == 0) {
+      return;
+    }
+    auto r_results = loader.load_multi(td::Span<td::Slice>(keys.data(), keys_size), true, *this);
+    if (r_results.is_error()) {
+      return;
+    }
+    for (auto &result : r_results.ok_ref()) {
+      if (result.status == CellLoader::LoadResult::Ok) {
+        cell_cache.put(std::move(result.cell()), generation);
+      }
+    }
+  }
+
+  // cached cells keep the reader alive, so it must not keep the cache alive
+  std::weak_ptr<CellCache> cell_cache_;
+};
+
 struct CellInfo {
   bool sync_with_db{false};
   bool in_db{false};
@@ -78,7 +161,10 @@ bool operator<(td::Slice a, const CellInfo &b) {
 
 class DynamicBagOfCellsDbImpl : public DynamicBagOfCellsDb, private ExtCellCreator {
  public:
-  DynamicBagOfCellsDbImpl() {
+  explicit DynamicBagOfCellsDbImpl(std::shared_ptr<CellCache> cell_cache) : cell_cache_(std::move(cell_cache)) {
+    if (cell_cache_) {
+      cached_cell_reader_ = std::make_shared<CachedCellReader>(cell_cache_);
+    }
     get_thread_safe_counter().add(1);
   }
   ~DynamicBagOfCellsDbImpl() {
@@ -139,6 +225,8 @@ class DynamicBagOfCellsDbImpl : public DynamicBagOfCellsDb, private ExtCellCreat
     if (is_prepared_for_commit()) {
       return td::Status::OK();
     }
+    //LOG(ERROR) << "prefetch_new_cells_in_db";
+    prefetch_new_cells_in_db();
     //LOG(ERROR) << "dfs_new_cells_in_db";
     for (auto &new_cell : to_inc_) {
       auto &new_cell_info = get_cell_info(new_cell);
@@ -151,11 +239,12 @@ class DynamicBagOfCellsDbImpl : public DynamicBagOfCellsDb, private ExtCellCreat
       dfs_new_cells(new_cell_info);
     }
 
-    //LOG(ERROR) << "dfs_old_cells";
+    //LOG(ERROR) << "bfs_old_cells";
+    std::vector<CellInfo *> old_cells;
     for (auto &old_cell : to_dec_) {
-      auto &old_cell_info = get_cell_info(old_cell);
-      dfs_old_cells(old_cell_info);
+      old_cells.push_back(&get_cell_info(old_cell));
     }
+    bfs_old_cells(std::move(old_cells));
 
     //LOG(ERROR) << "save_diff_prepare";
     save_diff_prepare();
@@ -181,20 +270,25 @@ class DynamicBagOfCellsDbImpl : public DynamicBagOfCellsDb, private ExtCellCreat
     loader_ = std::move(loader);
     //cell_db_reader_ = std::make_shared<CellDbReaderImpl>(this);
     // Temporary(?) fix to make ExtCell thread safe.
-    // Downside(?) - loaded cells won't be cached
-    cell_db_reader_ = std::make_shared<CellDbReaderImpl>(std::make_unique<CellLoader>(*loader_));
+    // Downside(?) - loaded cells are cached only in cell_cache_ (if any)
+    cell_db_reader_ =
+        std::make_shared<CellDbReaderImpl>(std::make_unique<CellLoader>(*loader_), cached_cell_reader_);
     stats_diff_ = {};
     return td::Status::OK();
   }
 
  private:
   std::unique_ptr<CellLoader> loader_;
+  std::shared_ptr<CellCache> cell_cache_;
+  std::shared_ptr<CachedCellReader> cached_cell_reader_;
   std::vector<Ref<Cell>> to_inc_;
   std::vector<Ref<Cell>> to_dec_;
   CellHashTable<CellInfo> hash_table_;
   std::vector<CellInfo *> visited_;
   Stats stats_diff_;
 
+  static constexpr size_t max_load_batch_size = 4096;
+
   static td::NamedThreadSafeCounter::CounterRef get_thread_safe_counter() {
     static auto res = td::NamedThreadSafeCounter::get_default().get_counter("DynamicBagOfCellsDb");
     return res;
@@ -204,7 +298,8 @@ class DynamicBagOfCellsDbImpl : public DynamicBagOfCellsDb, private ExtCellCreat
                            private ExtCellCreator,
                            public std::enable_shared_from_this<CellDbReaderImpl> {
    public:
-    CellDbReaderImpl(std::unique_ptr<CellLoader> cell_loader) : db_(nullptr), cell_loader_(std::move(cell_loader)) {
+    CellDbReaderImpl(std::unique_ptr<CellLoader> cell_loader, std::shared_ptr<CachedCellReader> cached_cell_reader)
+        : db_(nullptr), cell_loader_(std::move(cell_loader)), cached_cell_reader_(std::move(cached_cell_reader)) {
       if (cell_loader_) {
         get_thread_safe_counter().add(1);
       }
@@ -239,6 +334,13 @@ class DynamicBagOfCellsDbImpl : public DynamicBagOfCellsDb, private ExtCellCreat
       if (db_) {
         return db_->load_cell(hash);
       }
+      if (cached_cell_reader_) {
+        TRY_RESULT(cell, cached_cell_reader_->load_cached_cell(hash));
+        if (cell.not_null()) {
+          return std::move(cell);
+        }
+        // erased after the snapshot of this reader was taken; load it from the snapshot, bypassing the cache
+      }
       TRY_RESULT(load_result, cell_loader_->load(hash, true, *this));
       CHECK(load_result.status == CellLoader::LoadResult::Ok);
       return std::move(load_result.cell());
@@ -251,6 +353,7 @@ class DynamicBagOfCellsDbImpl : public DynamicBagOfCellsDb, private ExtCellCreat
     }
     DynamicBagOfCellsDb *db_;
     std::unique_ptr<CellLoader> cell_loader_;
+    std::shared_ptr<CachedCellReader> cached_cell_reader_;
   };
 
   std::shared_ptr<CellDbReaderImpl> cell_db_reader_;
@@ -323,23 +426,69 @@ class DynamicBagOfCellsDbImpl : public DynamicBagOfCellsDb, private ExtCellCreat
     for_each(info, [this](auto &child_info) { dfs_new_cells(child_info); });
   }
 
-  void dfs_old_cells(CellInfo &info) {
-    info.refcnt_diff--;
-    if (!info.was) {
-      info.was = true;
-      visited_.push_back(&info);
+  // Same as dfs_new_cells_in_db without recursion, but cells are loaded from db in batches, one batch per cell depth.
+  // Children have smaller depth than their parents, so all children are synced before their parent is processed.
+  void prefetch_new_cells_in_db() {
+    std::map<td::uint16, std::vector<CellInfo *>> by_depth;
+    std::set<CellInfo *> seen;
+    std::vector<CellInfo *> stack;
+    for (auto &new_cell : to_inc_) {
+      stack.push_back(&get_cell_info(new_cell));
     }
-    //LOG(ERROR) << "dfs old " << td::format::escaped(info.cell->hash());
+    while (!stack.empty()) {
+      auto info = stack.back();
+      stack.pop_back();
+      if (info->sync_with_db || info->in_db || !seen.insert(info).second) {
+        continue;
+      }
+      by_depth[info->cell->get_depth()].push_back(info);
+      for_each(
+          *info, [&stack](auto &child_info) { stack.push_back(&child_info); }, false);
+    }
+
+    for (auto &it : by_depth) {
+      std::vector<CellInfo *> to_load;
+      for (auto info : it.second) {
+        bool not_in_db = false;
+        for_each(
+            *info, [&not_in_db](auto &child_info) { not_in_db |= child_info.sync_with_db && !child_info.in_db; },
+            false);
+        if (not_in_db) {
+          CHECK(!info->in_db);
+          info->sync_with_db = true;
+        } else {
+          to_load.push_back(info);
+        }
+      }
+      load_cells(to_load);
+    }
+  }
 
-    load_cell(info);
+  void bfs_old_cells(std::vector<CellInfo *> infos) {
+    while (!infos.empty()) {
+      load_cells(infos);
+      std::vector<CellInfo *> next_infos;
+      for (auto info_ptr : infos) {
+        auto &info = *info_ptr;
+        info.refcnt_diff--;
+        if (!info.was) {
+          info.was = true;
+          visited_.push_back(&info);
+        }
+        //LOG(ERROR) << "bfs old " << td::format::escaped(info.cell->hash());
 
-    auto new_refcnt = info.refcnt_diff + info.db_refcnt;
-    CHECK(new_refcnt >= 0);
-    if (new_refcnt != 0) {
-      return;
-    }
+        load_cell(info);
+
+        auto new_refcnt = info.refcnt_diff + info.db_refcnt;
+        CHECK(new_refcnt >= 0);
+        if (new_refcnt != 0) {
+          continue;
+        }
 
-    for_each(info, [this](auto &child_info) { dfs_old_cells(child_info); });
+        for_each(info, [&next_infos](auto &child_info) { next_infos.push_back(&child_info); });
+      }
+      infos = std::move(next_infos);
+    }
   }
 
   void save_diff_prepare() {
@@ -398,6 +547,9 @@ class DynamicBagOfCellsDbImpl : public DynamicBagOfCellsDb, private ExtCellCreat
       //LOG(ERROR) << "ERASE";
       //CellSlice(NoVm(), info.cell).print_rec(std::cout);
       storer.erase(info.cell->get_hash().as_slice());
+      if (cell_cache_) {
+        cell_cache_->erase_on_next_loader(info.cell->get_hash().as_slice());
+      }
       info.in_db = false;
       hash_table_.erase(info.cell->get_hash().as_slice());
       guard.dismiss();
@@ -461,20 +613,69 @@ class DynamicBagOfCellsDbImpl : public DynamicBagOfCellsDb, private ExtCellCreat
       info.in_db = true;  // TODO
     }
   }
-  void update_cell_info_force(CellInfo &info, td::Slice hash) {
-    if (info.sync_with_db) {
-      return;
+  void load_cells(td::Span<CellInfo *> infos) {
+    std::vector<CellInfo *> to_load;
+    for (auto info : infos) {
+      if (!is_loaded(*info)) {
+        to_load.push_back(info);
+      }
     }
+    std::sort(to_load.begin(), to_load.end());
+    to_load.erase(std::unique(to_load.begin(), to_load.end()), to_load.end());
 
-    do {
+    for (size_t begin = 0; begin < to_load.size(); begin += max_load_batch_size) {
+      auto end = td::min(begin + max_load_batch_size, to_load.size());
+      if (end - begin == 1) {
+        do_load_cell(*to_load[begin]);
+        continue;
+      }
+      std::vector<Cell::Hash> hashes;
+      std::vector<td::Slice> keys;
+      hashes.reserve(end - begin);
+      keys.reserve(end - begin);
+      for (size_t i = begin; i < end; i++) {
+        hashes.push_back(to_load[i]->cell->get_hash());
+        keys.push_back(hashes.back().as_slice());
+      }
       CHECK(loader_);
-      auto r_res = loader_->load(hash, true, *this);
+      auto r_res = loader_->load_multi(keys, true, *this);
       if (r_res.is_error()) {
         //FIXME
-        LOG(ERROR) << "Failed to load cell from db" << r_res.error();
-        break;
+        LOG(ERROR) << "Failed to load cells from db" << r_res.error();
+        for (size_t i = begin; i < end; i++) {
+          to_load[i]->sync_with_db = true;
+        }
+        continue;
       }
       auto res = r_res.move_as_ok();
+      for (size_t i = begin; i < end; i++) {
+        update_cell_info_loaded(*to_load[i], keys[i - begin], std::move(res[i - begin]));
+      }
+    }
+  }
+
+  void update_cell_info_force(CellInfo &info, td::Slice hash) {
+    if (info.sync_with_db) {
+      return;
+    }
+
+    CHECK(loader_);
+    auto r_res = loader_->load(hash, true, *this);
+    if (r_res.is_error()) {
+      //FIXME
+      LOG(ERROR) << "Failed to load cell from db" << r_res.error();
+      info.sync_with_db = true;
+      return;
+    }
+    update_cell_info_loaded(info, hash, r_res.move_as_ok());
+  }
+
+  void update_cell_info_loaded(CellInfo &info, td::Slice hash, CellLoader::LoadResult res) {
+    if (info.sync_with_db) {
+      return;
+    }
+
+    do {
       if (res.status != CellLoader::LoadResult::Ok) {
         break;
       }
@@ -494,7 +695,7 @@ class DynamicBagOfCellsDbImpl : public DynamicBagOfCellsDb, private ExtCellCreat
 };
 }  // namespace
 
-std::unique_ptr<DynamicBagOfCellsDb> DynamicBagOfCellsDb::create() {
-  return std::make_unique<DynamicBagOfCellsDbImpl>();
+std::unique_ptr<DynamicBagOfCellsDb> DynamicBagOfCellsDb::create(std::shared_ptr<CellCache> cell_cache) {
+  return std::make_unique<DynamicBagOfCellsDbImpl>(std::move(cell_cache));
 }
 }  // namespace vm
@@ -25,6 +25,7 @@
 namespace vm {
 class CellLoader;
 class CellStorer;
+class CellCache;
 }  // namespace vm
 
 namespace vm {
@@ -56,7 +57,9 @@ class DynamicBagOfCellsDb {
   // restart with new loader will also reset stats_diff
   virtual td::Status set_loader(std::unique_ptr<CellLoader> loader) = 0;
 
-  static std::unique_ptr<DynamicBagOfCellsDb> create();
+  // cell_cache (optional) keeps cells loaded through ExtCell across loader replacements; see CellCache
+  // and on commit, and invalidated for cells erased by commit
+  static std::unique_ptr<DynamicBagOfCellsDb> create(std::shared_ptr<CellCache> cell_cache = {});
 };
 
 }  // namespace vm
@@ -57,10 +57,38 @@ DispatchTable* OpcodeTable::finalize() {
   }
 
   instruction_list.shrink_to_fit();
+  build_lookup_tables();
   final = true;
   return this;
 }
 
+// Builds a two-level dispatch table over instruction_list: an opcode prefix (8 or 16 bits) covered by
+// a single instruction is resolved without a search, otherwise only the few intersecting entries are searched
+void OpcodeTable::build_lookup_tables() {
+  CHECK(instruction_list.size() <= 0x10000);
+  lookup_mid.clear();
+  for (unsigned i = 0; i < 256; i++) {
+    auto& entry = lookup_top[i] = get_lookup_entry(i << 16, ((i + 1) << 16) - 1);
+    if (entry.first == entry.last) {
+      continue;
+    }
+    entry.next = static_cast<td::uint16>(lookup_mid.size());
+    auto& table = lookup_mid.emplace_back();
+    for (unsigned j = 0; j < 256; j++) {
+      unsigned opcode_min = (i << 16) | (j << 8);
+      table[j] = get_lookup_entry(opcode_min, opcode_min + 0xff);
+    }
+  }
+  lookup_mid.shrink_to_fit();
+}
+
+OpcodeTable::LookupEntry OpcodeTable::get_lookup_entry(unsigned opcode_min, unsigned opcode_max) const {
+  LookupEntry entry;
+  entry.first = static_cast<td::uint16>(search_instr(opcode_min, 0, instruction_list.size()));
+  entry.last = static_cast<td::uint16>(search_instr(opcode_max, entry.first, instruction_list.size()));
+  return entry;
+}
+
 OpcodeTable& OpcodeTable::insert(const OpcodeInstr* instr) {
   LOG_IF(FATAL, !insert_bool(instr)) << td::format::lambda([&](auto& sb) {
     sb << "cannot insert instruction into table " << name << ": ";
@@ -100,9 +128,8 @@ bool OpcodeTable::insert_bool(const OpcodeInstr* instr) {
   return true;
 }
 
-const OpcodeInstr* OpcodeTable::lookup_instr(unsigned opcode, unsigned bits) const {
-  std::size_t i = 0, j = instruction_list.size();
-  assert(j);
+std::size_t OpcodeTable::search_instr(unsigned opcode, std::size_t i, std::size_t j) const {
+  assert(j > i);
   while (j - i > 1) {
     auto k = ((j + i) >> 1);
     if (instruction_list[k].first <= opcode) {
@@ -111,7 +138,18 @@ const OpcodeInstr* OpcodeTable::lookup_instr(unsigned opcode, unsigned bits) con
       j = k;
     }
   }
-  return instruction_list[i].second;
+  return i;
+}
+
+const OpcodeInstr* OpcodeTable::lookup_instr(unsigned opcode, unsigned bits) const {
+  auto entry = lookup_top[opcode >> 16];
+  if (entry.first != entry.last) {
+    entry = lookup_mid[entry.next][(opcode >> 8) & 0xff];
+    if (entry.first != entry.last) {
+      return instruction_list[search_instr(opcode, entry.first, entry.last + 1)].second;
+    }
+  }
+  return instruction_list[entry.first].second;
 }
 
 const OpcodeInstr* OpcodeTable::lookup_instr(const CellSlice& cs, unsigned& opcode, unsigned& bits) const {
@@ -18,6 +18,8 @@
 */
 #pragma once
 #include "vm/dispatch.h"
+#include "td/utils/int_types.h"
+#include <array>
 #include <functional>
 #include <utility>
 #include <vector>
@@ -86,8 +88,15 @@ dump_arg_instr_func_t dump_2c_add(unsigned add, std::string prefix, std::string
 }  // namespace instr
 
 class OpcodeTable : public DispatchTable {
+  // range [first, last] of instruction_list entries intersecting an opcode prefix;
+  // next is the index of the second-level table in lookup_mid (used only in lookup_top)
+  struct LookupEntry {
+    td::uint16 first{0}, last{0}, next{0};
+  };
   std::map<unsigned, const OpcodeInstr*> instructions;
   std::vector<std::pair<unsigned, const OpcodeInstr*>> instruction_list;
+  std::array<LookupEntry, 256> lookup_top;               // indexed by the top 8 bits of an opcode
+  std::vector<std::array<LookupEntry, 256>> lookup_mid;  // indexed by the next 8 bits of an opcode
   std::string name;
   Codepage codepage;
   bool final;
@@ -111,6 +120,9 @@ class OpcodeTable : public DispatchTable {
   OpcodeTable& insert(const OpcodeInstr*);
 
  private:
+  std::size_t search_instr(unsigned opcode, std::size_t i, std::size_t j) const;
+  LookupEntry get_lookup_entry(unsigned opcode_min, unsigned opcode_max) const;
+  void build_lookup_tables();
   const OpcodeInstr* lookup_instr(unsigned opcode, unsigned bits) const;
   const OpcodeInstr* lookup_instr(const CellSlice& cs, unsigned& opcode, unsigned& bits) const;
 };
@@ -416,11 +416,31 @@ td::RefInt256 Stack::pop_int_finite() {
   return res;
 }
 
+td::RefInt256 StackEntry::small_int_as_refint(long long value) {
+  if (value < (1LL << 62)) {
+    return td::make_refint(value);
+  }
+  // make_refint() cannot normalize a single word this close to 2^63
+  return td::make_refint(value >> 1) * 2 + (value & 1);
+}
+
 bool Stack::pop_bool() {
+  check_underflow(1);
+  long long value;
+  if (stack.back().get_small_int(value)) {
+    stack.pop_back();
+    return value != 0;
+  }
   return sgn(pop_int_finite()) != 0;
 }
 
 long long Stack::pop_long() {
+  check_underflow(1);
+  long long value;
+  if (stack.back().get_small_int(value)) {
+    stack.pop_back();
+    return value;
+  }
   return pop_int()->to_long();
 }
 
@@ -617,7 +637,7 @@ void Stack::push_builder(Ref<CellBuilder> cb) {
 }
 
 void Stack::push_smallint(long long val) {
-  push(td::make_refint(val));
+  push().set_small_int(val);
 }
 
 void Stack::push_bool(bool val) {
@@ -87,6 +87,9 @@ class StackEntry {
  private:
   RefAny ref;
   Type tp;
+  // integers fitting into 64 bits may be stored inline (with null ref) to avoid allocating a BigInt256
+  bool int_inline{false};
+  long long int_value{0};
 
  public:
   StackEntry() : ref(), tp(t_null) {
@@ -111,10 +114,12 @@ class StackEntry {
   StackEntry(const std::vector<StackEntry>& tuple_components);
   StackEntry(std::vector<StackEntry>&& tuple_components);
   StackEntry(Ref<Atom> atom_ref);
-  StackEntry(const StackEntry& se) : ref(se.ref), tp(se.tp) {
+  StackEntry(const StackEntry& se) : ref(se.ref), tp(se.tp), int_inline(se.int_inline), int_value(se.int_value) {
   }
-  StackEntry(StackEntry&& se) noexcept : ref(std::move(se.ref)), tp(se.tp) {
+  StackEntry(StackEntry&& se) noexcept
+      : ref(std::move(se.ref)), tp(se.tp), int_inline(se.int_inline), int_value(se.int_value) {
     se.tp = t_null;
+    se.int_inline = false;
   }
   template <class T>
   StackEntry(from_object_t, Ref<T> obj_ref) : ref(std::move(obj_ref)), tp(t_object) {
@@ -122,22 +127,40 @@ class StackEntry {
   StackEntry& operator=(const StackEntry& se) {
     ref = se.ref;
     tp = se.tp;
+    int_inline = se.int_inline;
+    int_value = se.int_value;
     return *this;
   }
   StackEntry& operator=(StackEntry&& se) {
     ref = std::move(se.ref);
     tp = se.tp;
+    int_inline = se.int_inline;
+    int_value = se.int_value;
     se.tp = t_null;
+    se.int_inline = false;
     return *this;
   }
   StackEntry& clear() {
     ref.clear();
     tp = t_null;
+    int_inline = false;
     return *this;
   }
   bool set_int(td::RefInt256 value) {
     return set(t_int, std::move(value));
   }
+  bool set_small_int(long long value) {
+    ref.clear();
+    tp = t_int;
+    int_inline = true;
+    int_value = value;
+    return true;
+  }
+  // returns false unless this entry is an integer stored inline
+  bool get_small_int(long long& value) const {
+    value = int_value;
+    return int_inline;
+  }
   bool empty() const {
     return tp == t_null;
   }
@@ -168,12 +191,15 @@ class StackEntry {
   void swap(StackEntry& se) {
     ref.swap(se.ref);
     std::swap(tp, se.tp);
+    std::swap(int_inline, se.int_inline);
+    std::swap(int_value, se.int_value);
   }
   bool operator==(const StackEntry& other) const {
-    return tp == other.tp && ref == other.ref;
+    return tp == other.tp && ref == other.ref && int_inline == other.int_inline &&
+           (!int_inline || int_value == other.int_value);
   }
   bool operator!=(const StackEntry& other) const {
-    return !(tp == other.tp && ref == other.ref);
+    return !(*this == other);
   }
   Type type() const {
     return tp;
@@ -212,8 +238,10 @@ class StackEntry {
   bool set(Type _tp, RefAny _ref) {
     tp = _tp;
     ref = std::move(_ref);
+    int_inline = false;
     return ref.not_null() || tp == t_null;
   }
+  static td::RefInt256 small_int_as_refint(long long value);
 
  public:
   static StackEntry make_list(std::vector<StackEntry>&& elems);
@@ -231,10 +259,10 @@ class StackEntry {
     }
   }
   td::RefInt256 as_int() const & {
-    return as<td::CntInt256, t_int>();
+    return int_inline ? small_int_as_refint(int_value) : as<td::CntInt256, t_int>();
   }
   td::RefInt256 as_int() && {
-    return move_as<td::CntInt256, t_int>();
+    return int_inline ? small_int_as_refint(int_value) : move_as<td::CntInt256, t_int>();
   }
   Ref<Cell> as_cell() const & {
     return as<Cell, t_cell>();
@@ -17,13 +17,98 @@
     Copyright 2017-2020 Telegram Systems LLP
 */
 #include "fec.h"
+#include "td/fec/raptorq/Encoder.h"
+#include "td/utils/List.h"
+#include "td/utils/UInt.h"
+#include "td/utils/crypto.h"
 #include "td/utils/overloaded.h"
 #include "auto/tl/ton_api.hpp"
 
+#include <map>
+#include <mutex>
+
 namespace ton {
 
 namespace fec {
 
+namespace {
+
+/*
+ * process-wide cache of RaptorQ encoders, keyed by the hash of the data and the symbol size
+ *
+ * the same data is often sent by several transfers at once (a block broadcast in several overlays, the same
+ * answer to several peers); they share one encoder, so its precalculation is done only once
+ * least recently used encoders are dropped when the byte budget is exceeded; transfers keep their own references
+ */
+class RaptorQEncoderCache {
+ public:
+  static constexpr std::size_t max_bytes = 128 << 20;
+
+  static RaptorQEncoderCache &get() {
+    static RaptorQEncoderCache cache;
+    return cache;
+  }
+
+  std::shared_ptr<td::raptorq::Encoder> get_encoder(td::BufferSlice data, std::size_t symbol_size) {
+    Key key;
+    td::sha256(data.as_slice(), key.first.as_slice());
+    key.second = symbol_size;
+    auto size = Entry::estimate_size(data.size());
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      auto entry = it->second.get();
+      entry->remove();
+      lru_.put(entry);
+      return entry->encoder;
+    }
+    std::shared_ptr<td::raptorq::Encoder> encoder =
+        td::raptorq::Encoder::create(symbol_size, std::move(data)).move_as_ok();
+    if (size > max_bytes) {
+      return encoder;
+    }
+    auto entry = std::make_unique<Entry>();
+    entry->key = key;
+    entry->encoder = encoder;
+    entry->size = size;
+    total_bytes_ += size;
+    lru_.put(entry.get());
+    entries_[key] = std::move(entry);
+    while (total_bytes_ > max_bytes) {
+      auto oldest = Entry::from_list_node(lru_.get());
+      CHECK(oldest);
+      total_bytes_ -= oldest->size;
+      entries_.erase(oldest->key);
+    }
+    return encoder;
+  }
+
+ private:
+  using Key = std::pair<td::UInt256, std::size_t>;
+
+  struct Entry : public td::ListNode {
+    Key key;
+    std::shared_ptr<td::raptorq::Encoder> encoder;
+    std::size_t size;
+
+    // the data itself and the intermediate symbols, which are a bit larger than the data
+    static std::size_t estimate_size(std::size_t data_size) {
+      return sizeof(Entry) + data_size * 2;
+    }
+    static Entry *from_list_node(td::ListNode *node) {
+      return static_cast<Entry *>(node);
+    }
+  };
+
+  std::mutex mutex_;
+  std::map<Key, std::unique_ptr<Entry>> entries_;
+  td::ListNode lru_;
+  std::size_t total_bytes_{0};
+};
+
+}  // namespace
+
 tl_object_ptr<ton_api::fec_Type> FecType::tl() const {
   tl_object_ptr<ton_api::fec_Type> res;
   type_.visit(td::overloaded([&](const Empty &obj) { UNREACHABLE(); },
@@ -59,7 +144,8 @@ td::Result<std::unique_ptr<td::fec::Encoder>> FecType::create_encoder(td::Buffer
   std::unique_ptr<td::fec::Encoder> res;
   type_.visit(td::overloaded([&](const Empty &obj) { UNREACHABLE(); },
                              [&](const td::fec::RaptorQEncoder::Parameters &obj) {
-                               auto R = td::fec::RaptorQEncoder::create(std::move(data), obj.symbol_size);
+                               auto R = td::fec::RaptorQEncoder::create(
+                                   RaptorQEncoderCache::get().get_encoder(std::move(data), obj.symbol_size));
                                type_ = R->get_parameters();
                                res = std::move(R);
                              },
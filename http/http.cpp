@@ -872,6 +872,9 @@ void answer_error(HttpStatusCode code, std::string reason,
       case status_bad_request:
         reason = "Bad Request";
         break;
+      case status_not_found:
+        reason = "Not Found";
+        break;
       case status_method_not_allowed:
         reason = "Method Not Allowed";
         break;
@@ -891,8 +894,9 @@ void answer_error(HttpStatusCode code, std::string reason,
   }
   auto response = HttpResponse::create("HTTP/1.0", code, reason, false, false).move_as_ok();
   response->add_header(HttpHeader{"Content-Length", "0"});
+  response->complete_parse_header().ensure();
   auto payload = response->create_empty_payload().move_as_ok();
-  CHECK(payload->parse_completed());
+  payload->complete_parse();
   promise.set_value(std::make_pair(std::move(response), std::move(payload)));
 }
 
@@ -33,6 +33,7 @@ namespace http {
 enum HttpStatusCode : td::uint32 {
   status_ok = 200,
   status_bad_request = 400,
+  status_not_found = 404,
   status_method_not_allowed = 405,
   status_internal_server_error = 500,
   status_bad_gateway = 502,
@@ -54,6 +54,7 @@ extern "C" {
 #include "td/utils/port/thread.h"
 #include "td/utils/queue.h"
 #include "td/utils/Random.h"
+#include "td/utils/Sha256Batch.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 #include "td/utils/StealingQueue.h"
@@ -168,6 +169,21 @@ class BlockSha256Baseline {
   }
 };
 
+// hashes all cells of the block with td::Sha256Batch, using the kernel selected by td::Sha256Batch::set_kernel
+class BlockSha256Batch {
+ public:
+  static std::string get_description() {
+    return std::string("Sha256Batch ") + td::Sha256Batch::get_kernel().name;
+  }
+  static void calc_hash(Block &block) {
+    td::Sha256Batch batch;
+    for (auto &cell : block.cells) {
+      batch.add(cell.data, as_slice(cell.hash));
+    }
+    batch.flush();
+  }
+};
+
 class BlockSha256Threads {
  public:
   static std::string get_description() {
@@ -1639,6 +1655,16 @@ class YieldMany : public td::Benchmark {
 
 int main(int argc, char **argv) {
   if (argc > 1) {
+    if (td::Slice(argv[1]) == "sha256") {
+      bench(CalcHashSha256Benchmark<BlockSha256Baseline>());
+      auto &default_kernel = td::Sha256Batch::get_kernel();
+      for (auto kernel : td::Sha256Batch::available_kernels()) {
+        td::Sha256Batch::set_kernel(*kernel);
+        bench(CalcHashSha256Benchmark<BlockSha256Batch>());
+      }
+      td::Sha256Batch::set_kernel(default_kernel);
+      return 0;
+    }
     if (argv[1][0] == 'a') {
       bench_n(MpmcQueueBenchmark2<WaitQueue<td::MpmcQueue<size_t>, td::MpmcEagerWaiter, size_t>>(50, 1), 1 << 26);
       //bench_n(MpmcQueueBenchmark<td::MpmcQueue<size_t>>(1, 1), 1 << 26);
@@ -23,6 +23,8 @@
 
 #include "td/actor/core/Scheduler.h"  // FIXME: afer LocalQueue is in a separate file
 
+#include "td/utils/Metrics.h"
+
 namespace td {
 namespace actor {
 namespace core {
@@ -33,6 +35,11 @@ void CpuWorker::run() {
   MpmcWaiter::Slot slot;
   waiter_.init_slot(slot, thread_id);
   auto &debug = dispatcher.get_debug();
+  // time spent by the worker on one message, i.e. how long a heavy actor can hold a cpu thread
+  // only every TASK_SAMPLE_RATE-th message is timed to keep clock reads off the hot path
+  static auto &task_us = get_metric<MetricHistogram>("actor_cpu_task_us");
+  constexpr uint32 TASK_SAMPLE_RATE = 64;
+  uint32 task_cnt = 0;
   while (true) {
     SchedulerMessage message;
     if (try_pop(message, thread_id)) {
@@ -41,7 +48,18 @@ void CpuWorker::run() {
         return;
       }
       auto lock = debug.start(message->get_name());
-      ActorExecutor executor(*message, dispatcher, ActorExecutor::Options().with_from_queue());
+      bool is_sampled = ++task_cnt == TASK_SAMPLE_RATE;
+      double start_at = 0;
+      if (is_sampled) {
+        task_cnt = 0;
+        start_at = Time::now();
+      }
+      {
+        ActorExecutor executor(*message, dispatcher, ActorExecutor::Options().with_from_queue());
+      }
+      if (is_sampled) {
+        task_us.record_duration(Time::now() - start_at);
+      }
     } else {
       waiter_.wait(slot);
     }
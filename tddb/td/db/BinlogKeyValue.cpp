@@ -0,0 +1,333 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#include "td/db/BinlogKeyValue.h"
+
+#include "td/db/binlog/Binlog.h"
+#include "td/db/binlog/BinlogReaderInterface.h"
+
+#include "td/utils/crypto.h"
+#include "td/utils/format.h"
+#include "td/utils/port/Stat.h"
+
+#include <cstring>
+
+namespace td {
+namespace {
+// record: magic, key size, value size (erase_mark for erase), crc32c of the first three fields, the key and the value
+struct RecordHeader {
+  static constexpr uint32 magic = 0x7b1f4c6b;
+  static constexpr uint32 erase_mark = 0xffffffff;
+
+  uint32 magic_field;
+  uint32 key_size;
+  uint32 value_size;
+  uint32 crc32c;
+
+  uint32 data_size() const {
+    return key_size + (value_size == erase_mark ? 0 : value_size);
+  }
+};
+static_assert(sizeof(RecordHeader) == 16, "unexpected RecordHeader size");
+
+uint32 record_crc32c(const RecordHeader &header, Slice key, Slice value) {
+  auto crc = crc32c(Slice(reinterpret_cast<const char *>(&header), 12));
+  crc = crc32c_extend(crc, key);
+  return crc32c_extend(crc, value);
+}
+
+class Record {
+ public:
+  Record(Slice key, Slice value, bool is_erase) : key_(key), value_(value) {
+    header_.magic_field = RecordHeader::magic;
+    header_.key_size = narrow_cast<uint32>(key.size());
+    header_.value_size = is_erase ? RecordHeader::erase_mark : narrow_cast<uint32>(value.size());
+    header_.crc32c = record_crc32c(header_, key_, value_);
+  }
+
+  int64 size() const {
+    return static_cast<int64>(sizeof(header_) + key_.size() + value_.size());
+  }
+  int64 serialize(MutableSlice dest) const {
+    if (static_cast<int64>(dest.size()) < size()) {
+      return -size();
+    }
+    std::memcpy(dest.data(), &header_, sizeof(header_));
+    dest.substr(sizeof(header_)).copy_from(key_);
+    dest.substr(sizeof(header_) + key_.size()).copy_from(value_);
+    return size();
+  }
+
+ private:
+  RecordHeader header_;
+  Slice key_;
+  Slice value_;
+};
+
+// values are not buffered during replay: the key is parsed together with the header,
+// the value is skipped in whatever pieces it comes, only its crc32c is computed
+class IndexBuilder : public BinlogReaderInterface {
+ public:
+  explicit IndexBuilder(BinlogKeyValue::Index &index) : index_(index) {
+  }
+
+  Result<int64> parse(Slice data) override {
+    if (value_left_ > 0) {
+      auto size = std::min<size_t>(value_left_, data.size());
+      crc_ = crc32c_extend(crc_, data.substr(0, size));
+      value_left_ -= size;
+      if (value_left_ == 0) {
+        TRY_STATUS(finish_record());
+      }
+      return static_cast<int64>(size);
+    }
+
+    if (data.size() < sizeof(RecordHeader)) {
+      return -static_cast<int64>(sizeof(RecordHeader));
+    }
+    std::memcpy(&header_, data.data(), sizeof(header_));
+    if (header_.magic_field != RecordHeader::magic) {
+      return Status::Error(PSLICE() << "Bad record magic at offset " << valid_size_);
+    }
+    if (header_.key_size > BinlogKeyValue::max_key_size()) {
+      return Status::Error(PSLICE() << "Too big key at offset " << valid_size_);
+    }
+    auto prefix_size = sizeof(RecordHeader) + header_.key_size;
+    if (data.size() < prefix_size) {
+      return -static_cast<int64>(prefix_size);
+    }
+    key_ = data.substr(sizeof(RecordHeader), header_.key_size).str();
+    crc_ = record_crc32c(header_, key_, {});
+    value_left_ = header_.value_size == RecordHeader::erase_mark ? 0 : header_.value_size;
+    if (value_left_ == 0) {
+      TRY_STATUS(finish_record());
+    }
+    return static_cast<int64>(prefix_size);
+  }
+
+  // size of the prefix of the file consisting of complete valid records
+  int64 valid_size() const {
+    return valid_size_;
+  }
+
+ private:
+  BinlogKeyValue::Index &index_;
+  RecordHeader header_;
+  std::string key_;
+  uint32 crc_{0};
+  size_t value_left_{0};
+  int64 valid_size_{0};
+
+  Status finish_record() {
+    if (crc_ != header_.crc32c) {
+      return Status::Error(PSLICE() << "Crc mismatch at offset " << valid_size_);
+    }
+    auto value_offset = valid_size_ + static_cast<int64>(sizeof(RecordHeader) + header_.key_size);
+    if (header_.value_size == RecordHeader::erase_mark) {
+      index_.erase(key_);
+    } else {
+      index_[key_] = BinlogKeyValue::ValuePosition{value_offset, header_.value_size};
+    }
+    valid_size_ += static_cast<int64>(sizeof(RecordHeader) + header_.data_size());
+    return Status::OK();
+  }
+};
+
+Status read_value(const FileFd &fd, const BinlogKeyValue::ValuePosition &position, std::string &value) {
+  value.resize(position.size);
+  MutableSlice dest(value);
+  auto offset = position.offset;
+  while (!dest.empty()) {
+    TRY_RESULT(read, fd.pread(dest, offset));
+    if (read == 0) {
+      return Status::Error(PSLICE() << "Unexpected end of file at offset " << offset);
+    }
+    dest.remove_prefix(read);
+    offset += static_cast<int64>(read);
+  }
+  return Status::OK();
+}
+
+size_t count_prefix(const BinlogKeyValue::Index &index, Slice prefix) {
+  size_t res = 0;
+  for (auto it = index.lower_bound(prefix); it != index.end(); it++) {
+    if (Slice(it->first).truncate(prefix.size()) != prefix) {
+      break;
+    }
+    res++;
+  }
+  return res;
+}
+
+class Snapshot : public KeyValueReader {
+ public:
+  Snapshot(FileFd fd, BinlogKeyValue::Index index) : fd_(std::move(fd)), index_(std::move(index)) {
+  }
+  Result<GetStatus> get(Slice key, std::string &value) override {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return GetStatus::NotFound;
+    }
+    TRY_STATUS(read_value(fd_, it->second, value));
+    return GetStatus::Ok;
+  }
+  Result<size_t> count(Slice prefix) override {
+    return count_prefix(index_, prefix);
+  }
+
+ private:
+  FileFd fd_;
+  BinlogKeyValue::Index index_;
+};
+}  // namespace
+
+Result<BinlogKeyValue> BinlogKeyValue::open(std::string path) {
+  Index index;
+  int64 size = 0;
+  auto r_stat = stat(path);
+  if (r_stat.is_ok()) {
+    IndexBuilder builder(index);
+    auto S = Binlog(path).replay_sync(builder);
+    size = builder.valid_size();
+    if (S.is_error()) {
+      if (size != r_stat.ok().size_) {
+        LOG(WARNING) << "Cutting " << path << " from " << r_stat.ok().size_ << " to " << size << " bytes: " << S;
+      }
+      TRY_RESULT(fd, FileFd::open(path, FileFd::Flags::Write));
+      TRY_STATUS(fd.truncate_to_current_position(size));
+      TRY_STATUS(fd.sync());
+    }
+  }
+
+  BinlogKeyValue res(path, std::move(index), size);
+  res.writer_ = std::make_unique<BinlogWriter>(path);
+  TRY_STATUS(res.writer_->open());
+  TRY_RESULT(read_fd, FileFd::open(path, FileFd::Flags::Read));
+  res.read_fd_ = std::move(read_fd);
+  return std::move(res);
+}
+
+Status BinlogKeyValue::destroy(CSlice path) {
+  Binlog::destroy(path);
+  return Status::OK();
+}
+
+BinlogKeyValue::BinlogKeyValue(std::string path, Index index, int64 size)
+    : path_(std::move(path)), index_(std::move(index)), size_(size) {
+}
+BinlogKeyValue::BinlogKeyValue(BinlogKeyValue &&) = default;
+BinlogKeyValue &BinlogKeyValue::operator=(BinlogKeyValue &&) = default;
+BinlogKeyValue::~BinlogKeyValue() {
+  if (writer_) {
+    writer_->close().ignore();
+  }
+}
+
+Result<BinlogKeyValue::GetStatus> BinlogKeyValue::get(Slice key, std::string &value) {
+  get_count_++;
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return GetStatus::NotFound;
+  }
+  TRY_STATUS(flush_writer());
+  TRY_STATUS(read_value(read_fd_, it->second, value));
+  return GetStatus::Ok;
+}
+
+Status BinlogKeyValue::set(Slice key, Slice value) {
+  return append(key, value, false);
+}
+
+Status BinlogKeyValue::erase(Slice key) {
+  if (index_.count(key) == 0) {
+    return Status::OK();
+  }
+  return append(key, {}, true);
+}
+
+Status BinlogKeyValue::append(Slice key, Slice value, bool is_erase) {
+  if (key.size() > max_key_size()) {
+    return Status::Error(PSLICE() << "Too big key of size " << key.size());
+  }
+  Record record(key, value, is_erase);
+  TRY_STATUS(writer_->write_event(record, nullptr));
+  if (is_erase) {
+    index_.erase(index_.find(key));
+  } else {
+    auto value_offset = size_ + static_cast<int64>(sizeof(RecordHeader) + key.size());
+    index_[key.str()] = ValuePosition{value_offset, narrow_cast<uint32>(value.size())};
+  }
+  size_ += record.size();
+  need_flush_ = true;
+  need_sync_ = true;
+  return Status::OK();
+}
+
+Result<size_t> BinlogKeyValue::count(Slice prefix) {
+  return count_prefix(index_, prefix);
+}
+
+Status BinlogKeyValue::flush_writer() {
+  if (!need_flush_) {
+    return Status::OK();
+  }
+  need_flush_ = false;
+  return writer_->flush();
+}
+
+Status BinlogKeyValue::flush() {
+  if (!need_sync_) {
+    return Status::OK();
+  }
+  need_flush_ = false;
+  need_sync_ = false;
+  return writer_->sync();
+}
+
+// records cannot be taken back from the log, so batches and transactions only postpone the sync
+Status BinlogKeyValue::begin_write_batch() {
+  return Status::OK();
+}
+Status BinlogKeyValue::commit_write_batch() {
+  return flush();
+}
+Status BinlogKeyValue::abort_write_batch() {
+  return Status::Error("BinlogKeyValue: write batches cannot be aborted");
+}
+
+Status BinlogKeyValue::begin_transaction() {
+  return Status::OK();
+}
+Status BinlogKeyValue::commit_transaction() {
+  return flush();
+}
+Status BinlogKeyValue::abort_transaction() {
+  return Status::Error("BinlogKeyValue: transactions cannot be aborted");
+}
+
+std::unique_ptr<KeyValueReader> BinlogKeyValue::snapshot() {
+  flush_writer().ensure();
+  auto fd = FileFd::open(path_, FileFd::Flags::Read).move_as_ok();
+  return std::make_unique<Snapshot>(std::move(fd), index_);
+}
+
+std::string BinlogKeyValue::stats() const {
+  return PSTRING() << "BinlogKeyValueStats{" << tag("keys", index_.size()) << tag("size", size_)
+                   << tag("get_count", get_count_) << "}";
+}
+}  // namespace td
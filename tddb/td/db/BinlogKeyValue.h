@@ -0,0 +1,88 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#pragma once
+#include "td/db/KeyValue.h"
+
+#include "td/utils/port/FileFd.h"
+
+#include <map>
+
+namespace td {
+class BinlogWriter;
+
+/*
+ * append-only key-value storage in a single binlog file, for data which is written once and read back rarely
+ *
+ * every set and erase appends a record to the file, only the key and the position of the latest value of every key
+ * are kept in memory; values are read from the file on demand
+ * the file is replayed sequentially on open, a broken record at its end (an interrupted write) is cut off
+ * records are flushed and synced to disk on commit_transaction, so a transaction costs one fsync
+ */
+class BinlogKeyValue : public KeyValue {
+ public:
+  static Result<BinlogKeyValue> open(std::string path);
+  static Status destroy(CSlice path);
+
+  Result<GetStatus> get(Slice key, std::string &value) override;
+  Status set(Slice key, Slice value) override;
+  Status erase(Slice key) override;
+  Result<size_t> count(Slice prefix) override;
+
+  Status begin_write_batch() override;
+  Status commit_write_batch() override;
+  Status abort_write_batch() override;
+
+  Status begin_transaction() override;
+  Status commit_transaction() override;
+  Status abort_transaction() override;
+
+  std::unique_ptr<KeyValueReader> snapshot() override;
+
+  std::string stats() const override;
+  Status flush() override;
+
+  BinlogKeyValue(BinlogKeyValue &&);
+  BinlogKeyValue &operator=(BinlogKeyValue &&);
+  ~BinlogKeyValue();
+
+  static constexpr size_t max_key_size() {
+    return 512;
+  }
+
+  struct ValuePosition {
+    int64 offset;
+    uint32 size;
+  };
+  using Index = std::map<std::string, ValuePosition, std::less<>>;
+
+ private:
+  BinlogKeyValue(std::string path, Index index, int64 size);
+  Status append(Slice key, Slice value, bool is_erase);
+  Status flush_writer();
+
+  std::string path_;
+  std::unique_ptr<BinlogWriter> writer_;
+  FileFd read_fd_;
+  Index index_;
+  int64 size_{0};
+  bool need_flush_{false};
+  bool need_sync_{false};
+  int64 get_count_{0};
+};
+}  // namespace td
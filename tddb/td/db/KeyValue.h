@@ -17,6 +17,7 @@
     Copyright 2017-2020 Telegram Systems LLP
 */
 #pragma once
+#include "td/utils/Span.h"
 #include "td/utils/Status.h"
 #include "td/utils/logging.h"
 namespace td {
@@ -27,6 +28,18 @@ class KeyValueReader {
 
   virtual Result<GetStatus> get(Slice key, std::string &value) = 0;
   virtual Result<size_t> count(Slice prefix) = 0;
+
+  // values are resized to keys.size(); values[i] is meaningful only if the i-th status is Ok
+  virtual Result<std::vector<GetStatus>> get_multi(Span<Slice> keys, std::vector<std::string> &values) {
+    values.resize(keys.size());
+    std::vector<GetStatus> res;
+    res.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      TRY_RESULT(status, get(keys[i], values[i]));
+      res.push_back(status);
+    }
+    return std::move(res);
+  }
 };
 
 class PrefixedKeyValueReader : public KeyValueReader {
@@ -22,6 +22,7 @@
 #include "rocksdb/table.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/write_batch.h"
+#include "rocksdb/write_buffer_manager.h"
 #include "rocksdb/utilities/optimistic_transaction_db.h"
 #include "rocksdb/utilities/transaction.h"
 
@@ -59,7 +60,7 @@ RocksDb RocksDb::clone() const {
   return RocksDb{db_, statistics_};
 }
 
-Result<RocksDb> RocksDb::open(std::string path) {
+Result<RocksDb> RocksDb::open(std::string path, RocksDbOptions db_options) {
   rocksdb::OptimisticTransactionDB *db;
   auto statistics = rocksdb::CreateDBStatistics();
   {
@@ -78,6 +79,10 @@ Result<RocksDb> RocksDb::open(std::string path) {
     options.bytes_per_sync = 1 << 20;
     options.writable_file_max_buffer_size = 2 << 14;
     options.statistics = statistics;
+    options.max_open_files = db_options.max_open_files;
+    if (db_options.write_buffer_manager) {
+      options.write_buffer_manager = std::move(db_options.write_buffer_manager);
+    }
     rocksdb::OptimisticTransactionDBOptions occ_options;
     occ_options.validate_policy = rocksdb::OccValidationPolicy::kValidateSerial;
     rocksdb::ColumnFamilyOptions cf_options(options);
@@ -94,6 +99,10 @@ Result<RocksDb> RocksDb::open(std::string path) {
   return RocksDb(std::shared_ptr<rocksdb::OptimisticTransactionDB>(db), std::move(statistics));
 }
 
+std::shared_ptr<rocksdb::WriteBufferManager> RocksDb::create_write_buffer_manager(size_t limit) {
+  return std::make_shared<rocksdb::WriteBufferManager>(limit);
+}
+
 std::unique_ptr<KeyValueReader> RocksDb::snapshot() {
   auto res = std::make_unique<RocksDb>(clone());
   res->begin_snapshot().ensure();
@@ -129,6 +138,39 @@ Result<RocksDb::GetStatus> RocksDb::get(Slice key, std::string &value) {
   return from_rocksdb(status);
 }
 
+Result<std::vector<RocksDb::GetStatus>> RocksDb::get_multi(Span<Slice> keys, std::vector<std::string> &values) {
+  std::vector<rocksdb::Slice> rocksdb_keys;
+  rocksdb_keys.reserve(keys.size());
+  for (auto &key : keys) {
+    rocksdb_keys.push_back(to_rocksdb(key));
+  }
+  values.clear();
+  std::vector<rocksdb::Status> statuses;
+  if (snapshot_) {
+    rocksdb::ReadOptions options;
+    options.snapshot = snapshot_.get();
+    statuses = db_->MultiGet(options, rocksdb_keys, &values);
+  } else if (transaction_) {
+    statuses = transaction_->MultiGet({}, rocksdb_keys, &values);
+  } else {
+    statuses = db_->MultiGet({}, rocksdb_keys, &values);
+  }
+  CHECK(statuses.size() == keys.size());
+  values.resize(keys.size());
+  std::vector<GetStatus> res;
+  res.reserve(statuses.size());
+  for (auto &status : statuses) {
+    if (status.ok()) {
+      res.push_back(GetStatus::Ok);
+    } else if (status.code() == rocksdb::Status::kNotFound) {
+      res.push_back(GetStatus::NotFound);
+    } else {
+      return from_rocksdb(status);
+    }
+  }
+  return std::move(res);
+}
+
 Status RocksDb::set(Slice key, Slice value) {
   if (write_batch_) {
     return from_rocksdb(write_batch_->Put(to_rocksdb(key), to_rocksdb(value)));
@@ -31,16 +31,26 @@ class Transaction;
 class WriteBatch;
 class Snapshot;
 class Statistics;
+class WriteBufferManager;
 }  // namespace rocksdb
 
 namespace td {
+struct RocksDbOptions {
+  // memtables of all databases sharing a write buffer manager are flushed once their total size exceeds its limit
+  std::shared_ptr<rocksdb::WriteBufferManager> write_buffer_manager;
+  // -1 keeps all table files open
+  int max_open_files = -1;
+};
+
 class RocksDb : public KeyValue {
  public:
   static Status destroy(Slice path);
   RocksDb clone() const;
-  static Result<RocksDb> open(std::string path);
+  static Result<RocksDb> open(std::string path, RocksDbOptions db_options = {});
+  static std::shared_ptr<rocksdb::WriteBufferManager> create_write_buffer_manager(size_t limit);
 
   Result<GetStatus> get(Slice key, std::string &value) override;
+  Result<std::vector<GetStatus>> get_multi(Span<Slice> keys, std::vector<std::string> &values) override;
   Status set(Slice key, Slice value) override;
   Status erase(Slice key) override;
   Result<size_t> count(Slice prefix) override;
@@ -21,6 +21,7 @@
 #include "td/db/KeyValueAsync.h"
 #include "td/db/KeyValue.h"
 #include "td/db/RocksDb.h"
+#include "td/db/BinlogKeyValue.h"
 
 #include "td/utils/benchmark.h"
 #include "td/utils/buffer.h"
@@ -65,6 +66,103 @@ TEST(KeyValue, simple) {
   ensure_value(as_slice(x), as_slice(x));
 };
 
+TEST(KeyValue, get_multi) {
+  td::Slice db_name = "testdb";
+  td::RocksDb::destroy(db_name).ignore();
+
+  auto kv = std::make_unique<td::RocksDb>(td::RocksDb::open(db_name.str()).move_as_ok());
+  kv->begin_write_batch().ensure();
+  kv->set("A", "HELLO").ensure();
+  kv->set("C", "WORLD").ensure();
+  kv->commit_write_batch().ensure();
+
+  auto ensure_values = [](td::KeyValueReader &reader) {
+    std::vector<td::Slice> keys{"A", "B", "C"};
+    std::vector<std::string> values;
+    auto statuses = reader.get_multi(keys, values).move_as_ok();
+    ASSERT_EQ(3u, statuses.size());
+    ASSERT_EQ(3u, values.size());
+    ASSERT_EQ(td::int32(td::KeyValue::GetStatus::Ok), td::int32(statuses[0]));
+    ASSERT_EQ(td::int32(td::KeyValue::GetStatus::NotFound), td::int32(statuses[1]));
+    ASSERT_EQ(td::int32(td::KeyValue::GetStatus::Ok), td::int32(statuses[2]));
+    ASSERT_EQ("HELLO", values[0]);
+    ASSERT_EQ("WORLD", values[2]);
+  };
+  ensure_values(*kv);
+
+  auto snapshot = kv->snapshot();
+  kv->erase("A").ensure();
+  ensure_values(*snapshot);
+};
+
+TEST(KeyValue, binlog) {
+  td::CSlice db_name = "test.kv.binlog";
+  td::BinlogKeyValue::destroy(db_name).ensure();
+
+  auto kv = std::make_unique<td::BinlogKeyValue>(td::BinlogKeyValue::open(db_name.str()).move_as_ok());
+  auto ensure_value = [&](td::Slice key, td::Slice value) {
+    std::string kv_value;
+    auto status = kv->get(key, kv_value).move_as_ok();
+    ASSERT_EQ(td::int32(status), td::int32(td::KeyValue::GetStatus::Ok));
+    ASSERT_EQ(kv_value, value);
+  };
+  auto ensure_no_value = [&](td::Slice key) {
+    std::string kv_value;
+    auto status = kv->get(key, kv_value).move_as_ok();
+    ASSERT_EQ(td::int32(status), td::int32(td::KeyValue::GetStatus::NotFound));
+  };
+
+  // values larger than the replay buffers
+  std::string big(100000, 'x');
+  for (size_t i = 0; i < big.size(); i++) {
+    big[i] = static_cast<char>('a' + i % 26);
+  }
+  kv->begin_transaction().ensure();
+  kv->set("A", "HELLO").ensure();
+  kv->set("B", big).ensure();
+  kv->set("C", "").ensure();
+  ensure_value("B", big);
+  kv->commit_transaction().ensure();
+  kv->begin_transaction().ensure();
+  kv->set("A", "WORLD").ensure();
+  kv->erase("C").ensure();
+  kv->commit_transaction().ensure();
+  ensure_value("A", "WORLD");
+  ensure_no_value("C");
+  ASSERT_EQ(2u, kv->count("").move_as_ok());
+  {
+    auto snapshot = kv->snapshot();
+    kv->erase("A").ensure();
+    ASSERT_EQ(2u, snapshot->count("").move_as_ok());
+    ASSERT_EQ(1u, snapshot->count("A").move_as_ok());
+    ASSERT_EQ(0u, snapshot->count("C").move_as_ok());
+    ASSERT_EQ(1u, kv->count("").move_as_ok());
+    kv->set("A", "WORLD").ensure();
+  }
+
+  kv.reset();
+  {
+    // an interrupted write at the end of the file
+    auto fd = td::FileFd::open(db_name, td::FileFd::Flags::Write | td::FileFd::Flags::Append).move_as_ok();
+    fd.write("\x6b\x4c\x1f\x7b\x01\x00").ensure();
+  }
+  kv = std::make_unique<td::BinlogKeyValue>(td::BinlogKeyValue::open(db_name.str()).move_as_ok());
+  ensure_value("A", "WORLD");
+  ensure_value("B", big);
+  ensure_no_value("C");
+  kv->begin_transaction().ensure();
+  kv->set("D", "after restart").ensure();
+  kv->commit_transaction().ensure();
+
+  kv.reset();
+  kv = std::make_unique<td::BinlogKeyValue>(td::BinlogKeyValue::open(db_name.str()).move_as_ok());
+  ensure_value("A", "WORLD");
+  ensure_value("B", big);
+  ensure_value("D", "after restart");
+  kv.reset();
+  td::BinlogKeyValue::destroy(db_name).ensure();
+}
+
 TEST(KeyValue, async_simple) {
   td::Slice db_name = "testdb";
   td::RocksDb::destroy(db_name).ignore();
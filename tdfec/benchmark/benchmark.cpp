@@ -37,20 +37,20 @@
 #include "td/fec/algebra/Simd.h"
 #include <cstdio>
 
-template <class Simd, size_t size = 256>
+template <size_t size = 256>
 class Simd_gf256_from_gf2 : public td::Benchmark {
  public:
-  explicit Simd_gf256_from_gf2(std::string description) : description_(std::move(description)) {
+  explicit Simd_gf256_from_gf2(const td::Gf256Kernels &kernels) : kernels_(kernels) {
     for (size_t i = 0; i < size; i++) {
       src[i] = td::uint8(td::Random::fast(0, 255));
     }
   }
   std::string get_description() const override {
-    return PSTRING() << "gf256_from_gf2 " << description_ << " " << size;
+    return PSTRING() << "gf256_from_gf2 " << kernels_.name << " " << size;
   }
   void run(int n) override {
     for (int i = 0; i < n; i++) {
-      Simd::gf256_from_gf2(dest, src, size);
+      kernels_.gf256_from_gf2(dest, src, size);
     }
     td::do_not_optimize_away(dest[0]);
   }
@@ -58,22 +58,22 @@ class Simd_gf256_from_gf2 : public td::Benchmark {
  private:
   alignas(32) td::uint8 dest[8 * size];
   alignas(32) td::uint8 src[size];
-  std::string description_;
+  const td::Gf256Kernels &kernels_;
 };
-template <class Simd, size_t size = 256 * 8>
+template <size_t size = 256 * 8>
 class Simd_gf256_add : public td::Benchmark {
  public:
-  explicit Simd_gf256_add(std::string description) : description_(std::move(description)) {
+  explicit Simd_gf256_add(const td::Gf256Kernels &kernels) : kernels_(kernels) {
     for (size_t i = 0; i < size; i++) {
       src[i] = td::uint8(td::Random::fast(0, 255));
     }
   }
   std::string get_description() const override {
-    return PSTRING() << "gf256_add " << description_ << " " << size;
+    return PSTRING() << "gf256_add " << kernels_.name << " " << size;
   }
   void run(int n) override {
     for (int i = 0; i < n; i++) {
-      Simd::gf256_add(dest, src, size);
+      kernels_.gf256_add(dest, src, size);
     }
     td::do_not_optimize_away(dest[0]);
   }
@@ -81,23 +81,23 @@ class Simd_gf256_add : public td::Benchmark {
  private:
   alignas(32) td::uint8 dest[size];
   alignas(32) td::uint8 src[size];
-  std::string description_;
+  const td::Gf256Kernels &kernels_;
 };
 
-template <class Simd, size_t size = 256 * 8>
+template <size_t size = 256 * 8>
 class Simd_gf256_add_mul : public td::Benchmark {
  public:
-  explicit Simd_gf256_add_mul(std::string description) : description_(std::move(description)) {
+  explicit Simd_gf256_add_mul(const td::Gf256Kernels &kernels) : kernels_(kernels) {
     for (size_t i = 0; i < size; i++) {
       src[i] = td::uint8(td::Random::fast(0, 255));
     }
   }
   std::string get_description() const override {
-    return PSTRING() << "gf256_add_mul " << description_ << " " << size;
+    return PSTRING() << "gf256_add_mul " << kernels_.name << " " << size;
   }
   void run(int n) override {
     for (int i = 0; i < n; i++) {
-      Simd::gf256_add_mul(dest, src, 211, size);
+      kernels_.gf256_add_mul(dest, src, 211, size);
     }
     td::do_not_optimize_away(dest[0]);
   }
@@ -105,23 +105,23 @@ class Simd_gf256_add_mul : public td::Benchmark {
  private:
   alignas(32) td::uint8 dest[size];
   alignas(32) td::uint8 src[size];
-  std::string description_;
+  const td::Gf256Kernels &kernels_;
 };
 
-template <class Simd, size_t size = 256 * 8>
+template <size_t size = 256 * 8>
 class Simd_gf256_mul : public td::Benchmark {
  public:
-  explicit Simd_gf256_mul(std::string description) : description_(std::move(description)) {
+  explicit Simd_gf256_mul(const td::Gf256Kernels &kernels) : kernels_(kernels) {
     for (size_t i = 0; i < size; i++) {
       src[i] = td::uint8(td::Random::fast(0, 255));
     }
   }
   std::string get_description() const override {
-    return PSTRING() << "gf256_mul " << description_ << " " << size;
+    return PSTRING() << "gf256_mul " << kernels_.name << " " << size;
   }
   void run(int n) override {
     for (int i = 0; i < n; i++) {
-      Simd::gf256_mul(src, 211, size);
+      kernels_.gf256_mul(src, 211, size);
     }
     td::do_not_optimize_away(dest[0]);
   }
@@ -129,7 +129,7 @@ class Simd_gf256_mul : public td::Benchmark {
  private:
   alignas(32) td::uint8 dest[size];
   alignas(32) td::uint8 src[size];
-  std::string description_;
+  const td::Gf256Kernels &kernels_;
 };
 
 class GaussBenchmark : public td::Benchmark {
@@ -232,21 +232,18 @@ class FecBenchmark : public td::Benchmark {
   td::BufferSlice data_;
 };
 
-template <template <class T, size_t size> class O, size_t size = 256 * 8>
+template <template <size_t size> class O, size_t size = 256 * 8>
 void bench_simd() {
-  bench(O<td::Simd_null, size>("baseline"));
-#if TD_SSSE3
-  bench(O<td::Simd_sse, size>("SSE"));
-#endif
-#if TD_AVX2
-  bench(O<td::Simd_avx, size>("AVX"));
-#endif
+  for (auto kernels : td::Simd::available_kernels()) {
+    bench(O<size>(*kernels));
+  }
 }
 
-void run_encode_benchmark() {
+void run_encode_decode_benchmark(const td::Gf256Kernels &kernels) {
   constexpr size_t TARGET_TOTAL_BYTES = 100 * 1024 * 1024;
   constexpr size_t SYMBOLS_COUNT[11] = {10, 100, 250, 500, 1000, 2000, 4000, 10000, 20000, 40000, 56403};
 
+  td::Simd::set_kernels(kernels);
   td::uint64 junk = 0;
   for (int it = 0; it < 11; it++) {
     //for (int it = 0; true;) {
@@ -269,15 +266,43 @@ void run_encode_benchmark() {
     }
     double elapsed = td::Time::now() - now;
     double throughput = ((double)elements * (double)iterations * 8.0) / 1024 / 1024 / elapsed;
-    fprintf(stderr, "symbol count = %d, encoded %d MB in %.3lfsecs, throughtput: %.1lfMbit/s\n", (int)symbol_count,
-            (int)(elements * iterations / 1024 / 1024), elapsed, throughput);
+    fprintf(stderr, "%s: symbol count = %d, encoded %d MB in %.3lfsecs, throughtput: %.1lfMbit/s\n", kernels.name,
+            (int)symbol_count, (int)(elements * iterations / 1024 / 1024), elapsed, throughput);
+
+    // the first tenth of source symbols is lost and replaced with repair symbols
+    auto encoder = td::fec::RaptorQEncoder::create(data.clone(), symbol_size);
+    auto parameters = encoder->get_parameters();
+    encoder->prepare_more_symbols();
+    std::vector<td::fec::Symbol> symbols;
+    for (auto id = static_cast<td::uint32>(symbol_count / 10); symbols.size() < symbol_count + 5; id++) {
+      symbols.push_back(encoder->gen_symbol(id));
+    }
+
+    now = td::Time::now();
+    for (size_t i = 0; i < iterations; i++) {
+      auto decoder = td::fec::RaptorQDecoder::create(parameters);
+      for (auto &symbol : symbols) {
+        decoder->add_symbol({symbol.id, symbol.data.clone()});
+      }
+      auto res = decoder->try_decode(false);
+      CHECK(res.is_ok());
+      junk += res.ok().data.as_slice()[0];
+    }
+    elapsed = td::Time::now() - now;
+    throughput = ((double)elements * (double)iterations * 8.0) / 1024 / 1024 / elapsed;
+    fprintf(stderr, "%s: symbol count = %d, decoded %d MB in %.3lfsecs, throughtput: %.1lfMbit/s\n", kernels.name,
+            (int)symbol_count, (int)(elements * iterations / 1024 / 1024), elapsed, throughput);
   }
   td::do_not_optimize_away(junk);
 }
 
 int main(void) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
-  run_encode_benchmark();
+  auto &default_kernels = td::Simd::get_kernels();
+  for (auto kernels : td::Simd::available_kernels()) {
+    run_encode_decode_benchmark(*kernels);
+  }
+  td::Simd::set_kernels(default_kernels);
   bench_simd<Simd_gf256_mul, 32>();
   bench_simd<Simd_gf256_add_mul, 32>();
   bench_simd<Simd_gf256_add, 32>();
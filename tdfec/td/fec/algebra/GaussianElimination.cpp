@@ -56,4 +56,65 @@ Result<MatrixGF256> GaussianElimination::run(MatrixGF256 A, MatrixGF256 D) {
 
   return D.apply_row_permutation(row_perm);
 }
+
+IncrementalGaussianElimination::IncrementalGaussianElimination(size_t cols, size_t d_cols)
+    : cols_(cols), A_(cols + 1, cols), D_(cols + 1, d_cols), pivot_row_(cols, NO_PIVOT) {
+  A_.set_zero();
+  D_.set_zero();
+}
+
+bool IncrementalGaussianElimination::add_row(Slice a, Slice d) {
+  if (is_solved()) {
+    return false;
+  }
+  const size_t row = cols_;
+  A_.row_set(row, a);
+  D_.row_set(row, d);
+
+  // pivot rows are zero in all other pivot columns, so they may be subtracted in any order
+  for (size_t col = 0; col < cols_; col++) {
+    if (pivot_row_[col] == NO_PIVOT) {
+      continue;
+    }
+    auto x = A_.get(row, col);
+    if (!x.is_zero()) {
+      A_.row_add_mul(row, pivot_row_[col], x);
+      D_.row_add_mul(row, pivot_row_[col], x);
+    }
+  }
+
+  size_t pivot = 0;
+  for (; pivot < cols_ && A_.get(row, pivot).is_zero(); pivot++) {
+  }
+  if (pivot == cols_) {
+    return false;
+  }
+  auto mul = A_.get(row, pivot).inverse();
+  A_.row_multiply(row, mul);
+  D_.row_multiply(row, mul);
+
+  for (size_t i = 0; i < rank_; i++) {
+    auto x = A_.get(i, pivot);
+    if (!x.is_zero()) {
+      A_.row_add_mul(i, row, x);
+      D_.row_add_mul(i, row, x);
+    }
+  }
+  A_.row_set(rank_, A_.row(row));
+  D_.row_set(rank_, D_.row(row));
+  pivot_row_[pivot] = narrow_cast<uint32>(rank_);
+  rank_++;
+  return true;
+}
+
+Result<MatrixGF256> IncrementalGaussianElimination::get_solution() const {
+  if (!is_solved()) {
+    return Status::Error("Non solvable");
+  }
+  MatrixGF256 X(cols_, D_.cols());
+  for (size_t col = 0; col < cols_; col++) {
+    X.row_set(col, D_.row(pivot_row_[col]));
+  }
+  return std::move(X);
+}
 }  // namespace td
@@ -20,9 +20,34 @@
 
 #include "td/fec/algebra/MatrixGF256.h"
 
+#include <vector>
+
 namespace td {
 class GaussianElimination {
  public:
   static Result<MatrixGF256> run(MatrixGF256 A, MatrixGF256 D);
 };
+
+// Reduced row echelon form of A * X = D, built one equation at a time
+class IncrementalGaussianElimination {
+ public:
+  IncrementalGaussianElimination(size_t cols, size_t d_cols);
+
+  // returns false if the equation follows from the previous ones
+  bool add_row(Slice a, Slice d);
+  bool is_solved() const {
+    return rank_ == cols_;
+  }
+  Result<MatrixGF256> get_solution() const;
+
+ private:
+  static constexpr uint32 NO_PIVOT = static_cast<uint32>(-1);
+
+  size_t cols_;
+  size_t rank_{0};
+  // rows [0, rank_) hold the equations with pivots, the last row is the equation being added
+  MatrixGF256 A_;
+  MatrixGF256 D_;
+  std::vector<uint32> pivot_row_;
+};
 }  // namespace td
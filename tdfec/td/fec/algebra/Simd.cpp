@@ -0,0 +1,386 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#include "td/fec/algebra/Simd.h"
+
+#include "td/utils/cpu_features.h"
+
+// With gcc and clang every kernel is compiled with its own target attribute and chosen by cpuid at startup.
+// Other compilers get only the kernels enabled by the compiler flags.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TD_FEC_TARGET(x) __attribute__((target(x)))
+#define TD_FEC_SSSE3 1
+#define TD_FEC_AVX2 1
+// the AVX-512BW and GFNI intrinsics used below appeared in gcc 5 and gcc 8
+#if defined(__clang__)
+#if __has_builtin(__builtin_ia32_pshufb512)
+#define TD_FEC_AVX512 1
+#if __has_builtin(__builtin_ia32_vgf2p8affineqb_v64qi)
+#define TD_FEC_GFNI 1
+#endif
+#endif
+#else
+#if __GNUC__ >= 5
+#define TD_FEC_AVX512 1
+#endif
+#if __GNUC__ >= 8
+#define TD_FEC_GFNI 1
+#endif
+#endif
+#else
+#define TD_FEC_TARGET(x)
+#if __SSSE3__ || __AVX2__
+#define TD_FEC_SSSE3 1
+#endif
+#if __AVX2__
+#define TD_FEC_AVX2 1
+#endif
+#if __AVX512BW__
+#define TD_FEC_AVX512 1
+#endif
+#if __AVX512BW__ && __GFNI__
+#define TD_FEC_GFNI 1
+#endif
+#endif
+
+#if TD_FEC_SSSE3
+#include <immintrin.h>
+#endif
+
+namespace td {
+
+namespace {
+
+const Gf256Kernels null_kernels{"Without simd", &Simd_null::gf256_add, &Simd_null::gf256_mul,
+                                &Simd_null::gf256_add_mul, &Simd_null::gf256_from_gf2};
+
+#if TD_FEC_SSSE3
+TD_FEC_TARGET("ssse3") void sse_gf256_add(void *a, const void *b, size_t size) {
+  __m128i *ap128 = reinterpret_cast<__m128i *>(a);
+  const __m128i *bp128 = reinterpret_cast<const __m128i *>(b);
+  for (size_t idx = 0; idx < size; idx += 16) {
+    _mm_storeu_si128(ap128, _mm_xor_si128(_mm_loadu_si128(ap128), _mm_loadu_si128(bp128)));
+    ap128++;
+    bp128++;
+  }
+}
+
+TD_FEC_TARGET("ssse3") void sse_gf256_mul(void *a, uint8 u, size_t size) {
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  const __m128i urow_hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulHi[u]));
+  const __m128i urow_lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulLo[u]));
+
+  __m128i *ap128 = reinterpret_cast<__m128i *>(a);
+  for (size_t idx = 0; idx < size; idx += 16) {
+    __m128i ax = _mm_loadu_si128(ap128);
+    __m128i lo = _mm_and_si128(ax, mask);
+    ax = _mm_srli_epi64(ax, 4);
+    __m128i hi = _mm_and_si128(ax, mask);
+    lo = _mm_shuffle_epi8(urow_lo, lo);
+    hi = _mm_shuffle_epi8(urow_hi, hi);
+
+    _mm_storeu_si128(ap128, _mm_xor_si128(lo, hi));
+    ap128++;
+  }
+}
+
+TD_FEC_TARGET("ssse3") void sse_gf256_add_mul(void *a, const void *b, uint8 u, size_t size) {
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  const __m128i urow_hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulHi[u]));
+  const __m128i urow_lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulLo[u]));
+
+  __m128i *ap128 = reinterpret_cast<__m128i *>(a);
+  const __m128i *bp128 = reinterpret_cast<const __m128i *>(b);
+  for (size_t idx = 0; idx < size; idx += 16) {
+    __m128i bx = _mm_loadu_si128(bp128++);
+    __m128i lo = _mm_and_si128(bx, mask);
+    bx = _mm_srli_epi64(bx, 4);
+    __m128i hi = _mm_and_si128(bx, mask);
+    lo = _mm_shuffle_epi8(urow_lo, lo);
+    hi = _mm_shuffle_epi8(urow_hi, hi);
+
+    _mm_storeu_si128(ap128, _mm_xor_si128(_mm_loadu_si128(ap128), _mm_xor_si128(lo, hi)));
+    ap128++;
+  }
+}
+
+const Gf256Kernels sse_kernels{"With SSE", &sse_gf256_add, &sse_gf256_mul, &sse_gf256_add_mul,
+                               &Simd_null::gf256_from_gf2};
+#endif  // SSSE3
+
+#if TD_FEC_AVX2
+TD_FEC_TARGET("avx2") void avx_gf256_add(void *a, const void *b, size_t size) {
+  __m256i *ap256 = reinterpret_cast<__m256i *>(a);
+  const __m256i *bp256 = reinterpret_cast<const __m256i *>(b);
+  for (size_t idx = 0; idx < size; idx += 32) {
+    _mm256_storeu_si256(ap256, _mm256_xor_si256(_mm256_loadu_si256(ap256), _mm256_loadu_si256(bp256)));
+    ap256++;
+    bp256++;
+  }
+}
+
+TD_FEC_TARGET("avx2") __m256i avx_get_mask(const uint32 mask) {
+  // abcd -> abcd * 8
+  __m256i vmask(_mm256_set1_epi32(mask));
+
+  // abcd * 8 -> aaaaaaaabbbbbbbbccccccccdddddddd
+  const __m256i shuffle(
+      _mm256_setr_epi64x(0x0000000000000000, 0x0101010101010101, 0x0202020202020202, 0x0303030303030303));
+  vmask = _mm256_shuffle_epi8(vmask, shuffle);
+
+  const __m256i bit_mask(_mm256_set1_epi64x(0x7fbfdfeff7fbfdfe));
+  vmask = _mm256_or_si256(vmask, bit_mask);
+  return _mm256_and_si256(_mm256_cmpeq_epi8(vmask, _mm256_set1_epi64x(-1)), _mm256_set1_epi8(1));
+}
+
+TD_FEC_TARGET("avx2") void avx_gf256_from_gf2(void *a, const void *b, size_t size) {
+  DCHECK(size % 4 == 0);
+  __m256i *ap256 = reinterpret_cast<__m256i *>(a);
+  const uint32 *bp = reinterpret_cast<const uint32 *>(b);
+  size /= 4;
+  for (size_t i = 0; i < size; i++, bp++, ap256++) {
+    _mm256_store_si256(ap256, avx_get_mask(*bp));
+  }
+}
+
+TD_FEC_TARGET("avx2") void avx_gf256_mul(void *a, uint8 u, size_t size) {
+  const __m256i urow_hi =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulHi[u])));
+  const __m256i urow_lo =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulLo[u])));
+
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  __m256i *ap256 = reinterpret_cast<__m256i *>(a);
+  for (size_t idx = 0; idx < size; idx += 32) {
+    __m256i ax = _mm256_load_si256(ap256);
+    __m256i lo = _mm256_and_si256(ax, mask);
+    ax = _mm256_srli_epi64(ax, 4);
+    __m256i hi = _mm256_and_si256(ax, mask);
+    lo = _mm256_shuffle_epi8(urow_lo, lo);
+    hi = _mm256_shuffle_epi8(urow_hi, hi);
+
+    _mm256_store_si256(ap256, _mm256_xor_si256(lo, hi));
+    ap256++;
+  }
+}
+
+TD_FEC_TARGET("avx2") void avx_gf256_add_mul(void *a, const void *b, uint8 u, size_t size) {
+  const __m256i urow_hi =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulHi[u])));
+  const __m256i urow_lo =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulLo[u])));
+
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  __m256i *ap256 = reinterpret_cast<__m256i *>(a);
+  const __m256i *bp256 = reinterpret_cast<const __m256i *>(b);
+  for (size_t idx = 0; idx < size; idx += 32) {
+    __m256i bx = _mm256_load_si256(bp256++);
+    __m256i lo = _mm256_and_si256(bx, mask);
+    bx = _mm256_srli_epi64(bx, 4);
+    __m256i hi = _mm256_and_si256(bx, mask);
+    lo = _mm256_shuffle_epi8(urow_lo, lo);
+    hi = _mm256_shuffle_epi8(urow_hi, hi);
+
+    _mm256_store_si256(ap256, _mm256_xor_si256(_mm256_load_si256(ap256), _mm256_xor_si256(lo, hi)));
+    ap256++;
+  }
+}
+
+const Gf256Kernels avx_kernels{"With AVX", &avx_gf256_add, &avx_gf256_mul, &avx_gf256_add_mul,
+                               &avx_gf256_from_gf2};
+#endif  // AVX2
+
+// rows are only 32-byte aligned, so the AVX-512 kernels use unaligned accesses and a masked access for the last
+// partial 64-byte block
+#if TD_FEC_AVX512
+// gcc 12 reports the _mm512_undefined_epi32() passed as a source by _mm512_broadcast_i32x4 and _mm512_srli_epi64
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+TD_FEC_TARGET("avx512f,avx512bw") inline __mmask64 avx512_tail_mask(size_t size) {
+  return (static_cast<__mmask64>(1) << size) - 1;
+}
+
+TD_FEC_TARGET("avx512f,avx512bw") inline __m512i avx512_mul(__m512i x, __m512i urow_lo, __m512i urow_hi) {
+  const __m512i mask = _mm512_set1_epi8(0x0f);
+  __m512i lo = _mm512_and_si512(x, mask);
+  __m512i hi = _mm512_and_si512(_mm512_srli_epi64(x, 4), mask);
+  return _mm512_xor_si512(_mm512_shuffle_epi8(urow_lo, lo), _mm512_shuffle_epi8(urow_hi, hi));
+}
+
+TD_FEC_TARGET("avx512f,avx512bw") void avx512_gf256_add(void *a, const void *b, size_t size) {
+  uint8 *ap = reinterpret_cast<uint8 *>(a);
+  const uint8 *bp = reinterpret_cast<const uint8 *>(b);
+  size_t idx = 0;
+  for (; idx + 64 <= size; idx += 64) {
+    _mm512_storeu_si512(ap + idx, _mm512_xor_si512(_mm512_loadu_si512(ap + idx), _mm512_loadu_si512(bp + idx)));
+  }
+  if (idx < size) {
+    auto m = avx512_tail_mask(size - idx);
+    __m512i x = _mm512_xor_si512(_mm512_maskz_loadu_epi8(m, ap + idx), _mm512_maskz_loadu_epi8(m, bp + idx));
+    _mm512_mask_storeu_epi8(ap + idx, m, x);
+  }
+}
+
+TD_FEC_TARGET("avx512f,avx512bw") void avx512_gf256_mul(void *a, uint8 u, size_t size) {
+  const __m512i urow_hi =
+      _mm512_broadcast_i32x4(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulHi[u])));
+  const __m512i urow_lo =
+      _mm512_broadcast_i32x4(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulLo[u])));
+
+  uint8 *ap = reinterpret_cast<uint8 *>(a);
+  size_t idx = 0;
+  for (; idx + 64 <= size; idx += 64) {
+    _mm512_storeu_si512(ap + idx, avx512_mul(_mm512_loadu_si512(ap + idx), urow_lo, urow_hi));
+  }
+  if (idx < size) {
+    auto m = avx512_tail_mask(size - idx);
+    _mm512_mask_storeu_epi8(ap + idx, m, avx512_mul(_mm512_maskz_loadu_epi8(m, ap + idx), urow_lo, urow_hi));
+  }
+}
+
+TD_FEC_TARGET("avx512f,avx512bw") void avx512_gf256_add_mul(void *a, const void *b, uint8 u, size_t size) {
+  const __m512i urow_hi =
+      _mm512_broadcast_i32x4(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulHi[u])));
+  const __m512i urow_lo =
+      _mm512_broadcast_i32x4(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Octet::OctMulLo[u])));
+
+  uint8 *ap = reinterpret_cast<uint8 *>(a);
+  const uint8 *bp = reinterpret_cast<const uint8 *>(b);
+  size_t idx = 0;
+  for (; idx + 64 <= size; idx += 64) {
+    __m512i x = avx512_mul(_mm512_loadu_si512(bp + idx), urow_lo, urow_hi);
+    _mm512_storeu_si512(ap + idx, _mm512_xor_si512(_mm512_loadu_si512(ap + idx), x));
+  }
+  if (idx < size) {
+    auto m = avx512_tail_mask(size - idx);
+    __m512i x = avx512_mul(_mm512_maskz_loadu_epi8(m, bp + idx), urow_lo, urow_hi);
+    _mm512_mask_storeu_epi8(ap + idx, m, _mm512_xor_si512(_mm512_maskz_loadu_epi8(m, ap + idx), x));
+  }
+}
+
+const Gf256Kernels avx512_kernels{"With AVX-512", &avx512_gf256_add, &avx512_gf256_mul, &avx512_gf256_add_mul,
+                                  &avx_gf256_from_gf2};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif  // AVX512
+
+// GF2P8MULB multiplies modulo x^8 + x^4 + x^3 + x + 1, while RaptorQ uses x^8 + x^4 + x^3 + x^2 + 1,
+// so multiplication by u is done with GF2P8AFFINEQB and the 8x8 bit matrix of the linear map x -> u * x
+#if TD_FEC_GFNI
+uint64 gf2p8_matrices[256];
+
+void init_gf2p8_matrices() {
+  for (uint32 u = 0; u < 256; u++) {
+    uint64 matrix = 0;
+    for (uint32 j = 0; j < 8; j++) {
+      // column j is the image of x^j
+      uint8 column = (Octet(static_cast<uint8>(u)) * Octet(static_cast<uint8>(1 << j))).value();
+      for (uint32 i = 0; i < 8; i++) {
+        // bit i of the result is the parity of byte 7 - i of the matrix and the source byte
+        if ((column >> i) & 1) {
+          matrix |= static_cast<uint64>(1) << (8 * (7 - i) + j);
+        }
+      }
+    }
+    gf2p8_matrices[u] = matrix;
+  }
+}
+
+TD_FEC_TARGET("avx512f,avx512bw,gfni") void gfni_gf256_mul(void *a, uint8 u, size_t size) {
+  const __m512i matrix = _mm512_set1_epi64(static_cast<long long>(gf2p8_matrices[u]));
+  uint8 *ap = reinterpret_cast<uint8 *>(a);
+  size_t idx = 0;
+  for (; idx + 64 <= size; idx += 64) {
+    _mm512_storeu_si512(ap + idx, _mm512_gf2p8affine_epi64_epi8(_mm512_loadu_si512(ap + idx), matrix, 0));
+  }
+  if (idx < size) {
+    auto m = avx512_tail_mask(size - idx);
+    __m512i x = _mm512_gf2p8affine_epi64_epi8(_mm512_maskz_loadu_epi8(m, ap + idx), matrix, 0);
+    _mm512_mask_storeu_epi8(ap + idx, m, x);
+  }
+}
+
+TD_FEC_TARGET("avx512f,avx512bw,gfni") void gfni_gf256_add_mul(void *a, const void *b, uint8 u, size_t size) {
+  const __m512i matrix = _mm512_set1_epi64(static_cast<long long>(gf2p8_matrices[u]));
+  uint8 *ap = reinterpret_cast<uint8 *>(a);
+  const uint8 *bp = reinterpret_cast<const uint8 *>(b);
+  size_t idx = 0;
+  for (; idx + 64 <= size; idx += 64) {
+    __m512i x = _mm512_gf2p8affine_epi64_epi8(_mm512_loadu_si512(bp + idx), matrix, 0);
+    _mm512_storeu_si512(ap + idx, _mm512_xor_si512(_mm512_loadu_si512(ap + idx), x));
+  }
+  if (idx < size) {
+    auto m = avx512_tail_mask(size - idx);
+    __m512i x = _mm512_gf2p8affine_epi64_epi8(_mm512_maskz_loadu_epi8(m, bp + idx), matrix, 0);
+    _mm512_mask_storeu_epi8(ap + idx, m, _mm512_xor_si512(_mm512_maskz_loadu_epi8(m, ap + idx), x));
+  }
+}
+
+const Gf256Kernels gfni_kernels{"With GFNI", &avx512_gf256_add, &gfni_gf256_mul, &gfni_gf256_add_mul,
+                                &avx_gf256_from_gf2};
+#endif  // GFNI
+
+}  // namespace
+
+const Gf256Kernels *Simd_dispatch::current_ = &null_kernels;
+
+const std::vector<const Gf256Kernels *> &Simd_dispatch::available_kernels() {
+  static const std::vector<const Gf256Kernels *> kernels = [] {
+    std::vector<const Gf256Kernels *> res{&null_kernels};
+    auto &features = get_cpu_features();
+#if TD_FEC_SSSE3
+    if (features.ssse3) {
+      res.push_back(&sse_kernels);
+    }
+#endif
+#if TD_FEC_AVX2
+    if (features.avx2) {
+      res.push_back(&avx_kernels);
+    }
+#endif
+#if TD_FEC_AVX512
+    if (features.avx512bw) {
+      res.push_back(&avx512_kernels);
+    }
+#endif
+#if TD_FEC_GFNI
+    if (features.avx512bw && features.gfni) {
+      init_gf2p8_matrices();
+      res.push_back(&gfni_kernels);
+    }
+#endif
+    return res;
+  }();
+  return kernels;
+}
+
+namespace {
+// runs before main; until then the scalar kernels are used
+const bool kernels_selected = [] {
+  Simd_dispatch::set_kernels(*Simd_dispatch::available_kernels().back());
+  return true;
+}();
+}  // namespace
+
+}  // namespace td
@@ -96,6 +96,10 @@ std::unique_ptr<RaptorQEncoder> RaptorQEncoder::create(BufferSlice data, size_t
   return std::make_unique<RaptorQEncoder>(std::move(encoder));
 }
 
+std::unique_ptr<RaptorQEncoder> RaptorQEncoder::create(std::shared_ptr<raptorq::Encoder> encoder) {
+  return std::make_unique<RaptorQEncoder>(std::move(encoder));
+}
+
 Symbol RaptorQEncoder::gen_symbol(uint32 id) {
   BufferSlice data(encoder_->get_parameters().symbol_size);
   encoder_->gen_symbol(id, data.as_slice()).ensure();
@@ -120,7 +124,7 @@ RaptorQEncoder::Parameters RaptorQEncoder::get_parameters() const {
   return res;
 }
 
-RaptorQEncoder::RaptorQEncoder(std::unique_ptr<raptorq::Encoder> encoder) : encoder_(std::move(encoder)) {
+RaptorQEncoder::RaptorQEncoder(std::shared_ptr<raptorq::Encoder> encoder) : encoder_(std::move(encoder)) {
 }
 RaptorQEncoder::~RaptorQEncoder() = default;
 
@@ -121,6 +121,8 @@ class RoundRobinDecoder : public Decoder {
 class RaptorQEncoder : public Encoder {
  public:
   static std::unique_ptr<RaptorQEncoder> create(BufferSlice data, size_t max_symbol_size);
+  // the same raptorq::Encoder may be used by several RaptorQEncoders, possibly from different threads
+  static std::unique_ptr<RaptorQEncoder> create(std::shared_ptr<raptorq::Encoder> encoder);
 
   Symbol gen_symbol(uint32 id) override;
 
@@ -135,11 +137,11 @@ class RaptorQEncoder : public Encoder {
 
   Parameters get_parameters() const;
 
-  RaptorQEncoder(std::unique_ptr<raptorq::Encoder> encoder);
+  RaptorQEncoder(std::shared_ptr<raptorq::Encoder> encoder);
   ~RaptorQEncoder();
 
  private:
-  std::unique_ptr<raptorq::Encoder> encoder_;
+  std::shared_ptr<raptorq::Encoder> encoder_;
 };
 
 class RaptorQDecoder : public Decoder {
@@ -44,7 +44,7 @@ Status Decoder::add_symbol(SymbolRef symbol) {
     add_small_symbol(symbol);
     return Status::OK();
   }
-  if (mask_size_ + slow_symbols_set_.size() >= p_.K + 10) {
+  if (!solver_ && mask_size_ + slow_symbols_set_.size() >= p_.K + 10) {
     return Status::OK();
   }
   add_big_symbol(symbol);
@@ -58,9 +58,15 @@ Result<Decoder::DataWithEncoder> Decoder::try_decode(bool need_encoder) {
 
   optional<RawEncoder> raw_encoder;
   if (mask_size_ < p_.K) {
-    flush_symbols();
     may_decode_ = false;
-    TRY_RESULT(C, Solver::run(p_, symbols_));
+    if (!solver_) {
+      flush_symbols();
+      solver_ = std::make_unique<Solver>(p_, symbols_);
+      info_.full_solves++;
+      symbols_ = {};
+      buffer_ = {};
+    }
+    TRY_RESULT(C, solver_->get_intermediate_symbols());
     raw_encoder = RawEncoder(p_, std::move(C));
     for (uint32 i = 0; i < p_.K; i++) {
       if (!mask_[i]) {
@@ -71,6 +77,8 @@ Result<Decoder::DataWithEncoder> Decoder::try_decode(bool need_encoder) {
     }
   }
 
+  solver_.reset();
+
   auto data = data_.from_slice(data_.as_slice().truncate(data_size_));
 
   std::unique_ptr<Encoder> encoder;
@@ -90,7 +98,10 @@ void Decoder::add_small_symbol(SymbolRef symbol) {
   auto slice = data_.as_slice().substr(symbol.id * symbol_size_, symbol_size_);
   slice.copy_from(symbol.data);
 
-  if (flush_symbols_) {
+  if (solver_) {
+    solver_->add_symbol({symbol.id, slice});
+    info_.reduced_symbols++;
+  } else if (flush_symbols_) {
     symbols_.push_back({symbol.id, slice});
   }
   update_may_decode();
@@ -102,6 +113,14 @@ void Decoder::add_big_symbol(SymbolRef symbol) {
   }
   symbol.id += p_.K_padded - p_.K;
 
+  if (solver_) {
+    if (slow_symbols_set_.insert(symbol.id).second) {
+      solver_->add_symbol(symbol);
+      info_.reduced_symbols++;
+      update_may_decode();
+    }
+    return;
+  }
   if (slow_symbols_set_.size() == slow_symbols_) {
     // Got at least p.K + 10 different symbols
     return;
@@ -117,6 +136,10 @@ void Decoder::add_big_symbol(SymbolRef symbol) {
 }
 
 void Decoder::update_may_decode() {
+  if (solver_) {
+    may_decode_ = mask_size_ == p_.K || solver_->is_solved();
+    return;
+  }
   size_t total_symbols = mask_size_ + slow_symbols_set_.size();
   if (total_symbols < p_.K) {
     return;
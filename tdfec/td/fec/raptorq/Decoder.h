@@ -39,6 +39,16 @@ class Decoder {
   Result<DataWithEncoder> try_decode(bool need_encoder);
   bool may_try_decode() const;
 
+  struct Info {
+    // systems eliminated from scratch
+    uint32 full_solves{0};
+    // symbols reduced into the elimination state kept after a failed attempt
+    uint32 reduced_symbols{0};
+  };
+  Info get_info() const {
+    return info_;
+  }
+
  private:
   Rfc::Parameters p_;
   size_t symbol_size_;
@@ -56,6 +66,9 @@ class Decoder {
   std::vector<SymbolRef> symbols_;
   std::set<uint32> slow_symbols_set_;
   std::string zero_symbol_;
+  // kept after a failed attempt, so that new symbols are eliminated as they arrive instead of starting over
+  std::unique_ptr<Solver> solver_;
+  Info info_;
 
   void add_small_symbol(SymbolRef symbol);
   void add_big_symbol(SymbolRef symbol);
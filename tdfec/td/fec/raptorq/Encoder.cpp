@@ -68,13 +68,17 @@ bool Encoder::has_precalc() const {
 }
 
 void Encoder::precalc() {
+  if (has_precalc()) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(precalc_mutex_);
   if (has_precalc()) {
     return;
   }
   auto r_C = Solver::run(p_, first_symbols_.symbols());
   LOG_IF(FATAL, r_C.is_error()) << r_C.error();
   raw_encoder_ = RawEncoder(p_, r_C.move_as_ok());
-  has_encoder_ = true;
+  has_encoder_.store(true, std::memory_order_release);
 }
 
 }  // namespace raptorq
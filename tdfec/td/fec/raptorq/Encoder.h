@@ -24,6 +24,7 @@
 #include "td/utils/buffer.h"
 
 #include <atomic>
+#include <mutex>
 
 namespace td {
 namespace raptorq {
@@ -51,8 +52,8 @@ class Encoder {
 
   bool has_precalc() const;
 
-  // Must be called only once. No concurrent calls are allowed.
-  // Also it may be and should be called from another thread.
+  // May be called from several threads at once, the precalculation is done only once.
+  // gen_symbol may be called concurrently after the precalculation is finished.
   void precalc();
 
  private:
@@ -63,6 +64,7 @@ class Encoder {
 
   optional<RawEncoder> raw_encoder_;
   std::atomic<bool> has_encoder_{false};
+  std::mutex precalc_mutex_;
 };
 }  // namespace raptorq
 }  // namespace td
@@ -18,13 +18,20 @@
 */
 #include "td/fec/raptorq/RawEncoder.h"
 
+#include "td/utils/port/thread_local.h"
+
 namespace td {
 namespace raptorq {
 void RawEncoder::gen_symbol(uint32 id, MutableSlice to) const {
   CHECK(to.size() == symbol_size());
-  d_.set_zero();
-  p_.encoding_row_for_each(p_.get_encoding_row(id), [&](auto row) { d_.row_add(0, C_.row(row)); });
-  to.copy_from(d_.row(0).truncate(symbol_size()));
+  // aligned scratch row, reused by all encoders running on this thread
+  static TD_THREAD_LOCAL MatrixGF256 *d;
+  if (!init_thread_local<MatrixGF256>(d, 1, symbol_size()) && d->cols() != symbol_size()) {
+    *d = MatrixGF256(1, symbol_size());
+  }
+  d->set_zero();
+  p_.encoding_row_for_each(p_.get_encoding_row(id), [&](auto row) { d->row_add(0, C_.row(row)); });
+  to.copy_from(d->row(0).truncate(symbol_size()));
 }
 }  // namespace raptorq
 }  // namespace td
@@ -70,6 +70,11 @@ Result<MatrixGF256> Solver::run(const Rfc::Parameters &p, Span<SymbolRef> symbol
     auto C = GaussianElimination::run(std::move(A), std::move(D));
     return C;
   }
+  Solver solver(p, symbols);
+  return solver.get_intermediate_symbols();
+}
+
+Solver::Solver(const Rfc::Parameters &p, Span<SymbolRef> symbols) : p_(p) {
   PerfWarningTimer x("solve");
   Timer timer;
   auto perf_log = [&](Slice message) {
@@ -210,35 +215,67 @@ Result<MatrixGF256> Solver::run(const Rfc::Parameters &p, Span<SymbolRef> symbol
   small_D_lower.add(HDPC_left_multiply(D_upper));
   perf_log("small_D_lower += HDPC_left * D_upper");
 
-  // Combine small_A from small_A_lower and small_A_upper
-  MatrixGF256 small_A(small_A_upper.rows() + small_A_lower.rows(), small_A_upper.cols());
-  small_A.set_from(small_A_upper, 0, 0);
-  small_A.set_from(small_A_lower, small_A_upper.rows(), 0);
+  // Keep the state needed to reduce rows of further symbols
+  small_system_ = IncrementalGaussianElimination(small_A_upper.cols(), small_D_upper.cols());
+  for (uint32 i = 0; i < small_A_upper.rows() && !small_system_.is_solved(); i++) {
+    small_system_.add_row(small_A_upper.row(i), small_D_upper.row(i));
+  }
+  for (uint32 i = 0; i < small_A_lower.rows() && !small_system_.is_solved(); i++) {
+    small_system_.add_row(small_A_lower.row(i), small_D_lower.row(i));
+  }
+  perf_log("gauss");
 
-  // Combine small_D from small_D_lower and small_D_upper
-  MatrixGF256 small_D(small_D_upper.rows() + small_D_lower.rows(), small_D_upper.cols());
-  small_D.set_from(small_D_upper, 0, 0);
-  small_D.set_from(small_D_lower, small_D_upper.rows(), 0);
+  U_size_ = U_size;
+  inverse_col_permutation_ = inverse_permutation(col_permutation);
+  col_permutation_ = std::move(col_permutation);
+  A_upper_t_ = A_upper.transpose();
+  E_ = std::move(E);
+  D_upper_ = std::move(D_upper);
+  C_ = std::move(C);
+}
 
-  TRY_RESULT(small_C, GaussianElimination::run(std::move(small_A), std::move(small_D)));
-  perf_log("gauss");
+void Solver::add_symbol(SymbolRef symbol) {
+  if (is_solved()) {
+    return;
+  }
+  // Same as a row of G: subtract rows of U from the encoding row, what remains is a row of the small system
+  std::vector<uint32> upper;
+  MatrixGF2 right(1, E_.cols());
+  right.set_zero();
+  p_.encoding_row_for_each(p_.get_encoding_row(symbol.id), [&](auto col) {
+    auto permuted_col = inverse_col_permutation_[col];
+    if (permuted_col < U_size_) {
+      upper.push_back(permuted_col);
+    } else {
+      right.set_one(0, permuted_col - U_size_);
+    }
+  });
+
+  MatrixGF256 d(1, D_upper_.cols());
+  d.set_zero();
+  d.row_set(0, symbol.data);
+  for (auto row : upper) {
+    right.row_add(0, E_.row(row));
+    d.row_add(0, D_upper_.row(row));
+  }
+  auto a = right.to_gf256();
+  small_system_.add_row(a.row(0), d.row(0));
+}
 
-  C.set_from(small_C.block_view(0, 0, C.rows() - U_size, C.cols()), U_size, 0);
+Result<MatrixGF256> Solver::get_intermediate_symbols() {
+  TRY_RESULT(small_C, small_system_.get_solution());
+  C_.set_from(small_C.block_view(0, 0, C_.rows() - U_size_, C_.cols()), U_size_, 0);
 
-  SparseMatrixGF2 A_upper_t = A_upper.transpose();
-  for (uint32 row = 0; row < U_size; row++) {
-    for (auto col : A_upper_t.col(row)) {
+  for (uint32 row = 0; row < U_size_; row++) {
+    for (auto col : A_upper_t_.col(row)) {
       if (col == row) {
         continue;
       }
-      C.row_add(row, col);
+      C_.row_add(row, col);
     }
   }
-  perf_log("Calc result");
 
-  auto res = C.apply_row_permutation(inverse_permutation(col_permutation));
-  perf_log("Apply permutation");
-  return std::move(res);
+  return C_.apply_row_permutation(inverse_permutation(col_permutation_));
 }
 }  // namespace raptorq
 }  // namespace td
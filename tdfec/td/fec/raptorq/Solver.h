@@ -22,6 +22,7 @@
 
 #include "td/fec/raptorq/Rfc.h"
 #include "td/fec/common/SymbolRef.h"
+#include "td/fec/algebra/GaussianElimination.h"
 
 namespace td {
 namespace raptorq {
@@ -29,6 +30,31 @@ namespace raptorq {
 class Solver {
  public:
   static Result<MatrixGF256> run(const Rfc::Parameters &p, Span<SymbolRef> symbols);
+
+  // Eliminates the system given by symbols (at least K_padded of them). If the system turns out to be degenerate,
+  // the partially eliminated state is kept and further symbols are reduced into it one at a time.
+  Solver(const Rfc::Parameters &p, Span<SymbolRef> symbols);
+
+  void add_symbol(SymbolRef symbol);
+  bool is_solved() const {
+    return small_system_.is_solved();
+  }
+  // intermediate symbols; fails without changing the state if the system is not solved yet
+  Result<MatrixGF256> get_intermediate_symbols();
+
+ private:
+  Rfc::Parameters p_;
+  uint32 U_size_{0};
+  std::vector<uint32> col_permutation_;
+  std::vector<uint32> inverse_col_permutation_;
+  // first U_size_ rows of A_upper (after permutations), used for the final substitution
+  SparseMatrixGF2 A_upper_t_{IdentityGenerator(0)};
+  // after elimination of U: C[i] + E[i] * C[U_size_...] = D_upper[i] for i < U_size_
+  MatrixGF2 E_{0, 0};
+  MatrixGF256 D_upper_{0, 0};
+  // C[0...U_size_) initially contains the encoded symbols of the rows of U
+  MatrixGF256 C_{0, 0};
+  IncrementalGaussianElimination small_system_{0, 0};
 };
 
 }  // namespace raptorq
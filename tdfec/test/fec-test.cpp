@@ -24,9 +24,11 @@
 #if USE_LIBRAPTORQ
 #include "LibRaptorQ.h"
 #endif
+#include "td/utils/port/thread.h"
 #include "td/utils/tests.h"
 
 #include <string>
+#include <vector>
 td::Slice get_long_string() {
   const size_t max_symbol_size = 200;
   const size_t symbols_count = 100;
@@ -90,13 +92,12 @@ TEST(Fec, Simd) {
       }
     };
     run(td::Simd_null());
-#if TD_SSE3
-    run(td::Simd_sse());
-#endif
-#if TD_AVX2
-    run(td::Simd_avx());
-#endif
-    run(td::Simd());
+    auto &default_kernels = td::Simd::get_kernels();
+    for (auto kernels : td::Simd::available_kernels()) {
+      td::Simd::set_kernels(*kernels);
+      run(td::Simd());
+    }
+    td::Simd::set_kernels(default_kernels);
   }
 }
 
@@ -167,6 +168,50 @@ TEST(Fec, RaptorQRandomSymbols) {
   UNREACHABLE();
 }
 
+TEST(Fec, RaptorQIncremental) {
+  // with exactly K symbols decoding fails now and then; later symbols must be added to the kept elimination state
+  auto data = td::rand_string('a', 'z', 200 * 20);
+  auto encoder = td::raptorq::Encoder::create(200, td::BufferSlice(data)).move_as_ok();
+  encoder->precalc();
+  auto parameters = encoder->get_parameters();
+  std::string symbol(parameters.symbol_size, '\0');
+
+  td::Random::Xorshift128plus rnd(123);
+  size_t failed_attempts = 0;
+  size_t retried_decoders = 0;
+  for (int test = 0; test < 1000; test++) {
+    auto decoder = td::raptorq::Decoder::create(parameters).move_as_ok();
+    bool ok = false;
+    bool failed = false;
+    for (size_t i = 0; i < parameters.symbols_count + 20 && !ok; i++) {
+      auto id = static_cast<td::uint32>(rnd() % 100);
+      encoder->gen_symbol(id, symbol);
+      decoder->add_symbol({id, td::Slice(symbol)});
+      if (decoder->may_try_decode()) {
+        auto r = decoder->try_decode(false);
+        if (r.is_ok()) {
+          ASSERT_EQ(r.ok().data, data);
+          ok = true;
+        } else {
+          failed_attempts++;
+          failed = true;
+        }
+      }
+    }
+    CHECK(ok);
+    // a retry must continue from the kept state instead of eliminating the whole system again
+    auto info = decoder->get_info();
+    ASSERT_TRUE(info.full_solves <= 1);
+    if (failed) {
+      retried_decoders++;
+      ASSERT_EQ(1u, info.full_solves);
+      ASSERT_TRUE(info.reduced_symbols > 0);
+    }
+  }
+  LOG(INFO) << "failed attempts: " << failed_attempts;
+  ASSERT_TRUE(retried_decoders > 0);
+}
+
 template <class Encoder, class Decoder>
 void fec_test(td::Slice data, size_t max_symbol_size) {
   LOG(ERROR) << "!";
@@ -225,6 +270,30 @@ TEST(Fec, RaptorQFull) {
   fec_test<td::fec::RaptorQEncoder, td::fec::RaptorQDecoder>(data, max_symbol_size);
 }
 
+TEST(Fec, RaptorQSharedEncoder) {
+  const size_t max_symbol_size = 200;
+  std::string data = td::rand_string('a', 'z', max_symbol_size * 5000);
+  std::shared_ptr<td::raptorq::Encoder> shared =
+      td::raptorq::Encoder::create(max_symbol_size, td::BufferSlice(data)).move_as_ok();
+  auto reference_encoder = td::fec::RaptorQEncoder::create(td::BufferSlice(data), max_symbol_size);
+  reference_encoder->prepare_more_symbols();
+
+  std::vector<td::thread> threads;
+  for (td::uint32 t = 0; t < 4; t++) {
+    threads.push_back(td::thread([&, t] {
+      auto encoder = td::fec::RaptorQEncoder::create(shared);
+      encoder->prepare_more_symbols();
+      for (td::uint32 i = t; i < 20000; i += 4) {
+        auto symbol = encoder->gen_symbol(i);
+        CHECK(symbol.data.as_slice() == reference_encoder->gen_symbol(i).data.as_slice());
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
 #if USE_LIBRAPTORQ
 TEST(Fec, RaptorQEncoder) {
   const size_t max_symbol_size = 200;
@@ -389,10 +389,11 @@ class UdpServerViaTcp : public UdpServer {
 
 }  // namespace detail
 
-Result<actor::ActorOwn<UdpServer>> UdpServer::create(td::Slice name, int32 port, std::unique_ptr<Callback> callback) {
+Result<actor::ActorOwn<UdpServer>> UdpServer::create(td::Slice name, int32 port, std::unique_ptr<Callback> callback,
+                                                     bool reuse_port) {
   td::IPAddress from_ip;
   TRY_STATUS(from_ip.init_ipv4_port("0.0.0.0", port));
-  TRY_RESULT(fd, UdpSocketFd::open(from_ip));
+  TRY_RESULT(fd, UdpSocketFd::open(from_ip, reuse_port));
   fd.maximize_rcv_buffer().ensure();
   return detail::UdpServerImpl::create(name, std::move(fd), std::move(callback));
 }
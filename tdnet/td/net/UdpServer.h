@@ -34,7 +34,8 @@ class UdpServer : public td::actor::Actor {
   };
   virtual void send(td::UdpMessage &&message) = 0;
 
-  static Result<actor::ActorOwn<UdpServer>> create(td::Slice name, int32 port, std::unique_ptr<Callback> callback);
+  static Result<actor::ActorOwn<UdpServer>> create(td::Slice name, int32 port, std::unique_ptr<Callback> callback,
+                                                   bool reuse_port = false);
   static Result<actor::ActorOwn<UdpServer>> create_via_tcp(td::Slice name, int32 port,
                                                            std::unique_ptr<Callback> callback);
 };
@@ -0,0 +1,176 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#include "td/utils/Metrics.h"
+
+#include "td/utils/bits.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/StringBuilder.h"
+
+namespace td {
+
+size_t MetricHistogram::get_bucket(uint64 value) {
+  if (value < static_cast<uint64>(SUB_BUCKETS)) {
+    return static_cast<size_t>(value);
+  }
+  int32 exponent = 63 - count_leading_zeroes64(value);
+  auto sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+  return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket);
+}
+
+uint64 MetricHistogram::get_bucket_upper_bound(size_t bucket) {
+  if (bucket < static_cast<size_t>(SUB_BUCKETS)) {
+    return bucket;
+  }
+  int32 shift = static_cast<int32>(bucket / SUB_BUCKETS) - 1;
+  uint64 sub_bucket = bucket % SUB_BUCKETS;
+  return ((SUB_BUCKETS + sub_bucket) << shift) + ((uint64(1) << shift) - 1);
+}
+
+uint64 MetricHistogram::Snapshot::quantile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  auto rank = static_cast<uint64>(q * static_cast<double>(count) + 0.5);
+  rank = td::max(rank, static_cast<uint64>(1));
+  uint64 seen = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return td::min(get_bucket_upper_bound(i), max);
+    }
+  }
+  return max;
+}
+
+MetricHistogram::~MetricHistogram() {
+  for (auto &shard : shards_) {
+    delete shard.load(std::memory_order_relaxed);
+  }
+}
+
+MetricHistogram::Shard &MetricHistogram::get_shard() {
+  auto thread_id = static_cast<size_t>(get_thread_id());
+  CHECK(thread_id < MAX_SHARDS);
+  auto &ptr = shards_[thread_id];
+  auto *shard = ptr.load(std::memory_order_acquire);
+  if (shard != nullptr) {
+    return *shard;
+  }
+  // threads without their own id share the shard 0, so installation can race
+  auto new_shard = std::make_unique<Shard>();
+  if (ptr.compare_exchange_strong(shard, new_shard.get(), std::memory_order_acq_rel)) {
+    return *new_shard.release();
+  }
+  return *shard;
+}
+
+void MetricHistogram::record(uint64 value) {
+  auto &shard = get_shard();
+  shard.sum.fetch_add(value, std::memory_order_relaxed);
+  shard.buckets[get_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+  auto max = shard.max.load(std::memory_order_relaxed);
+  while (max < value && !shard.max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+MetricHistogram::Snapshot MetricHistogram::snapshot() const {
+  Snapshot res;
+  res.buckets.resize(BUCKET_COUNT, 0);
+  for (auto &ptr : shards_) {
+    auto *shard = ptr.load(std::memory_order_acquire);
+    if (shard == nullptr) {
+      continue;
+    }
+    res.sum += shard->sum.load(std::memory_order_relaxed);
+    res.max = td::max(res.max, shard->max.load(std::memory_order_relaxed));
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+      res.buckets[i] += shard->buckets[i].load(std::memory_order_relaxed);
+    }
+  }
+  // count is taken from the buckets, so that quantiles are consistent even if records are added concurrently
+  for (auto x : res.buckets) {
+    res.count += x;
+  }
+  return res;
+}
+
+MetricsRegistry &MetricsRegistry::get_default() {
+  static MetricsRegistry res;
+  return res;
+}
+
+bool MetricsRegistry::is_used_name(Slice name) const {
+  return counters_.count(name) != 0 || gauges_.count(name) != 0 || histograms_.count(name) != 0;
+}
+
+template <class T>
+T &MetricsRegistry::get_or_create(std::map<std::string, std::unique_ptr<T>, std::less<>> &metrics, Slice name) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = metrics.find(name);
+  if (it != metrics.end()) {
+    return *it->second;
+  }
+  CHECK(!name.empty() && !is_digit(name[0]));
+  for (auto c : name) {
+    CHECK(('a' <= c && c <= 'z') || is_digit(c) || c == '_');
+  }
+  LOG_CHECK(!is_used_name(name)) << "Metric " << name << " is already registered with another kind";
+  auto &res = metrics[name.str()];
+  res = std::make_unique<T>();
+  return *res;
+}
+
+MetricCounter &MetricsRegistry::counter(Slice name) {
+  return get_or_create(counters_, name);
+}
+
+MetricGauge &MetricsRegistry::gauge(Slice name) {
+  return get_or_create(gauges_, name);
+}
+
+MetricHistogram &MetricsRegistry::histogram(Slice name) {
+  return get_or_create(histograms_, name);
+}
+
+std::string MetricsRegistry::to_text() const {
+  static const std::pair<double, Slice> quantiles[] = {{0.5, "0.5"}, {0.9, "0.9"}, {0.99, "0.99"}, {0.999, "0.999"}};
+  std::lock_guard<std::mutex> guard(mutex_);
+  StringBuilder sb;
+  for (auto &it : counters_) {
+    sb << "# TYPE " << it.first << " counter\n" << it.first << " " << it.second->value() << "\n";
+  }
+  for (auto &it : gauges_) {
+    sb << "# TYPE " << it.first << " gauge\n" << it.first << " " << it.second->value() << "\n";
+  }
+  for (auto &it : histograms_) {
+    auto snapshot = it.second->snapshot();
+    sb << "# TYPE " << it.first << " summary\n";
+    for (auto &q : quantiles) {
+      sb << it.first << "{quantile=\"" << q.second << "\"} " << snapshot.quantile(q.first) << "\n";
+    }
+    sb << it.first << "_sum " << snapshot.sum << "\n";
+    sb << it.first << "_count " << snapshot.count << "\n";
+    sb << it.first << "_max " << snapshot.max << "\n";
+  }
+  return sb.as_cslice().str();
+}
+
+}  // namespace td
@@ -0,0 +1,190 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+#include "td/utils/ThreadSafeCounter.h"
+#include "td/utils/Time.h"
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+namespace td {
+
+class MetricCounter {
+ public:
+  void add(int64 diff = 1) {
+    counter_.add(diff);
+  }
+  int64 value() const {
+    return counter_.sum();
+  }
+
+ private:
+  ThreadSafeCounter counter_;
+};
+
+class MetricGauge {
+ public:
+  void set(int64 value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+  void add(int64 diff) {
+    value_.fetch_add(diff, std::memory_order_relaxed);
+  }
+  int64 value() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64> value_{0};
+};
+
+/*
+ * distribution of non-negative integer values (latencies in microseconds, sizes in bytes)
+ *
+ * values are counted in log-linear buckets: every power of two is split into SUB_BUCKETS buckets,
+ * so a quantile is known with relative error below 1 / SUB_BUCKETS
+ * every thread records into its own shard, allocated on the first record; shards are merged on snapshot()
+ */
+class MetricHistogram {
+ public:
+  static constexpr int32 SUB_BUCKET_BITS = 3;
+  static constexpr int32 SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+  static size_t get_bucket(uint64 value);
+  static uint64 get_bucket_upper_bound(size_t bucket);
+
+  struct Snapshot {
+    uint64 count{0};
+    uint64 sum{0};
+    uint64 max{0};
+    std::vector<uint64> buckets;
+
+    // upper bound of the bucket containing the q-th quantile, 0 <= q <= 1
+    uint64 quantile(double q) const;
+  };
+
+  MetricHistogram() = default;
+  MetricHistogram(const MetricHistogram &) = delete;
+  MetricHistogram &operator=(const MetricHistogram &) = delete;
+  ~MetricHistogram();
+
+  void record(uint64 value);
+  void record_duration(double seconds) {
+    record(seconds <= 0 ? 0 : static_cast<uint64>(seconds * 1e6));
+  }
+  Snapshot snapshot() const;
+
+ private:
+  struct Shard {
+    std::atomic<uint64> sum{0};
+    std::atomic<uint64> max{0};
+    std::array<std::atomic<uint64>, BUCKET_COUNT> buckets{};
+  };
+  static constexpr size_t MAX_SHARDS = 128;
+  std::array<std::atomic<Shard *>, MAX_SHARDS> shards_{};
+
+  Shard &get_shard();
+};
+
+// records the lifetime of the object into a histogram in microseconds
+class MetricTimer {
+ public:
+  explicit MetricTimer(MetricHistogram &histogram) : histogram_(&histogram), start_at_(Time::now()) {
+  }
+  MetricTimer(const MetricTimer &) = delete;
+  MetricTimer &operator=(const MetricTimer &) = delete;
+  MetricTimer(MetricTimer &&other) : histogram_(other.histogram_), start_at_(other.start_at_) {
+    other.histogram_ = nullptr;
+  }
+  MetricTimer &operator=(MetricTimer &&) = delete;
+  ~MetricTimer() {
+    reset();
+  }
+
+  void reset() {
+    if (histogram_ != nullptr) {
+      histogram_->record_duration(Time::now() - start_at_);
+      histogram_ = nullptr;
+    }
+  }
+
+ private:
+  MetricHistogram *histogram_;
+  double start_at_;
+};
+
+/*
+ * process-wide set of named metrics
+ *
+ * registration takes a mutex, so the returned references should be looked up once and cached
+ * (e.g. in a function-local static); updating a metric never locks
+ * names must match [a-z_][a-z0-9_]*, the same name can't be used for metrics of different kinds
+ */
+class MetricsRegistry {
+ public:
+  static MetricsRegistry &get_default();
+
+  MetricCounter &counter(Slice name);
+  MetricGauge &gauge(Slice name);
+  MetricHistogram &histogram(Slice name);
+
+  // Prometheus text exposition format; histograms are exported as summaries with _max added
+  std::string to_text() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<MetricCounter>, std::less<>> counters_;
+  std::map<std::string, std::unique_ptr<MetricGauge>, std::less<>> gauges_;
+  std::map<std::string, std::unique_ptr<MetricHistogram>, std::less<>> histograms_;
+
+  template <class T>
+  T &get_or_create(std::map<std::string, std::unique_ptr<T>, std::less<>> &metrics, Slice name);
+  bool is_used_name(Slice name) const;
+};
+
+/*
+ * metric of the default registry with the given name
+ *
+ * the lookup takes a mutex, so the reference should be kept in a function-local static:
+ *   static auto &packets = td::get_metric<td::MetricCounter>("adnl_in_packets_total");
+ */
+template <class T>
+T &get_metric(Slice name);
+
+template <>
+inline MetricCounter &get_metric<MetricCounter>(Slice name) {
+  return MetricsRegistry::get_default().counter(name);
+}
+
+template <>
+inline MetricGauge &get_metric<MetricGauge>(Slice name) {
+  return MetricsRegistry::get_default().gauge(name);
+}
+
+template <>
+inline MetricHistogram &get_metric<MetricHistogram>(Slice name) {
+  return MetricsRegistry::get_default().histogram(name);
+}
+
+}  // namespace td
@@ -0,0 +1,469 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#include "td/utils/Sha256Batch.h"
+
+#include "td/utils/check.h"
+#include "td/utils/cpu_features.h"
+#include "td/utils/crypto.h"
+#include "td/utils/misc.h"
+
+#include <algorithm>
+#include <cstring>
+
+// With gcc and clang every kernel is compiled with its own target attribute and chosen by cpuid at startup.
+// Other compilers get only the kernels enabled by the compiler flags.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TD_SHA256_TARGET(x) __attribute__((target(x)))
+#define TD_SHA256_SHANI 1
+#define TD_SHA256_AVX2 1
+#define TD_SHA256_AVX512 1
+#else
+#define TD_SHA256_TARGET(x)
+#if __SHA__ && __SSE4_1__
+#define TD_SHA256_SHANI 1
+#endif
+#if __AVX2__
+#define TD_SHA256_AVX2 1
+#endif
+#if __AVX512F__ && __AVX512BW__
+#define TD_SHA256_AVX512 1
+#endif
+#endif
+
+#if TD_SHA256_SHANI || TD_SHA256_AVX2 || TD_SHA256_AVX512
+#include <immintrin.h>
+#endif
+
+namespace td {
+
+namespace {
+
+alignas(64) const uint32 sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+const uint32 sha256_init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                               0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+uint32 load_be32(const uint8 *ptr) {
+  return (static_cast<uint32>(ptr[0]) << 24) | (static_cast<uint32>(ptr[1]) << 16) |
+         (static_cast<uint32>(ptr[2]) << 8) | static_cast<uint32>(ptr[3]);
+}
+
+void store_be32(uint8 *ptr, uint32 value) {
+  ptr[0] = static_cast<uint8>(value >> 24);
+  ptr[1] = static_cast<uint8>(value >> 16);
+  ptr[2] = static_cast<uint8>(value >> 8);
+  ptr[3] = static_cast<uint8>(value);
+}
+
+uint32 rotr(uint32 x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+void scalar_compress(uint32 *state, const uint8 *data, size_t blocks) {
+  for (; blocks > 0; blocks--, data += 64) {
+    uint32 w[64];
+    for (int t = 0; t < 16; t++) {
+      w[t] = load_be32(data + t * 4);
+    }
+    for (int t = 16; t < 64; t++) {
+      uint32 s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+      uint32 s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+      w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+    uint32 a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32 e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int t = 0; t < 64; t++) {
+      uint32 t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[t] + w[t];
+      uint32 t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+void scalar_hash(const uint8 *data, const uint32 *offsets, const uint32 * /*lengths*/, size_t count, size_t blocks,
+                 uint8 *const *outputs) {
+  for (size_t i = 0; i < count; i++) {
+    uint32 state[8];
+    std::memcpy(state, sha256_init, sizeof(state));
+    scalar_compress(state, data + offsets[i], blocks);
+    for (int j = 0; j < 8; j++) {
+      store_be32(outputs[i] + j * 4, state[j]);
+    }
+  }
+}
+
+const Sha256Kernel scalar_kernel{"Scalar", 1, &scalar_hash};
+
+#if TD_HAVE_OPENSSL
+void openssl_hash(const uint8 *data, const uint32 *offsets, const uint32 *lengths, size_t count, size_t /*blocks*/,
+                  uint8 *const *outputs) {
+  for (size_t i = 0; i < count; i++) {
+    sha256(Slice(data + offsets[i], lengths[i]), MutableSlice(outputs[i], 32));
+  }
+}
+
+const Sha256Kernel openssl_kernel{"OpenSSL", 1, &openssl_hash};
+#endif
+
+#if TD_SHA256_SHANI
+TD_SHA256_TARGET("sha,sse4.1") void shani_compress(uint32 *state, const uint8 *data, size_t blocks) {
+  const __m128i bswap_mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  // the instructions keep the state as ABEF and CDGH
+  __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0xb1);
+  __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4)), 0x1b);
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+  for (; blocks > 0; blocks--, data += 64) {
+    __m128i abef_save = state0;
+    __m128i cdgh_save = state1;
+    __m128i w[4];
+    for (int i = 0; i < 16; i++) {
+      __m128i m;
+      if (i < 4) {
+        m = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16)), bswap_mask);
+      } else {
+        m = _mm_sha256msg1_epu32(w[i & 3], w[(i - 3) & 3]);
+        m = _mm_add_epi32(m, _mm_alignr_epi8(w[(i - 1) & 3], w[(i - 2) & 3], 4));
+        m = _mm_sha256msg2_epu32(m, w[(i - 1) & 3]);
+      }
+      w[i & 3] = m;
+      __m128i msg = _mm_add_epi32(m, _mm_load_si128(reinterpret_cast<const __m128i *>(sha256_k + i * 4)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+    }
+    state0 = _mm_add_epi32(state0, abef_save);
+    state1 = _mm_add_epi32(state1, cdgh_save);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1b);
+  state1 = _mm_shuffle_epi32(state1, 0xb1);
+  state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+  state1 = _mm_alignr_epi8(state1, tmp, 8);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(state), state0);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), state1);
+}
+
+void shani_hash(const uint8 *data, const uint32 *offsets, const uint32 * /*lengths*/, size_t count, size_t blocks,
+                uint8 *const *outputs) {
+  for (size_t i = 0; i < count; i++) {
+    uint32 state[8];
+    std::memcpy(state, sha256_init, sizeof(state));
+    shani_compress(state, data + offsets[i], blocks);
+    for (int j = 0; j < 8; j++) {
+      store_be32(outputs[i] + j * 4, state[j]);
+    }
+  }
+}
+
+const Sha256Kernel shani_kernel{"SHA-NI", 1, &shani_hash};
+#endif  // SHANI
+
+// Multi-buffer kernels keep word j of all lanes in one vector. Words of the message blocks are gathered
+// from the lanes with 32-bit offsets and byte-swapped.
+
+#if TD_SHA256_AVX2
+template <int n>
+TD_SHA256_TARGET("avx2") __m256i avx2_rotr(__m256i x) {
+  return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+TD_SHA256_TARGET("avx2")
+void avx2_hash(const uint8 *data, const uint32 *offsets, const uint32 * /*lengths*/, size_t count, size_t blocks,
+               uint8 *const *outputs) {
+  constexpr size_t lanes = 8;
+  const __m256i bswap_mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6,
+                                              5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  for (size_t begin = 0; begin < count; begin += lanes) {
+    size_t n = std::min(lanes, count - begin);
+    alignas(32) int32 lane_offsets[lanes];
+    for (size_t i = 0; i < lanes; i++) {
+      // unused lanes hash the first message once more
+      lane_offsets[i] = static_cast<int32>(offsets[begin + (i < n ? i : 0)]);
+    }
+    const __m256i index = _mm256_load_si256(reinterpret_cast<const __m256i *>(lane_offsets));
+
+    __m256i s[8];
+    for (int j = 0; j < 8; j++) {
+      s[j] = _mm256_set1_epi32(static_cast<int32>(sha256_init[j]));
+    }
+    for (size_t b = 0; b < blocks; b++) {
+      const uint8 *block = data + b * 64;
+      __m256i w[16];
+      for (int t = 0; t < 16; t++) {
+        w[t] = _mm256_shuffle_epi8(
+            _mm256_i32gather_epi32(reinterpret_cast<const int *>(block + t * 4), index, 1), bswap_mask);
+      }
+      __m256i a = s[0], bb = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+      for (int t = 0; t < 64; t++) {
+        if (t >= 16) {
+          __m256i w15 = w[(t - 15) & 15];
+          __m256i w2 = w[(t - 2) & 15];
+          __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(avx2_rotr<7>(w15), avx2_rotr<18>(w15)),
+                                        _mm256_srli_epi32(w15, 3));
+          __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(avx2_rotr<17>(w2), avx2_rotr<19>(w2)),
+                                        _mm256_srli_epi32(w2, 10));
+          w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0), _mm256_add_epi32(w[(t - 7) & 15], s1));
+        }
+        __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(avx2_rotr<6>(e), avx2_rotr<11>(e)), avx2_rotr<25>(e));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, sigma1), _mm256_add_epi32(ch, w[t & 15]));
+        t1 = _mm256_add_epi32(t1, _mm256_set1_epi32(static_cast<int32>(sha256_k[t])));
+        __m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(avx2_rotr<2>(a), avx2_rotr<13>(a)), avx2_rotr<22>(a));
+        __m256i maj = _mm256_or_si256(_mm256_and_si256(a, bb), _mm256_and_si256(c, _mm256_or_si256(a, bb)));
+        __m256i t2 = _mm256_add_epi32(sigma0, maj);
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c;
+        c = bb;
+        bb = a;
+        a = _mm256_add_epi32(t1, t2);
+      }
+      s[0] = _mm256_add_epi32(s[0], a);
+      s[1] = _mm256_add_epi32(s[1], bb);
+      s[2] = _mm256_add_epi32(s[2], c);
+      s[3] = _mm256_add_epi32(s[3], d);
+      s[4] = _mm256_add_epi32(s[4], e);
+      s[5] = _mm256_add_epi32(s[5], f);
+      s[6] = _mm256_add_epi32(s[6], g);
+      s[7] = _mm256_add_epi32(s[7], h);
+    }
+
+    alignas(32) uint32 result[8][lanes];
+    for (int j = 0; j < 8; j++) {
+      _mm256_store_si256(reinterpret_cast<__m256i *>(result[j]), s[j]);
+    }
+    for (size_t i = 0; i < n; i++) {
+      for (int j = 0; j < 8; j++) {
+        store_be32(outputs[begin + i] + j * 4, result[j][i]);
+      }
+    }
+  }
+}
+
+const Sha256Kernel avx2_kernel{"AVX2 x8", 8, &avx2_hash};
+#endif  // AVX2
+
+#if TD_SHA256_AVX512
+#if defined(__GNUC__) && !defined(__clang__)
+// false positives of gcc 12 on the undefined source vectors inside the AVX-512 intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+TD_SHA256_TARGET("avx512f,avx512bw")
+void avx512_hash(const uint8 *data, const uint32 *offsets, const uint32 * /*lengths*/, size_t count, size_t blocks,
+                 uint8 *const *outputs) {
+  constexpr size_t lanes = 16;
+  const __m512i bswap_mask = _mm512_broadcast_i32x4(_mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+  for (size_t begin = 0; begin < count; begin += lanes) {
+    size_t n = std::min(lanes, count - begin);
+    alignas(64) int32 lane_offsets[lanes];
+    for (size_t i = 0; i < lanes; i++) {
+      lane_offsets[i] = static_cast<int32>(offsets[begin + (i < n ? i : 0)]);
+    }
+    const __m512i index = _mm512_load_si512(lane_offsets);
+
+    __m512i s[8];
+    for (int j = 0; j < 8; j++) {
+      s[j] = _mm512_set1_epi32(static_cast<int32>(sha256_init[j]));
+    }
+    for (size_t b = 0; b < blocks; b++) {
+      const uint8 *block = data + b * 64;
+      __m512i w[16];
+      for (int t = 0; t < 16; t++) {
+        w[t] = _mm512_shuffle_epi8(_mm512_i32gather_epi32(index, block + t * 4, 1), bswap_mask);
+      }
+      __m512i a = s[0], bb = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+      for (int t = 0; t < 64; t++) {
+        if (t >= 16) {
+          __m512i w15 = w[(t - 15) & 15];
+          __m512i w2 = w[(t - 2) & 15];
+          // 0x96 is a ^ b ^ c
+          __m512i s0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w15, 7), _mm512_ror_epi32(w15, 18),
+                                                 _mm512_srli_epi32(w15, 3), 0x96);
+          __m512i s1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w2, 17), _mm512_ror_epi32(w2, 19),
+                                                 _mm512_srli_epi32(w2, 10), 0x96);
+          w[t & 15] = _mm512_add_epi32(_mm512_add_epi32(w[t & 15], s0), _mm512_add_epi32(w[(t - 7) & 15], s1));
+        }
+        __m512i sigma1 =
+            _mm512_ternarylogic_epi32(_mm512_ror_epi32(e, 6), _mm512_ror_epi32(e, 11), _mm512_ror_epi32(e, 25), 0x96);
+        // 0xca is a ? b : c
+        __m512i ch = _mm512_ternarylogic_epi32(e, f, g, 0xca);
+        __m512i t1 = _mm512_add_epi32(_mm512_add_epi32(h, sigma1), _mm512_add_epi32(ch, w[t & 15]));
+        t1 = _mm512_add_epi32(t1, _mm512_set1_epi32(static_cast<int32>(sha256_k[t])));
+        __m512i sigma0 =
+            _mm512_ternarylogic_epi32(_mm512_ror_epi32(a, 2), _mm512_ror_epi32(a, 13), _mm512_ror_epi32(a, 22), 0x96);
+        // 0xe8 is the majority of a, b, c
+        __m512i maj = _mm512_ternarylogic_epi32(a, bb, c, 0xe8);
+        __m512i t2 = _mm512_add_epi32(sigma0, maj);
+        h = g;
+        g = f;
+        f = e;
+        e = _mm512_add_epi32(d, t1);
+        d = c;
+        c = bb;
+        bb = a;
+        a = _mm512_add_epi32(t1, t2);
+      }
+      s[0] = _mm512_add_epi32(s[0], a);
+      s[1] = _mm512_add_epi32(s[1], bb);
+      s[2] = _mm512_add_epi32(s[2], c);
+      s[3] = _mm512_add_epi32(s[3], d);
+      s[4] = _mm512_add_epi32(s[4], e);
+      s[5] = _mm512_add_epi32(s[5], f);
+      s[6] = _mm512_add_epi32(s[6], g);
+      s[7] = _mm512_add_epi32(s[7], h);
+    }
+
+    alignas(64) uint32 result[8][lanes];
+    for (int j = 0; j < 8; j++) {
+      _mm512_store_si512(result[j], s[j]);
+    }
+    for (size_t i = 0; i < n; i++) {
+      for (int j = 0; j < 8; j++) {
+        store_be32(outputs[begin + i] + j * 4, result[j][i]);
+      }
+    }
+  }
+}
+
+const Sha256Kernel avx512_kernel{"AVX-512 x16", 16, &avx512_hash};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif  // AVX512
+
+}  // namespace
+
+const Sha256Kernel *Sha256Batch::kernel_ = &scalar_kernel;
+
+const std::vector<const Sha256Kernel *> &Sha256Batch::available_kernels() {
+  static const std::vector<const Sha256Kernel *> kernels = [] {
+    std::vector<const Sha256Kernel *> res{&scalar_kernel};
+#if TD_HAVE_OPENSSL
+    res.push_back(&openssl_kernel);
+#endif
+    auto &features = get_cpu_features();
+#if TD_SHA256_AVX2
+    if (features.avx2) {
+      res.push_back(&avx2_kernel);
+    }
+#endif
+#if TD_SHA256_SHANI
+    if (features.sse41 && features.sha) {
+      res.push_back(&shani_kernel);
+    }
+#endif
+#if TD_SHA256_AVX512
+    if (features.avx512bw) {
+      res.push_back(&avx512_kernel);
+    }
+#endif
+    return res;
+  }();
+  return kernels;
+}
+
+void Sha256Batch::add(Slice data, MutableSlice output) {
+  CHECK(output.size() >= 32);
+  if (data_.size() + data.size() + 72 > MAX_PENDING_BYTES && !entries_.empty()) {
+    flush();
+  }
+  auto length = narrow_cast<uint32>(data.size());
+  auto blocks = (length + 9 + 63) / 64;
+  auto offset = narrow_cast<uint32>(data_.size());
+  data_.resize(offset + blocks * 64, 0);
+  auto *ptr = data_.data() + offset;
+  std::memcpy(ptr, data.ubegin(), length);
+  ptr[length] = 0x80;
+  uint64 bit_length = static_cast<uint64>(length) * 8;
+  store_be32(ptr + blocks * 64 - 8, static_cast<uint32>(bit_length >> 32));
+  store_be32(ptr + blocks * 64 - 4, static_cast<uint32>(bit_length));
+  entries_.push_back(Entry{offset, length, blocks, output.ubegin()});
+}
+
+void Sha256Batch::flush() {
+  if (entries_.empty()) {
+    return;
+  }
+  std::stable_sort(entries_.begin(), entries_.end(),
+                   [](const Entry &a, const Entry &b) { return a.blocks < b.blocks; });
+  offsets_.clear();
+  lengths_.clear();
+  outputs_.clear();
+  for (auto &entry : entries_) {
+    offsets_.push_back(entry.offset);
+    lengths_.push_back(entry.length);
+    outputs_.push_back(entry.output);
+  }
+  for (size_t begin = 0; begin < entries_.size();) {
+    auto blocks = entries_[begin].blocks;
+    size_t end = begin + 1;
+    while (end < entries_.size() && entries_[end].blocks == blocks) {
+      end++;
+    }
+    kernel_->hash(data_.data(), offsets_.data() + begin, lengths_.data() + begin, end - begin, blocks,
+                  outputs_.data() + begin);
+    begin = end;
+  }
+  clear();
+}
+
+void Sha256Batch::clear() {
+  entries_.clear();
+  data_.clear();
+}
+
+namespace {
+// runs before main; until then the scalar kernel is used
+const bool kernel_selected = [] {
+  Sha256Batch::set_kernel(*Sha256Batch::available_kernels().back());
+  return true;
+}();
+}  // namespace
+
+}  // namespace td
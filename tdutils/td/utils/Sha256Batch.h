@@ -0,0 +1,96 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+
+#include <vector>
+
+namespace td {
+
+// one implementation of SHA-256, selected at runtime among the ones supported by the cpu
+struct Sha256Kernel {
+  const char *name;
+  // number of messages hashed at once; 1 for kernels hashing messages one by one
+  size_t lanes;
+  // hashes count messages; message i is stored at data + offsets[i], has lengths[i] bytes,
+  // and is followed by the standard padding, so that it takes exactly blocks 64-byte blocks
+  void (*hash)(const uint8 *data, const uint32 *offsets, const uint32 *lengths, size_t count, size_t blocks,
+               uint8 *const *outputs);
+};
+
+/*
+ * SHA-256 of many small independent messages
+ *
+ * messages are collected by add() and hashed by flush(); messages taking the same number of 64-byte blocks
+ * are hashed together, several at a time when a multi-buffer kernel (AVX2, AVX-512) is used
+ * the output of a message must not be read before flush(), and must stay valid until flush() or clear()
+ */
+class Sha256Batch {
+ public:
+  Sha256Batch() = default;
+  Sha256Batch(const Sha256Batch &) = delete;
+  Sha256Batch &operator=(const Sha256Batch &) = delete;
+  Sha256Batch(Sha256Batch &&) = default;
+  Sha256Batch &operator=(Sha256Batch &&) = default;
+  ~Sha256Batch() {
+    flush();
+  }
+
+  void add(Slice data, MutableSlice output);
+  void flush();
+  // forgets all pending messages without hashing them
+  void clear();
+  size_t size() const {
+    return entries_.size();
+  }
+  bool empty() const {
+    return entries_.empty();
+  }
+
+  static const Sha256Kernel &get_kernel() {
+    return *kernel_;
+  }
+  static void set_kernel(const Sha256Kernel &kernel) {
+    kernel_ = &kernel;
+  }
+  // kernels supported by the cpu, from the slowest to the fastest; the fastest one is used by default
+  static const std::vector<const Sha256Kernel *> &available_kernels();
+
+ private:
+  static constexpr size_t MAX_PENDING_BYTES = 1 << 18;
+
+  struct Entry {
+    uint32 offset;
+    uint32 length;
+    uint32 blocks;
+    uint8 *output;
+  };
+  std::vector<Entry> entries_;
+  std::vector<uint8> data_;
+
+  std::vector<uint32> offsets_;
+  std::vector<uint32> lengths_;
+  std::vector<uint8 *> outputs_;
+
+  static const Sha256Kernel *kernel_;
+};
+
+}  // namespace td
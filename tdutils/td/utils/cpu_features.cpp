@@ -0,0 +1,89 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "td/utils/cpu_features.h"
+
+#include "td/utils/int_types.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TD_HAVE_CPUID 1
+#include <cpuid.h>
+#endif
+
+namespace td {
+
+namespace {
+
+CpuFeatures detect_cpu_features() {
+  CpuFeatures res;
+#if TD_HAVE_CPUID
+  unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return res;
+  }
+  res.ssse3 = (ecx & (1u << 9)) != 0;
+  res.sse41 = (ecx & (1u << 19)) != 0;
+  bool osxsave = (ecx & (1u << 27)) != 0;
+  bool avx = (ecx & (1u << 28)) != 0;
+
+  // ymm and zmm registers must also be saved by the OS
+  uint64 xcr0 = 0;
+  if (osxsave) {
+    unsigned xcr0_lo = 0, xcr0_hi = 0;
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    xcr0 = (static_cast<uint64>(xcr0_hi) << 32) | xcr0_lo;
+  }
+  bool ymm_state = (xcr0 & 0x06) == 0x06;
+  bool zmm_state = (xcr0 & 0xe6) == 0xe6;
+
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return res;
+  }
+  res.sha = (ebx & (1u << 29)) != 0;
+  res.avx2 = avx && ymm_state && (ebx & (1u << 5)) != 0;
+  res.avx512bw = res.avx2 && zmm_state && (ebx & (1u << 16)) != 0 && (ebx & (1u << 30)) != 0;
+  res.gfni = (ecx & (1u << 8)) != 0;
+#else
+#if __SSSE3__
+  res.ssse3 = true;
+#endif
+#if __SSE4_1__
+  res.sse41 = true;
+#endif
+#if __SHA__
+  res.sha = true;
+#endif
+#if __AVX2__
+  res.avx2 = true;
+#endif
+#if __AVX512F__ && __AVX512BW__
+  res.avx512bw = true;
+#endif
+#if __GFNI__
+  res.gfni = true;
+#endif
+#endif
+  return res;
+}
+
+}  // namespace
+
+const CpuFeatures &get_cpu_features() {
+  static const CpuFeatures features = detect_cpu_features();
+  return features;
+}
+
+}  // namespace td
@@ -0,0 +1,35 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+namespace td {
+
+// x86 instruction set extensions supported by the CPU and the OS
+// without cpuid (compilers other than gcc and clang) only the extensions enabled by the compiler flags are reported
+struct CpuFeatures {
+  bool ssse3{false};
+  bool sse41{false};
+  bool sha{false};
+  bool avx2{false};
+  // AVX-512F and AVX-512BW
+  bool avx512bw{false};
+  bool gfni{false};
+};
+
+const CpuFeatures &get_cpu_features();
+
+}  // namespace td
@@ -0,0 +1,117 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "td/utils/parallel_for.h"
+
+#include "td/utils/misc.h"
+#include "td/utils/port/thread.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace td {
+
+namespace detail {
+
+#if !TD_THREAD_UNSUPPORTED
+namespace {
+// Workers are started once and live until the process exits. A batch is queued once for every worker that may join
+// it; the calling thread works on the batch too, and then removes the entries no worker has taken yet, so batches
+// never wait for a busy pool and nested calls cannot deadlock.
+class ParallelForPool {
+ public:
+  explicit ParallelForPool(size_t workers) {
+    workers_.reserve(workers);
+    for (size_t i = 0; i < workers; i++) {
+      workers_.emplace_back([this] { loop(); });
+    }
+  }
+
+  void run(ParallelForBatch &batch, size_t helpers) {
+    helpers = std::min(helpers, workers_.size());
+    if (helpers > 0) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      for (size_t i = 0; i < helpers; i++) {
+        queue_.push_back(&batch);
+      }
+      queue_cv_.notify_all();
+    }
+    batch.run();
+    if (helpers == 0) {
+      return;
+    }
+    std::unique_lock<std::mutex> guard(mutex_);
+    queue_.erase(std::remove(queue_.begin(), queue_.end(), &batch), queue_.end());
+    done_cv_.wait(guard, [&] { return std::count(running_.begin(), running_.end(), &batch) == 0; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable queue_cv_;
+  std::condition_variable done_cv_;
+  std::deque<ParallelForBatch *> queue_;
+  std::vector<ParallelForBatch *> running_;
+  std::vector<td::thread> workers_;
+
+  void loop() {
+    std::unique_lock<std::mutex> guard(mutex_);
+    while (true) {
+      queue_cv_.wait(guard, [&] { return !queue_.empty(); });
+      auto batch = queue_.front();
+      queue_.pop_front();
+      running_.push_back(batch);
+      guard.unlock();
+      batch->run();
+      guard.lock();
+      running_.erase(std::find(running_.begin(), running_.end(), batch));
+      done_cv_.notify_all();
+    }
+  }
+};
+
+std::once_flag pool_once;
+ParallelForPool *pool;
+
+void init_pool(int threads) {
+  std::call_once(pool_once, [threads] {
+    // never destroyed: the workers wait on the queue until the process exits
+    pool = new ParallelForPool(static_cast<size_t>(clamp(threads, 1, max_parallel_for_threads()) - 1));
+  });
+}
+}  // namespace
+#endif
+
+void run_parallel_for_batch(ParallelForBatch &batch, size_t helpers) {
+#if !TD_THREAD_UNSUPPORTED
+  init_pool(static_cast<int>(td::thread::hardware_concurrency()));
+  pool->run(batch, helpers);
+#else
+  batch.run();
+#endif
+}
+
+}  // namespace detail
+
+void init_parallel_for_pool(int threads) {
+#if !TD_THREAD_UNSUPPORTED
+  detail::init_pool(threads);
+#endif
+}
+
+}  // namespace td
@@ -0,0 +1,103 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "td/utils/common.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+
+namespace td {
+
+namespace detail {
+// one loop of parallel_for() as seen by the worker pool
+class ParallelForBatch {
+ public:
+  virtual void run() = 0;
+
+ protected:
+  ~ParallelForBatch() = default;
+};
+
+// runs batch on up to helpers workers of the shared pool and on the calling thread; returns when no worker runs it
+void run_parallel_for_batch(ParallelForBatch &batch, size_t helpers);
+}  // namespace detail
+
+// Upper bound of the number of threads of one parallel_for() call, the calling thread included. Pool workers take
+// thread ids, which are limited by ThreadLocalStorage and the metrics, so options that set thread counts are clamped
+// to it.
+constexpr int max_parallel_for_threads() {
+  return 32;
+}
+
+// Starts the shared pool of parallel_for() workers, so that up to threads threads are used by every call.
+// Can be called once at startup; otherwise the pool is started on the first parallel call with one worker per core.
+void init_parallel_for_pool(int threads);
+
+// Calls task(i) for every i in [0, count) on up to threads threads, the calling thread included, and returns when all
+// of them are done. The other threads are workers of a pool shared by all calls; if all of them are busy, the calling
+// thread does the work alone. Tasks are claimed one at a time, so they may differ in cost. If a task throws, the tasks
+// not claimed yet are skipped and the first exception is rethrown in the calling thread.
+template <class F>
+void parallel_for(size_t count, int threads, F &&task) {
+  if (threads <= 1 || count <= 1) {
+    for (size_t i = 0; i < count; i++) {
+      task(i);
+    }
+    return;
+  }
+
+  class Batch final : public detail::ParallelForBatch {
+   public:
+    Batch(size_t count, F &task) : count_(count), task_(task) {
+    }
+    void run() final {
+      for (size_t i = next_++; i < count_; i = next_++) {
+        try {
+          task_(i);
+        } catch (...) {
+          std::lock_guard<std::mutex> guard(error_mutex_);
+          if (!error_) {
+            error_ = std::current_exception();
+          }
+          next_ = count_;
+        }
+      }
+    }
+    void rethrow() {
+      if (error_) {
+        std::rethrow_exception(error_);
+      }
+    }
+
+   private:
+    size_t count_;
+    F &task_;
+    std::atomic<size_t> next_{0};
+    std::exception_ptr error_;
+    std::mutex error_mutex_;
+  };
+
+  Batch batch(count, task);
+  auto helpers = std::min(static_cast<size_t>(std::min(threads, max_parallel_for_threads())), count) - 1;
+  detail::run_parallel_for_batch(batch, helpers);
+  batch.rethrow();
+}
+
+}  // namespace td
@@ -757,7 +757,7 @@ const PollableFdInfo &UdpSocketFd::get_poll_info() const {
   return impl_->get_poll_info();
 }
 
-Result<UdpSocketFd> UdpSocketFd::open(const IPAddress &address) {
+Result<UdpSocketFd> UdpSocketFd::open(const IPAddress &address, bool reuse_port) {
   NativeFd native_fd{socket(address.get_address_family(), SOCK_DGRAM, IPPROTO_UDP)};
   if (!native_fd) {
     return OS_SOCKET_ERROR("Failed to create a socket");
@@ -771,6 +771,15 @@ Result<UdpSocketFd> UdpSocketFd::open(const IPAddress &address) {
   BOOL flags = TRUE;
 #endif
   setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&flags), sizeof(flags));
+  if (reuse_port) {
+#if defined(SO_REUSEPORT)
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char *>(&flags), sizeof(flags)) != 0) {
+      return OS_SOCKET_ERROR("Failed to set SO_REUSEPORT");
+    }
+#else
+    return Status::Error("SO_REUSEPORT is not supported");
+#endif
+  }
   // TODO: SO_REUSEADDR, SO_KEEPALIVE, TCP_NODELAY, SO_SNDBUF, SO_RCVBUF, TCP_QUICKACK, SO_LINGER
 
   auto bind_addr = address.get_any_addr();
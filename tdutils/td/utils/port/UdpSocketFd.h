@@ -60,7 +60,8 @@ class UdpSocketFd {
   Result<uint32> maximize_snd_buffer(uint32 max_buffer_size = 0);
   Result<uint32> maximize_rcv_buffer(uint32 max_buffer_size = 0);
 
-  static Result<UdpSocketFd> open(const IPAddress &address) TD_WARN_UNUSED_RESULT;
+  // with reuse_port several sockets may be bound to the same port, the kernel distributes received datagrams among them
+  static Result<UdpSocketFd> open(const IPAddress &address, bool reuse_port = false) TD_WARN_UNUSED_RESULT;
 
   PollableFdInfo &get_poll_info();
   const PollableFdInfo &get_poll_info() const;
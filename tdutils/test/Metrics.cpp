@@ -0,0 +1,119 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#include "td/utils/Metrics.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+
+#include <limits>
+#include <vector>
+
+TEST(Metrics, histogram_buckets) {
+  td::uint64 prev_upper_bound = 0;
+  for (size_t i = 0; i < td::MetricHistogram::BUCKET_COUNT; i++) {
+    auto upper_bound = td::MetricHistogram::get_bucket_upper_bound(i);
+    ASSERT_EQ(i, td::MetricHistogram::get_bucket(upper_bound));
+    if (i > 0) {
+      ASSERT_EQ(i, td::MetricHistogram::get_bucket(prev_upper_bound + 1));
+    }
+    prev_upper_bound = upper_bound;
+  }
+  ASSERT_EQ(std::numeric_limits<td::uint64>::max(), prev_upper_bound);
+
+  for (int i = 0; i < 100000; i++) {
+    auto value = td::Random::fast_uint64() >> td::Random::fast(0, 63);
+    auto bucket = td::MetricHistogram::get_bucket(value);
+    auto upper_bound = td::MetricHistogram::get_bucket_upper_bound(bucket);
+    ASSERT_TRUE(value <= upper_bound);
+    ASSERT_TRUE(static_cast<double>(upper_bound - value) <= static_cast<double>(value) / 8);
+  }
+}
+
+TEST(Metrics, histogram_quantiles) {
+  td::MetricHistogram histogram;
+  ASSERT_EQ(0u, histogram.snapshot().quantile(0.5));
+  for (td::uint64 i = 1; i <= 1000; i++) {
+    histogram.record(i);
+  }
+  auto snapshot = histogram.snapshot();
+  ASSERT_EQ(1000u, snapshot.count);
+  ASSERT_EQ(500500u, snapshot.sum);
+  ASSERT_EQ(1000u, snapshot.max);
+  auto check_quantile = [&](double q, td::uint64 expected) {
+    auto value = snapshot.quantile(q);
+    ASSERT_TRUE(expected <= value);
+    ASSERT_TRUE(static_cast<double>(value - expected) <= static_cast<double>(expected) / 8);
+  };
+  check_quantile(0.5, 500);
+  check_quantile(0.9, 900);
+  check_quantile(0.99, 990);
+  ASSERT_EQ(1000u, snapshot.quantile(1));
+  ASSERT_EQ(1u, snapshot.quantile(0));
+}
+
+TEST(Metrics, threads) {
+  td::MetricHistogram histogram;
+  td::MetricCounter counter;
+  constexpr int threads_n = 4;
+  constexpr int records_n = 100000;
+  std::vector<td::thread> threads;
+  for (int i = 0; i < threads_n; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < records_n; j++) {
+        histogram.record(j % 100);
+        counter.add();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto snapshot = histogram.snapshot();
+  ASSERT_EQ(static_cast<td::uint64>(threads_n * records_n), snapshot.count);
+  ASSERT_EQ(static_cast<td::uint64>(threads_n * (records_n / 100) * 4950), snapshot.sum);
+  ASSERT_EQ(99u, snapshot.max);
+  ASSERT_EQ(static_cast<td::int64>(threads_n * records_n), counter.value());
+}
+
+TEST(Metrics, registry_text) {
+  td::MetricsRegistry registry;
+  registry.counter("test_queries_total").add(3);
+  registry.gauge("test_queue_size").set(-7);
+  registry.histogram("test_query_us").record(42);
+  ASSERT_EQ(&registry.counter("test_queries_total"), &registry.counter("test_queries_total"));
+  ASSERT_EQ(4, [&] {
+    registry.counter("test_queries_total").add();
+    return registry.counter("test_queries_total").value();
+  }());
+
+  auto text = registry.to_text();
+  ASSERT_TRUE(text.find("# TYPE test_queries_total counter\ntest_queries_total 4\n") != std::string::npos);
+  ASSERT_TRUE(text.find("# TYPE test_queue_size gauge\ntest_queue_size -7\n") != std::string::npos);
+  ASSERT_TRUE(text.find("# TYPE test_query_us summary\n") != std::string::npos);
+  ASSERT_TRUE(text.find("test_query_us{quantile=\"0.5\"} 42\n") != std::string::npos);
+  ASSERT_TRUE(text.find("test_query_us_count 1\n") != std::string::npos);
+  ASSERT_TRUE(text.find("test_query_us_max 42\n") != std::string::npos);
+}
+
+TEST(Metrics, get_metric) {
+  auto &registry = td::MetricsRegistry::get_default();
+  ASSERT_EQ(&registry.counter("test_get_metric_total"), &td::get_metric<td::MetricCounter>("test_get_metric_total"));
+  ASSERT_EQ(&registry.gauge("test_get_metric_size"), &td::get_metric<td::MetricGauge>("test_get_metric_size"));
+  ASSERT_EQ(&registry.histogram("test_get_metric_us"), &td::get_metric<td::MetricHistogram>("test_get_metric_us"));
+}
@@ -21,6 +21,8 @@
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
 #include "td/utils/logging.h"
+#include "td/utils/Random.h"
+#include "td/utils/Sha256Batch.h"
 #include "td/utils/Slice.h"
 #include "td/utils/tests.h"
 #include "td/utils/UInt.h"
@@ -152,6 +154,42 @@ TEST(Crypto, sha256) {
   }
 }
 
+TEST(Crypto, Sha256Batch) {
+  std::vector<td::string> messages;
+  for (int length = 0; length <= 300; length++) {
+    messages.push_back(td::rand_string(std::numeric_limits<char>::min(), std::numeric_limits<char>::max(), length));
+  }
+  for (int i = 0; i < 1000; i++) {
+    messages.push_back(td::rand_string(std::numeric_limits<char>::min(), std::numeric_limits<char>::max(),
+                                       td::Random::fast(0, 300)));
+  }
+  messages.push_back(td::string(10000, 'a'));
+
+  auto &default_kernel = td::Sha256Batch::get_kernel();
+  for (auto kernel : td::Sha256Batch::available_kernels()) {
+    td::Sha256Batch::set_kernel(*kernel);
+    for (size_t batch_size : {1, 3, 16, 17, 100000}) {
+      std::vector<td::UInt256> results(messages.size());
+      td::Sha256Batch batch;
+      for (size_t i = 0; i < messages.size(); i++) {
+        batch.add(messages[i], as_slice(results[i]));
+        if (batch.size() == batch_size) {
+          batch.flush();
+        }
+      }
+      batch.flush();
+      for (size_t i = 0; i < messages.size(); i++) {
+        td::UInt256 baseline;
+        td::sha256(messages[i], as_slice(baseline));
+        if (baseline != results[i]) {
+          LOG(FATAL) << kernel->name << " " << messages[i].size();
+        }
+      }
+    }
+  }
+  td::Sha256Batch::set_kernel(default_kernel);
+}
+
 TEST(Crypto, md5) {
   td::vector<td::Slice> answers{
       "1B2M2Y8AsgTpgAmY7PhCfg==", "xMpCOKC5I4INzFCab3WEmw==", "vwBninYbDRkgk+uA7GMiIQ==", "dwfWrk4CfHDuoqk1wilvIQ=="};
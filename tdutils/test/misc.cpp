@@ -29,6 +29,7 @@
 #include "td/utils/invoke.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/parallel_for.h"
 #include "td/utils/port/EventFd.h"
 #include "td/utils/port/FileFd.h"
 #include "td/utils/port/IPAddress.h"
@@ -52,6 +53,9 @@
 #include <clocale>
 #include <limits>
 #include <locale>
+#include <mutex>
+#include <set>
+#include <stdexcept>
 #include <unordered_map>
 #include <utility>
 
@@ -1003,3 +1007,46 @@ TEST(Misc, Xorshift128plus) {
   ASSERT_EQ(5645917797309401285ull, rnd());
   ASSERT_EQ(13554822455746959330ull, rnd());
 }
+
+TEST(Misc, parallel_for) {
+  for (int threads : {1, 2, 4}) {
+    for (size_t count : {0, 1, 3, 1000}) {
+      std::vector<std::atomic<int>> calls(count);
+      td::parallel_for(count, threads, [&](size_t i) { calls[i]++; });
+      for (auto &c : calls) {
+        ASSERT_EQ(1, c.load());
+      }
+    }
+
+    std::atomic<size_t> done{0};
+    bool caught = false;
+    try {
+      td::parallel_for(1000, threads, [&](size_t i) {
+        if (i == 10) {
+          throw std::runtime_error("task failed");
+        }
+        done++;
+      });
+    } catch (const std::runtime_error &e) {
+      caught = true;
+      ASSERT_STREQ("task failed", e.what());
+    }
+    ASSERT_TRUE(caught);
+    ASSERT_TRUE(done < 1000u);
+  }
+
+  // workers are reused by all calls, so they take a bounded number of thread ids
+  std::mutex mutex;
+  std::set<td::int32> thread_ids;
+  for (int t = 0; t < 100; t++) {
+    td::parallel_for(16, 4, [&](size_t) {
+      std::lock_guard<std::mutex> guard(mutex);
+      thread_ids.insert(td::get_thread_id());
+    });
+  }
+  ASSERT_TRUE(thread_ids.size() <= static_cast<size_t>(td::max_parallel_for_threads()));
+
+  std::atomic<int> nested{0};
+  td::parallel_for(8, 4, [&](size_t) { td::parallel_for(8, 4, [&](size_t) { nested++; }); });
+  ASSERT_EQ(64, nested.load());
+}
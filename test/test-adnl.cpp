@@ -31,8 +31,10 @@
 
 #include "keys/encryptor.h"
 
+#include "td/utils/port/config.h"
 #include "td/utils/port/signals.h"
 #include "td/utils/port/path.h"
+#include "td/utils/port/UdpSocketFd.h"
 #include "td/utils/Random.h"
 
 #include <memory>
@@ -386,6 +388,95 @@ int main() {
   }
   LOG(ERROR) << "successfully tested ignoring";
 
+#if TD_PORT_POSIX && defined(SO_REUSEPORT)
+  LOG(ERROR) << "testing receiving through several sockets of one port";
+  {
+    // let the kernel choose a free port, then listen on it with several SO_REUSEPORT sockets
+    td::IPAddress probe_address;
+    probe_address.init_ipv4_port("0.0.0.0", 1).ensure();
+    probe_address.set_port(0);
+    auto probe = td::UdpSocketFd::open(probe_address).move_as_ok();
+    sockaddr_storage probe_sockaddr;
+    socklen_t probe_sockaddr_len = sizeof(probe_sockaddr);
+    CHECK(getsockname(probe.get_native_fd().socket(), reinterpret_cast<sockaddr *>(&probe_sockaddr),
+                      &probe_sockaddr_len) == 0);
+    probe_address.init_sockaddr(reinterpret_cast<sockaddr *>(&probe_sockaddr), probe_sockaddr_len).ensure();
+    auto port = td::narrow_cast<td::uint16>(probe_address.get_port());
+    probe.close();
+
+    class ReceiveCallback : public ton::adnl::AdnlNetworkManager::Callback {
+     public:
+      void receive_packet(td::IPAddress addr, ton::adnl::AdnlCategoryMask cat_mask, td::BufferSlice data) override {
+        CHECK(cat_mask.test(0));
+        CHECK(data.size() == 64);
+        CHECK(remaining_ > 0);
+        remaining_--;
+      }
+      ReceiveCallback(std::atomic<td::uint32> &remaining) : remaining_(remaining) {
+      }
+
+     private:
+      std::atomic<td::uint32> &remaining_;
+    };
+
+    const td::uint32 senders_count = 8;
+    const td::uint32 packets_per_sender = 32;
+    remaining = senders_count * packets_per_sender;
+
+    std::atomic<bool> listening{false};
+    td::actor::ActorOwn<ton::adnl::AdnlNetworkManager> udp_network_manager;
+    td::IPAddress listen_address;
+    listen_address.init_ipv4_port("127.0.0.1", port).ensure();
+    scheduler.run_in_context([&] {
+      udp_network_manager = ton::adnl::AdnlNetworkManager::create(port, 4);
+      td::actor::send_closure(udp_network_manager, &ton::adnl::AdnlNetworkManager::install_callback,
+                              std::make_unique<ReceiveCallback>(remaining));
+      ton::adnl::AdnlCategoryMask cat_mask;
+      cat_mask[0] = true;
+      td::actor::send_closure(udp_network_manager, &ton::adnl::AdnlNetworkManager::add_self_addr, listen_address,
+                              std::move(cat_mask), 0);
+      td::actor::send_lambda(udp_network_manager, [&] { listening = true; });
+    });
+    // the sockets are bound by add_self_addr, packets sent after that are queued by the kernel
+    t = td::Timestamp::in(10.0);
+    while (scheduler.run(0.1) && !listening) {
+      if (t.is_in_past()) {
+        LOG(FATAL) << "failed to open udp sockets";
+      }
+    }
+
+    // packets from different source ports are spread by the kernel among the sockets of the port
+    std::vector<td::UdpSocketFd> senders;
+    td::IPAddress sender_address;
+    sender_address.init_ipv4_port("127.0.0.1", 1).ensure();
+    sender_address.set_port(0);
+    for (td::uint32 i = 0; i < senders_count; i++) {
+      senders.push_back(td::UdpSocketFd::open(sender_address).move_as_ok());
+    }
+    char packet[64];
+    td::MutableSlice(packet, sizeof(packet)).fill('a');
+    for (td::uint32 i = 0; i < packets_per_sender; i++) {
+      for (auto &sender : senders) {
+        bool is_sent = false;
+        sender.send_message({&listen_address, td::Slice(packet, sizeof(packet))}, is_sent).ensure();
+        CHECK(is_sent);
+      }
+    }
+
+    t = td::Timestamp::in(10.0);
+    while (scheduler.run(0.1)) {
+      if (!remaining) {
+        break;
+      }
+      if (t.is_in_past()) {
+        LOG(FATAL) << "failed to receive udp packets: remaining=" << remaining;
+      }
+    }
+    scheduler.run_in_context([&] { udp_network_manager.reset(); });
+  }
+  LOG(ERROR) << "successfully tested receiving through several sockets of one port";
+#endif
+
   if (true) {
     auto a = ton::adnl::Adnl::adnl_start_time();
     std::this_thread::sleep_for(std::chrono::milliseconds(10000));
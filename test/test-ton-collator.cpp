@@ -85,6 +85,7 @@ class TestNode : public td::actor::Actor {
   bool tdescr_save_{false};
   std::string tdescr_pfx_;
   ton::BlockIdExt shard_top_block_id_;
+  td::uint32 validation_threads_{1};
 
   ton::ShardIdFull shard_{ton::masterchainId, ton::shardIdAll};
 
@@ -112,6 +113,9 @@ class TestNode : public td::actor::Actor {
   void set_collator_flags(int flags) {
     ton::collator_settings |= flags;
   }
+  void set_validation_threads(td::uint32 threads) {
+    validation_threads_ = threads;
+  }
   void start_up() override {
   }
   void alarm() override {
@@ -231,6 +235,7 @@ class TestNode : public td::actor::Actor {
         ton::BlockIdExt{ton::masterchainId, ton::shardIdAll, 0, zero_id_.root_hash, zero_id_.file_hash},
         ton::BlockIdExt{ton::masterchainId, ton::shardIdAll, 0, zero_id_.root_hash, zero_id_.file_hash});
     opts.write().set_initial_sync_disabled(true);
+    opts.write().set_validation_threads(validation_threads_);
     validator_manager_ = ton::validator::ValidatorManagerDiskFactory::create(ton::PublicKeyHash::zero(), opts, shard_,
                                                                              shard_top_block_id_, db_root_);
     for (auto &msg : ext_msgs_) {
@@ -411,6 +416,15 @@ int main(int argc, char *argv[]) {
     td::actor::send_closure(x, &TestNode::set_collator_flags, 2);
     return td::Status::OK();
   });
+  p.add_option('V', "validation-threads", "number of threads checking transactions of the new block (default=1)",
+               [&](td::Slice arg) {
+                 TRY_RESULT(threads, td::to_integer_safe<td::uint32>(arg));
+                 if (threads < 1 || threads > 256) {
+                   return td::Status::Error("bad value for --validation-threads: should be in range [1..256]");
+                 }
+                 td::actor::send_closure(x, &TestNode::set_validation_threads, threads);
+                 return td::Status::OK();
+               });
   p.add_option('s', "save-top-descr", "saves generated shard top block description into files with specified prefix",
                [&](td::Slice arg) {
                  td::actor::send_closure(x, &TestNode::set_top_descr_prefix, arg.str());
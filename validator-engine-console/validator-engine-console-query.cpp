@@ -622,6 +622,24 @@ td::Status GetStatsQuery::receive(td::BufferSlice data) {
   return td::Status::OK();
 }
 
+td::Status GetMetricsQuery::run() {
+  TRY_STATUS(tokenizer_.check_endl());
+  return td::Status::OK();
+}
+
+td::Status GetMetricsQuery::send() {
+  auto b = ton::create_serialize_tl_object<ton::ton_api::engine_validator_getMetrics>();
+  td::actor::send_closure(console_, &ValidatorEngineConsole::envelope_send_query, std::move(b), create_promise());
+  return td::Status::OK();
+}
+
+td::Status GetMetricsQuery::receive(td::BufferSlice data) {
+  TRY_RESULT_PREFIX(f, ton::fetch_tl_object<ton::ton_api::engine_validator_metrics>(data.as_slice(), true),
+                    "received incorrect answer: ");
+  td::TerminalIO::out() << f->text_;
+  return td::Status::OK();
+}
+
 td::Status QuitQuery::send() {
   td::actor::send_closure(console_, &ValidatorEngineConsole::close);
   return td::Status::OK();
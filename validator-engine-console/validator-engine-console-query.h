@@ -753,6 +753,25 @@ class GetStatsQuery : public Query {
   }
 };
 
+class GetMetricsQuery : public Query {
+ public:
+  GetMetricsQuery(td::actor::ActorId<ValidatorEngineConsole> console, Tokenizer tokenizer)
+      : Query(console, std::move(tokenizer)) {
+  }
+  td::Status run() override;
+  td::Status send() override;
+  td::Status receive(td::BufferSlice data) override;
+  static std::string get_name() {
+    return "getmetrics";
+  }
+  static std::string get_help() {
+    return "getmetrics\tprints counters and latency histograms in Prometheus text format";
+  }
+  std::string name() const override {
+    return get_name();
+  }
+};
+
 class QuitQuery : public Query {
  public:
   QuitQuery(td::actor::ActorId<ValidatorEngineConsole> console, Tokenizer tokenizer)
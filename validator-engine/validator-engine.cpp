@@ -37,10 +37,13 @@
 #include "crypto/fift/utils.h"
 
 #include "td/utils/filesystem.h"
+#include "td/utils/Metrics.h"
 #include "td/actor/MultiPromise.h"
 #include "td/utils/overloaded.h"
+#include "td/utils/parallel_for.h"
 #include "td/utils/OptionsParser.h"
 #include "td/utils/port/path.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/port/signals.h"
 #include "td/utils/port/user.h"
 #include "td/utils/port/rlimit.h"
@@ -1327,6 +1330,25 @@ td::Status ValidatorEngine::load_global_config() {
   if (truncate_seqno_ > 0) {
     validator_options_.write().truncate_db(truncate_seqno_);
   }
+  // collation, validation, state updates and deserialization of large states share one pool of worker threads
+  auto parallel_threads = std::max({collator_threads_, validation_threads_, state_update_threads_,
+                                    static_cast<td::uint32>(td::thread::hardware_concurrency())});
+  td::init_parallel_for_pool(static_cast<int>(parallel_threads));
+  if (collator_threads_ > 1) {
+    validator_options_.write().set_collator_threads(collator_threads_);
+  }
+  if (validation_threads_ > 1) {
+    validator_options_.write().set_validation_threads(validation_threads_);
+  }
+  if (state_update_threads_ > 1) {
+    validator_options_.write().set_state_update_threads(state_update_threads_);
+  }
+  if (max_open_archive_slices_ > 0) {
+    validator_options_.write().set_max_open_archive_slices(max_open_archive_slices_);
+  }
+  if (archive_index_memory_ > 0) {
+    validator_options_.write().set_archive_index_memory(archive_index_memory_);
+  }
 
   std::vector<ton::BlockIdExt> h;
   for (auto &x : conf.validator_->hardforks_) {
@@ -1633,11 +1655,46 @@ void ValidatorEngine::got_key(ton::PublicKey key) {
 
 void ValidatorEngine::start() {
   read_config_ = true;
+  start_metrics_http_server();
   start_adnl();
 }
 
+void ValidatorEngine::start_metrics_http_server() {
+  if (metrics_http_port_ == 0) {
+    return;
+  }
+  class Callback : public ton::http::HttpServer::Callback {
+   public:
+    void receive_request(
+        std::unique_ptr<ton::http::HttpRequest> request, std::shared_ptr<ton::http::HttpPayload> payload,
+        td::Promise<std::pair<std::unique_ptr<ton::http::HttpResponse>, std::shared_ptr<ton::http::HttpPayload>>>
+            promise) override {
+      if (request->method() != "GET") {
+        ton::http::answer_error(ton::http::HttpStatusCode::status_method_not_allowed, "", std::move(promise));
+        return;
+      }
+      if (request->url() != "/metrics") {
+        ton::http::answer_error(ton::http::HttpStatusCode::status_not_found, "", std::move(promise));
+        return;
+      }
+      auto text = td::MetricsRegistry::get_default().to_text();
+      auto response = ton::http::HttpResponse::create("HTTP/1.0", 200, "OK", false, false).move_as_ok();
+      response->add_header(ton::http::HttpHeader{"Content-Type", "text/plain; version=0.0.4"}).ensure();
+      TRY_STATUS_PROMISE(promise,
+                         response->add_header(ton::http::HttpHeader{"Content-Length", td::to_string(text.size())}));
+      response->complete_parse_header().ensure();
+      TRY_RESULT_PROMISE(promise, response_payload, response->create_empty_payload());
+      response_payload->add_chunk(td::BufferSlice(text));
+      response_payload->complete_parse();
+      promise.set_value(std::make_pair(std::move(response), std::move(response_payload)));
+    }
+  };
+  // the metrics are not authenticated, so they are served on the loopback interface only
+  metrics_http_server_ = ton::http::HttpServer::create(metrics_http_port_, std::make_shared<Callback>(), "127.0.0.1");
+}
+
 void ValidatorEngine::start_adnl() {
-  adnl_network_manager_ = ton::adnl::AdnlNetworkManager::create(config_.out_port);
+  adnl_network_manager_ = ton::adnl::AdnlNetworkManager::create(config_.out_port, adnl_receive_sockets_);
   adnl_ = ton::adnl::Adnl::create(db_root_, keyring_.get());
   td::actor::send_closure(adnl_, &ton::adnl::Adnl::register_network_manager, adnl_network_manager_.get());
 
@@ -3066,6 +3123,17 @@ void ValidatorEngine::run_control_query(ton::ton_api::engine_validator_getStats
   td::actor::send_closure(validator_manager_, &ton::validator::ValidatorManagerInterface::prepare_stats, std::move(P));
 }
 
+void ValidatorEngine::run_control_query(ton::ton_api::engine_validator_getMetrics &query, td::BufferSlice data,
+                                        ton::PublicKeyHash src, td::uint32 perm, td::Promise<td::BufferSlice> promise) {
+  if (!(perm & ValidatorEnginePermissions::vep_default)) {
+    promise.set_value(create_control_query_error(td::Status::Error(ton::ErrorCode::error, "not authorized")));
+    return;
+  }
+
+  promise.set_value(ton::create_serialize_tl_object<ton::ton_api::engine_validator_metrics>(
+      td::MetricsRegistry::get_default().to_text()));
+}
+
 void ValidatorEngine::run_control_query(ton::ton_api::engine_validator_createElectionBid &query, td::BufferSlice data,
                                         ton::PublicKeyHash src, td::uint32 perm, td::Promise<td::BufferSlice> promise) {
   if (!(perm & ValidatorEnginePermissions::vep_default)) {
@@ -3457,6 +3525,84 @@ int main(int argc, char *argv[]) {
     return td::Status::OK();
   });
 
+  p.add_option('w', "collator-threads",
+               "number of threads executing transactions of a block being collated default=1 (sequential)",
+               [&](td::Slice arg) {
+                 TRY_RESULT(v, td::to_integer_safe<td::uint32>(arg));
+                 if (v < 1 || v > static_cast<td::uint32>(td::max_parallel_for_threads())) {
+                   return td::Status::Error(ton::ErrorCode::error,
+                                            PSTRING() << "bad value for --collator-threads: should be in range [1.."
+                                                      << td::max_parallel_for_threads() << "]");
+                 }
+                 acts.push_back([&x, v]() { td::actor::send_closure(x, &ValidatorEngine::set_collator_threads, v); });
+                 return td::Status::OK();
+               });
+  p.add_option('V', "validation-threads",
+               "number of threads checking transactions of a block candidate default=1 (sequential)",
+               [&](td::Slice arg) {
+                 TRY_RESULT(v, td::to_integer_safe<td::uint32>(arg));
+                 if (v < 1 || v > static_cast<td::uint32>(td::max_parallel_for_threads())) {
+                   return td::Status::Error(ton::ErrorCode::error,
+                                            PSTRING() << "bad value for --validation-threads: should be in range [1.."
+                                                      << td::max_parallel_for_threads() << "]");
+                 }
+                 acts.push_back([&x, v]() { td::actor::send_closure(x, &ValidatorEngine::set_validation_threads, v); });
+                 return td::Status::OK();
+               });
+  p.add_option('P', "state-update-threads",
+               "number of threads applying Merkle updates of large blocks to shard states default=1 (sequential)",
+               [&](td::Slice arg) {
+                 TRY_RESULT(v, td::to_integer_safe<td::uint32>(arg));
+                 if (v < 1 || v > static_cast<td::uint32>(td::max_parallel_for_threads())) {
+                   return td::Status::Error(ton::ErrorCode::error,
+                                            PSTRING() << "bad value for --state-update-threads: should be in range [1.."
+                                                      << td::max_parallel_for_threads() << "]");
+                 }
+                 acts.push_back(
+                     [&x, v]() { td::actor::send_closure(x, &ValidatorEngine::set_state_update_threads, v); });
+                 return td::Status::OK();
+               });
+  p.add_option('O', "max-open-archive-slices",
+               "maximal number of archive slices with open index and files, least recently used ones are closed "
+               "default=0 (no limit)",
+               [&](td::Slice arg) {
+                 TRY_RESULT(v, td::to_integer_safe<td::uint32>(arg));
+                 acts.push_back(
+                     [&x, v]() { td::actor::send_closure(x, &ValidatorEngine::set_max_open_archive_slices, v); });
+                 return td::Status::OK();
+               });
+  p.add_option('M', "archive-index-memory",
+               "total memtable size of archive slice indexes (in megabytes) default=0 (RocksDB defaults)",
+               [&](td::Slice arg) {
+                 TRY_RESULT(v, td::to_integer_safe<td::uint64>(arg));
+                 acts.push_back([&x, v]() {
+                   td::actor::send_closure(x, &ValidatorEngine::set_archive_index_memory, v << 20);
+                 });
+                 return td::Status::OK();
+               });
+
+  p.add_option('R', "adnl-receive-sockets",
+               "number of SO_REUSEPORT sockets opened for every ADNL port, each processed by a separate actor "
+               "default=1",
+               [&](td::Slice arg) {
+                 TRY_RESULT(v, td::to_integer_safe<td::uint32>(arg));
+                 if (v < 1 || v > 256) {
+                   return td::Status::Error(ton::ErrorCode::error,
+                                            "bad value for --adnl-receive-sockets: should be in range [1..256]");
+                 }
+                 acts.push_back(
+                     [&x, v]() { td::actor::send_closure(x, &ValidatorEngine::set_adnl_receive_sockets, v); });
+                 return td::Status::OK();
+               });
+
+  p.add_option('H', "metrics-http-port",
+               "serve metrics in Prometheus text format at http://127.0.0.1:<port>/metrics default=0 (disabled)",
+               [&](td::Slice arg) {
+                 TRY_RESULT(v, td::to_integer_safe<td::uint16>(arg));
+                 acts.push_back([&x, v]() { td::actor::send_closure(x, &ValidatorEngine::set_metrics_http_port, v); });
+                 return td::Status::OK();
+               });
+
   td::uint32 threads = 7;
 
   p.add_option('t', "threads", PSTRING() << "number of threads (default=" << threads << ")", [&](td::Slice fname) {
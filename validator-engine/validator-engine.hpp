@@ -35,6 +35,7 @@
 #include "validator/full-node.h"
 #include "validator/full-node-master.h"
 #include "adnl/adnl-ext-client.h"
+#include "http/http-server.h"
 
 #include "td/actor/MultiPromise.h"
 
@@ -144,6 +145,7 @@ class ValidatorEngine : public td::actor::Actor {
   td::actor::ActorOwn<ton::validator::fullnode::FullNode> full_node_;
   std::map<td::uint16, td::actor::ActorOwn<ton::validator::fullnode::FullNodeMaster>> full_node_masters_;
   td::actor::ActorOwn<ton::adnl::AdnlExtServer> control_ext_server_;
+  td::actor::ActorOwn<ton::http::HttpServer> metrics_http_server_;
 
   std::string local_config_ = "";
   std::string global_config_ = "ton-global.config";
@@ -199,6 +201,13 @@ class ValidatorEngine : public td::actor::Actor {
   bool started_keyring_ = false;
   bool started_ = false;
   ton::BlockSeqno truncate_seqno_{0};
+  td::uint32 collator_threads_{1};
+  td::uint32 validation_threads_{1};
+  td::uint32 state_update_threads_{1};
+  td::uint32 max_open_archive_slices_{0};
+  td::uint64 archive_index_memory_{0};
+  td::uint32 adnl_receive_sockets_{1};
+  td::uint16 metrics_http_port_{0};
 
   std::set<ton::CatchainSeqno> unsafe_catchains_;
 
@@ -234,6 +243,27 @@ class ValidatorEngine : public td::actor::Actor {
   void set_truncate_seqno(ton::BlockSeqno seqno) {
     truncate_seqno_ = seqno;
   }
+  void set_collator_threads(td::uint32 threads) {
+    collator_threads_ = threads;
+  }
+  void set_validation_threads(td::uint32 threads) {
+    validation_threads_ = threads;
+  }
+  void set_state_update_threads(td::uint32 threads) {
+    state_update_threads_ = threads;
+  }
+  void set_max_open_archive_slices(td::uint32 value) {
+    max_open_archive_slices_ = value;
+  }
+  void set_archive_index_memory(td::uint64 value) {
+    archive_index_memory_ = value;
+  }
+  void set_adnl_receive_sockets(td::uint32 value) {
+    adnl_receive_sockets_ = value;
+  }
+  void set_metrics_http_port(td::uint16 port) {
+    metrics_http_port_ = port;
+  }
   void add_ip(td::IPAddress addr) {
     addrs_.push_back(addr);
   }
@@ -253,6 +283,8 @@ class ValidatorEngine : public td::actor::Actor {
 
   void start();
 
+  void start_metrics_http_server();
+
   void start_adnl();
   void add_addr(const Config::Addr &addr, const Config::AddrCats &cats);
   void add_adnl(ton::PublicKeyHash id, AdnlCategory cat);
@@ -381,6 +413,8 @@ class ValidatorEngine : public td::actor::Actor {
                          ton::PublicKeyHash src, td::uint32 perm, td::Promise<td::BufferSlice> promise);
   void run_control_query(ton::ton_api::engine_validator_getStats &query, td::BufferSlice data, ton::PublicKeyHash src,
                          td::uint32 perm, td::Promise<td::BufferSlice> promise);
+  void run_control_query(ton::ton_api::engine_validator_getMetrics &query, td::BufferSlice data, ton::PublicKeyHash src,
+                         td::uint32 perm, td::Promise<td::BufferSlice> promise);
   void run_control_query(ton::ton_api::engine_validator_createElectionBid &query, td::BufferSlice data,
                          ton::PublicKeyHash src, td::uint32 perm, td::Promise<td::BufferSlice> promise);
   void run_control_query(ton::ton_api::engine_validator_checkDhtServers &query, td::BufferSlice data,
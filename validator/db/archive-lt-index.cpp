@@ -0,0 +1,518 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#include "archive-lt-index.hpp"
+#include "auto/tl/ton_api.h"
+#include "common/errorcode.h"
+#include "tl-utils/tl-utils.hpp"
+#include "ton/ton-shard.h"
+#include "ton/ton-tl.hpp"
+#include "td/utils/filesystem.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/path.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ton {
+
+namespace validator {
+
+namespace {
+
+struct IndexHeader {
+  td::uint32 magic;
+  td::uint32 version;
+  td::uint32 shards;
+  td::uint32 fences;
+  td::uint64 blocks;
+  td::uint64 handles_offset;
+};
+
+constexpr td::uint32 index_magic() {
+  return 0x7c3e5a19;
+}
+
+constexpr td::uint32 index_version() {
+  return 1;
+}
+
+template <class T>
+T load(td::Slice data, td::uint64 idx) {
+  T res;
+  std::memcpy(&res, data.data() + idx * sizeof(T), sizeof(T));
+  return res;
+}
+
+template <class T>
+void store(std::string &data, const T &value) {
+  data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+}  // namespace
+
+td::Status ArchiveLtIndex::write(td::CSlice path, std::vector<Shard> shards) {
+  static_assert(sizeof(IndexHeader) == 32, "unexpected padding");
+  static_assert(sizeof(ShardRecord) == 32, "unexpected padding");
+  static_assert(sizeof(FenceRecord) == 16, "unexpected padding");
+  static_assert(sizeof(BlockRecord) == 96, "unexpected padding");
+
+  std::sort(shards.begin(), shards.end(), [](const Shard &a, const Shard &b) {
+    return std::make_pair(a.shard.workchain, a.shard.shard) < std::make_pair(b.shard.workchain, b.shard.shard);
+  });
+  std::string shard_data, fence_data, block_data, handle_data;
+  td::uint32 total_fences = 0;
+  td::uint64 total_blocks = 0;
+  for (auto &shard : shards) {
+    for (size_t i = 1; i < shard.blocks.size(); i++) {
+      if (shard.blocks[i].id.seqno() <= shard.blocks[i - 1].id.seqno()) {
+        return td::Status::Error(ErrorCode::error, "blocks of a shard are not sorted");
+      }
+    }
+    ShardRecord s;
+    std::memset(&s, 0, sizeof(s));
+    s.workchain = shard.shard.workchain;
+    s.shard = shard.shard.shard;
+    s.first_block = td::narrow_cast<td::uint32>(total_blocks);
+    s.blocks = td::narrow_cast<td::uint32>(shard.blocks.size());
+    s.first_fence = total_fences;
+    s.fences = (s.blocks + fence_step() - 1) / fence_step();
+    store(shard_data, s);
+    for (td::uint32 i = 0; i < s.blocks; i++) {
+      auto &block = shard.blocks[i];
+      BlockRecord b;
+      std::memset(&b, 0, sizeof(b));
+      b.seqno = block.id.seqno();
+      b.ts = block.ts;
+      b.lt = block.lt;
+      std::memcpy(b.root_hash, block.id.root_hash.data(), 32);
+      std::memcpy(b.file_hash, block.id.file_hash.data(), 32);
+      b.handle_offset = handle_data.size();
+      b.handle_size = td::narrow_cast<td::uint32>(block.handle.size());
+      handle_data.append(block.handle.as_slice().str());
+      store(block_data, b);
+      if (i % fence_step() == 0) {
+        store(fence_data, FenceRecord{b.seqno, b.ts, b.lt});
+      }
+    }
+    total_fences += s.fences;
+    total_blocks += s.blocks;
+  }
+
+  IndexHeader header;
+  header.magic = index_magic();
+  header.version = index_version();
+  header.shards = td::narrow_cast<td::uint32>(shards.size());
+  header.fences = total_fences;
+  header.blocks = total_blocks;
+  header.handles_offset = sizeof(header) + shard_data.size() + fence_data.size() + block_data.size();
+
+  std::string data;
+  data.reserve(static_cast<size_t>(header.handles_offset) + handle_data.size());
+  store(data, header);
+  data += shard_data;
+  data += fence_data;
+  data += block_data;
+  data += handle_data;
+
+  // the index is either complete or absent
+  auto tmp_path = PSTRING() << path << ".tmp";
+  TRY_STATUS(td::write_file(tmp_path, data));
+  return td::rename(tmp_path, path);
+}
+
+td::Result<ArchiveLtIndex> ArchiveLtIndex::open(td::CSlice path) {
+  TRY_RESULT(fd, td::FileFd::open(path, td::FileFd::Read));
+  TRY_RESULT(mapping, td::MemoryMapping::create_from_file(fd));
+  fd.close();
+
+  ArchiveLtIndex index{std::move(mapping)};
+  auto data = index.mapping_.as_slice();
+  if (data.size() < sizeof(IndexHeader)) {
+    return td::Status::Error(ErrorCode::protoviolation, "too short lt index");
+  }
+  auto header = load<IndexHeader>(data, 0);
+  if (header.magic != index_magic() || header.version != index_version()) {
+    return td::Status::Error(ErrorCode::protoviolation, "bad lt index magic");
+  }
+  td::uint64 shards_size = td::uint64{header.shards} * sizeof(ShardRecord);
+  td::uint64 fences_size = td::uint64{header.fences} * sizeof(FenceRecord);
+  td::uint64 blocks_size = header.blocks * sizeof(BlockRecord);
+  if (header.blocks > data.size() / sizeof(BlockRecord) ||
+      header.handles_offset != sizeof(IndexHeader) + shards_size + fences_size + blocks_size ||
+      header.handles_offset > data.size()) {
+    return td::Status::Error(ErrorCode::protoviolation, "bad lt index size");
+  }
+  index.shards_ = header.shards;
+  index.fences_ = header.fences;
+  index.blocks_ = header.blocks;
+  data.remove_prefix(sizeof(IndexHeader));
+  index.shard_records_ = data.substr(0, static_cast<size_t>(shards_size));
+  data.remove_prefix(static_cast<size_t>(shards_size));
+  index.fence_records_ = data.substr(0, static_cast<size_t>(fences_size));
+  data.remove_prefix(static_cast<size_t>(fences_size));
+  index.block_records_ = data.substr(0, static_cast<size_t>(blocks_size));
+  data.remove_prefix(static_cast<size_t>(blocks_size));
+  index.handles_ = data;
+
+  for (td::uint32 i = 0; i < index.shards_; i++) {
+    auto s = load<ShardRecord>(index.shard_records_, i);
+    if (td::uint64{s.first_block} + s.blocks > index.blocks_ || td::uint64{s.first_fence} + s.fences > index.fences_ ||
+        s.fences != (s.blocks + fence_step() - 1) / fence_step()) {
+      return td::Status::Error(ErrorCode::protoviolation, "bad lt index shard record");
+    }
+  }
+  return std::move(index);
+}
+
+bool ArchiveLtIndex::find_shard(ShardIdFull shard, ShardRecord &record) const {
+  auto key = std::make_pair(shard.workchain, shard.shard);
+  td::uint32 l = 0, r = shards_;
+  while (l < r) {
+    auto x = l + (r - l) / 2;
+    auto s = load<ShardRecord>(shard_records_, x);
+    auto cur = std::make_pair(s.workchain, s.shard);
+    if (cur < key) {
+      l = x + 1;
+    } else if (key < cur) {
+      r = x;
+    } else {
+      record = s;
+      return true;
+    }
+  }
+  return false;
+}
+
+ArchiveLtIndex::FenceRecord ArchiveLtIndex::get_fence(const ShardRecord &shard, td::uint32 idx) const {
+  return load<FenceRecord>(fence_records_, td::uint64{shard.first_fence} + idx);
+}
+
+ArchiveLtIndex::BlockRecord ArchiveLtIndex::get_block(const ShardRecord &shard, td::uint32 idx) const {
+  return load<BlockRecord>(block_records_, td::uint64{shard.first_block} + idx);
+}
+
+BlockIdExt ArchiveLtIndex::block_id(const ShardRecord &shard, const BlockRecord &block) {
+  BlockIdExt id{shard.workchain, shard.shard, block.seqno, RootHash::zero(), FileHash::zero()};
+  std::memcpy(id.root_hash.data(), block.root_hash, 32);
+  std::memcpy(id.file_hash.data(), block.file_hash, 32);
+  return id;
+}
+
+td::Result<BlockIdExt> ArchiveLtIndex::lookup(AccountIdPrefixFull account_id,
+                                              const std::function<td::int32(const LtDbEntry &)> &compare,
+                                              bool exact) const {
+  bool f = false;
+  BlockIdExt block_id;
+  td::uint32 ls = 0;
+  for (td::uint32 len = 0; len <= 60; len++) {
+    ShardRecord shard;
+    if (!find_shard(shard_prefix(account_id, len), shard)) {
+      if (!f) {
+        continue;
+      } else {
+        break;
+      }
+    }
+    f = true;
+    if (shard.blocks == 0) {
+      continue;
+    }
+    auto last = get_block(shard, shard.blocks - 1);
+    if (compare(LtDbEntry{last.seqno, last.lt, last.ts}) > 0) {
+      continue;
+    }
+    // the fences bound the part of the shard where the key is; an exact match is returned right away
+    td::int64 fl = -1, fr = shard.fences;
+    while (fr - fl > 1) {
+      auto x = static_cast<td::uint32>((fl + fr) / 2);
+      auto e = get_fence(shard, x);
+      int cmp_val = compare(LtDbEntry{e.seqno, e.lt, e.ts});
+      if (cmp_val < 0) {
+        fr = x;
+      } else if (cmp_val > 0) {
+        fl = x;
+      } else {
+        return ArchiveLtIndex::block_id(shard, get_block(shard, x * fence_step()));
+      }
+    }
+    td::int64 l = fl < 0 ? -1 : fl * fence_step();
+    td::int64 r = fr < shard.fences ? fr * fence_step() : shard.blocks;
+    while (r - l > 1) {
+      auto x = static_cast<td::uint32>((l + r) / 2);
+      auto e = get_block(shard, x);
+      int cmp_val = compare(LtDbEntry{e.seqno, e.lt, e.ts});
+      if (cmp_val < 0) {
+        r = x;
+      } else if (cmp_val > 0) {
+        l = x;
+      } else {
+        return ArchiveLtIndex::block_id(shard, e);
+      }
+    }
+    if (r < shard.blocks) {
+      auto rseq = ArchiveLtIndex::block_id(shard, get_block(shard, static_cast<td::uint32>(r)));
+      if (!block_id.is_valid()) {
+        block_id = rseq;
+      } else if (block_id.id.seqno > rseq.id.seqno) {
+        block_id = rseq;
+      }
+    }
+    if (l >= 0) {
+      auto lseqno = get_block(shard, static_cast<td::uint32>(l)).seqno;
+      if (ls < lseqno) {
+        ls = lseqno;
+      }
+    }
+    if (block_id.is_valid() && ls + 1 == block_id.id.seqno) {
+      if (!exact) {
+        return block_id;
+      } else {
+        return td::Status::Error(ErrorCode::notready, "ltdb: block not found");
+      }
+    }
+  }
+  if (!exact && block_id.is_valid()) {
+    return block_id;
+  } else {
+    return td::Status::Error(ErrorCode::notready, "ltdb: block not found");
+  }
+}
+
+td::Result<td::Slice> ArchiveLtIndex::get_handle(const BlockIdExt &block_id) const {
+  ShardRecord shard;
+  if (find_shard(block_id.shard_full(), shard)) {
+    td::uint32 l = 0, r = shard.blocks;
+    while (l < r) {
+      auto x = l + (r - l) / 2;
+      auto e = get_block(shard, x);
+      if (e.seqno < block_id.seqno()) {
+        l = x + 1;
+      } else if (e.seqno > block_id.seqno()) {
+        r = x;
+      } else {
+        if (e.handle_size == 0 || ArchiveLtIndex::block_id(shard, e) != block_id) {
+          break;
+        }
+        if (e.handle_offset + e.handle_size > handles_.size()) {
+          return td::Status::Error(ErrorCode::protoviolation, "bad lt index handle offset");
+        }
+        return handles_.substr(static_cast<size_t>(e.handle_offset), e.handle_size);
+      }
+    }
+  }
+  return td::Status::Error(ErrorCode::notready, "handle not in archive slice");
+}
+
+td::BufferSlice ArchiveLtDb::desc_key(ShardIdFull shard) {
+  return create_serialize_tl_object<ton_api::db_lt_desc_key>(shard.workchain, shard.shard);
+}
+
+td::BufferSlice ArchiveLtDb::el_key(ShardIdFull shard, td::uint32 idx) {
+  return create_serialize_tl_object<ton_api::db_lt_el_key>(shard.workchain, shard.shard, idx);
+}
+
+td::BufferSlice ArchiveLtDb::block_info_key(const BlockIdExt &block_id) {
+  return create_serialize_tl_object<ton_api::db_blockdb_key_value>(create_tl_block_id(block_id));
+}
+
+bool ArchiveLtDb::add_block(td::KeyValue &kv, const BlockIdExt &block_id, LogicalTime lt, UnixTime ts) {
+  auto key = desc_key(block_id.shard_full());
+
+  std::string value;
+  auto R = kv.get(key.as_slice(), value);
+  R.ensure();
+  tl_object_ptr<ton_api::db_lt_desc_value> v;
+  bool add_shard = false;
+  if (R.move_as_ok() == td::KeyValue::GetStatus::Ok) {
+    auto F = fetch_tl_object<ton_api::db_lt_desc_value>(td::BufferSlice{value}, true);
+    F.ensure();
+    v = F.move_as_ok();
+  } else {
+    v = create_tl_object<ton_api::db_lt_desc_value>(1, 1, 0, 0, 0);
+    add_shard = true;
+  }
+  if (block_id.seqno() <= static_cast<td::uint32>(v->last_seqno_) || lt <= static_cast<LogicalTime>(v->last_lt_) ||
+      ts <= static_cast<UnixTime>(v->last_ts_)) {
+    return false;
+  }
+  auto db_value = create_serialize_tl_object<ton_api::db_lt_el_value>(create_tl_block_id(block_id), lt, ts);
+  auto db_key = el_key(block_id.shard_full(), v->last_idx_++);
+  auto status_key = create_serialize_tl_object<ton_api::db_lt_status_key>();
+  v->last_seqno_ = block_id.seqno();
+  v->last_lt_ = lt;
+  v->last_ts_ = ts;
+
+  td::uint32 idx = 0;
+  if (add_shard) {
+    auto G = kv.get(status_key.as_slice(), value);
+    G.ensure();
+    if (G.move_as_ok() == td::KeyValue::GetStatus::NotFound) {
+      idx = 0;
+    } else {
+      auto F = fetch_tl_object<ton_api::db_lt_status_value>(value, true);
+      F.ensure();
+      auto f = F.move_as_ok();
+      idx = f->total_shards_;
+    }
+  }
+
+  kv.set(key, serialize_tl_object(v, true)).ensure();
+  kv.set(db_key, db_value.as_slice()).ensure();
+  if (add_shard) {
+    auto shard_key = create_serialize_tl_object<ton_api::db_lt_shard_key>(idx);
+    auto shard_value = create_serialize_tl_object<ton_api::db_lt_shard_value>(block_id.id.workchain, block_id.id.shard);
+    kv.set(status_key.as_slice(), create_serialize_tl_object<ton_api::db_lt_status_value>(idx + 1)).ensure();
+    kv.set(shard_key.as_slice(), shard_value.as_slice()).ensure();
+  }
+  return true;
+}
+
+td::Result<BlockIdExt> ArchiveLtDb::lookup(td::KeyValueReader &kv, AccountIdPrefixFull account_id,
+                                           const std::function<td::int32(const LtDbEntry &)> &compare, bool exact) {
+  bool f = false;
+  BlockIdExt block_id;
+  td::uint32 ls = 0;
+  for (td::uint32 len = 0; len <= 60; len++) {
+    auto s = shard_prefix(account_id, len);
+    auto key = desc_key(s);
+    std::string value;
+    auto F = kv.get(key, value);
+    F.ensure();
+    if (F.move_as_ok() == td::KeyValue::GetStatus::NotFound) {
+      if (!f) {
+        continue;
+      } else {
+        break;
+      }
+    }
+    f = true;
+    auto G = fetch_tl_object<ton_api::db_lt_desc_value>(value, true);
+    G.ensure();
+    auto g = G.move_as_ok();
+    if (compare(LtDbEntry{static_cast<BlockSeqno>(g->last_seqno_), static_cast<LogicalTime>(g->last_lt_),
+                          static_cast<UnixTime>(g->last_ts_)}) > 0) {
+      continue;
+    }
+    td::uint32 l = g->first_idx_ - 1;
+    BlockIdExt lseq;
+    td::uint32 r = g->last_idx_;
+    BlockIdExt rseq;
+    while (r - l > 1) {
+      auto x = (r + l) / 2;
+      auto db_key = el_key(s, x);
+      F = kv.get(db_key, value);
+      F.ensure();
+      CHECK(F.move_as_ok() == td::KeyValue::GetStatus::Ok);
+      auto E = fetch_tl_object<ton_api::db_lt_el_value>(td::BufferSlice{value}, true);
+      E.ensure();
+      auto e = E.move_as_ok();
+      int cmp_val = compare(LtDbEntry{static_cast<BlockSeqno>(e->id_->seqno_), static_cast<LogicalTime>(e->lt_),
+                                      static_cast<UnixTime>(e->ts_)});
+
+      if (cmp_val < 0) {
+        rseq = create_block_id(e->id_);
+        r = x;
+      } else if (cmp_val > 0) {
+        lseq = create_block_id(e->id_);
+        l = x;
+      } else {
+        return create_block_id(e->id_);
+      }
+    }
+    if (rseq.is_valid()) {
+      if (!block_id.is_valid()) {
+        block_id = rseq;
+      } else if (block_id.id.seqno > rseq.id.seqno) {
+        block_id = rseq;
+      }
+    }
+    if (lseq.is_valid()) {
+      if (ls < lseq.id.seqno) {
+        ls = lseq.id.seqno;
+      }
+    }
+    if (block_id.is_valid() && ls + 1 == block_id.id.seqno) {
+      if (!exact) {
+        return block_id;
+      } else {
+        return td::Status::Error(ErrorCode::notready, "ltdb: block not found");
+      }
+    }
+  }
+  if (!exact && block_id.is_valid()) {
+    return block_id;
+  } else {
+    return td::Status::Error(ErrorCode::notready, "ltdb: block not found");
+  }
+}
+
+std::vector<ArchiveLtIndex::Shard> ArchiveLtDb::read(td::KeyValueReader &kv) {
+  std::string value;
+  auto status_key = create_serialize_tl_object<ton_api::db_lt_status_key>();
+  auto R = kv.get(status_key, value);
+  R.ensure();
+  td::int32 total_shards = 0;
+  if (R.move_as_ok() == td::KeyValue::GetStatus::Ok) {
+    auto F = fetch_tl_object<ton_api::db_lt_status_value>(value, true);
+    F.ensure();
+    total_shards = F.move_as_ok()->total_shards_;
+  }
+
+  std::vector<ArchiveLtIndex::Shard> shards;
+  for (td::int32 i = 0; i < total_shards; i++) {
+    R = kv.get(create_serialize_tl_object<ton_api::db_lt_shard_key>(i), value);
+    R.ensure();
+    CHECK(R.move_as_ok() == td::KeyValue::GetStatus::Ok);
+    auto G = fetch_tl_object<ton_api::db_lt_shard_value>(value, true);
+    G.ensure();
+    auto g = G.move_as_ok();
+    ArchiveLtIndex::Shard shard{ShardIdFull{g->workchain_, static_cast<ShardId>(g->shard_)}, {}};
+
+    R = kv.get(desc_key(shard.shard), value);
+    R.ensure();
+    if (R.move_as_ok() == td::KeyValue::GetStatus::NotFound) {
+      continue;
+    }
+    auto D = fetch_tl_object<ton_api::db_lt_desc_value>(value, true);
+    D.ensure();
+    auto d = D.move_as_ok();
+    for (td::int32 idx = d->first_idx_; idx < d->last_idx_; idx++) {
+      R = kv.get(el_key(shard.shard, idx), value);
+      R.ensure();
+      CHECK(R.move_as_ok() == td::KeyValue::GetStatus::Ok);
+      auto E = fetch_tl_object<ton_api::db_lt_el_value>(td::BufferSlice{value}, true);
+      E.ensure();
+      auto e = E.move_as_ok();
+      ArchiveLtIndex::Block block{create_block_id(e->id_), static_cast<LogicalTime>(e->lt_),
+                                  static_cast<UnixTime>(e->ts_), td::BufferSlice()};
+      R = kv.get(block_info_key(block.id), value);
+      R.ensure();
+      if (R.move_as_ok() == td::KeyValue::GetStatus::Ok) {
+        block.handle = td::BufferSlice{value};
+      }
+      shard.blocks.push_back(std::move(block));
+    }
+    shards.push_back(std::move(shard));
+  }
+  return shards;
+}
+
+}  // namespace validator
+
+}  // namespace ton
@@ -0,0 +1,136 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#pragma once
+
+#include "ton/ton-types.h"
+#include "td/db/KeyValue.h"
+#include "td/utils/buffer.h"
+#include "td/utils/port/MemoryMapping.h"
+
+#include <functional>
+#include <vector>
+
+namespace ton {
+
+namespace validator {
+
+// position of a block in the ltdb of an archive slice; within a shard seqno, lt and unix time grow together
+struct LtDbEntry {
+  BlockSeqno seqno;
+  LogicalTime lt;
+  UnixTime ts;
+};
+
+/*
+ * immutable ltdb of a finalized archive slice, read through a memory mapping
+ *
+ * for every shard keeps its blocks sorted by seqno (and so by lt and unix time) and their serialized handles;
+ * every fence_step()-th block of a shard is also copied to a compact fence array, which is searched first
+ */
+class ArchiveLtIndex {
+ public:
+  struct Block {
+    BlockIdExt id;
+    LogicalTime lt;
+    UnixTime ts;
+    td::BufferSlice handle;  // empty if the slice keeps no handle of the block
+  };
+  struct Shard {
+    ShardIdFull shard;
+    std::vector<Block> blocks;
+  };
+
+  static td::Status write(td::CSlice path, std::vector<Shard> shards);
+  static td::Result<ArchiveLtIndex> open(td::CSlice path);
+
+  // compare returns the sign of (key - entry); same results as the ltdb lookup of ArchiveSlice
+  td::Result<BlockIdExt> lookup(AccountIdPrefixFull account_id,
+                                const std::function<td::int32(const LtDbEntry &)> &compare, bool exact) const;
+  td::Result<td::Slice> get_handle(const BlockIdExt &block_id) const;
+
+  static constexpr td::uint32 fence_step() {
+    return 64;
+  }
+
+ private:
+  struct ShardRecord {
+    td::int32 workchain;
+    td::uint32 reserved;
+    td::uint64 shard;
+    td::uint32 first_block;
+    td::uint32 blocks;
+    td::uint32 first_fence;
+    td::uint32 fences;
+  };
+  struct FenceRecord {
+    td::uint32 seqno;
+    td::uint32 ts;
+    td::uint64 lt;
+  };
+  struct BlockRecord {
+    td::uint32 seqno;
+    td::uint32 ts;
+    td::uint64 lt;
+    td::uint8 root_hash[32];
+    td::uint8 file_hash[32];
+    td::uint64 handle_offset;
+    td::uint32 handle_size;
+    td::uint32 reserved;
+  };
+
+  explicit ArchiveLtIndex(td::MemoryMapping mapping) : mapping_(std::move(mapping)) {
+  }
+
+  bool find_shard(ShardIdFull shard, ShardRecord &record) const;
+  FenceRecord get_fence(const ShardRecord &shard, td::uint32 idx) const;
+  BlockRecord get_block(const ShardRecord &shard, td::uint32 idx) const;
+  static BlockIdExt block_id(const ShardRecord &shard, const BlockRecord &block);
+
+  td::MemoryMapping mapping_;
+  td::uint32 shards_{0};
+  td::uint32 fences_{0};
+  td::uint64 blocks_{0};
+  td::Slice shard_records_, fence_records_, block_records_, handles_;
+};
+
+/*
+ * ltdb of an archive slice as kept in its key-value index
+ *
+ * for every shard stores the blocks in the order they were added; a block is added only if its seqno, lt and unix time
+ * are all greater than those of the last block of the shard; handles of all blocks of the slice are stored too,
+ * including the ones that are not in the ltdb (zerostates, blocks added out of order)
+ */
+class ArchiveLtDb {
+ public:
+  static td::BufferSlice desc_key(ShardIdFull shard);
+  static td::BufferSlice el_key(ShardIdFull shard, td::uint32 idx);
+  static td::BufferSlice block_info_key(const BlockIdExt &block_id);
+
+  // returns false without changing anything if the block does not follow the last block of its shard
+  static bool add_block(td::KeyValue &kv, const BlockIdExt &block_id, LogicalTime lt, UnixTime ts);
+  // same semantics as ArchiveLtIndex::lookup()
+  static td::Result<BlockIdExt> lookup(td::KeyValueReader &kv, AccountIdPrefixFull account_id,
+                                       const std::function<td::int32(const LtDbEntry &)> &compare, bool exact);
+  // all blocks of the ltdb with their handles, for ArchiveLtIndex::write()
+  static std::vector<ArchiveLtIndex::Shard> read(td::KeyValueReader &kv);
+};
+
+}  // namespace validator
+
+}  // namespace ton
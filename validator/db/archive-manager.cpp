@@ -55,7 +55,9 @@ std::string PackageId::name() const {
   }
 }
 
-ArchiveManager::ArchiveManager(td::actor::ActorId<RootDb> root, std::string db_root) : db_root_(db_root) {
+ArchiveManager::ArchiveManager(td::actor::ActorId<RootDb> root, std::string db_root, td::uint32 max_open_slices,
+                               td::uint64 index_memory)
+    : db_root_(db_root), max_open_slices_(max_open_slices), index_memory_(index_memory) {
 }
 
 void ArchiveManager::add_handle(BlockHandle handle, td::Promise<td::Unit> promise) {
@@ -336,6 +338,28 @@ void ArchiveManager::add_zero_state(BlockIdExt block_id, td::BufferSlice data, t
 
 void ArchiveManager::add_persistent_state(BlockIdExt block_id, BlockIdExt masterchain_block_id, td::BufferSlice data,
                                           td::Promise<td::Unit> promise) {
+  auto create_writer = [&](std::string path, td::Promise<std::string> P) {
+    td::actor::create_actor<db::WriteFile>("writefile", db_root_ + "/archive/tmp/", std::move(path), std::move(data),
+                                           std::move(P))
+        .release();
+  };
+  add_persistent_state_impl(block_id, masterchain_block_id, std::move(promise), std::move(create_writer));
+}
+
+void ArchiveManager::add_persistent_state_gen(BlockIdExt block_id, BlockIdExt masterchain_block_id,
+                                              std::function<td::Status(td::FileFd&)> write_state,
+                                              td::Promise<td::Unit> promise) {
+  auto create_writer = [&](std::string path, td::Promise<std::string> P) {
+    td::actor::create_actor<db::WriteFile>("writefile", db_root_ + "/archive/tmp/", std::move(path),
+                                           std::move(write_state), std::move(P))
+        .release();
+  };
+  add_persistent_state_impl(block_id, masterchain_block_id, std::move(promise), std::move(create_writer));
+}
+
+void ArchiveManager::add_persistent_state_impl(
+    BlockIdExt block_id, BlockIdExt masterchain_block_id, td::Promise<td::Unit> promise,
+    std::function<void(std::string, td::Promise<std::string>)> create_writer) {
   auto id = FileReference{fileref::PersistentState{block_id, masterchain_block_id}};
   auto hash = id.hash();
   if (perm_states_.find(hash) != perm_states_.end()) {
@@ -353,8 +377,7 @@ void ArchiveManager::add_persistent_state(BlockIdExt block_id, BlockIdExt master
           promise.set_value(td::Unit());
         }
       });
-  td::actor::create_actor<db::WriteFile>("writefile", db_root_ + "/archive/tmp/", path, std::move(data), std::move(P))
-      .release();
+  create_writer(std::move(path), std::move(P));
 }
 
 void ArchiveManager::get_zero_state(BlockIdExt block_id, td::Promise<td::BufferSlice> promise) {
@@ -388,8 +411,7 @@ void ArchiveManager::get_persistent_state(BlockIdExt block_id, BlockIdExt master
     return;
   }
 
-  auto path = db_root_ + "/archive/states/" + id.filename_short();
-  td::actor::create_actor<db::ReadFile>("readfile", path, 0, -1, 0, std::move(promise)).release();
+  read_persistent_state(id, 0, -1, std::move(promise));
 }
 
 void ArchiveManager::get_persistent_state_slice(BlockIdExt block_id, BlockIdExt masterchain_block_id, td::int64 offset,
@@ -401,8 +423,50 @@ void ArchiveManager::get_persistent_state_slice(BlockIdExt block_id, BlockIdExt
     return;
   }
 
+  read_persistent_state(id, offset, max_size, std::move(promise));
+}
+
+void ArchiveManager::read_persistent_state(const FileReference &id, td::int64 offset, td::int64 max_size,
+                                           td::Promise<td::BufferSlice> promise) {
   auto path = db_root_ + "/archive/states/" + id.filename_short();
-  td::actor::create_actor<db::ReadFile>("readfile", path, offset, max_size, 0, std::move(promise)).release();
+  auto mapping = get_state_mapping(id.hash(), path);
+  if (!mapping) {
+    td::actor::create_actor<db::ReadFile>("readfile", path, offset, max_size, 0, std::move(promise)).release();
+    return;
+  }
+  td::actor::create_actor<db::ReadMappedFile>("readmapped", std::move(mapping), offset, max_size, std::move(promise))
+      .release();
+}
+
+std::shared_ptr<const td::MemoryMapping> ArchiveManager::get_state_mapping(const FileHash &hash,
+                                                                           const std::string &path) {
+  auto it = state_mappings_.find(hash);
+  if (it != state_mappings_.end()) {
+    it->second.last_used = td::Timestamp::now();
+    return it->second.mapping;
+  }
+  auto fd = td::FileFd::open(path, td::FileFd::Flags::Read);
+  if (fd.is_error()) {
+    return nullptr;
+  }
+  auto mapping = td::MemoryMapping::create_from_file(fd.ok());
+  if (mapping.is_error()) {
+    LOG(INFO) << "failed to map state file " << path << ": " << mapping.error();
+    return nullptr;
+  }
+  if (state_mappings_.size() >= max_state_mappings()) {
+    auto oldest = state_mappings_.begin();
+    for (auto it2 = state_mappings_.begin(); it2 != state_mappings_.end(); it2++) {
+      if (it2->second.last_used.at() < oldest->second.last_used.at()) {
+        oldest = it2;
+      }
+    }
+    state_mappings_.erase(oldest);
+  }
+  auto &entry = state_mappings_[hash];
+  entry.mapping = std::make_shared<const td::MemoryMapping>(mapping.move_as_ok());
+  entry.last_used = td::Timestamp::now();
+  return entry.mapping;
 }
 
 void ArchiveManager::check_persistent_state(BlockIdExt block_id, BlockIdExt masterchain_block_id,
@@ -566,7 +630,8 @@ void ArchiveManager::load_package(PackageId id) {
     }
   }
 
-  desc.file = td::actor::create_actor<ArchiveSlice>("slice", id.id, id.key, id.temp, false, db_root_);
+  desc.file = td::actor::create_actor<ArchiveSlice>("slice", id.id, id.key, id.temp, false, db_root_,
+                                                     archive_lru_.get(), slice_db_options_);
 
   get_file_map(id).emplace(id, std::move(desc));
 }
@@ -599,7 +664,8 @@ ArchiveManager::FileDescription *ArchiveManager::add_file_desc(ShardIdFull shard
   FileDescription desc{id, false};
   td::mkdir(db_root_ + id.path()).ensure();
   std::string prefix = PSTRING() << db_root_ << id.path() << id.name();
-  desc.file = td::actor::create_actor<ArchiveSlice>("slice", id.id, id.key, id.temp, false, db_root_);
+  desc.file = td::actor::create_actor<ArchiveSlice>("slice", id.id, id.key, id.temp, false, db_root_,
+                                                     archive_lru_.get(), slice_db_options_);
   if (!id.temp) {
     update_desc(desc, shard, seqno, ts, lt);
   }
@@ -642,7 +708,11 @@ ArchiveManager::FileDescription *ArchiveManager::add_file_desc(ShardIdFull shard
   }
   index_->commit_transaction().ensure();
 
-  return &f.emplace(id, std::move(desc)).first->second;
+  auto res = &f.emplace(id, std::move(desc)).first->second;
+  if (!id.temp && !id.key) {
+    finalize_old_slices();
+  }
+  return res;
 }
 
 void ArchiveManager::update_desc(FileDescription &desc, ShardIdFull shard, BlockSeqno seqno, UnixTime ts,
@@ -837,6 +907,12 @@ void ArchiveManager::start_up() {
   td::mkdir(db_root_ + "/archive/states/").ensure();
   td::mkdir(db_root_ + "/files/").ensure();
   td::mkdir(db_root_ + "/files/packages/").ensure();
+  if (max_open_slices_ > 0) {
+    archive_lru_ = td::actor::create_actor<ArchiveLru>("archivelru", max_open_slices_);
+  }
+  if (index_memory_ > 0) {
+    slice_db_options_.write_buffer_manager = td::RocksDb::create_write_buffer_manager(index_memory_);
+  }
   index_ = std::make_shared<td::RocksDb>(td::RocksDb::open(db_root_ + "/files/globalindex").move_as_ok());
   std::string value;
   auto v = index_->get(create_serialize_tl_object<ton_api::db_files_index_key>().as_slice(), value);
@@ -893,6 +969,22 @@ void ArchiveManager::start_up() {
   }).ensure();
 
   persistent_state_gc(FileHash::zero());
+  finalize_old_slices();
+}
+
+void ArchiveManager::finalize_old_slices() {
+  // blocks of shards may still be added to the previous slice, older ones are not modified anymore
+  size_t skip = 2;
+  for (auto it = files_.rbegin(); it != files_.rend(); it++) {
+    if (it->second.deleted) {
+      continue;
+    }
+    if (skip > 0) {
+      skip--;
+      continue;
+    }
+    td::actor::send_closure(it->second.file_actor_id(), &ArchiveSlice::finalize);
+  }
 }
 
 void ArchiveManager::run_gc(UnixTime ts, UnixTime archive_ttl) {
@@ -970,6 +1062,7 @@ void ArchiveManager::persistent_state_gc(FileHash last) {
 
   if (res == -1) {
     td::unlink(db_root_ + "/archive/states/" + F.filename_short()).ignore();
+    state_mappings_.erase(it->first);
     perm_states_.erase(it);
   }
   if (res != 0) {
@@ -1003,6 +1096,7 @@ void ArchiveManager::got_gc_masterchain_handle(ConstBlockHandle handle, FileHash
   auto &F = it->second;
   if (to_del) {
     td::unlink(db_root_ + "/archive/states/" + F.filename_short()).ignore();
+    state_mappings_.erase(it->first);
     perm_states_.erase(it);
   }
   delay_action([hash, SelfId = actor_id(
@@ -1205,6 +1299,7 @@ void ArchiveManager::truncate(BlockSeqno masterchain_seqno, ConstBlockHandle han
         auto it2 = it;
         it++;
         td::unlink(db_root_ + "/archive/states/" + it2->second.filename_short()).ignore();
+        state_mappings_.erase(it2->first);
         perm_states_.erase(it2);
       }
     }
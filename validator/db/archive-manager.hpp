@@ -19,6 +19,7 @@
 #pragma once
 
 #include "archive-slice.hpp"
+#include "td/utils/port/MemoryMapping.h"
 
 namespace ton {
 
@@ -28,7 +29,8 @@ class RootDb;
 
 class ArchiveManager : public td::actor::Actor {
  public:
-  ArchiveManager(td::actor::ActorId<RootDb> root, std::string db_root);
+  ArchiveManager(td::actor::ActorId<RootDb> root, std::string db_root, td::uint32 max_open_slices = 0,
+                 td::uint64 index_memory = 0);
 
   void add_handle(BlockHandle handle, td::Promise<td::Unit> promise);
   void update_handle(BlockHandle handle, td::Promise<td::Unit> promise);
@@ -45,6 +47,8 @@ class ArchiveManager : public td::actor::Actor {
   void add_zero_state(BlockIdExt block_id, td::BufferSlice data, td::Promise<td::Unit> promise);
   void add_persistent_state(BlockIdExt block_id, BlockIdExt masterchain_block_id, td::BufferSlice data,
                             td::Promise<td::Unit> promise);
+  void add_persistent_state_gen(BlockIdExt block_id, BlockIdExt masterchain_block_id,
+                                std::function<td::Status(td::FileFd&)> write_state, td::Promise<td::Unit> promise);
   void get_zero_state(BlockIdExt block_id, td::Promise<td::BufferSlice> promise);
   void get_persistent_state(BlockIdExt block_id, BlockIdExt masterchain_block_id, td::Promise<td::BufferSlice> promise);
   void get_persistent_state_slice(BlockIdExt block_id, BlockIdExt masterchain_block_id, td::int64 offset,
@@ -114,8 +118,19 @@ class ArchiveManager : public td::actor::Actor {
   }
 
   std::map<FileHash, FileReferenceShort> perm_states_;
+  // persistent state files are immutable once written, so they are served from memory mappings
+  // that stay open between slice requests
+  struct StateMapping {
+    std::shared_ptr<const td::MemoryMapping> mapping;
+    td::Timestamp last_used;
+  };
+  std::map<FileHash, StateMapping> state_mappings_;
+  static constexpr std::size_t max_state_mappings() {
+    return 8;
+  }
 
   void load_package(PackageId seqno);
+  void finalize_old_slices();
   void delete_package(PackageId seqno, td::Promise<td::Unit> promise);
   void deleted_package(PackageId seqno, td::Promise<td::Unit> promise);
   void get_handle_cont(BlockIdExt block_id, PackageId id, td::Promise<BlockHandle> promise);
@@ -139,10 +154,19 @@ class ArchiveManager : public td::actor::Actor {
 
   void written_perm_state(FileReferenceShort id);
 
+  void add_persistent_state_impl(BlockIdExt block_id, BlockIdExt masterchain_block_id, td::Promise<td::Unit> promise,
+                                 std::function<void(std::string, td::Promise<std::string>)> create_writer);
+  void read_persistent_state(const FileReference &id, td::int64 offset, td::int64 max_size,
+                             td::Promise<td::BufferSlice> promise);
+  std::shared_ptr<const td::MemoryMapping> get_state_mapping(const FileHash &hash, const std::string &path);
   void persistent_state_gc(FileHash last);
   void got_gc_masterchain_handle(ConstBlockHandle handle, FileHash hash);
 
   std::string db_root_;
+  td::uint32 max_open_slices_;
+  td::uint64 index_memory_;
+  td::actor::ActorOwn<ArchiveLru> archive_lru_;
+  td::RocksDbOptions slice_db_options_;
 
   std::shared_ptr<td::KeyValue> index_;
 
@@ -24,7 +24,7 @@
 #include "ton/ton-io.hpp"
 #include "td/utils/port/path.h"
 #include "common/delay.h"
-#include "files-async.hpp"
+#include "td/utils/port/Stat.h"
 
 namespace ton {
 
@@ -55,11 +55,78 @@ class PackageReader : public td::actor::Actor {
   td::Promise<std::pair<std::string, td::BufferSlice>> promise_;
 };
 
+class PackageRawReader : public td::actor::Actor {
+ public:
+  PackageRawReader(std::shared_ptr<Package> package, td::uint64 offset, td::uint64 limit,
+                   td::Promise<td::BufferSlice> promise)
+      : package_(std::move(package)), offset_(offset), limit_(limit), promise_(std::move(promise)) {
+  }
+  void start_up() {
+    promise_.set_result(package_->read_raw(offset_, limit_));
+    stop();
+  }
+
+ private:
+  std::shared_ptr<Package> package_;
+  td::uint64 offset_;
+  td::uint64 limit_;
+  td::Promise<td::BufferSlice> promise_;
+};
+
+void ArchiveLru::on_query(td::actor::ActorId<ArchiveSlice> slice, PackageId id) {
+  auto key = get_key(id);
+  auto &entry = open_slices_[key];
+  if (entry) {
+    if (entry->closing) {
+      entry->closing = false;
+      closing_slices_--;
+    } else {
+      entry->remove();
+    }
+  } else {
+    entry = std::make_unique<Entry>();
+    entry->key = key;
+    entry->slice = std::move(slice);
+  }
+  lru_.put(entry.get());
+  // the slices being closed stay tracked until they report the result
+  while (open_slices_.size() - closing_slices_ > max_open_slices_) {
+    auto oldest = Entry::from_list_node(lru_.get());
+    CHECK(oldest);
+    oldest->closing = true;
+    closing_slices_++;
+    td::actor::send_closure(oldest->slice, &ArchiveSlice::close_files);
+  }
+}
+
+void ArchiveLru::on_close(PackageId id) {
+  auto it = open_slices_.find(get_key(id));
+  if (it == open_slices_.end()) {
+    return;
+  }
+  if (it->second->closing) {
+    closing_slices_--;
+  }
+  open_slices_.erase(it);
+}
+
+void ArchiveLru::on_close_refused(PackageId id) {
+  auto it = open_slices_.find(get_key(id));
+  if (it == open_slices_.end() || !it->second->closing) {
+    return;
+  }
+  // the slice has unfinished writes; it goes back as the most recently used one and is asked again later
+  it->second->closing = false;
+  closing_slices_--;
+  lru_.put(it->second.get());
+}
+
 void ArchiveSlice::add_handle(BlockHandle handle, td::Promise<td::Unit> promise) {
   if (destroyed_) {
     promise.set_error(td::Status::Error(ErrorCode::notready, "package already gc'd"));
     return;
   }
+  before_query();
   if (handle->id().seqno() == 0) {
     update_handle(std::move(handle), std::move(promise));
     return;
@@ -69,63 +136,19 @@ void ArchiveSlice::add_handle(BlockHandle handle, td::Promise<td::Unit> promise)
   CHECK(handle->inited_unix_time());
   CHECK(handle->inited_logical_time());
 
-  auto key = get_db_key_lt_desc(handle->id().shard_full());
+  auto version = handle->version();
 
-  std::string value;
-  auto R = kv_->get(key.as_slice(), value);
-  R.ensure();
-  tl_object_ptr<ton_api::db_lt_desc_value> v;
-  bool add_shard = false;
-  if (R.move_as_ok() == td::KeyValue::GetStatus::Ok) {
-    auto F = fetch_tl_object<ton_api::db_lt_desc_value>(td::BufferSlice{value}, true);
-    F.ensure();
-    v = F.move_as_ok();
-  } else {
-    v = create_tl_object<ton_api::db_lt_desc_value>(1, 1, 0, 0, 0);
-    add_shard = true;
+  begin_transaction();
+  bool added = ArchiveLtDb::add_block(*kv_, handle->id(), handle->logical_time(), handle->unix_time());
+  if (added) {
+    drop_lt_index();
+    kv_->set(get_db_key_block_info(handle->id()), handle->serialize().as_slice()).ensure();
   }
-  if (handle->id().seqno() <= static_cast<td::uint32>(v->last_seqno_) ||
-      handle->logical_time() <= static_cast<LogicalTime>(v->last_lt_) ||
-      handle->unix_time() <= static_cast<UnixTime>(v->last_ts_)) {
+  commit_transaction();
+  if (!added) {
     update_handle(std::move(handle), std::move(promise));
     return;
   }
-  auto db_value = create_serialize_tl_object<ton_api::db_lt_el_value>(create_tl_block_id(handle->id()),
-                                                                      handle->logical_time(), handle->unix_time());
-  auto db_key = get_db_key_lt_el(handle->id().shard_full(), v->last_idx_++);
-  auto status_key = create_serialize_tl_object<ton_api::db_lt_status_key>();
-  v->last_seqno_ = handle->id().seqno();
-  v->last_lt_ = handle->logical_time();
-  v->last_ts_ = handle->unix_time();
-
-  td::uint32 idx = 0;
-  if (add_shard) {
-    auto G = kv_->get(status_key.as_slice(), value);
-    G.ensure();
-    if (G.move_as_ok() == td::KeyValue::GetStatus::NotFound) {
-      idx = 0;
-    } else {
-      auto F = fetch_tl_object<ton_api::db_lt_status_value>(value, true);
-      F.ensure();
-      auto f = F.move_as_ok();
-      idx = f->total_shards_;
-    }
-  }
-
-  auto version = handle->version();
-
-  begin_transaction();
-  kv_->set(key, serialize_tl_object(v, true)).ensure();
-  kv_->set(db_key, db_value.as_slice()).ensure();
-  if (add_shard) {
-    auto shard_key = create_serialize_tl_object<ton_api::db_lt_shard_key>(idx);
-    auto shard_value =
-        create_serialize_tl_object<ton_api::db_lt_shard_value>(handle->id().id.workchain, handle->id().id.shard);
-    kv_->set(status_key.as_slice(), create_serialize_tl_object<ton_api::db_lt_status_value>(idx + 1)).ensure();
-    kv_->set(shard_key.as_slice(), shard_value.as_slice()).ensure();
-  }
-  kv_->set(get_db_key_block_info(handle->id()), handle->serialize().as_slice()).ensure();
-  commit_transaction();
 
   handle->flushed_upto(version);
   handle->set_handle_moved_to_archive();
@@ -142,11 +165,13 @@ void ArchiveSlice::update_handle(BlockHandle handle, td::Promise<td::Unit> promi
     promise.set_error(td::Status::Error(ErrorCode::notready, "package already gc'd"));
     return;
   }
+  before_query();
   if (!handle->need_flush() && (temp_ || handle->handle_moved_to_archive())) {
     promise.set_value(td::Unit());
     return;
   }
   CHECK(!key_blocks_only_);
+  drop_lt_index();
 
   begin_transaction();
   do {
@@ -168,6 +193,8 @@ void ArchiveSlice::add_file(BlockHandle handle, FileReference ref_id, td::Buffer
     promise.set_error(td::Status::Error(ErrorCode::notready, "package already gc'd"));
     return;
   }
+  before_query();
+  drop_lt_index();
   TRY_RESULT_PROMISE(
       promise, p,
       choose_package(
@@ -181,24 +208,27 @@ void ArchiveSlice::add_file(BlockHandle handle, FileReference ref_id, td::Buffer
   }
   auto P = td::PromiseCreator::lambda([SelfId = actor_id(this), idx = p->idx, ref_id, promise = std::move(promise)](
                                           td::Result<std::pair<td::uint64, td::uint64>> R) mutable {
-    if (R.is_error()) {
-      promise.set_error(R.move_as_error());
-      return;
-    }
-    auto v = R.move_as_ok();
-    td::actor::send_closure(SelfId, &ArchiveSlice::add_file_cont, idx, std::move(ref_id), v.first, v.second,
+    td::actor::send_closure(SelfId, &ArchiveSlice::add_file_cont, idx, std::move(ref_id), std::move(R),
                             std::move(promise));
   });
 
+  // the files must stay open until the index refers to the appended data, see close_files()
+  pending_writes_++;
   td::actor::send_closure(p->writer, &PackageWriter::append, ref_id.filename(), std::move(data), std::move(P));
 }
 
-void ArchiveSlice::add_file_cont(size_t idx, FileReference ref_id, td::uint64 offset, td::uint64 size,
+void ArchiveSlice::add_file_cont(size_t idx, FileReference ref_id, td::Result<std::pair<td::uint64, td::uint64>> R,
                                  td::Promise<td::Unit> promise) {
+  CHECK(pending_writes_ > 0);
+  pending_writes_--;
   if (destroyed_) {
     promise.set_error(td::Status::Error(ErrorCode::notready, "package already gc'd"));
     return;
   }
+  TRY_RESULT_PROMISE(promise, v, std::move(R));
+  auto offset = v.first;
+  auto size = v.second;
+  before_query();
   begin_transaction();
   if (sliced_mode_) {
     kv_->set(PSTRING() << "status." << idx, td::to_string(size)).ensure();
@@ -212,6 +242,21 @@ void ArchiveSlice::add_file_cont(size_t idx, FileReference ref_id, td::uint64 of
   promise.set_value(td::Unit());
 }
 
+bool ArchiveSlice::get_handle_value(const BlockIdExt &block_id, std::string &value) {
+  if (auto index = get_lt_index()) {
+    auto R = index->get_handle(block_id);
+    if (R.is_ok()) {
+      value = R.ok().str();
+      return true;
+    }
+    // handles of blocks outside of the ltdb (zerostates, blocks added out of order) are only in the key-value index
+  }
+  before_query();
+  auto R = kv_->get(get_db_key_block_info(block_id), value);
+  R.ensure();
+  return R.move_as_ok() == td::KeyValue::GetStatus::Ok;
+}
+
 void ArchiveSlice::get_handle(BlockIdExt block_id, td::Promise<BlockHandle> promise) {
   if (destroyed_) {
     promise.set_error(td::Status::Error(ErrorCode::notready, "package already gc'd"));
@@ -219,9 +264,7 @@ void ArchiveSlice::get_handle(BlockIdExt block_id, td::Promise<BlockHandle> prom
   }
   CHECK(!key_blocks_only_);
   std::string value;
-  auto R = kv_->get(get_db_key_block_info(block_id), value);
-  R.ensure();
-  if (R.move_as_ok() == td::KeyValue::GetStatus::NotFound) {
+  if (!get_handle_value(block_id, value)) {
     promise.set_error(td::Status::Error(ErrorCode::notready, "handle not in archive slice"));
     return;
   }
@@ -241,9 +284,7 @@ void ArchiveSlice::get_temp_handle(BlockIdExt block_id, td::Promise<ConstBlockHa
   }
   CHECK(!key_blocks_only_);
   std::string value;
-  auto R = kv_->get(get_db_key_block_info(block_id), value);
-  R.ensure();
-  if (R.move_as_ok() == td::KeyValue::GetStatus::NotFound) {
+  if (!get_handle_value(block_id, value)) {
     promise.set_error(td::Status::Error(ErrorCode::notready, "handle not in archive slice"));
     return;
   }
@@ -261,6 +302,7 @@ void ArchiveSlice::get_file(ConstBlockHandle handle, FileReference ref_id, td::P
     promise.set_error(td::Status::Error(ErrorCode::notready, "package already gc'd"));
     return;
   }
+  before_query();
   std::string value;
   auto R = kv_->get(ref_id.hash().to_hex(), value);
   R.ensure();
@@ -285,157 +327,160 @@ void ArchiveSlice::get_file(ConstBlockHandle handle, FileReference ref_id, td::P
 }
 
 void ArchiveSlice::get_block_common(AccountIdPrefixFull account_id,
-                                    std::function<td::int32(ton_api::db_lt_desc_value &)> compare_desc,
-                                    std::function<td::int32(ton_api::db_lt_el_value &)> compare, bool exact,
+                                    std::function<td::int32(const LtDbEntry &)> compare, bool exact,
                                     td::Promise<ConstBlockHandle> promise) {
   if (destroyed_) {
     promise.set_error(td::Status::Error(ErrorCode::notready, "package already gc'd"));
     return;
   }
-  bool f = false;
-  BlockIdExt block_id;
-  td::uint32 ls = 0;
-  for (td::uint32 len = 0; len <= 60; len++) {
-    auto s = shard_prefix(account_id, len);
-    auto key = get_db_key_lt_desc(s);
-    std::string value;
-    auto F = kv_->get(key, value);
-    F.ensure();
-    if (F.move_as_ok() == td::KeyValue::GetStatus::NotFound) {
-      if (!f) {
-        continue;
-      } else {
-        break;
-      }
-    }
-    f = true;
-    auto G = fetch_tl_object<ton_api::db_lt_desc_value>(value, true);
-    G.ensure();
-    auto g = G.move_as_ok();
-    if (compare_desc(*g.get()) > 0) {
-      continue;
-    }
-    td::uint32 l = g->first_idx_ - 1;
-    BlockIdExt lseq;
-    td::uint32 r = g->last_idx_;
-    BlockIdExt rseq;
-    while (r - l > 1) {
-      auto x = (r + l) / 2;
-      auto db_key = get_db_key_lt_el(s, x);
-      F = kv_->get(db_key, value);
-      F.ensure();
-      CHECK(F.move_as_ok() == td::KeyValue::GetStatus::Ok);
-      auto E = fetch_tl_object<ton_api::db_lt_el_value>(td::BufferSlice{value}, true);
-      E.ensure();
-      auto e = E.move_as_ok();
-      int cmp_val = compare(*e.get());
-
-      if (cmp_val < 0) {
-        rseq = create_block_id(e->id_);
-        r = x;
-      } else if (cmp_val > 0) {
-        lseq = create_block_id(e->id_);
-        l = x;
-      } else {
-        get_temp_handle(create_block_id(e->id_), std::move(promise));
-        return;
-      }
-    }
-    if (rseq.is_valid()) {
-      if (!block_id.is_valid()) {
-        block_id = rseq;
-      } else if (block_id.id.seqno > rseq.id.seqno) {
-        block_id = rseq;
-      }
-    }
-    if (lseq.is_valid()) {
-      if (ls < lseq.id.seqno) {
-        ls = lseq.id.seqno;
-      }
-    }
-    if (block_id.is_valid() && ls + 1 == block_id.id.seqno) {
-      if (!exact) {
-        get_temp_handle(block_id, std::move(promise));
-      } else {
-        promise.set_error(td::Status::Error(ErrorCode::notready, "ltdb: block not found"));
-      }
-      return;
-    }
-  }
-  if (!exact && block_id.is_valid()) {
+  if (auto index = get_lt_index()) {
+    TRY_RESULT_PROMISE(promise, block_id, index->lookup(account_id, compare, exact));
     get_temp_handle(block_id, std::move(promise));
-  } else {
-    promise.set_error(td::Status::Error(ErrorCode::notready, "ltdb: block not found"));
+    return;
   }
+  before_query();
+  TRY_RESULT_PROMISE(promise, block_id, ArchiveLtDb::lookup(*kv_, account_id, compare, exact));
+  get_temp_handle(block_id, std::move(promise));
 }
 
 void ArchiveSlice::get_block_by_lt(AccountIdPrefixFull account_id, LogicalTime lt,
                                    td::Promise<ConstBlockHandle> promise) {
   return get_block_common(
-      account_id,
-      [lt](ton_api::db_lt_desc_value &w) {
-        return lt > static_cast<LogicalTime>(w.last_lt_) ? 1 : lt == static_cast<LogicalTime>(w.last_lt_) ? 0 : -1;
-      },
-      [lt](ton_api::db_lt_el_value &w) {
-        return lt > static_cast<LogicalTime>(w.lt_) ? 1 : lt == static_cast<LogicalTime>(w.lt_) ? 0 : -1;
-      },
-      false, std::move(promise));
+      account_id, [lt](const LtDbEntry &w) { return lt > w.lt ? 1 : lt == w.lt ? 0 : -1; }, false,
+      std::move(promise));
 }
 
 void ArchiveSlice::get_block_by_seqno(AccountIdPrefixFull account_id, BlockSeqno seqno,
                                       td::Promise<ConstBlockHandle> promise) {
   return get_block_common(
-      account_id,
-      [seqno](ton_api::db_lt_desc_value &w) {
-        return seqno > static_cast<BlockSeqno>(w.last_seqno_)
-                   ? 1
-                   : seqno == static_cast<BlockSeqno>(w.last_seqno_) ? 0 : -1;
-      },
-      [seqno](ton_api::db_lt_el_value &w) {
-        return seqno > static_cast<BlockSeqno>(w.id_->seqno_)
-                   ? 1
-                   : seqno == static_cast<BlockSeqno>(w.id_->seqno_) ? 0 : -1;
-      },
-      true, std::move(promise));
+      account_id, [seqno](const LtDbEntry &w) { return seqno > w.seqno ? 1 : seqno == w.seqno ? 0 : -1; }, true,
+      std::move(promise));
 }
 
 void ArchiveSlice::get_block_by_unix_time(AccountIdPrefixFull account_id, UnixTime ts,
                                           td::Promise<ConstBlockHandle> promise) {
   return get_block_common(
-      account_id,
-      [ts](ton_api::db_lt_desc_value &w) {
-        return ts > static_cast<UnixTime>(w.last_ts_) ? 1 : ts == static_cast<UnixTime>(w.last_ts_) ? 0 : -1;
-      },
-      [ts](ton_api::db_lt_el_value &w) {
-        return ts > static_cast<UnixTime>(w.ts_) ? 1 : ts == static_cast<UnixTime>(w.ts_) ? 0 : -1;
-      },
-      false, std::move(promise));
+      account_id, [ts](const LtDbEntry &w) { return ts > w.ts ? 1 : ts == w.ts ? 0 : -1; }, false,
+      std::move(promise));
 }
 
 td::BufferSlice ArchiveSlice::get_db_key_lt_desc(ShardIdFull shard) {
-  return create_serialize_tl_object<ton_api::db_lt_desc_key>(shard.workchain, shard.shard);
+  return ArchiveLtDb::desc_key(shard);
 }
 
 td::BufferSlice ArchiveSlice::get_db_key_lt_el(ShardIdFull shard, td::uint32 idx) {
-  return create_serialize_tl_object<ton_api::db_lt_el_key>(shard.workchain, shard.shard, idx);
+  return ArchiveLtDb::el_key(shard, idx);
 }
 
 td::BufferSlice ArchiveSlice::get_db_key_block_info(BlockIdExt block_id) {
-  return create_serialize_tl_object<ton_api::db_blockdb_key_value>(create_tl_block_id(block_id));
+  return ArchiveLtDb::block_info_key(block_id);
 }
 
 void ArchiveSlice::get_slice(td::uint64 archive_id, td::uint64 offset, td::uint32 limit,
                              td::Promise<td::BufferSlice> promise) {
+  if (destroyed_) {
+    promise.set_error(td::Status::Error(ErrorCode::notready, "package already gc'd"));
+    return;
+  }
+  before_query();
   if (static_cast<td::uint32>(archive_id) != archive_id_) {
     promise.set_error(td::Status::Error(ErrorCode::error, "bad archive id"));
     return;
   }
   auto value = static_cast<td::uint32>(archive_id >> 32);
   TRY_RESULT_PROMISE(promise, p, choose_package(value, false));
-  td::actor::create_actor<db::ReadFile>("readfile", p->path, offset, limit, 0, std::move(promise)).release();
+
+  auto it = readahead_.begin();
+  while (it != readahead_.end() && !(it->package_idx == p->idx && it->next_offset == offset)) {
+    it++;
+  }
+  if (it == readahead_.end()) {
+    it = readahead_.begin();
+    while (it != readahead_.end() &&
+           !(it->package_idx == p->idx && offset >= it->offset && offset + limit <= it->offset + it->data.size())) {
+      it++;
+    }
+  }
+  if (it != readahead_.end()) {
+    // move the stream to the end of the list
+    auto stream = std::move(*it);
+    readahead_.erase(it);
+    readahead_.push_back(std::move(stream));
+  } else if (offset == 0) {
+    // a new download
+    if (readahead_.size() >= max_readahead_streams()) {
+      readahead_.erase(readahead_.begin());
+    }
+    readahead_.push_back(SliceReadahead{next_readahead_id_++, p->idx, 0, 0, td::BufferSlice(), td::Timestamp::never()});
+  } else {
+    td::actor::create_actor<PackageRawReader>("rawreader", p->package, offset, limit, std::move(promise)).release();
+    return;
+  }
+
+  auto &stream = readahead_.back();
+  stream.next_offset = offset + limit;
+  stream.timeout = td::Timestamp::in(readahead_timeout());
+  alarm_timestamp().relax(stream.timeout);
+  if (offset >= stream.offset && offset + limit <= stream.offset + stream.data.size()) {
+    auto data = stream.data.as_slice().substr(static_cast<size_t>(offset - stream.offset), limit);
+    promise.set_value(stream.data.from_slice(data));
+    return;
+  }
+  auto P = td::PromiseCreator::lambda([SelfId = actor_id(this), id = stream.id, offset, limit,
+                                       promise = std::move(promise)](td::Result<td::BufferSlice> R) mutable {
+    td::actor::send_closure(SelfId, &ArchiveSlice::got_slice_readahead, id, offset, limit, std::move(R),
+                            std::move(promise));
+  });
+  td::actor::create_actor<PackageRawReader>("rawreader", p->package, offset,
+                                            std::max<td::uint64>(limit, slice_readahead_size()), std::move(P))
+      .release();
+}
+
+void ArchiveSlice::got_slice_readahead(td::uint64 stream_id, td::uint64 offset, td::uint32 limit,
+                                       td::Result<td::BufferSlice> R, td::Promise<td::BufferSlice> promise) {
+  TRY_RESULT_PROMISE(promise, data, std::move(R));
+  auto result = data.clone();
+  result.truncate(limit);
+  promise.set_value(std::move(result));
+  if (destroyed_) {
+    return;
+  }
+  for (auto &stream : readahead_) {
+    if (stream.id == stream_id) {
+      stream.offset = offset;
+      stream.data = std::move(data);
+      break;
+    }
+  }
+}
+
+void ArchiveSlice::alarm() {
+  for (auto it = readahead_.begin(); it != readahead_.end();) {
+    if (it->timeout.is_in_past()) {
+      it = readahead_.erase(it);
+    } else {
+      alarm_timestamp().relax(it->timeout);
+      it++;
+    }
+  }
+  if (kv_ && idle_timeout_) {
+    if (idle_timeout_.is_in_past()) {
+      idle_timeout_ = td::Timestamp::never();
+      if (try_close_files() && !archive_lru_.empty()) {
+        td::actor::send_closure(archive_lru_, &ArchiveLru::on_close, PackageId{archive_id_, key_blocks_only_, temp_});
+      }
+    } else {
+      alarm_timestamp().relax(idle_timeout_);
+    }
+  }
 }
 
 void ArchiveSlice::get_archive_id(BlockSeqno masterchain_seqno, td::Promise<td::uint64> promise) {
+  if (destroyed_) {
+    promise.set_error(td::Status::Error(ErrorCode::notready, "package already gc'd"));
+    return;
+  }
+  before_query();
   if (!sliced_mode_) {
     promise.set_result(archive_id_);
   } else {
@@ -444,10 +489,113 @@ void ArchiveSlice::get_archive_id(BlockSeqno masterchain_seqno, td::Promise<td::
   }
 }
 
-void ArchiveSlice::start_up() {
+void ArchiveSlice::before_query() {
+  if (!kv_) {
+    open_files();
+    if (lt_index_requested_) {
+      write_lt_index();
+    }
+  }
+  idle_timeout_ = td::Timestamp::in(index_idle_timeout());
+  alarm_timestamp().relax(idle_timeout_);
+  if (!archive_lru_.empty()) {
+    td::actor::send_closure(archive_lru_, &ArchiveLru::on_query, actor_id(this),
+                            PackageId{archive_id_, key_blocks_only_, temp_});
+  }
+}
+
+void ArchiveSlice::close_files() {
+  if (destroyed_ || archive_lru_.empty()) {
+    return;
+  }
+  PackageId id{archive_id_, key_blocks_only_, temp_};
+  if (try_close_files()) {
+    td::actor::send_closure(archive_lru_, &ArchiveLru::on_close, id);
+  } else {
+    td::actor::send_closure(archive_lru_, &ArchiveLru::on_close_refused, id);
+  }
+}
+
+bool ArchiveSlice::try_close_files() {
+  if (!kv_) {
+    return true;
+  }
+  // in async mode the index keeps an uncommitted transaction and the packages are not synced,
+  // an unfinished append would be truncated away on reopening
+  if (async_mode_ || pending_writes_ > 0) {
+    return false;
+  }
+  LOG(DEBUG) << "closing archive slice " << archive_id_;
+  packages_.clear();
+  readahead_.clear();
+  kv_ = nullptr;
+  return true;
+}
+
+std::string ArchiveSlice::lt_index_path() const {
+  PackageId p_id{archive_id_, key_blocks_only_, temp_};
+  return PSTRING() << db_root_ << p_id.path() << p_id.name() << ".ltindex";
+}
+
+ArchiveLtIndex *ArchiveSlice::get_lt_index() {
+  if (lt_index_state_ == LtIndexState::unknown) {
+    lt_index_state_ = LtIndexState::absent;
+    if (destroyed_ || temp_ || key_blocks_only_) {
+      return nullptr;
+    }
+    auto path = lt_index_path();
+    if (td::stat(path).is_error()) {
+      return nullptr;
+    }
+    auto R = ArchiveLtIndex::open(path);
+    if (R.is_error()) {
+      LOG(WARNING) << "failed to open lt index '" << path << "': " << R.move_as_error();
+      td::unlink(path).ignore();
+      return nullptr;
+    }
+    lt_index_ = std::make_unique<ArchiveLtIndex>(R.move_as_ok());
+    lt_index_state_ = LtIndexState::present;
+  }
+  return lt_index_.get();
+}
+
+void ArchiveSlice::drop_lt_index() {
+  if (lt_index_state_ == LtIndexState::absent) {
+    return;
+  }
+  lt_index_ = nullptr;
+  lt_index_state_ = LtIndexState::absent;
+  td::unlink(lt_index_path()).ignore();
+}
+
+void ArchiveSlice::finalize() {
+  if (destroyed_ || temp_ || key_blocks_only_) {
+    return;
+  }
+  // the ltdb is read from the key-value index, so the lt index is written only when the slice is open anyway
+  lt_index_requested_ = true;
+  if (kv_) {
+    write_lt_index();
+  }
+}
+
+void ArchiveSlice::write_lt_index() {
+  if (get_lt_index()) {
+    return;
+  }
+  auto S = ArchiveLtIndex::write(lt_index_path(), ArchiveLtDb::read(*kv_));
+  if (S.is_error()) {
+    LOG(ERROR) << "failed to write lt index of archive slice " << archive_id_ << ": " << S;
+    return;
+  }
+  lt_index_state_ = LtIndexState::unknown;
+  LOG(INFO) << "finalized archive slice " << archive_id_;
+}
+
+void ArchiveSlice::open_files() {
   PackageId p_id{archive_id_, key_blocks_only_, temp_};
   std::string db_path = PSTRING() << db_root_ << p_id.path() << p_id.name() << ".index";
-  kv_ = std::make_shared<td::RocksDb>(td::RocksDb::open(db_path).move_as_ok());
+  kv_ = std::make_shared<td::RocksDb>(td::RocksDb::open(db_path, db_options_).move_as_ok());
 
   std::string value;
   auto R2 = kv_->get("status", value);
@@ -532,16 +680,21 @@ void ArchiveSlice::set_async_mode(bool mode, td::Promise<td::Unit> promise) {
   ig.add_promise(std::move(promise));
 
   for (auto &p : packages_) {
-    td::actor::send_closure(p.writer, &PackageWriter::set_async_mode, mode, std::move(promise));
+    if (!p.writer.empty()) {
+      td::actor::send_closure(p.writer, &PackageWriter::set_async_mode, mode, std::move(promise));
+    }
   }
 }
 
-ArchiveSlice::ArchiveSlice(td::uint32 archive_id, bool key_blocks_only, bool temp, bool finalized, std::string db_root)
+ArchiveSlice::ArchiveSlice(td::uint32 archive_id, bool key_blocks_only, bool temp, bool finalized, std::string db_root,
+                           td::actor::ActorId<ArchiveLru> archive_lru, td::RocksDbOptions db_options)
     : archive_id_(archive_id)
     , key_blocks_only_(key_blocks_only)
     , temp_(temp)
     , finalized_(finalized)
-    , db_root_(std::move(db_root)) {
+    , db_root_(std::move(db_root))
+    , archive_lru_(std::move(archive_lru))
+    , db_options_(std::move(db_options)) {
 }
 
 td::Result<ArchiveSlice::PackageInfo *> ArchiveSlice::choose_package(BlockSeqno masterchain_seqno, bool force) {
@@ -573,21 +726,27 @@ td::Result<ArchiveSlice::PackageInfo *> ArchiveSlice::choose_package(BlockSeqno
 void ArchiveSlice::add_package(td::uint32 seqno, td::uint64 size, td::uint32 version) {
   PackageId p_id{seqno, key_blocks_only_, temp_};
   std::string path = PSTRING() << db_root_ << p_id.path() << p_id.name() << ".pack";
+  auto idx = td::narrow_cast<td::uint32>(packages_.size());
+  if (finalized_) {
+    auto R = Package::open(path, true, false);
+    if (R.is_error()) {
+      LOG(FATAL) << "failed to open archive '" << path << "': " << R.move_as_error();
+      return;
+    }
+    auto pack = std::make_shared<Package>(R.move_as_ok());
+    packages_.emplace_back(std::move(pack), td::actor::ActorOwn<PackageWriter>(), seqno, path, idx, version);
+    return;
+  }
   auto R = Package::open(path, false, true);
   if (R.is_error()) {
     LOG(FATAL) << "failed to open/create archive '" << path << "': " << R.move_as_error();
     return;
   }
-  auto idx = td::narrow_cast<td::uint32>(packages_.size());
-  if (finalized_) {
-    packages_.emplace_back(nullptr, td::actor::ActorOwn<PackageWriter>(), seqno, path, idx, version);
-    return;
-  }
   auto pack = std::make_shared<Package>(R.move_as_ok());
   if (version >= 1) {
     pack->truncate(size).ensure();
   }
-  auto writer = td::actor::create_actor<PackageWriter>("writer", pack);
+  auto writer = td::actor::create_actor<PackageWriter>("writer", pack, async_mode_);
   packages_.emplace_back(std::move(pack), std::move(writer), seqno, path, idx, version);
 }
 
@@ -614,13 +773,22 @@ void ArchiveSlice::destroy(td::Promise<td::Unit> promise) {
   td::MultiPromise mp;
   auto ig = mp.init_guard();
   ig.add_promise(std::move(promise));
+  if (!kv_ && !destroyed_) {
+    // paths of the packages are kept in the index
+    open_files();
+  }
   destroyed_ = true;
+  if (!archive_lru_.empty()) {
+    td::actor::send_closure(archive_lru_, &ArchiveLru::on_close, PackageId{archive_id_, key_blocks_only_, temp_});
+  }
 
   for (auto &p : packages_) {
     td::unlink(p.path).ensure();
   }
+  drop_lt_index();
 
   packages_.clear();
+  readahead_.clear();
   kv_ = nullptr;
 
   PackageId p_id{archive_id_, key_blocks_only_, temp_};
@@ -763,12 +931,19 @@ void ArchiveSlice::truncate(BlockSeqno masterchain_seqno, ConstBlockHandle handl
     destroy(std::move(promise));
     return;
   }
+  if (destroyed_) {
+    promise.set_error(td::Status::Error(ErrorCode::notready, "package already gc'd"));
+    return;
+  }
+  before_query();
+  drop_lt_index();
   LOG(INFO) << "TRUNCATE: slice " << archive_id_ << " maxseqno= " << max_masterchain_seqno()
             << " truncate_upto=" << masterchain_seqno;
   if (max_masterchain_seqno() <= masterchain_seqno) {
     promise.set_value(td::Unit());
     return;
   }
+  readahead_.clear();
 
   auto cutoff = choose_package(masterchain_seqno, false);
   cutoff.ensure();
@@ -21,6 +21,11 @@
 #include "validator/interfaces/db.h"
 #include "package.hpp"
 #include "fileref.hpp"
+#include "archive-lt-index.hpp"
+#include "td/db/RocksDb.h"
+#include "td/utils/List.h"
+
+#include <tuple>
 
 namespace ton {
 
@@ -54,7 +59,8 @@ struct PackageId {
 
 class PackageWriter : public td::actor::Actor {
  public:
-  PackageWriter(std::shared_ptr<Package> package) : package_(std::move(package)) {
+  PackageWriter(std::shared_ptr<Package> package, bool async_mode = false)
+      : package_(std::move(package)), async_mode_(async_mode) {
   }
 
   void append(std::string filename, td::BufferSlice data, td::Promise<std::pair<td::uint64, td::uint64>> promise);
@@ -71,9 +77,47 @@ class PackageWriter : public td::actor::Actor {
   bool async_mode_ = false;
 };
 
+class ArchiveSlice;
+
+/*
+ * keeps the number of archive slices with open index and package files within a limit:
+ * slices report every query, the least recently used ones are asked to close their files
+ */
+class ArchiveLru : public td::actor::Actor {
+ public:
+  explicit ArchiveLru(td::uint32 max_open_slices) : max_open_slices_(max_open_slices) {
+  }
+
+  void on_query(td::actor::ActorId<ArchiveSlice> slice, PackageId id);
+  void on_close(PackageId id);
+  void on_close_refused(PackageId id);
+
+ private:
+  using Key = std::tuple<td::uint32, bool, bool>;
+  struct Entry : public td::ListNode {
+    Key key;
+    td::actor::ActorId<ArchiveSlice> slice;
+    bool closing{false};  // asked to close its files, not in the lru list until it answers
+
+    static Entry *from_list_node(td::ListNode *node) {
+      return static_cast<Entry *>(node);
+    }
+  };
+
+  static Key get_key(const PackageId &id) {
+    return Key{id.id, id.key, id.temp};
+  }
+
+  td::uint32 max_open_slices_;
+  std::map<Key, std::unique_ptr<Entry>> open_slices_;
+  size_t closing_slices_{0};
+  td::ListNode lru_;
+};
+
 class ArchiveSlice : public td::actor::Actor {
  public:
-  ArchiveSlice(td::uint32 archive_id, bool key_blocks_only, bool temp, bool finalized, std::string db_root);
+  ArchiveSlice(td::uint32 archive_id, bool key_blocks_only, bool temp, bool finalized, std::string db_root,
+               td::actor::ActorId<ArchiveLru> archive_lru = {}, td::RocksDbOptions db_options = {});
 
   void get_archive_id(BlockSeqno masterchain_seqno, td::Promise<td::uint64> promise);
 
@@ -88,14 +132,12 @@ class ArchiveSlice : public td::actor::Actor {
   void get_block_by_unix_time(AccountIdPrefixFull account_id, UnixTime ts, td::Promise<ConstBlockHandle> promise);
   void get_block_by_lt(AccountIdPrefixFull account_id, LogicalTime lt, td::Promise<ConstBlockHandle> promise);
   void get_block_by_seqno(AccountIdPrefixFull account_id, BlockSeqno seqno, td::Promise<ConstBlockHandle> promise);
-  void get_block_common(AccountIdPrefixFull account_id,
-                        std::function<td::int32(ton_api::db_lt_desc_value &)> compare_desc,
-                        std::function<td::int32(ton_api::db_lt_el_value &)> compare, bool exact,
-                        td::Promise<ConstBlockHandle> promise);
+  void get_block_common(AccountIdPrefixFull account_id, std::function<td::int32(const LtDbEntry &)> compare,
+                        bool exact, td::Promise<ConstBlockHandle> promise);
 
   void get_slice(td::uint64 archive_id, td::uint64 offset, td::uint32 limit, td::Promise<td::BufferSlice> promise);
 
-  void start_up() override;
+  void alarm() override;
   void destroy(td::Promise<td::Unit> promise);
   void truncate(BlockSeqno masterchain_seqno, ConstBlockHandle handle, td::Promise<td::Unit> promise);
 
@@ -103,10 +145,28 @@ class ArchiveSlice : public td::actor::Actor {
   void commit_transaction();
   void set_async_mode(bool mode, td::Promise<td::Unit> promise);
 
+  // the index and the packages are opened on the first query and closed when the slice is idle
+  // or when asked by ArchiveLru; a slice with unfinished writes keeps them open and tells ArchiveLru so
+  void close_files();
+  // requests the immutable ltdb index used by lookups afterwards, it is written now if the slice is open,
+  // or when the slice is opened next time; any later write to the slice drops it
+  void finalize();
+
  private:
+  void before_query();
+  void open_files();
+  bool try_close_files();
+  std::string lt_index_path() const;
+  ArchiveLtIndex *get_lt_index();
+  void write_lt_index();
+  void drop_lt_index();
+  bool get_handle_value(const BlockIdExt &block_id, std::string &value);
+
   void written_data(BlockHandle handle, td::Promise<td::Unit> promise);
-  void add_file_cont(size_t idx, FileReference ref_id, td::uint64 offset, td::uint64 size,
+  void add_file_cont(size_t idx, FileReference ref_id, td::Result<std::pair<td::uint64, td::uint64>> R,
                      td::Promise<td::Unit> promise);
+  void got_slice_readahead(td::uint64 stream_id, td::uint64 offset, td::uint32 limit,
+                           td::Result<td::BufferSlice> R, td::Promise<td::BufferSlice> promise);
 
   /* ltdb */
   td::BufferSlice get_db_key_lt_desc(ShardIdFull shard);
@@ -128,7 +188,15 @@ class ArchiveSlice : public td::actor::Actor {
   td::uint32 slice_size_{100};
 
   std::string db_root_;
+  td::actor::ActorId<ArchiveLru> archive_lru_;
+  td::RocksDbOptions db_options_;
   std::shared_ptr<td::KeyValue> kv_;
+  td::Timestamp idle_timeout_;
+  enum class LtIndexState { unknown, absent, present };
+  LtIndexState lt_index_state_{LtIndexState::unknown};
+  std::unique_ptr<ArchiveLtIndex> lt_index_;
+  bool lt_index_requested_{false};
+  td::uint32 pending_writes_{0};
 
   struct PackageInfo {
     PackageInfo(std::shared_ptr<Package> package, td::actor::ActorOwn<PackageWriter> writer, BlockSeqno id,
@@ -149,6 +217,19 @@ class ArchiveSlice : public td::actor::Actor {
   };
   std::vector<PackageInfo> packages_;
 
+  // peers download a package with consecutive get_slice queries, so such downloads are served
+  // from a larger chunk read in advance
+  struct SliceReadahead {
+    td::uint64 id;
+    td::uint32 package_idx;
+    td::uint64 next_offset;  // where the next query of this download is expected to start
+    td::uint64 offset;
+    td::BufferSlice data;
+    td::Timestamp timeout;
+  };
+  std::vector<SliceReadahead> readahead_;  // least recently used first
+  td::uint64 next_readahead_id_{0};
+
   td::Result<PackageInfo *> choose_package(BlockSeqno masterchain_seqno, bool force);
   void add_package(BlockSeqno masterchain_seqno, td::uint64 size, td::uint32 version);
   void truncate_shard(BlockSeqno masterchain_seqno, ShardIdFull shard, td::uint32 cutoff_idx, Package *pack);
@@ -164,6 +245,18 @@ class ArchiveSlice : public td::actor::Actor {
   static constexpr td::uint32 default_package_version() {
     return 1;
   }
+  static constexpr td::uint32 slice_readahead_size() {
+    return 4 << 20;
+  }
+  static constexpr size_t max_readahead_streams() {
+    return 4;
+  }
+  static constexpr double readahead_timeout() {
+    return 30.0;
+  }
+  static constexpr double index_idle_timeout() {
+    return 600.0;
+  }
 };
 
 }  // namespace validator
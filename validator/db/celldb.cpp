@@ -20,6 +20,7 @@
 #include "rootdb.hpp"
 
 #include "td/db/RocksDb.h"
+#include "td/utils/Metrics.h"
 
 #include "ton/ton-tl.hpp"
 #include "ton/ton-io.hpp"
@@ -28,78 +29,173 @@ namespace ton {
 
 namespace validator {
 
-CellDbIn::CellDbIn(td::actor::ActorId<RootDb> root_db, td::actor::ActorId<CellDb> parent, std::string path)
-    : root_db_(root_db), parent_(parent), path_(std::move(path)) {
+CellDbIn::CellDbIn(td::actor::ActorId<RootDb> root_db, td::actor::ActorId<CellDb> parent, std::string path,
+                   std::shared_ptr<vm::CellCache> cell_cache)
+    : root_db_(root_db), parent_(parent), path_(std::move(path)), cell_cache_(std::move(cell_cache)) {
 }
 
 void CellDbIn::start_up() {
   cell_db_ = std::make_shared<td::RocksDb>(td::RocksDb::open(path_).move_as_ok());
 
-  boc_ = vm::DynamicBagOfCellsDb::create();
-  boc_->set_loader(std::make_unique<vm::CellLoader>(cell_db_->snapshot())).ensure();
-  td::actor::send_closure(parent_, &CellDb::update_snapshot, cell_db_->snapshot());
+  boc_ = vm::DynamicBagOfCellsDb::create(cell_cache_);
+  update_snapshot();
 
   alarm_timestamp() = td::Timestamp::in(10.0);
 
   auto empty = get_empty_key_hash();
   if (get_block(empty).is_error()) {
     DbEntry e{get_empty_key(), empty, empty, RootHash::zero()};
-    cell_db_->begin_write_batch().ensure();
-    set_block(empty, std::move(e));
-    cell_db_->commit_write_batch().ensure();
+    cell_db_->set(td::as_slice(get_key(empty)), e.release()).ensure();
   }
   last_gc_ = empty;
 }
 
 void CellDbIn::load_cell(RootHash hash, td::Promise<td::Ref<vm::DataCell>> promise) {
-  td::PerfWarningTimer{"loadcell", 0.1};
+  if (commit_in_progress_) {
+    pending_loads_.push_back(PendingLoad{hash, std::move(promise)});
+    return;
+  }
+  td::PerfWarningTimer timer{"loadcell", 0.1};
+  static auto &load_cell_metric = td::get_metric<td::MetricHistogram>("celldb_load_cell_us");
+  td::MetricTimer metric_timer{load_cell_metric};
   promise.set_result(boc_->load_cell(hash.as_slice()));
 }
 
 void CellDbIn::store_cell(BlockIdExt block_id, td::Ref<vm::Cell> cell, td::Promise<td::Ref<vm::DataCell>> promise) {
-  td::PerfWarningTimer{"storecell", 0.1};
-  auto key_hash = get_key_hash(block_id);
-  auto R = get_block(key_hash);
-  // duplicate
-  if (R.is_ok()) {
-    promise.set_result(boc_->load_cell(cell->get_hash().as_slice()));
+  pending_stores_.push_back(PendingStore{block_id, std::move(cell), std::move(promise)});
+  try_commit();
+}
+
+void CellDbIn::try_commit() {
+  if (commit_in_progress_ || (pending_stores_.empty() && !pending_gc_)) {
     return;
   }
+  td::PerfWarningTimer timer{"storecellprepare", 0.1};
+  static auto &prepare_commit_metric = td::get_metric<td::MetricHistogram>("celldb_prepare_commit_us");
+  td::MetricTimer metric_timer{prepare_commit_metric};
+  CHECK(uncommitted_blocks_.empty());
+  CellDbCommitter::Batch batch;
 
   auto empty = get_empty_key_hash();
-  auto ER = get_block(empty);
-  ER.ensure();
-  auto E = ER.move_as_ok();
+  for (auto &store : pending_stores_) {
+    auto key_hash = get_key_hash(store.block_id);
+    // duplicate
+    if (get_block(key_hash).is_ok()) {
+      committing_stores_.push_back(std::move(store));
+      continue;
+    }
+
+    auto ER = get_block(empty);
+    ER.ensure();
+    auto E = ER.move_as_ok();
+
+    auto PR = get_block(E.prev);
+    PR.ensure();
+    auto P = PR.move_as_ok();
+    CHECK(P.next == empty);
 
-  auto PR = get_block(E.prev);
-  PR.ensure();
-  auto P = PR.move_as_ok();
-  CHECK(P.next == empty);
+    DbEntry D{store.block_id, E.prev, empty, store.cell->get_hash().bits()};
 
-  DbEntry D{block_id, E.prev, empty, cell->get_hash().bits()};
+    E.prev = key_hash;
+    P.next = key_hash;
 
-  E.prev = key_hash;
-  P.next = key_hash;
+    if (P.is_empty()) {
+      E.next = key_hash;
+      P.prev = key_hash;
+    }
+
+    set_block(empty, std::move(E));
+    set_block(D.prev, std::move(P));
+    set_block(key_hash, std::move(D));
 
-  if (P.is_empty()) {
-    E.next = key_hash;
-    P.prev = key_hash;
+    batch.to_inc.push_back(store.cell);
+    committing_stores_.push_back(std::move(store));
   }
+  pending_stores_.clear();
+
+  if (pending_gc_) {
+    pending_gc_ = false;
+
+    auto FR = get_block(last_gc_);
+    FR.ensure();
+    auto F = FR.move_as_ok();
+
+    auto PR = get_block(F.prev);
+    PR.ensure();
+    auto P = PR.move_as_ok();
+    auto NR = get_block(F.next);
+    NR.ensure();
+    auto N = NR.move_as_ok();
+
+    P.next = F.next;
+    N.prev = F.prev;
+    if (P.is_empty() && N.is_empty()) {
+      P.prev = P.next;
+      N.next = N.prev;
+    }
 
-  boc_->inc(cell);
-  boc_->prepare_commit().ensure();
-  vm::CellStorer stor{*cell_db_.get()};
-  cell_db_->begin_write_batch().ensure();
-  boc_->commit(stor).ensure();
-  set_block(empty, std::move(E));
-  set_block(D.prev, std::move(P));
-  set_block(key_hash, std::move(D));
-  cell_db_->commit_write_batch().ensure();
+    batch.to_dec.push_back(boc_->load_cell(F.root_hash.as_slice()).move_as_ok());
+    erase_block(last_gc_);
+    set_block(F.prev, std::move(P));
+    set_block(F.next, std::move(N));
+    committing_gc_next_ = F.next;
+  }
+
+  for (auto &it : uncommitted_blocks_) {
+    if (it.second) {
+      batch.to_set.emplace_back(get_key(it.first), it.second.value().release());
+    } else {
+      batch.to_erase.push_back(get_key(it.first));
+    }
+  }
+  CHECK(committing_blocks_.empty());
+  committing_blocks_ = std::move(uncommitted_blocks_);
+  uncommitted_blocks_.clear();
+
+  commit_in_progress_ = true;
+  auto P = td::PromiseCreator::lambda(
+      [SelfId = actor_id(this)](td::Result<std::unique_ptr<vm::DynamicBagOfCellsDb>> R) mutable {
+        R.ensure();
+        td::actor::send_closure(SelfId, &CellDbIn::committed, R.move_as_ok());
+      });
+  td::actor::create_actor<CellDbCommitter>("celldbcommit", std::move(boc_),
+                                           std::make_shared<td::RocksDb>(cell_db_->clone()), std::move(batch),
+                                           std::move(P))
+      .release();
+}
 
+void CellDbIn::update_snapshot() {
   boc_->set_loader(std::make_unique<vm::CellLoader>(cell_db_->snapshot())).ensure();
+  // drops the cells erased by the last commit from the cache
+  cell_cache_->set_loader(std::make_shared<vm::CellLoader>(cell_db_->snapshot()));
   td::actor::send_closure(parent_, &CellDb::update_snapshot, cell_db_->snapshot());
+}
+
+void CellDbIn::committed(std::unique_ptr<vm::DynamicBagOfCellsDb> boc) {
+  CHECK(commit_in_progress_);
+  commit_in_progress_ = false;
+  boc_ = std::move(boc);
+  committing_blocks_.clear();
+
+  update_snapshot();
+
+  for (auto &store : committing_stores_) {
+    store.promise.set_result(boc_->load_cell(store.cell->get_hash().as_slice()));
+  }
+  committing_stores_.clear();
 
-  promise.set_result(boc_->load_cell(cell->get_hash().as_slice()));
+  if (committing_gc_next_) {
+    DCHECK(get_block(last_gc_).is_error());
+    last_gc_ = committing_gc_next_.unwrap();
+    alarm_timestamp() = td::Timestamp::now();
+  }
+
+  for (auto &load : pending_loads_) {
+    load.promise.set_result(boc_->load_cell(load.hash.as_slice()));
+  }
+  pending_loads_.clear();
+
+  try_commit();
 }
 
 void CellDbIn::alarm() {
@@ -156,44 +252,9 @@ void CellDbIn::gc_cont(BlockHandle handle) {
 }
 
 void CellDbIn::gc_cont2(BlockHandle handle) {
-  td::PerfWarningTimer{"gccell", 0.1};
-
-  auto FR = get_block(last_gc_);
-  FR.ensure();
-  auto F = FR.move_as_ok();
-
-  auto PR = get_block(F.prev);
-  PR.ensure();
-  auto P = PR.move_as_ok();
-  auto NR = get_block(F.next);
-  NR.ensure();
-  auto N = NR.move_as_ok();
-
-  P.next = F.next;
-  N.prev = F.prev;
-  if (P.is_empty() && N.is_empty()) {
-    P.prev = P.next;
-    N.next = N.prev;
-  }
-
-  auto cell = boc_->load_cell(F.root_hash.as_slice()).move_as_ok();
-
-  boc_->dec(cell);
-  boc_->prepare_commit().ensure();
-  vm::CellStorer stor{*cell_db_.get()};
-  cell_db_->begin_write_batch().ensure();
-  boc_->commit(stor).ensure();
-  cell_db_->erase(get_key(last_gc_)).ensure();
-  set_block(F.prev, std::move(P));
-  set_block(F.next, std::move(N));
-  cell_db_->commit_write_batch().ensure();
-  alarm_timestamp() = td::Timestamp::now();
-
-  boc_->set_loader(std::make_unique<vm::CellLoader>(cell_db_->snapshot())).ensure();
-  td::actor::send_closure(parent_, &CellDb::update_snapshot, cell_db_->snapshot());
-
-  DCHECK(get_block(last_gc_).is_error());
-  last_gc_ = F.next;
+  CHECK(!pending_gc_);
+  pending_gc_ = true;
+  try_commit();
 }
 
 void CellDbIn::skip_gc() {
@@ -229,6 +290,15 @@ CellDbIn::KeyHash CellDbIn::get_empty_key_hash() {
 }
 
 td::Result<CellDbIn::DbEntry> CellDbIn::get_block(KeyHash key_hash) {
+  for (auto *blocks : {&uncommitted_blocks_, &committing_blocks_}) {
+    auto it = blocks->find(key_hash);
+    if (it != blocks->end()) {
+      if (!it->second) {
+        return td::Status::Error(ErrorCode::notready, "not in db");
+      }
+      return it->second.value();
+    }
+  }
   const auto key = get_key(key_hash);
   std::string value;
   auto R = cell_db_->get(td::as_slice(key), value);
@@ -243,8 +313,41 @@ td::Result<CellDbIn::DbEntry> CellDbIn::get_block(KeyHash key_hash) {
 }
 
 void CellDbIn::set_block(KeyHash key_hash, DbEntry e) {
-  const auto key = get_key(key_hash);
-  cell_db_->set(td::as_slice(key), e.release()).ensure();
+  uncommitted_blocks_[key_hash] = std::move(e);
+}
+
+void CellDbIn::erase_block(KeyHash key_hash) {
+  uncommitted_blocks_[key_hash] = td::optional<DbEntry>();
+}
+
+void CellDbCommitter::start_up() {
+  td::PerfWarningTimer timer{"storecell", 0.1};
+  static auto &commit_metric = td::get_metric<td::MetricHistogram>("celldb_commit_us");
+  static auto &stored_states_metric = td::get_metric<td::MetricCounter>("celldb_stored_states_total");
+  static auto &gc_states_metric = td::get_metric<td::MetricCounter>("celldb_gc_states_total");
+  td::MetricTimer metric_timer{commit_metric};
+  stored_states_metric.add(static_cast<td::int64>(batch_.to_inc.size()));
+  gc_states_metric.add(static_cast<td::int64>(batch_.to_dec.size()));
+  for (auto &cell : batch_.to_inc) {
+    boc_->inc(cell);
+  }
+  for (auto &cell : batch_.to_dec) {
+    boc_->dec(cell);
+  }
+  boc_->prepare_commit().ensure();
+  vm::CellStorer stor{*cell_db_};
+  cell_db_->begin_write_batch().ensure();
+  boc_->commit(stor).ensure();
+  for (auto &it : batch_.to_set) {
+    cell_db_->set(td::as_slice(it.first), it.second.as_slice()).ensure();
+  }
+  for (auto &key : batch_.to_erase) {
+    cell_db_->erase(td::as_slice(key)).ensure();
+  }
+  cell_db_->commit_write_batch().ensure();
+
+  promise_.set_value(std::move(boc_));
+  stop();
 }
 
 void CellDb::load_cell(RootHash hash, td::Promise<td::Ref<vm::DataCell>> promise) {
@@ -260,13 +363,34 @@ void CellDb::load_cell(RootHash hash, td::Promise<td::Ref<vm::DataCell>> promise
   }
 }
 
+void CellDb::get_cell_loader(td::Promise<vm::BagOfCells::LoadCell> promise) {
+  if (!snapshot_) {
+    promise.set_error(td::Status::Error(ErrorCode::notready, "cell db is not started"));
+    return;
+  }
+  auto loader = std::make_shared<vm::CellLoader>(snapshot_);
+  promise.set_value([loader](td::Slice hash) { return loader->load_detached(hash); });
+}
+
 void CellDb::store_cell(BlockIdExt block_id, td::Ref<vm::Cell> cell, td::Promise<td::Ref<vm::DataCell>> promise) {
   td::actor::send_closure(cell_db_, &CellDbIn::store_cell, block_id, std::move(cell), std::move(promise));
 }
 
+void CellDb::prepare_stats(td::Promise<std::vector<std::pair<std::string, std::string>>> promise) {
+  auto stats = cell_cache_->get_stats();
+  std::vector<std::pair<std::string, std::string>> vec;
+  vec.emplace_back("cachehits", td::to_string(stats.hits));
+  vec.emplace_back("cachemisses", td::to_string(stats.misses));
+  vec.emplace_back("cacheevictions", td::to_string(stats.evictions));
+  vec.emplace_back("cachesize", td::to_string(stats.size));
+  vec.emplace_back("cachememory", td::to_string(stats.memory));
+  promise.set_value(std::move(vec));
+}
+
 void CellDb::start_up() {
-  boc_ = vm::DynamicBagOfCellsDb::create();
-  cell_db_ = td::actor::create_actor<CellDbIn>("celldbin", root_db_, actor_id(this), path_);
+  cell_cache_ = std::make_shared<vm::CellCache>(cell_cache_max_memory_);
+  boc_ = vm::DynamicBagOfCellsDb::create(cell_cache_);
+  cell_db_ = td::actor::create_actor<CellDbIn>("celldbin", root_db_, actor_id(this), path_, cell_cache_);
 }
 
 CellDbIn::DbEntry::DbEntry(tl_object_ptr<ton_api::db_celldb_value> entry)
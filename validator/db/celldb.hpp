@@ -21,11 +21,20 @@
 #include "td/actor/actor.h"
 #include "crypto/vm/db/DynamicBagOfCellsDb.h"
 #include "crypto/vm/db/CellStorage.h"
+#include "crypto/vm/db/CellCache.h"
+#include "crypto/vm/boc.h"
 #include "td/db/KeyValue.h"
+#include "td/utils/optional.h"
 #include "ton/ton-types.h"
 #include "interfaces/block-handle.h"
 #include "auto/tl/ton_api.h"
 
+#include <map>
+
+namespace td {
+class RocksDb;
+}  // namespace td
+
 namespace ton {
 
 namespace validator {
@@ -34,6 +43,31 @@ class RootDb;
 
 class CellDb;
 
+// Applies a merged batch of state stores and deletions to the cell db: computes the refcount diff
+// and writes it together with the list updates in one write batch, off the CellDbIn actor
+class CellDbCommitter : public td::actor::Actor {
+ public:
+  struct Batch {
+    std::vector<td::Ref<vm::Cell>> to_inc;
+    std::vector<td::Ref<vm::Cell>> to_dec;
+    std::vector<std::pair<std::string, td::BufferSlice>> to_set;
+    std::vector<std::string> to_erase;
+  };
+
+  CellDbCommitter(std::unique_ptr<vm::DynamicBagOfCellsDb> boc, std::shared_ptr<vm::KeyValue> cell_db, Batch batch,
+                  td::Promise<std::unique_ptr<vm::DynamicBagOfCellsDb>> promise)
+      : boc_(std::move(boc)), cell_db_(std::move(cell_db)), batch_(std::move(batch)), promise_(std::move(promise)) {
+  }
+
+  void start_up() override;
+
+ private:
+  std::unique_ptr<vm::DynamicBagOfCellsDb> boc_;
+  std::shared_ptr<vm::KeyValue> cell_db_;
+  Batch batch_;
+  td::Promise<std::unique_ptr<vm::DynamicBagOfCellsDb>> promise_;
+};
+
 class CellDbIn : public td::actor::Actor {
  public:
   using KeyHash = td::Bits256;
@@ -41,7 +75,8 @@ class CellDbIn : public td::actor::Actor {
   void load_cell(RootHash hash, td::Promise<td::Ref<vm::DataCell>> promise);
   void store_cell(BlockIdExt block_id, td::Ref<vm::Cell> cell, td::Promise<td::Ref<vm::DataCell>> promise);
 
-  CellDbIn(td::actor::ActorId<RootDb> root_db, td::actor::ActorId<CellDb> parent, std::string path);
+  CellDbIn(td::actor::ActorId<RootDb> root_db, td::actor::ActorId<CellDb> parent, std::string path,
+           std::shared_ptr<vm::CellCache> cell_cache);
 
   void start_up() override;
   void alarm() override;
@@ -66,6 +101,7 @@ class CellDbIn : public td::actor::Actor {
   };
   td::Result<DbEntry> get_block(KeyHash key);
   void set_block(KeyHash key, DbEntry e);
+  void erase_block(KeyHash key);
 
   static std::string get_key(KeyHash key);
   static KeyHash get_key_hash(BlockIdExt block_id);
@@ -77,15 +113,44 @@ class CellDbIn : public td::actor::Actor {
   void gc_cont2(BlockHandle handle);
   void skip_gc();
 
+  void try_commit();
+  void committed(std::unique_ptr<vm::DynamicBagOfCellsDb> boc);
+  void update_snapshot();
+
   td::actor::ActorId<RootDb> root_db_;
   td::actor::ActorId<CellDb> parent_;
 
   std::string path_;
 
+  std::shared_ptr<vm::CellCache> cell_cache_;
   std::unique_ptr<vm::DynamicBagOfCellsDb> boc_;
-  std::shared_ptr<vm::KeyValue> cell_db_;
+  std::shared_ptr<td::RocksDb> cell_db_;
 
   KeyHash last_gc_;
+
+  struct PendingStore {
+    BlockIdExt block_id;
+    td::Ref<vm::Cell> cell;
+    td::Promise<td::Ref<vm::DataCell>> promise;
+  };
+  struct PendingLoad {
+    RootHash hash;
+    td::Promise<td::Ref<vm::DataCell>> promise;
+  };
+  // requests received while a batch is being committed; they go to the next batch
+  std::vector<PendingStore> pending_stores_;
+  bool pending_gc_ = false;
+
+  // batch being committed; boc_ is owned by the committer until it finishes
+  bool commit_in_progress_ = false;
+  std::vector<PendingStore> committing_stores_;
+  td::optional<KeyHash> committing_gc_next_;
+  std::vector<PendingLoad> pending_loads_;
+
+  // list entries changed by the batch being built, they are not in cell_db_ yet
+  std::map<KeyHash, td::optional<DbEntry>> uncommitted_blocks_;
+  // list entries changed by the batch being committed, they are visible to get_block() until the commit completes
+  std::map<KeyHash, td::optional<DbEntry>> committing_blocks_;
 };
 
 class CellDb : public td::actor::Actor {
@@ -94,8 +159,12 @@ class CellDb : public td::actor::Actor {
   void store_cell(BlockIdExt block_id, td::Ref<vm::Cell> cell, td::Promise<td::Ref<vm::DataCell>> promise);
   void update_snapshot(std::unique_ptr<td::KeyValueReader> snapshot) {
     started_ = true;
-    boc_->set_loader(std::make_unique<vm::CellLoader>(std::move(snapshot))).ensure();
+    snapshot_ = std::move(snapshot);
+    boc_->set_loader(std::make_unique<vm::CellLoader>(snapshot_)).ensure();
   }
+  // loads cells from the current snapshot without keeping them, for the serialization of persistent states
+  void get_cell_loader(td::Promise<vm::BagOfCells::LoadCell> promise);
+  void prepare_stats(td::Promise<std::vector<std::pair<std::string, std::string>>> promise);
 
   CellDb(td::actor::ActorId<RootDb> root_db, std::string path) : root_db_(root_db), path_(path) {
   }
@@ -108,7 +177,11 @@ class CellDb : public td::actor::Actor {
 
   td::actor::ActorOwn<CellDbIn> cell_db_;
 
+  // cells loaded by both bags of cells, kept across snapshots until evicted or erased by a commit
+  static constexpr size_t cell_cache_max_memory_ = 256 << 20;
+  std::shared_ptr<vm::CellCache> cell_cache_;
   std::unique_ptr<vm::DynamicBagOfCellsDb> boc_;
+  std::shared_ptr<td::KeyValueReader> snapshot_;
   bool started_ = false;
 };
 
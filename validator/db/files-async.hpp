@@ -22,6 +22,8 @@
 #include "td/utils/filesystem.h"
 #include "td/actor/actor.h"
 #include "td/utils/buffer.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/MemoryMapping.h"
 
 #include "common/errorcode.h"
 
@@ -52,12 +54,13 @@ class WriteFile : public td::actor::Actor {
     auto res = R.move_as_ok();
     auto file = std::move(res.first);
     auto old_name = res.second;
-    td::uint64 offset = 0;
-    while (data_.size() > 0) {
-      auto R = file.pwrite(data_.as_slice(), offset);
-      auto s = R.move_as_ok();
-      offset += s;
-      data_.confirm_read(s);
+    auto S = write_data(file);
+    if (S.is_error()) {
+      file.close();
+      td::unlink(old_name).ignore();
+      promise_.set_error(std::move(S));
+      stop();
+      return;
     }
     file.sync().ensure();
     if (new_name_.length() > 0) {
@@ -71,11 +74,29 @@ class WriteFile : public td::actor::Actor {
   WriteFile(std::string tmp_dir, std::string new_name, td::BufferSlice data, td::Promise<std::string> promise)
       : tmp_dir_(tmp_dir), new_name_(new_name), data_(std::move(data)), promise_(std::move(promise)) {
   }
+  WriteFile(std::string tmp_dir, std::string new_name, std::function<td::Status(td::FileFd&)> write_data,
+            td::Promise<std::string> promise)
+      : tmp_dir_(tmp_dir), new_name_(new_name), write_data_(std::move(write_data)), promise_(std::move(promise)) {
+  }
 
  private:
+  td::Status write_data(td::FileFd& file) {
+    if (write_data_) {
+      return write_data_(file);
+    }
+    td::uint64 offset = 0;
+    while (data_.size() > 0) {
+      TRY_RESULT(s, file.pwrite(data_.as_slice(), offset));
+      offset += s;
+      data_.confirm_read(s);
+    }
+    return td::Status::OK();
+  }
+
   const std::string tmp_dir_;
   std::string new_name_;
   td::BufferSlice data_;
+  std::function<td::Status(td::FileFd&)> write_data_;
   td::Promise<std::string> promise_;
 };
 
@@ -110,6 +131,41 @@ class ReadFile : public td::actor::Actor {
   td::Promise<td::BufferSlice> promise_;
 };
 
+class ReadMappedFile : public td::actor::Actor {
+ public:
+  void start_up() override {
+    promise_.set_result(read());
+    stop();
+  }
+  ReadMappedFile(std::shared_ptr<const td::MemoryMapping> mapping, td::int64 offset, td::int64 max_length,
+                 td::Promise<td::BufferSlice> promise)
+      : mapping_(std::move(mapping)), offset_(offset), max_length_(max_length), promise_(std::move(promise)) {
+  }
+
+ private:
+  // same bounds as td::read_file
+  td::Result<td::BufferSlice> read() {
+    auto data = mapping_->as_slice();
+    auto file_size = static_cast<td::int64>(data.size());
+    if (offset_ < 0 || offset_ > file_size) {
+      return td::Status::Error(ErrorCode::error, "invalid offset");
+    }
+    auto size = max_length_;
+    if (size == -1 || (size >= 0 && size > file_size - offset_)) {
+      size = file_size - offset_;
+    }
+    if (size < 0) {
+      return td::Status::Error(ErrorCode::error, "invalid size");
+    }
+    return td::BufferSlice{data.substr(static_cast<size_t>(offset_), static_cast<size_t>(size))};
+  }
+
+  std::shared_ptr<const td::MemoryMapping> mapping_;
+  td::int64 offset_;
+  td::int64 max_length_;
+  td::Promise<td::BufferSlice> promise_;
+};
+
 }  // namespace db
 
 }  // namespace validator
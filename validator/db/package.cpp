@@ -19,6 +19,13 @@
 #include "package.hpp"
 #include "common/errorcode.h"
 
+#include "td/utils/port/platform.h"
+
+#if TD_LINUX || TD_FREEBSD
+#include <cerrno>
+#include <sys/uio.h>
+#endif
+
 namespace ton {
 
 namespace {
@@ -42,6 +49,79 @@ constexpr td::uint16 entry_header_magic() {
 constexpr td::uint32 package_header_magic() {
   return 0xae8fdd01;
 }
+
+// enough for the entry header and the filename; read into a buffer on the stack
+constexpr td::uint32 entry_prefix_size() {
+  return 1 << 10;
+}
+
+// the beginning of the data read together with the prefix
+constexpr td::uint32 entry_prefetch_size() {
+  return 1 << 16;
+}
+
+struct EntryHeader {
+  td::uint32 fname_size;
+  td::uint32 data_size;
+};
+
+td::Result<EntryHeader> parse_entry_header(td::Slice data, td::uint64 offset) {
+  if (data.size() < 8) {
+    return td::Status::Error(ErrorCode::notready, "too short read");
+  }
+  td::uint32 header[2];
+  std::memcpy(header, data.data(), 8);
+  if ((header[0] & 0xffff) != entry_header_magic()) {
+    return td::Status::Error(ErrorCode::notready,
+                             PSTRING() << "bad entry magic " << (header[0] & 0xffff) << " offset=" << offset);
+  }
+  return EntryHeader{header[0] >> 16, header[1]};
+}
+
+// pread returns less than requested only at the end of the file
+td::Result<size_t> pread_full(const td::FileFd &fd, td::MutableSlice slice, td::uint64 offset) {
+  size_t total = 0;
+  while (total < slice.size()) {
+    TRY_RESULT(s, fd.pread(slice.substr(total), offset + total));
+    if (s == 0) {
+      break;
+    }
+    total += s;
+  }
+  return total;
+}
+
+// reads both slices with one preadv where it is available
+td::Result<size_t> pread_full(const td::FileFd &fd, td::MutableSlice first, td::MutableSlice second,
+                              td::uint64 offset) {
+  size_t total = 0;
+#if TD_LINUX || TD_FREEBSD
+  struct iovec iov[2];
+  iov[0].iov_base = first.data();
+  iov[0].iov_len = first.size();
+  iov[1].iov_base = second.data();
+  iov[1].iov_len = second.size();
+  TRY_RESULT(native_offset, td::narrow_cast_safe<off_t>(offset));
+  ssize_t res;
+  do {
+    res = ::preadv(fd.get_native_fd().fd(), iov, 2, native_offset);
+  } while (res < 0 && errno == EINTR);
+  if (res < 0) {
+    return OS_ERROR(PSLICE() << "Preadv from " << fd.get_native_fd() << " at offset " << offset << " has failed");
+  }
+  total = static_cast<size_t>(res);
+#endif
+  // the rest is read only after a short read
+  if (total < first.size()) {
+    TRY_RESULT(s, pread_full(fd, first.substr(total), offset + total));
+    total += s;
+    if (total < first.size()) {
+      return total;
+    }
+  }
+  TRY_RESULT(s, pread_full(fd, second.substr(total - first.size()), offset + total));
+  return total + s;
+}
 }  // namespace
 
 Package::Package(td::FileFd fd) : fd_(std::move(fd)) {
@@ -89,34 +169,65 @@ td::uint64 Package::size() const {
 td::Result<std::pair<std::string, td::BufferSlice>> Package::read(td::uint64 offset) const {
   offset += header_size();
 
-  td::uint32 header[2];
-  TRY_RESULT(s1, fd_.pread(td::MutableSlice(reinterpret_cast<td::uint8*>(header), 8), offset));
-  if (s1 != 8) {
-    return td::Status::Error(ErrorCode::notready, "too short read");
-  }
-  if ((header[0] & 0xffff) != entry_header_magic()) {
-    return td::Status::Error(ErrorCode::notready,
-                             PSTRING() << "bad entry magic " << (header[0] & 0xffff) << " offset=" << offset);
-  }
+  // the index keeps only the offset of an entry, so the header, the filename and the beginning of the data
+  // are read at once; only entries with larger data or filenames need one more pread
+  char prefix_buf[entry_prefix_size()];
+  td::BufferSlice prefetch_buf{entry_prefetch_size()};
+  TRY_RESULT(s1, pread_full(fd_, td::MutableSlice(prefix_buf, sizeof(prefix_buf)), prefetch_buf.as_slice(), offset));
+  td::Slice prefix(prefix_buf, std::min<size_t>(s1, sizeof(prefix_buf)));
+  td::Slice prefetched = prefetch_buf.as_slice().substr(0, s1 - prefix.size());
+  TRY_RESULT(header, parse_entry_header(prefix, offset));
   offset += 8;
-  auto fname_size = header[0] >> 16;
-  auto data_size = header[1];
+  auto fname_size = header.fname_size;
+  auto data_size = header.data_size;
+  td::Slice rest = prefix.substr(8);
 
   std::string fname(fname_size, '\0');
-  TRY_RESULT(s2, fd_.pread(fname, offset));
-  if (s2 != fname_size) {
-    return td::Status::Error(ErrorCode::notready, "too short read (filename)");
+  if (rest.size() >= fname_size) {
+    td::MutableSlice(fname).copy_from(rest.substr(0, fname_size));
+    rest.remove_prefix(fname_size);
+  } else {
+    TRY_RESULT(s2, pread_full(fd_, fname, offset));
+    if (s2 != fname_size) {
+      return td::Status::Error(ErrorCode::notready, "too short read (filename)");
+    }
+    rest = td::Slice();
+    prefetched = td::Slice();
   }
   offset += fname_size;
 
   td::BufferSlice data{data_size};
-  TRY_RESULT(s3, fd_.pread(data.as_slice(), offset));
-  if (s3 != data_size) {
-    return td::Status::Error(ErrorCode::notready, "too short read (data)");
+  auto data_slice = data.as_slice();
+  for (auto part : {rest, prefetched}) {
+    auto size = std::min(part.size(), data_slice.size());
+    data_slice.copy_from(part.substr(0, size));
+    data_slice.remove_prefix(size);
+  }
+  if (!data_slice.empty()) {
+    auto have = data_size - data_slice.size();
+    TRY_RESULT(s3, pread_full(fd_, data_slice, offset + have));
+    if (s3 != data_slice.size()) {
+      return td::Status::Error(ErrorCode::notready, "too short read (data)");
+    }
   }
   return std::pair<std::string, td::BufferSlice>{std::move(fname), std::move(data)};
 }
 
+td::Result<td::BufferSlice> Package::read_raw(td::uint64 offset, td::uint64 limit) const {
+  TRY_RESULT(size, fd_.get_size());
+  td::uint64 file_size = size;
+  if (offset > file_size) {
+    return td::Status::Error(ErrorCode::notready, "offset is out of range");
+  }
+  limit = std::min(limit, file_size - offset);
+  td::BufferSlice data{static_cast<size_t>(limit)};
+  TRY_RESULT(s, pread_full(fd_, data.as_slice(), offset));
+  if (s != limit) {
+    return td::Status::Error(ErrorCode::notready, "too short read");
+  }
+  return std::move(data);
+}
+
 td::Result<td::uint64> Package::advance(td::uint64 offset) {
   offset += header_size();
 
@@ -187,11 +298,12 @@ void Package::iterate(std::function<bool(std::string, td::BufferSlice, td::uint6
       return;
     }
     auto q = R.move_as_ok();
-    if (!func(q.first, q.second.clone(), p)) {
+    auto next = p + 8 + q.first.size() + q.second.size();
+    if (!func(std::move(q.first), std::move(q.second), p)) {
       break;
     }
 
-    p = advance(p).move_as_ok();
+    p = next;
   }
 }
 
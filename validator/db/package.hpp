@@ -38,6 +38,8 @@ class Package {
   void sync();
   td::uint64 size() const;
   td::Result<std::pair<std::string, td::BufferSlice>> read(td::uint64 offset) const;
+  // reads up to limit raw bytes of the package file starting from the given file offset
+  td::Result<td::BufferSlice> read_raw(td::uint64 offset, td::uint64 limit) const;
 
   td::Result<td::uint64> advance(td::uint64 offset);
   void iterate(std::function<bool(std::string, td::BufferSlice, td::uint64)> func);
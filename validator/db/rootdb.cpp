@@ -276,6 +276,25 @@ void RootDb::store_persistent_state_file(BlockIdExt block_id, BlockIdExt masterc
                           std::move(state), std::move(promise));
 }
 
+void RootDb::store_persistent_state_file_gen(BlockIdExt block_id, BlockIdExt masterchain_block_id,
+                                             PersistentStateWriter write_data, td::Promise<td::Unit> promise) {
+  // the state is written with cells loaded from a snapshot of the cell db, so that they are not kept in memory
+  auto P = td::PromiseCreator::lambda([archive_db = archive_db_.get(), block_id, masterchain_block_id,
+                                       write_data = std::move(write_data), promise = std::move(promise)](
+                                          td::Result<vm::BagOfCells::LoadCell> R) mutable {
+    vm::BagOfCells::LoadCell load_cell;
+    if (R.is_ok()) {
+      load_cell = R.move_as_ok();
+    }
+    td::actor::send_closure(archive_db, &ArchiveManager::add_persistent_state_gen, block_id, masterchain_block_id,
+                            [write_data = std::move(write_data), load_cell = std::move(load_cell)](td::FileFd& fd) {
+                              return write_data(fd, load_cell);
+                            },
+                            std::move(promise));
+  });
+  td::actor::send_closure(cell_db_, &CellDb::get_cell_loader, std::move(P));
+}
+
 void RootDb::get_persistent_state_file(BlockIdExt block_id, BlockIdExt masterchain_block_id,
                                        td::Promise<td::BufferSlice> promise) {
   td::actor::send_closure(archive_db_, &ArchiveManager::get_persistent_state, block_id, masterchain_block_id,
@@ -389,7 +408,9 @@ void RootDb::start_up() {
   cell_db_ = td::actor::create_actor<CellDb>("celldb", actor_id(this), root_path_ + "/celldb/");
   state_db_ = td::actor::create_actor<StateDb>("statedb", actor_id(this), root_path_ + "/state/");
   static_files_db_ = td::actor::create_actor<StaticFilesDb>("staticfilesdb", actor_id(this), root_path_ + "/static/");
-  archive_db_ = td::actor::create_actor<ArchiveManager>("archive", actor_id(this), root_path_);
+  archive_db_ = td::actor::create_actor<ArchiveManager>("archive", actor_id(this), root_path_,
+                                                        opts_->get_max_open_archive_slices(),
+                                                        opts_->get_archive_index_memory());
 }
 
 void RootDb::archive(BlockHandle handle, td::Promise<td::Unit> promise) {
@@ -407,6 +428,8 @@ void RootDb::allow_block_gc(BlockIdExt block_id, td::Promise<bool> promise) {
 
 void RootDb::prepare_stats(td::Promise<std::vector<std::pair<std::string, std::string>>> promise) {
   auto merger = StatsMerger::create(std::move(promise));
+
+  td::actor::send_closure(cell_db_, &CellDb::prepare_stats, merger.make_promise("celldb."));
 }
 
 void RootDb::truncate(BlockSeqno seqno, ConstBlockHandle handle, td::Promise<td::Unit> promise) {
@@ -27,6 +27,7 @@
 #include "block/block.h"
 #include "block/transaction.h"
 #include "block/block-db.h"
+#include "td/utils/Timer.h"
 #include "block/output-queue-merger.h"
 #include "vm/cells/MerkleProof.h"
 #include "vm/cells/MerkleUpdate.h"
@@ -88,7 +89,8 @@ class Collator final : public td::actor::Actor {
  public:
   Collator(ShardIdFull shard, bool is_hardfork, td::uint32 min_ts, BlockIdExt min_masterchain_block_id,
            std::vector<BlockIdExt> prev, Ref<ValidatorSet> validator_set, Ed25519_PublicKey collator_id,
-           td::actor::ActorId<ValidatorManager> manager, td::Timestamp timeout, td::Promise<BlockCandidate> promise);
+           td::actor::ActorId<ValidatorManager> manager, td::Timestamp timeout, td::Promise<BlockCandidate> promise,
+           td::uint32 threads = 1);
   ~Collator() override = default;
   bool is_busy() const {
     return busy_;
@@ -108,6 +110,8 @@ class Collator final : public td::actor::Actor {
   void alarm() override;
   int verbosity{3 * 0};
   int verify{1};
+  td::uint32 threads_{1};
+  td::Timer timer_;
   ton::LogicalTime start_lt, max_lt;
   ton::UnixTime now_;
   ton::UnixTime prev_now_;
@@ -119,7 +123,7 @@ class Collator final : public td::actor::Actor {
   Ref<vm::Cell> mc_state_root;
   Ref<vm::Cell> mc_block_root;
   td::BitArray<256> rand_seed_;
-  std::unique_ptr<block::ConfigInfo> config_;
+  std::shared_ptr<const block::ConfigInfo> config_;
   std::unique_ptr<block::ShardConfig> shard_conf_;
   std::map<BlockSeqno, Ref<MasterchainStateQ>> aux_mc_states_;
   std::vector<block::McShardDescr> neighbors_;
@@ -188,10 +192,24 @@ class Collator final : public td::actor::Actor {
   std::unique_ptr<ton::BlockCandidate> block_candidate;
 
   td::PerfWarningTimer perf_timer_{"collate", 0.1};
+  // an ordinary transaction executed ahead of time against a private copy of its account
+  // (see run_prepared_transactions()); committed in message order, or dropped if sequential collation would not create it
+  struct PreparedTransaction {
+    Ref<vm::Cell> msg_root;
+    std::unique_ptr<block::Account> account;  // becomes the account state on commit
+    bool new_account{false};                  // not in `accounts` yet
+    bool external{false};
+    ton::LogicalTime trans_min_lt{0};
+    std::unique_ptr<block::Transaction> trans;
+    td::Status error;                  // reported only when this transaction is reached
+    vm::CellUsageTree::LoadLog loads;  // cells of the previous state loaded by account lookup and execution
+  };
+  static constexpr unsigned max_prepared_transactions = 256;
   //
   block::Account* lookup_account(td::ConstBitPtr addr) const;
   std::unique_ptr<block::Account> make_account_from(td::ConstBitPtr addr, Ref<vm::CellSlice> account,
                                                     Ref<vm::CellSlice> extra, bool force_create = false);
+  td::Result<std::unique_ptr<block::Account>> extract_account(td::ConstBitPtr addr, bool force_create);
   td::Result<block::Account*> make_account(td::ConstBitPtr addr, bool force_create = false);
   td::actor::ActorId<Collator> get_self() {
     return actor_id(this);
@@ -232,7 +250,14 @@ class Collator final : public td::actor::Actor {
                                   Ref<vm::Cell>& in_msg);
   bool create_ticktock_transactions(int mask);
   bool create_ticktock_transaction(const ton::StdSmcAddress& smc_addr, ton::LogicalTime req_start_lt, int mask);
-  Ref<vm::Cell> create_ordinary_transaction(Ref<vm::Cell> msg_root);
+  Ref<vm::Cell> create_ordinary_transaction(Ref<vm::Cell> msg_root, PreparedTransaction* prepared = nullptr);
+  td::Result<std::unique_ptr<block::Transaction>> run_ordinary_transaction(const block::Account& acc,
+                                                                            Ref<vm::Cell> msg_root, bool external,
+                                                                            ton::LogicalTime trans_min_lt) const;
+  bool get_ordinary_transaction_dest(Ref<vm::Cell> msg_root, ton::StdSmcAddress& addr, bool& external) const;
+  std::unique_ptr<PreparedTransaction> prepare_transaction(Ref<vm::Cell> msg_root, const ton::StdSmcAddress& addr,
+                                                          bool external);
+  void run_prepared_transactions(const std::vector<PreparedTransaction*>& batch);
   bool check_cur_validator_set();
   bool unpack_last_mc_state();
   bool unpack_last_state();
@@ -267,10 +292,11 @@ class Collator final : public td::actor::Actor {
   bool process_new_messages(bool enqueue_only = false);
   int process_one_new_message(block::NewOutMsg msg, bool enqueue_only = false, Ref<vm::Cell>* is_special = nullptr);
   bool process_inbound_internal_messages();
+  bool process_inbound_internal_messages_parallel();
   bool process_inbound_message(Ref<vm::CellSlice> msg, ton::LogicalTime lt, td::ConstBitPtr key,
-                               const block::McShardDescr& src_nb);
+                               const block::McShardDescr& src_nb, PreparedTransaction* prepared = nullptr);
   bool process_inbound_external_messages();
-  int process_external_message(Ref<vm::Cell> msg);
+  int process_external_message(Ref<vm::Cell> msg, PreparedTransaction* prepared = nullptr);
   bool enqueue_message(block::NewOutMsg msg, td::RefInt256 fwd_fees_remaining, ton::LogicalTime enqueued_lt);
   bool enqueue_transit_message(Ref<vm::Cell> msg, Ref<vm::Cell> old_msg_env, ton::AccountIdPrefixFull prev_prefix,
                                ton::AccountIdPrefixFull cur_prefix, ton::AccountIdPrefixFull dest_prefix,
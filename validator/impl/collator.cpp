@@ -34,7 +34,10 @@
 #include "validator-set.hpp"
 #include "top-shard-descr.hpp"
 #include <ctime>
+#include "td/utils/Metrics.h"
 #include "td/utils/Random.h"
+#include "td/utils/parallel_for.h"
+#include <set>
 
 namespace ton {
 
@@ -57,7 +60,7 @@ static inline bool dbg(int c) {
 Collator::Collator(ShardIdFull shard, bool is_hardfork, UnixTime min_ts, BlockIdExt min_masterchain_block_id,
                    std::vector<BlockIdExt> prev, td::Ref<ValidatorSet> validator_set, Ed25519_PublicKey collator_id,
                    td::actor::ActorId<ValidatorManager> manager, td::Timestamp timeout,
-                   td::Promise<BlockCandidate> promise)
+                   td::Promise<BlockCandidate> promise, td::uint32 threads)
     : shard_(shard)
     , is_hardfork_(is_hardfork)
     , min_ts(min_ts)
@@ -67,7 +70,8 @@ Collator::Collator(ShardIdFull shard, bool is_hardfork, UnixTime min_ts, BlockId
     , validator_set_(std::move(validator_set))
     , manager(manager)
     , timeout(timeout)
-    , main_promise(std::move(promise)) {
+    , main_promise(std::move(promise))
+    , threads_(std::max(threads, 1u)) {
 }
 
 void Collator::start_up() {
@@ -273,6 +277,8 @@ bool Collator::fatal_error(td::Status error) {
   error.ensure_error();
   LOG(ERROR) << "cannot generate block candidate for " << show_shard(shard_) << " : " << error.to_string();
   if (busy_) {
+    static auto &errors_metric = td::get_metric<td::MetricCounter>("collator_errors_total");
+    errors_metric.add();
     main_promise(std::move(error));
     busy_ = false;
   }
@@ -519,8 +525,8 @@ void Collator::after_get_shard_blocks(td::Result<std::vector<Ref<ShardTopBlockDe
 }
 
 bool Collator::unpack_last_mc_state() {
-  auto res = block::ConfigInfo::extract_config(
-      mc_state_root,
+  auto res = block::ConfigInfoCache::get_default().extract_config(
+      mc_state_root, mc_block_id_,
       block::ConfigInfo::needShardHashes | block::ConfigInfo::needLibraries | block::ConfigInfo::needValidatorSet |
           block::ConfigInfo::needWorkchainInfo | block::ConfigInfo::needCapabilities |
           (is_masterchain() ? block::ConfigInfo::needAccountsRoot | block::ConfigInfo::needSpecialSmc : 0));
@@ -531,7 +537,6 @@ bool Collator::unpack_last_mc_state() {
   }
   config_ = res.move_as_ok();
   CHECK(config_);
-  config_->set_block_id_ext(mc_block_id_);
   global_id_ = config_->get_global_blockchain_id();
   ihr_enabled_ = config_->ihr_enabled();
   create_stats_enabled_ = config_->create_stats_enabled();
@@ -1939,11 +1944,8 @@ block::Account* Collator::lookup_account(td::ConstBitPtr addr) const {
   return found != accounts.end() ? found->second.get() : nullptr;
 }
 
-td::Result<block::Account*> Collator::make_account(td::ConstBitPtr addr, bool force_create) {
-  auto found = lookup_account(addr);
-  if (found) {
-    return found;
-  }
+// loads an account from the previous state without registering it in `accounts`
+td::Result<std::unique_ptr<block::Account>> Collator::extract_account(td::ConstBitPtr addr, bool force_create) {
   auto dict_entry = account_dict->lookup_extra(addr, 256);
   if (dict_entry.first.is_null()) {
     if (!force_create) {
@@ -1958,6 +1960,18 @@ td::Result<block::Account*> Collator::make_account(td::ConstBitPtr addr, bool fo
     return td::Status::Error(PSTRING() << "account " << addr.to_hex(256) << " does not really belong to current shard "
                                        << shard_.to_str());
   }
+  return std::move(new_acc);
+}
+
+td::Result<block::Account*> Collator::make_account(td::ConstBitPtr addr, bool force_create) {
+  auto found = lookup_account(addr);
+  if (found) {
+    return found;
+  }
+  TRY_RESULT(new_acc, extract_account(addr, force_create));
+  if (!new_acc) {
+    return nullptr;
+  }
   auto ins = accounts.emplace(addr, std::move(new_acc));
   if (!ins.second) {
     return td::Status::Error(PSTRING() << "cannot insert newly-extracted account " << addr.to_hex(256)
@@ -2177,7 +2191,7 @@ bool Collator::create_ticktock_transaction(const ton::StdSmcAddress& smc_addr, t
   return true;
 }
 
-Ref<vm::Cell> Collator::create_ordinary_transaction(Ref<vm::Cell> msg_root) {
+Ref<vm::Cell> Collator::create_ordinary_transaction(Ref<vm::Cell> msg_root, PreparedTransaction* prepared) {
   ton::StdSmcAddress addr;
   auto cs = vm::load_cell_slice(msg_root);
   bool external;
@@ -2213,98 +2227,220 @@ Ref<vm::Cell> Collator::create_ordinary_transaction(Ref<vm::Cell> msg_root) {
     return {};
   }
   LOG(DEBUG) << "inbound message to our smart contract " << addr.to_hex();
-  auto acc_res = make_account(addr.cbits(), true);
-  if (acc_res.is_error()) {
-    fatal_error(acc_res.move_as_error());
+  block::Account* acc;
+  std::unique_ptr<block::Transaction> trans;
+  if (prepared) {
+    // the transaction has already been executed on a private copy of the account
+    CHECK(prepared->msg_root->get_hash() == msg_root->get_hash());
+    state_usage_tree_->apply(prepared->loads);
+    if (prepared->error.is_error()) {
+      fatal_error(std::move(prepared->error));
+      return {};
+    }
+    acc = prepared->account.get();
+    trans = std::move(prepared->trans);
+    if (prepared->new_account) {
+      CHECK(accounts.emplace(addr, std::move(prepared->account)).second);
+    } else if (trans) {
+      accounts[addr] = std::move(prepared->account);
+    }
+  } else {
+    auto acc_res = make_account(addr.cbits(), true);
+    if (acc_res.is_error()) {
+      fatal_error(acc_res.move_as_error());
+      return {};
+    }
+    acc = acc_res.move_as_ok();
+    assert(acc);
+    if (acc->last_trans_end_lt_ >= start_lt && acc->transactions.empty()) {
+      fatal_error(PSTRING() << "last transaction time in the state of account " << workchain() << ":" << addr.to_hex()
+                            << " is too large");
+      return {};
+    }
+    auto trans_min_lt = start_lt;
+    if (external) {
+      // transactions processing external messages must have lt larger than all processed internal messages
+      trans_min_lt = std::max(trans_min_lt, last_proc_int_msg_.first);
+    }
+    auto trans_res = run_ordinary_transaction(*acc, msg_root, external, trans_min_lt);
+    if (trans_res.is_error()) {
+      fatal_error(trans_res.move_as_error());
+      return {};
+    }
+    trans = trans_res.move_as_ok();
+  }
+  if (!trans) {
+    // inbound external message was not accepted
     return {};
   }
-  block::Account* acc = acc_res.move_as_ok();
-  assert(acc);
-  if (acc->last_trans_end_lt_ >= start_lt && acc->transactions.empty()) {
-    fatal_error(PSTRING() << "last transaction time in the state of account " << workchain() << ":" << addr.to_hex()
-                          << " is too large");
+  if (!trans->update_limits(*block_limit_status_)) {
+    fatal_error("cannot update block limit status to include the new transaction");
     return {};
   }
-  auto trans_min_lt = start_lt;
-  if (external) {
-    // transactions processing external messages must have lt larger than all processed internal messages
-    trans_min_lt = std::max(trans_min_lt, last_proc_int_msg_.first);
+  auto trans_root = trans->commit(*acc);
+  if (trans_root.is_null()) {
+    fatal_error("cannot commit new transaction for smart contract "s + addr.to_hex());
+    return {};
   }
+  register_new_msgs(*trans);
+  update_max_lt(acc->last_trans_end_lt_);
+  // temporary patch to stop producing dangerous block
+  if (acc->status == block::Account::acc_nonexist) {
+    block_full_ = true;
+  }
+  return trans_root;
+}
+
+// executes all phases of an ordinary transaction without committing it, so it may be called on any thread
+// returns nullptr if an inbound external message is not accepted
+td::Result<std::unique_ptr<block::Transaction>> Collator::run_ordinary_transaction(const block::Account& acc,
+                                                                                     Ref<vm::Cell> msg_root,
+                                                                                     bool external,
+                                                                                     ton::LogicalTime trans_min_lt) const {
+  auto addr = acc.addr.to_hex();
   std::unique_ptr<block::Transaction> trans =
-      std::make_unique<block::Transaction>(*acc, block::Transaction::tr_ord, trans_min_lt + 1, now_, msg_root);
+      std::make_unique<block::Transaction>(acc, block::Transaction::tr_ord, trans_min_lt + 1, now_, msg_root);
   bool ihr_delivered = false;  // FIXME
   if (!trans->unpack_input_msg(ihr_delivered, &action_phase_cfg_)) {
     if (external) {
       // inbound external message was not accepted
-      LOG(DEBUG) << "inbound external message rejected by account " << addr.to_hex()
-                 << " before smart-contract execution";
-      return {};
+      LOG(DEBUG) << "inbound external message rejected by account " << addr << " before smart-contract execution";
+      return nullptr;
     }
-    fatal_error("cannot unpack input message for a new transaction");
-    return {};
+    return td::Status::Error(-666, "cannot unpack input message for a new transaction");
   }
   if (trans->bounce_enabled) {
     if (!trans->prepare_storage_phase(storage_phase_cfg_, true)) {
-      fatal_error("cannot create storage phase of a new transaction for smart contract "s + addr.to_hex());
-      return {};
+      return td::Status::Error(-666, "cannot create storage phase of a new transaction for smart contract "s + addr);
     }
     if (!external && !trans->prepare_credit_phase()) {
-      fatal_error("cannot create credit phase of a new transaction for smart contract "s + addr.to_hex());
-      return {};
+      return td::Status::Error(-666, "cannot create credit phase of a new transaction for smart contract "s + addr);
     }
   } else {
     if (!external && !trans->prepare_credit_phase()) {
-      fatal_error("cannot create credit phase of a new transaction for smart contract "s + addr.to_hex());
-      return {};
+      return td::Status::Error(-666, "cannot create credit phase of a new transaction for smart contract "s + addr);
     }
     if (!trans->prepare_storage_phase(storage_phase_cfg_, true, true)) {
-      fatal_error("cannot create storage phase of a new transaction for smart contract "s + addr.to_hex());
-      return {};
+      return td::Status::Error(-666, "cannot create storage phase of a new transaction for smart contract "s + addr);
     }
   }
   if (!trans->prepare_compute_phase(compute_phase_cfg_)) {
-    fatal_error("cannot create compute phase of a new transaction for smart contract "s + addr.to_hex());
-    return {};
+    return td::Status::Error(-666, "cannot create compute phase of a new transaction for smart contract "s + addr);
   }
   if (!trans->compute_phase->accepted) {
     if (external) {
       // inbound external message was not accepted
-      LOG(DEBUG) << "inbound external message rejected by transaction " << addr.to_hex();
-      return {};
+      LOG(DEBUG) << "inbound external message rejected by transaction " << addr;
+      return nullptr;
     } else if (trans->compute_phase->skip_reason == block::ComputePhase::sk_none) {
-      fatal_error("new ordinary transaction for smart contract "s + addr.to_hex() +
-                  " has not been accepted by the smart contract (?)");
-      return {};
+      return td::Status::Error(-666, "new ordinary transaction for smart contract "s + addr +
+                                         " has not been accepted by the smart contract (?)");
     }
   }
   if (trans->compute_phase->success && !trans->prepare_action_phase(action_phase_cfg_)) {
-    fatal_error("cannot create action phase of a new transaction for smart contract "s + addr.to_hex());
-    return {};
+    return td::Status::Error(-666, "cannot create action phase of a new transaction for smart contract "s + addr);
   }
   if (trans->bounce_enabled && !trans->compute_phase->success && !trans->prepare_bounce_phase(action_phase_cfg_)) {
-    fatal_error("cannot create bounce phase of a new transaction for smart contract "s + addr.to_hex());
-    return {};
+    return td::Status::Error(-666, "cannot create bounce phase of a new transaction for smart contract "s + addr);
   }
   if (!trans->serialize()) {
-    fatal_error("cannot serialize new transaction for smart contract "s + addr.to_hex());
-    return {};
+    return td::Status::Error(-666, "cannot serialize new transaction for smart contract "s + addr);
   }
-  if (!trans->update_limits(*block_limit_status_)) {
-    fatal_error("cannot update block limit status to include the new transaction");
-    return {};
+  return std::move(trans);
+}
+
+// extracts the destination of a message to be processed by an ordinary transaction in our workchain
+bool Collator::get_ordinary_transaction_dest(Ref<vm::Cell> msg_root, ton::StdSmcAddress& addr, bool& external) const {
+  auto cs = vm::load_cell_slice(msg_root);
+  Ref<vm::CellSlice> dest;
+  switch (block::gen::t_CommonMsgInfo.get_tag(cs)) {
+    case block::gen::CommonMsgInfo::ext_in_msg_info: {
+      block::gen::CommonMsgInfo::Record_ext_in_msg_info info;
+      if (!tlb::unpack(cs, info)) {
+        return false;
+      }
+      dest = std::move(info.dest);
+      external = true;
+      break;
+    }
+    case block::gen::CommonMsgInfo::int_msg_info: {
+      block::gen::CommonMsgInfo::Record_int_msg_info info;
+      if (!tlb::unpack(cs, info)) {
+        return false;
+      }
+      dest = std::move(info.dest);
+      external = false;
+      break;
+    }
+    default:
+      return false;
   }
-  auto trans_root = trans->commit(*acc);
-  if (trans_root.is_null()) {
-    fatal_error("cannot commit new transaction for smart contract "s + addr.to_hex());
-    return {};
+  ton::WorkchainId wc;
+  return block::tlb::t_MsgAddressInt.extract_std_address(dest, wc, addr) && wc == workchain() &&
+         is_our_address(addr);
+}
+
+// looks up (or creates) the destination account of a message and copies it for run_prepared_transactions()
+// the loads made meanwhile are recorded, since sequential collation makes them only when it gets to this message
+std::unique_ptr<Collator::PreparedTransaction> Collator::prepare_transaction(Ref<vm::Cell> msg_root,
+                                                                             const ton::StdSmcAddress& addr,
+                                                                             bool external) {
+  auto prepared = std::make_unique<PreparedTransaction>();
+  prepared->msg_root = std::move(msg_root);
+  prepared->external = external;
+  prepared->trans_min_lt = start_lt;
+  if (external) {
+    prepared->trans_min_lt = std::max(start_lt, last_proc_int_msg_.first);
   }
-  register_new_msgs(*trans);
-  update_max_lt(acc->last_trans_end_lt_);
-  // temporary patch to stop producing dangerous block
-  if (acc->status == block::Account::acc_nonexist) {
-    block_full_ = true;
+  vm::CellUsageTree::LoadRecorder recorder{state_usage_tree_.get(), prepared->loads};
+  auto acc = lookup_account(addr.cbits());
+  if (acc) {
+    prepared->account = std::make_unique<block::Account>(*acc);
+  } else {
+    auto acc_res = extract_account(addr.cbits(), true);
+    if (acc_res.is_error()) {
+      prepared->error = acc_res.move_as_error();
+      return prepared;
+    }
+    prepared->account = acc_res.move_as_ok();
+    prepared->new_account = true;
   }
-  return trans_root;
+  if (prepared->account->last_trans_end_lt_ >= start_lt && prepared->account->transactions.empty()) {
+    prepared->error = td::Status::Error(-666, PSTRING() << "last transaction time in the state of account "
+                                                        << workchain() << ":" << addr.to_hex() << " is too large");
+  }
+  return prepared;
+}
+
+// executes prepared transactions (on distinct accounts) on up to threads_ threads
+void Collator::run_prepared_transactions(const std::vector<PreparedTransaction*>& batch) {
+  td::parallel_for(batch.size(), static_cast<int>(threads_), [&](std::size_t i) {
+    auto& prepared = *batch[i];
+    if (prepared.error.is_error()) {
+      return;
+    }
+    vm::CellUsageTree::LoadRecorder recorder{state_usage_tree_.get(), prepared.loads};
+    try {
+      auto trans_res =
+          run_ordinary_transaction(*prepared.account, prepared.msg_root, prepared.external, prepared.trans_min_lt);
+      if (trans_res.is_error()) {
+        prepared.error = trans_res.move_as_error();
+      } else {
+        prepared.trans = trans_res.move_as_ok();
+      }
+    } catch (vm::VmError vme) {
+      prepared.error = td::Status::Error(PSLICE() << vme.get_msg());
+    } catch (vm::VmVirtError err) {
+      prepared.error = err.as_status();
+    } catch (vm::VmFatal) {
+      prepared.error = td::Status::Error("fatal error while running transaction");
+    } catch (std::exception& e) {
+      prepared.error = td::Status::Error(PSLICE() << "exception while running transaction: " << e.what());
+    } catch (...) {
+      // an exception escaping a worker thread would take down the whole collator; report it as a failed transaction
+      prepared.error = td::Status::Error("unknown exception while running transaction");
+    }
+  });
 }
 
 void Collator::update_max_lt(ton::LogicalTime lt) {
@@ -2556,7 +2692,7 @@ bool Collator::delete_out_msg_queue_msg(td::ConstBitPtr key) {
 }
 
 bool Collator::process_inbound_message(Ref<vm::CellSlice> enq_msg, ton::LogicalTime lt, td::ConstBitPtr key,
-                                       const block::McShardDescr& src_nb) {
+                                       const block::McShardDescr& src_nb, PreparedTransaction* prepared) {
   ton::LogicalTime enqueued_lt = 0;
   if (enq_msg.is_null() || enq_msg->size_ext() != 0x10040 ||
       (enqueued_lt = enq_msg->prefetch_ulong(64)) < /* 0 */ 1 * lt) {  // DEBUG
@@ -2686,7 +2822,7 @@ bool Collator::process_inbound_message(Ref<vm::CellSlice> enq_msg, ton::LogicalT
   // process the message by an ordinary transaction similarly to process_one_new_message()
   //
   // 8. create a Transaction processing this Message
-  auto trans_root = create_ordinary_transaction(env.msg);
+  auto trans_root = create_ordinary_transaction(env.msg, prepared);
   if (trans_root.is_null()) {
     return fatal_error("cannot create transaction for processing inbound message");
   }
@@ -2720,6 +2856,9 @@ bool Collator::process_inbound_message(Ref<vm::CellSlice> enq_msg, ton::LogicalT
 }
 
 bool Collator::process_inbound_internal_messages() {
+  if (threads_ > 1) {
+    return process_inbound_internal_messages_parallel();
+  }
   while (!block_full_ && !nb_out_msgs_->is_eof()) {
     block_full_ = !block_limit_status_->fits(block::ParamLimits::cl_normal);
     if (block_full_) {
@@ -2748,20 +2887,129 @@ bool Collator::process_inbound_internal_messages() {
   return true;
 }
 
+// Same as process_inbound_internal_messages(), but the transactions for a run of messages to distinct accounts
+// are executed on several threads first, then the messages are processed in order as usual.
+// Reading ahead in the neighbors' queues and executing transactions load cells of the previous state;
+// these loads are recorded and applied only when sequential collation would make them, so that
+// the Merkle update of the state (and the whole block) does not depend on the number of threads.
+bool Collator::process_inbound_internal_messages_parallel() {
+  struct Entry {
+    std::unique_ptr<block::OutputQueueMerger::MsgKeyValue> kv;
+    std::unique_ptr<PreparedTransaction> prepared;
+    vm::CellUsageTree::LoadLog fetch_loads, next_loads;
+  };
+  std::vector<Entry> window;
+  std::size_t pos = 0;
+  while (!block_full_) {
+    if (pos == window.size()) {
+      window.clear();
+      pos = 0;
+      std::set<ton::StdSmcAddress> window_accounts;
+      std::vector<PreparedTransaction*> batch;
+      while (window.size() < max_prepared_transactions && !nb_out_msgs_->is_eof()) {
+        window.emplace_back();
+        auto& entry = window.back();
+        bool last = false;
+        {
+          vm::CellUsageTree::LoadRecorder recorder{state_usage_tree_.get(), entry.fetch_loads};
+          entry.kv = nb_out_msgs_->extract_cur();
+          CHECK(entry.kv && entry.kv->msg.not_null());
+          auto msg_env = entry.kv->msg->prefetch_ref();
+          block::tlb::MsgEnvelope::Record_std env;
+          ton::StdSmcAddress addr;
+          bool external;
+          if (msg_env.not_null() && tlb::unpack_cell(msg_env, env) &&
+              get_ordinary_transaction_dest(env.msg, addr, external) && !external) {
+            if (window_accounts.insert(addr).second) {
+              entry.prepared = prepare_transaction(std::move(env.msg), addr, false);
+              batch.push_back(entry.prepared.get());
+            } else {
+              // depends on the outcome of an earlier message in this window
+              last = true;
+            }
+          }
+        }
+        {
+          vm::CellUsageTree::LoadRecorder recorder{state_usage_tree_.get(), entry.next_loads};
+          nb_out_msgs_->next();
+        }
+        if (last) {
+          break;
+        }
+      }
+      if (window.empty()) {
+        break;
+      }
+      run_prepared_transactions(batch);
+    }
+    block_full_ = !block_limit_status_->fits(block::ParamLimits::cl_normal);
+    if (block_full_) {
+      LOG(INFO) << "BLOCK FULL, stop processing inbound internal messages";
+      break;
+    }
+    auto& entry = window[pos++];
+    state_usage_tree_->apply(entry.fetch_loads);
+    auto& kv = entry.kv;
+    LOG(DEBUG) << "processing inbound message with (lt,hash)=(" << kv->lt << "," << kv->key.to_hex()
+               << ") from neighbor #" << kv->source;
+    if (verbosity > 2) {
+      std::cerr << "inbound message: lt=" << kv->lt << " from=" << kv->source << " key=" << kv->key.to_hex() << " msg=";
+      block::gen::t_EnqueuedMsg.print(std::cerr, *(kv->msg));
+    }
+    if (!process_inbound_message(kv->msg, kv->lt, kv->key.cbits(), neighbors_.at(kv->source), entry.prepared.get())) {
+      if (verbosity > 1) {
+        std::cerr << "invalid inbound message: lt=" << kv->lt << " from=" << kv->source << " key=" << kv->key.to_hex()
+                  << " msg=";
+        block::gen::t_EnqueuedMsg.print(std::cerr, *(kv->msg));
+      }
+      return fatal_error("error processing inbound internal message");
+    }
+    state_usage_tree_->apply(entry.next_loads);
+  }
+  inbound_queues_empty_ = pos == window.size() && nb_out_msgs_->is_eof();
+  return true;
+}
+
 bool Collator::process_inbound_external_messages() {
   if (skip_extmsg_) {
     LOG(INFO) << "skipping processing of inbound external messages";
     return true;
   }
   bool full = !block_limit_status_->fits(block::ParamLimits::cl_soft);
-  for (auto& ext_msg_pair : ext_msg_list_) {
+  // with several threads, transactions for runs of messages to distinct accounts are executed in advance
+  std::vector<std::unique_ptr<PreparedTransaction>> prepared;
+  std::size_t prepared_from = 0;
+  for (std::size_t i = 0; i < ext_msg_list_.size(); i++) {
+    auto& ext_msg_pair = ext_msg_list_[i];
     if (full) {
       LOG(INFO) << "BLOCK FULL, stop processing external messages";
       break;
     }
+    if (threads_ > 1 && i == prepared_from + prepared.size()) {
+      prepared.clear();
+      prepared_from = i;
+      std::set<ton::StdSmcAddress> batch_accounts;
+      std::vector<PreparedTransaction*> batch;
+      for (std::size_t j = i; j < ext_msg_list_.size() && prepared.size() < max_prepared_transactions; j++) {
+        ton::StdSmcAddress addr;
+        bool external;
+        if (!get_ordinary_transaction_dest(ext_msg_list_[j].first, addr, external) || !external) {
+          prepared.emplace_back();
+          continue;
+        }
+        if (!batch_accounts.insert(addr).second) {
+          // depends on the outcome of an earlier message in this run
+          prepared.emplace_back();
+          break;
+        }
+        prepared.push_back(prepare_transaction(ext_msg_list_[j].first, addr, true));
+        batch.push_back(prepared.back().get());
+      }
+      run_prepared_transactions(batch);
+    }
     auto ext_msg = ext_msg_pair.first;
     ton::Bits256 hash{ext_msg->get_hash().bits()};
-    int r = process_external_message(std::move(ext_msg));
+    int r = process_external_message(std::move(ext_msg), threads_ > 1 ? prepared[i - prepared_from].get() : nullptr);
     if (r < 0) {
       bad_ext_msgs_.emplace_back(ext_msg_pair.second);
       return false;
@@ -2783,7 +3031,7 @@ bool Collator::process_inbound_external_messages() {
 }
 
 // 1 = processed, 0 = skipped, 3 = processed, all future messages must be skipped (block overflown)
-int Collator::process_external_message(Ref<vm::Cell> msg) {
+int Collator::process_external_message(Ref<vm::Cell> msg, PreparedTransaction* prepared) {
   auto cs = load_cell_slice(msg);
   td::RefInt256 fwd_fees;
   block::gen::CommonMsgInfo::Record_ext_in_msg_info info;
@@ -2795,7 +3043,7 @@ int Collator::process_external_message(Ref<vm::Cell> msg) {
   }
   // process message by a transaction in this block:
   // 1. create a Transaction processing this Message
-  auto trans_root = create_ordinary_transaction(msg);
+  auto trans_root = create_ordinary_transaction(msg, prepared);
   if (trans_root.is_null()) {
     if (busy_) {
       // transaction rejected by account
@@ -3996,6 +4244,10 @@ void Collator::return_block_candidate(td::Result<td::Unit> saved) {
   } else {
     CHECK(block_candidate);
     LOG(INFO) << "sending new BlockCandidate to Promise";
+    static auto &collate_metric = td::get_metric<td::MetricHistogram>("collator_collate_us");
+    static auto &blocks_metric = td::get_metric<td::MetricCounter>("collator_blocks_total");
+    collate_metric.record_duration(timer_.elapsed());
+    blocks_metric.add();
     main_promise(block_candidate->clone());
     busy_ = false;
     stop();
@@ -0,0 +1,78 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "liteserver-answers.hpp"
+
+namespace ton {
+
+namespace validator {
+
+bool LiteServerAnswers::get(const td::Bits256 &key, td::BufferSlice &value) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  auto entry = it->second.get();
+  entry->remove();
+  lru_.put(entry);
+  value = entry->value.clone();
+  return true;
+}
+
+void LiteServerAnswers::store(const td::Bits256 &key, bool last_block, BlockSeqno seqno, td::BufferSlice value) {
+  auto entry = std::make_unique<Entry>();
+  entry->key = key;
+  entry->value = std::move(value);
+  entry->seqno = seqno;
+  entry->last_block = last_block;
+  if (entry->size() > max_bytes_) {
+    return;
+  }
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    erase(it->second.get());
+  }
+  total_bytes_ += entry->size();
+  lru_.put(entry.get());
+  entries_[key] = std::move(entry);
+  while (total_bytes_ > max_bytes_) {
+    auto oldest = Entry::from_list_node(lru_.get());
+    CHECK(oldest);
+    erase(oldest);
+  }
+}
+
+void LiteServerAnswers::erase(Entry *entry) {
+  total_bytes_ -= entry->size();
+  auto key = entry->key;
+  entries_.erase(key);
+}
+
+void LiteServerAnswers::new_masterchain_block(BlockSeqno seqno) {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    auto &entry = *it->second;
+    if (entry.last_block || entry.seqno + keep_masterchain_blocks_ <= seqno) {
+      total_bytes_ -= entry.size();
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace validator
+
+}  // namespace ton
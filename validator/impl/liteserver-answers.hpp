@@ -0,0 +1,82 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "ton/ton-types.h"
+#include "td/utils/buffer.h"
+#include "td/utils/List.h"
+
+#include <map>
+#include <memory>
+
+namespace ton {
+
+namespace validator {
+
+/*
+ * serialized liteserver answers kept by LiteServerCacheImpl, keyed by the hash of the serialized query
+ *
+ * every answer remembers the masterchain block it was computed for; answers that depend on the last masterchain
+ * block are dropped by the next one, other answers expire after a few masterchain blocks;
+ * least recently used answers are evicted when the byte budget is exceeded
+ */
+class LiteServerAnswers {
+ public:
+  LiteServerAnswers(std::size_t max_bytes, BlockSeqno keep_masterchain_blocks)
+      : max_bytes_(max_bytes), keep_masterchain_blocks_(keep_masterchain_blocks) {
+  }
+
+  // returns false if there is no answer; a found answer becomes the most recently used one
+  bool get(const td::Bits256 &key, td::BufferSlice &value);
+  void store(const td::Bits256 &key, bool last_block, BlockSeqno seqno, td::BufferSlice value);
+  // drops answers that expire at masterchain block seqno
+  void new_masterchain_block(BlockSeqno seqno);
+
+  std::size_t size() const {
+    return entries_.size();
+  }
+  std::size_t bytes() const {
+    return total_bytes_;
+  }
+
+ private:
+  struct Entry : public td::ListNode {
+    td::Bits256 key;
+    td::BufferSlice value;
+    BlockSeqno seqno;
+    bool last_block;
+
+    std::size_t size() const {
+      return sizeof(Entry) + value.size();
+    }
+    static Entry *from_list_node(td::ListNode *node) {
+      return static_cast<Entry *>(node);
+    }
+  };
+
+  void erase(Entry *entry);
+
+  std::size_t max_bytes_;
+  BlockSeqno keep_masterchain_blocks_;
+  std::size_t total_bytes_{0};
+  std::map<td::Bits256, std::unique_ptr<Entry>> entries_;
+  td::ListNode lru_;
+};
+
+}  // namespace validator
+
+}  // namespace ton
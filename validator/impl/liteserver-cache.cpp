@@ -0,0 +1,193 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#include "liteserver-cache.hpp"
+#include "liteserver.hpp"
+#include "auto/tl/lite_api.h"
+#include "common/checksum.h"
+
+namespace ton {
+
+namespace validator {
+
+LiteServerCacheImpl::QueryKind LiteServerCacheImpl::get_query_kind(td::Slice data) {
+  if (data.size() < 4) {
+    return QueryKind::not_cached;
+  }
+  switch (td::as<td::int32>(data.data())) {
+    case lite_api::liteServer_getMasterchainInfo::ID:
+    case lite_api::liteServer_getBlockProof::ID:
+      return QueryKind::last_block;
+    case lite_api::liteServer_getAccountState::ID:
+    case lite_api::liteServer_getConfigAll::ID:
+    case lite_api::liteServer_getConfigParams::ID:
+    case lite_api::liteServer_getShardInfo::ID:
+    case lite_api::liteServer_runSmcMethod::ID:
+      return QueryKind::given_block;
+    default:
+      return QueryKind::not_cached;
+  }
+}
+
+void LiteServerCacheImpl::run_query(td::BufferSlice data, td::Promise<td::BufferSlice> promise) {
+  auto kind = get_query_kind(data.as_slice());
+  if (kind == QueryKind::not_cached) {
+    LiteQuery::run_query(std::move(data), manager_, actor_id(this), std::move(promise));
+    return;
+  }
+  auto key = td::sha256_bits256(data.as_slice());
+  td::BufferSlice answer;
+  if (answers_.get(key, answer)) {
+    hits_++;
+    promise.set_value(std::move(answer));
+    return;
+  }
+  misses_++;
+  auto &waiters = pending_[key];
+  waiters.push_back(std::move(promise));
+  if (waiters.size() > 1) {
+    return;
+  }
+  auto P = td::PromiseCreator::lambda([SelfId = actor_id(this), key, last_block = kind == QueryKind::last_block,
+                                       seqno = last_masterchain_seqno_](td::Result<td::BufferSlice> R) {
+    td::actor::send_closure(SelfId, &LiteServerCacheImpl::got_answer, key, last_block, seqno, std::move(R));
+  });
+  LiteQuery::run_query(std::move(data), manager_, actor_id(this), std::move(P));
+}
+
+void LiteServerCacheImpl::got_answer(td::Bits256 key, bool last_block, BlockSeqno seqno,
+                                     td::Result<td::BufferSlice> R) {
+  auto it = pending_.find(key);
+  CHECK(it != pending_.end());
+  auto waiters = std::move(it->second);
+  pending_.erase(it);
+  if (R.is_error()) {
+    auto S = R.move_as_error();
+    for (auto &promise : waiters) {
+      promise.set_error(S.clone());
+    }
+    return;
+  }
+  auto value = R.move_as_ok();
+  for (auto &promise : waiters) {
+    promise.set_value(value.clone());
+  }
+  // the answer could have been computed for a newer masterchain block than the one it would be kept for
+  if (seqno == last_masterchain_seqno_) {
+    answers_.store(key, last_block, seqno, std::move(value));
+  }
+}
+
+void LiteServerCacheImpl::new_masterchain_block(BlockSeqno seqno) {
+  if (seqno <= last_masterchain_seqno_) {
+    return;
+  }
+  last_masterchain_seqno_ = seqno;
+  answers_.new_masterchain_block(seqno);
+  for (auto it = contexts_.begin(); it != contexts_.end();) {
+    if (it->second.waiters.empty() && it->second.seqno + keep_masterchain_blocks <= seqno) {
+      it = contexts_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  LOG(DEBUG) << "liteserver cache: " << answers_.size() << " answers (" << answers_.bytes()
+             << " bytes) after masterchain block " << seqno << ", " << hits_ << " hits, " << misses_ << " misses";
+}
+
+void LiteServerCacheImpl::get_block_context(BlockIdExt block_id,
+                                            td::Promise<td::Ref<LiteServerBlockContext>> promise) {
+  auto it = contexts_.find(block_id);
+  if (it != contexts_.end() && it->second.context.not_null()) {
+    promise.set_value(td::Ref<LiteServerBlockContext>{it->second.context});
+    return;
+  }
+  if (it == contexts_.end()) {
+    it = contexts_.emplace(block_id, BlockContext{}).first;
+  }
+  auto &entry = it->second;
+  entry.seqno = last_masterchain_seqno_;
+  entry.waiters.push_back(std::move(promise));
+  if (entry.waiters.size() > 1) {
+    return;
+  }
+  td::actor::send_closure(manager_, &ValidatorManager::get_block_data_from_db_short, block_id,
+                          [SelfId = actor_id(this), block_id](td::Result<td::Ref<BlockData>> R) {
+                            td::actor::send_closure(SelfId, &LiteServerCacheImpl::got_context_block, block_id,
+                                                    std::move(R));
+                          });
+}
+
+void LiteServerCacheImpl::got_context_block(BlockIdExt block_id, td::Result<td::Ref<BlockData>> R) {
+  if (R.is_error()) {
+    failed_block_context(block_id, R.move_as_error());
+    return;
+  }
+  auto it = contexts_.find(block_id);
+  CHECK(it != contexts_.end());
+  it->second.block = R.move_as_ok();
+  td::actor::send_closure(manager_, &ValidatorManager::get_shard_state_from_db_short, block_id,
+                          [SelfId = actor_id(this), block_id](td::Result<td::Ref<ShardState>> R) {
+                            td::actor::send_closure(SelfId, &LiteServerCacheImpl::got_context_state, block_id,
+                                                    std::move(R));
+                          });
+}
+
+void LiteServerCacheImpl::got_context_state(BlockIdExt block_id, td::Result<td::Ref<ShardState>> R) {
+  if (R.is_error()) {
+    failed_block_context(block_id, R.move_as_error());
+    return;
+  }
+  auto it = contexts_.find(block_id);
+  CHECK(it != contexts_.end());
+  auto &entry = it->second;
+  auto context = td::make_ref<LiteServerBlockContext>();
+  auto &ctx = context.write();
+  ctx.block_id = block_id;
+  ctx.block = std::move(entry.block);
+  ctx.state = R.move_as_ok();
+  auto proof = LiteQuery::build_state_root_proof(ctx.state->root_cell(), ctx.block->root_cell(), block_id);
+  if (proof.is_error()) {
+    failed_block_context(block_id, proof.move_as_error());
+    return;
+  }
+  ctx.state_root_proof = proof.move_as_ok();
+  auto waiters = std::move(entry.waiters);
+  if (contexts_.size() <= max_block_contexts) {
+    entry.context = context;
+  } else {
+    contexts_.erase(it);
+  }
+  for (auto &promise : waiters) {
+    promise.set_value(td::Ref<LiteServerBlockContext>{context});
+  }
+}
+
+void LiteServerCacheImpl::failed_block_context(BlockIdExt block_id, td::Status error) {
+  auto it = contexts_.find(block_id);
+  CHECK(it != contexts_.end());
+  auto waiters = std::move(it->second.waiters);
+  contexts_.erase(it);
+  for (auto &promise : waiters) {
+    promise.set_error(error.clone());
+  }
+}
+
+}  // namespace validator
+
+}  // namespace ton
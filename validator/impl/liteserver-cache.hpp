@@ -0,0 +1,86 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright 2017-2020 Telegram Systems LLP
+*/
+#pragma once
+
+#include "interfaces/liteserver.h"
+#include "interfaces/validator-manager.h"
+#include "liteserver-answers.hpp"
+
+#include <map>
+#include <vector>
+
+namespace ton {
+
+namespace validator {
+
+/*
+ * keeps serialized answers to liteserver queries, keyed by the hash of the serialized query
+ * (which includes the query type, the block id and all other parameters)
+ *
+ * answers that depend on the last masterchain block (getMasterchainInfo, getBlockProof) are dropped
+ * when a new masterchain block arrives, answers about a given block are kept during the next few
+ * masterchain blocks; least recently used answers are evicted when the byte budget is exceeded
+ *
+ * also keeps the data and the state of recently requested blocks, so that concurrent queries to the same block
+ * load them once and share the cells loaded from the state
+ */
+class LiteServerCacheImpl : public LiteServerCache {
+ public:
+  static constexpr std::size_t default_max_bytes = 64 << 20;
+  static constexpr BlockSeqno keep_masterchain_blocks = 4;
+  static constexpr std::size_t max_block_contexts = 64;
+
+  enum class QueryKind { not_cached, last_block, given_block };
+  static QueryKind get_query_kind(td::Slice data);
+
+  LiteServerCacheImpl(td::actor::ActorId<ValidatorManager> manager, std::size_t max_bytes = default_max_bytes)
+      : manager_(std::move(manager)), answers_(max_bytes, keep_masterchain_blocks) {
+  }
+
+  void run_query(td::BufferSlice data, td::Promise<td::BufferSlice> promise) override;
+  void new_masterchain_block(BlockSeqno seqno) override;
+  void get_block_context(BlockIdExt block_id, td::Promise<td::Ref<LiteServerBlockContext>> promise) override;
+
+ private:
+  struct BlockContext {
+    td::Ref<LiteServerBlockContext> context;
+    td::Ref<BlockData> block;
+    BlockSeqno seqno;
+    std::vector<td::Promise<td::Ref<LiteServerBlockContext>>> waiters;
+  };
+
+  void got_answer(td::Bits256 key, bool last_block, BlockSeqno seqno, td::Result<td::BufferSlice> R);
+  void got_context_block(BlockIdExt block_id, td::Result<td::Ref<BlockData>> R);
+  void got_context_state(BlockIdExt block_id, td::Result<td::Ref<ShardState>> R);
+  void failed_block_context(BlockIdExt block_id, td::Status error);
+
+  td::actor::ActorId<ValidatorManager> manager_;
+  BlockSeqno last_masterchain_seqno_{0};
+
+  LiteServerAnswers answers_;
+  // identical queries received while the answer is being computed
+  std::map<td::Bits256, std::vector<td::Promise<td::BufferSlice>>> pending_;
+  std::map<BlockIdExt, BlockContext> contexts_;
+
+  td::uint64 hits_{0}, misses_{0};
+};
+
+}  // namespace validator
+
+}  // namespace ton
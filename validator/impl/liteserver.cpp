@@ -26,6 +26,7 @@
 #include "adnl/utils.hpp"
 #include "ton/lite-tl.hpp"
 #include "tl-utils/lite-utils.hpp"
+#include "td/utils/Metrics.h"
 #include "td/utils/Random.h"
 #include "vm/boc.h"
 #include "tl/tlblib.hpp"
@@ -54,13 +55,27 @@ td::int32 get_tl_tag(td::Slice slice) {
 }
 
 void LiteQuery::run_query(td::BufferSlice data, td::actor::ActorId<ValidatorManager> manager,
-                          td::Promise<td::BufferSlice> promise) {
-  td::actor::create_actor<LiteQuery>("litequery", std::move(data), std::move(manager), std::move(promise)).release();
+                          td::actor::ActorId<LiteServerCache> cache, td::Promise<td::BufferSlice> promise) {
+  static auto &queries_metric = td::get_metric<td::MetricCounter>("liteserver_queries_total");
+  static auto &query_metric = td::get_metric<td::MetricHistogram>("liteserver_query_us");
+  queries_metric.add();
+  promise = td::PromiseCreator::lambda([promise = std::move(promise), timer = td::MetricTimer(query_metric)](
+                                           td::Result<td::BufferSlice> R) mutable {
+    timer.reset();
+    if (R.is_error()) {
+      static auto &errors_metric = td::get_metric<td::MetricCounter>("liteserver_errors_total");
+      errors_metric.add();
+    }
+    promise.set_result(std::move(R));
+  });
+  td::actor::create_actor<LiteQuery>("litequery", std::move(data), std::move(manager), std::move(cache),
+                                     std::move(promise))
+      .release();
 }
 
 LiteQuery::LiteQuery(td::BufferSlice data, td::actor::ActorId<ValidatorManager> manager,
-                     td::Promise<td::BufferSlice> promise)
-    : query_(std::move(data)), manager_(std::move(manager)), promise_(std::move(promise)) {
+                     td::actor::ActorId<LiteServerCache> cache, td::Promise<td::BufferSlice> promise)
+    : query_(std::move(data)), manager_(std::move(manager)), cache_(std::move(cache)), promise_(std::move(promise)) {
   timeout_ = td::Timestamp::in(default_timeout_msec * 0.001);
 }
 
@@ -523,14 +538,46 @@ bool LiteQuery::request_mc_block_state(BlockIdExt blkid) {
 }
 
 bool LiteQuery::request_mc_block_data_state(BlockIdExt blkid) {
+  if (!cache_.empty()) {
+    return request_block_context(blkid, true);
+  }
   return request_mc_block_data(blkid) && request_mc_block_state(blkid);
 }
 
 bool LiteQuery::request_block_data_state(BlockIdExt blkid) {
   LOG(INFO) << "requesting state for block (" << blkid.to_str() << ")";
+  if (!cache_.empty()) {
+    return request_block_context(blkid, false);
+  }
   return request_block_data(blkid) && request_block_state(blkid);
 }
 
+// block data and state shared with other queries to the same block
+bool LiteQuery::request_block_context(BlockIdExt blkid, bool mc) {
+  if (mc && !blkid.is_masterchain()) {
+    return fatal_error("reference block must belong to the masterchain");
+  }
+  if (!blkid.is_valid_full()) {
+    return fatal_error("invalid block id requested");
+  }
+  if (!cont_set_) {
+    return fatal_error("continuation not set");
+  }
+  (mc ? base_blk_id_ : blk_id_) = blkid;
+  ++pending_;
+  td::actor::send_closure_later(
+      cache_, &LiteServerCache::get_block_context, blkid,
+      [Self = actor_id(this), blkid, mc](td::Result<Ref<LiteServerBlockContext>> res) {
+        if (res.is_error()) {
+          td::actor::send_closure(Self, &LiteQuery::abort_query,
+                                  res.move_as_error_prefix("cannot load block "s + blkid.to_str() + " : "));
+        } else {
+          td::actor::send_closure_later(Self, &LiteQuery::got_block_context, mc, res.move_as_ok());
+        }
+      });
+  return true;
+}
+
 bool LiteQuery::request_block_state(BlockIdExt blkid) {
   if (!blkid.is_valid_full()) {
     return fatal_error("invalid block id requested");
@@ -829,6 +876,24 @@ void LiteQuery::got_zero_state(BlockIdExt blkid, td::BufferSlice zerostate) {
   dec_pending();
 }
 
+void LiteQuery::got_block_context(bool mc, Ref<LiteServerBlockContext> context) {
+  LOG(INFO) << "obtained data and state of " << context->block_id.to_str() << " needed by a liteserver query";
+  if (mc) {
+    mc_block_ = Ref<BlockQ>(context->block);
+    mc_state_ = Ref<MasterchainStateQ>(context->state);
+    CHECK(mc_block_.not_null() && mc_state_.not_null());
+    CHECK(context->block_id == base_blk_id_);
+    mc_state_root_proof_ = context->state_root_proof;
+  } else {
+    block_ = Ref<BlockQ>(context->block);
+    state_ = Ref<ShardStateQ>(context->state);
+    CHECK(block_.not_null() && state_.not_null());
+    CHECK(context->block_id == blk_id_);
+    state_root_proof_ = context->state_root_proof;
+  }
+  dec_pending();
+}
+
 void LiteQuery::check_pending() {
   CHECK(pending_ >= 0);
   if (!pending_) {
@@ -851,10 +916,18 @@ bool LiteQuery::set_continuation(std::function<void()>&& cont) {
 }
 
 bool LiteQuery::make_mc_state_root_proof(Ref<vm::Cell>& proof) {
+  if (mc_state_root_proof_.not_null()) {
+    proof = mc_state_root_proof_;
+    return true;
+  }
   return make_state_root_proof(proof, mc_state_, mc_block_, base_blk_id_);
 }
 
 bool LiteQuery::make_state_root_proof(Ref<vm::Cell>& proof) {
+  if (state_root_proof_.not_null()) {
+    proof = state_root_proof_;
+    return true;
+  }
   return make_state_root_proof(proof, state_, block_, blk_id_);
 }
 
@@ -866,6 +939,16 @@ bool LiteQuery::make_state_root_proof(Ref<vm::Cell>& proof, Ref<ShardStateQ> sta
 
 bool LiteQuery::make_state_root_proof(Ref<vm::Cell>& proof, Ref<vm::Cell> state_root, Ref<vm::Cell> block_root,
                                       const BlockIdExt& blkid) {
+  auto res = build_state_root_proof(std::move(state_root), std::move(block_root), blkid);
+  if (res.is_error()) {
+    return fatal_error(res.move_as_error());
+  }
+  proof = res.move_as_ok();
+  return true;
+}
+
+td::Result<Ref<vm::Cell>> LiteQuery::build_state_root_proof(Ref<vm::Cell> state_root, Ref<vm::Cell> block_root,
+                                                            const BlockIdExt& blkid) {
   CHECK(block_root.not_null() && state_root.not_null());
   RootHash rhash{block_root->get_hash().bits()};
   CHECK(rhash == blkid.root_hash);
@@ -873,22 +956,24 @@ bool LiteQuery::make_state_root_proof(Ref<vm::Cell>& proof, Ref<vm::Cell> state_
   block::gen::Block::Record blk;
   block::gen::BlockInfo::Record info;
   if (!(tlb::unpack_cell(pb.root(), blk) && tlb::unpack_cell(blk.info, info))) {
-    return fatal_error("cannot unpack block header");
+    return td::Status::Error(-400, "cannot unpack block header");
   }
   vm::CellSlice upd_cs{vm::NoVmSpec(), blk.state_update};
   if (!(upd_cs.is_special() && upd_cs.prefetch_long(8) == 4  // merkle update
         && upd_cs.size_ext() == 0x20228)) {
-    return fatal_error("invalid Merkle update in block");
+    return td::Status::Error(-400, "invalid Merkle update in block");
   }
   auto upd_hash = upd_cs.prefetch_ref(1)->get_hash(0).bits();
   auto state_hash = state_root->get_hash().bits();
   if (upd_hash.compare(state_hash, 256)) {
-    return fatal_error("cannot construct Merkle proof for given masterchain state because of hash mismatch");
+    return td::Status::Error(-400,
+                             "cannot construct Merkle proof for given masterchain state because of hash mismatch");
   }
+  Ref<vm::Cell> proof;
   if (!pb.extract_proof_to(proof)) {
-    return fatal_error("unknown error creating Merkle proof");
+    return td::Status::Error(-400, "unknown error creating Merkle proof");
   }
-  return true;
+  return proof;
 }
 
 bool LiteQuery::make_shard_info_proof(Ref<vm::Cell>& proof, Ref<block::McShardHash>& info, ShardIdFull shard,
@@ -967,6 +1052,7 @@ void LiteQuery::continue_getAccountState() {
     blk_id_ = base_blk_id_;
     block_ = mc_block_;
     state_ = mc_state_;
+    state_root_proof_ = mc_state_root_proof_;
     finish_getAccountState({});
     return;
   }
@@ -1557,10 +1643,12 @@ void LiteQuery::continue_getAllShardsInfo() {
     fatal_error("cannot construct Merkle proof for all shards dictionary");
     return;
   }
-  shards_dict = block::ShardConfig::extract_shard_hashes_dict(mc_state_->root_cell());
+  // the dictionary itself is taken from the configuration already unpacked for this state
+  auto config = mc_state_->get_config();
+  auto shards_root = config ? config->get_root_csr() : Ref<vm::CellSlice>{};
   vm::CellBuilder cb;
   Ref<vm::Cell> cell;
-  if (!(std::move(shards_dict)->append_dict_to_bool(cb) && cb.finalize_to(cell))) {
+  if (!(shards_root.not_null() && cb.append_cellslice_bool(std::move(shards_root)) && cb.finalize_to(cell))) {
     fatal_error("cannot store ShardHashes from last mc state into a new cell");
     return;
   }
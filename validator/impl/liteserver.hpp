@@ -22,6 +22,7 @@
 #include "td/utils/Time.h"
 #include "interfaces/block-handle.h"
 #include "interfaces/validator-manager.h"
+#include "interfaces/liteserver.h"
 #include "interfaces/shard.h"
 #include "block.hpp"
 #include "shard.hpp"
@@ -35,6 +36,7 @@ using td::Ref;
 class LiteQuery : public td::actor::Actor {
   td::BufferSlice query_;
   td::actor::ActorId<ton::validator::ValidatorManager> manager_;
+  td::actor::ActorId<LiteServerCache> cache_;
   td::Timestamp timeout_;
   td::Promise<td::BufferSlice> promise_;
   int pending_{0};
@@ -49,6 +51,7 @@ class LiteQuery : public td::actor::Actor {
   Ref<BlockQ> mc_block_, block_;
   Ref<ProofQ> mc_proof_, mc_proof_alt_;
   Ref<ProofLinkQ> proof_link_;
+  Ref<vm::Cell> mc_state_root_proof_, state_root_proof_;
   td::BufferSlice buffer_;
   std::function<void()> continuation_;
   bool cont_set_{false};
@@ -70,9 +73,11 @@ class LiteQuery : public td::actor::Actor {
     ls_capabilities = 7
   };  // version 1.1; +1 = build block proof chains, +2 = masterchainInfoExt, +4 = runSmcMethod
   LiteQuery(td::BufferSlice data, td::actor::ActorId<ton::validator::ValidatorManager> manager,
-            td::Promise<td::BufferSlice> promise);
+            td::actor::ActorId<LiteServerCache> cache, td::Promise<td::BufferSlice> promise);
   static void run_query(td::BufferSlice data, td::actor::ActorId<ton::validator::ValidatorManager> manager,
-                        td::Promise<td::BufferSlice> promise);
+                        td::actor::ActorId<LiteServerCache> cache, td::Promise<td::BufferSlice> promise);
+  static td::Result<Ref<vm::Cell>> build_state_root_proof(Ref<vm::Cell> state_root, Ref<vm::Cell> block_root,
+                                                          const BlockIdExt& blkid);
 
  private:
   bool fatal_error(td::Status error);
@@ -147,6 +152,7 @@ class LiteQuery : public td::actor::Actor {
   bool request_mc_block_data_state(BlockIdExt blkid);
   bool request_mc_proof(BlockIdExt blkid, int mode = 0);
   bool request_zero_state(BlockIdExt blkid);
+  bool request_block_context(BlockIdExt blkid, bool mc);
   void got_block_state(BlockIdExt blkid, Ref<ShardState> state);
   void got_mc_block_state(BlockIdExt blkid, Ref<ShardState> state);
   void got_block_data(BlockIdExt blkid, Ref<BlockData> data);
@@ -154,6 +160,7 @@ class LiteQuery : public td::actor::Actor {
   void got_mc_block_proof(BlockIdExt blkid, int mode, Ref<Proof> proof);
   void got_block_proof_link(BlockIdExt blkid, Ref<ProofLink> proof_link);
   void got_zero_state(BlockIdExt blkid, td::BufferSlice zerostate);
+  void got_block_context(bool mc, Ref<LiteServerBlockContext> context);
   void dec_pending() {
     if (!--pending_) {
       check_pending();
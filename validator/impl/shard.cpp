@@ -26,6 +26,9 @@
 #include "vm/cells/MerkleUpdate.h"
 #include "block/block-parse.h"
 #include "block/block-auto.h"
+#include "td/utils/port/thread.h"
+
+#include <atomic>
 
 #define LAZY_STATE_DESERIALIZE 1
 
@@ -59,6 +62,28 @@ ShardStateQ::ShardStateQ(const BlockIdExt& _id, Ref<vm::Cell> _root, td::BufferS
     : blkid(_id), data(std::move(_data)), root(std::move(_root)) {
 }
 
+static int state_deserialize_threads(std::size_t size) {
+  // large serialized states (mostly downloaded persistent states) are deserialized by several threads
+  if (size < (1 << 24)) {
+    return 1;
+  }
+  return static_cast<int>(td::clamp(td::thread::hardware_concurrency(), 1u, 8u));
+}
+
+static std::atomic<int> max_state_update_threads{1};
+
+void ShardStateQ::set_update_threads(td::uint32 threads) {
+  max_state_update_threads.store(static_cast<int>(td::clamp(threads, 1u, 256u)), std::memory_order_relaxed);
+}
+
+static int state_update_threads(std::size_t block_size) {
+  // spawning threads does not pay off for the Merkle updates of ordinary blocks
+  if (block_size < (1 << 18)) {
+    return 1;
+  }
+  return max_state_update_threads.load(std::memory_order_relaxed);
+}
+
 td::Result<Ref<ShardStateQ>> ShardStateQ::fetch(const BlockIdExt& _id, td::BufferSlice _data, Ref<vm::Cell> _root) {
   if (_id.is_masterchain()) {
     auto res = MasterchainStateQ::fetch(_id, std::move(_data), std::move(_root));
@@ -83,27 +108,36 @@ td::Status ShardStateQ::init() {
       return td::Status::Error(
           -668, "cannot initialize shardchain state without either a root cell or a BufferSlice with serialized data");
     }
+    int threads = state_deserialize_threads(data.size());
 #if LAZY_STATE_DESERIALIZE
-    vm::StaticBagOfCellsDbLazy::Options options;
-    options.check_crc32c = true;
-    auto res = vm::StaticBagOfCellsDbLazy::create(td::BufferSliceBlobView::create(data.clone()), options);
-    if (res.is_error()) {
-      return res.move_as_error();
-    }
-    auto boc = res.move_as_ok();
-    auto rc = boc->get_root_count();
-    if (rc.is_error()) {
-      return rc.move_as_error();
-    }
-    if (rc.move_as_ok() != 1) {
-      return td::Status::Error(-668, "shardchain state BoC is invalid");
-    }
-    auto res3 = boc->get_root_cell(0);
-    bocs_.clear();
-    bocs_.push_back(std::move(boc));
+    // a large state is loaded completely anyway when it is stored to the cell db,
+    // so it is deserialized at once on several threads instead
+    bool lazy = threads == 1;
 #else
-    auto res3 = vm::std_boc_deserialize(data.as_slice());
+    bool lazy = false;
 #endif
+    td::Result<Ref<vm::Cell>> res3;
+    if (lazy) {
+      vm::StaticBagOfCellsDbLazy::Options options;
+      options.check_crc32c = true;
+      auto res = vm::StaticBagOfCellsDbLazy::create(td::BufferSliceBlobView::create(data.clone()), options);
+      if (res.is_error()) {
+        return res.move_as_error();
+      }
+      auto boc = res.move_as_ok();
+      auto rc = boc->get_root_count();
+      if (rc.is_error()) {
+        return rc.move_as_error();
+      }
+      if (rc.move_as_ok() != 1) {
+        return td::Status::Error(-668, "shardchain state BoC is invalid");
+      }
+      res3 = boc->get_root_cell(0);
+      bocs_.clear();
+      bocs_.push_back(std::move(boc));
+    } else {
+      res3 = vm::std_boc_deserialize(data.as_slice(), false, threads);
+    }
     if (res3.is_error()) {
       return res3.move_as_error();
     }
@@ -136,7 +170,7 @@ td::Status ShardStateQ::validate_deep() const {
     return td::Status::Error(-668,
                              "cannot validate serialized shard state because no serialized shard state is present");
   }
-  auto res = vm::std_boc_deserialize(data.as_slice());
+  auto res = vm::std_boc_deserialize(data.as_slice(), false, state_deserialize_threads(data.size()));
   if (res.is_error()) {
     return res.move_as_error();
   }
@@ -190,7 +224,7 @@ td::Status ShardStateQ::apply_block(BlockIdExt newid, td::Ref<BlockData> block)
     return td::Status::Error(-666, "invalid shardchain block header for block "s + block->block_id().id.to_str());
   }
   Ref<vm::Cell> update = cs.prefetch_ref(2);  // Merkle update
-  auto next_state_root = vm::MerkleUpdate::apply(root, update);
+  auto next_state_root = vm::MerkleUpdate::apply(root, update, state_update_threads(block->data().size()));
   if (next_state_root.is_null()) {
     return td::Status::Error("cannot apply Merkle update from block "s + block->block_id().id.to_str() +
                              " to previous state");
@@ -301,6 +335,34 @@ td::Result<td::BufferSlice> ShardStateQ::serialize() const {
   return st_res.move_as_ok();
 }
 
+td::Status ShardStateQ::serialize_to_file(td::FileFd& fd, const vm::BagOfCells::LoadCell& load_cell) const {
+  td::PerfWarningTimer perf_timer_{"serializestate", 0.1};
+  if (!data.is_null()) {
+    auto cur_data = data.clone();
+    while (!cur_data.empty()) {
+      TRY_RESULT(s, fd.write(cur_data.as_slice()));
+      cur_data.confirm_read(s);
+    }
+    return td::Status::OK();
+  }
+  if (root.is_null()) {
+    return td::Status::Error(-666, "cannot serialize an uninitialized state");
+  }
+  vm::BagOfCells new_boc;
+  new_boc.set_root(root);
+  if (load_cell) {
+    TRY_STATUS(new_boc.import_cells_lazy(load_cell));
+  } else {
+    TRY_STATUS(new_boc.import_cells());
+  }
+  auto res = new_boc.serialize_to_file(fd, 31);
+  if (res.is_error()) {
+    LOG(ERROR) << "cannot serialize a shardchain state";
+    return res;
+  }
+  return td::Status::OK();
+}
+
 MasterchainStateQ::MasterchainStateQ(const BlockIdExt& _id, td::BufferSlice _data)
     : MasterchainState(), ShardStateQ(_id, std::move(_data)) {
 }
@@ -337,9 +399,10 @@ td::Status MasterchainStateQ::mc_init() {
 }
 
 td::Status MasterchainStateQ::mc_reinit() {
-  auto res = block::ConfigInfo::extract_config(
-      root_cell(), block::ConfigInfo::needStateRoot | block::ConfigInfo::needValidatorSet |
-                       block::ConfigInfo::needShardHashes | block::ConfigInfo::needPrevBlocks);
+  auto res = block::ConfigInfoCache::get_default().extract_config(
+      root_cell(), get_block_id(),
+      block::ConfigInfo::needStateRoot | block::ConfigInfo::needValidatorSet | block::ConfigInfo::needShardHashes |
+          block::ConfigInfo::needPrevBlocks);
   cur_validators_.reset();
   next_validators_.reset();
   if (res.is_error()) {
@@ -347,7 +410,6 @@ td::Status MasterchainStateQ::mc_reinit() {
   }
   config_ = res.move_as_ok();
   CHECK(config_);
-  CHECK(config_->set_block_id_ext(get_block_id()));
 
   auto cv_root = config_->get_config_param(35, 34);
   if (cv_root.not_null()) {
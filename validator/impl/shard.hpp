@@ -53,6 +53,8 @@ class ShardStateQ : virtual public ShardState {
   ShardStateQ(const BlockIdExt& _id, Ref<vm::Cell> _root, td::BufferSlice _data = {});
   virtual ~ShardStateQ() = default;
   static td::Result<Ref<ShardStateQ>> fetch(const BlockIdExt& _id, td::BufferSlice _data, Ref<vm::Cell> _root = {});
+  // maximal number of threads used by apply_block() for large blocks, process-wide
+  static void set_update_threads(td::uint32 threads);
   bool disable_boc() const override {
     return false;
   }
@@ -87,6 +89,7 @@ class ShardStateQ : virtual public ShardState {
   td::Result<Ref<ShardState>> merge_with(const ShardState& with) const override;
   td::Result<std::pair<Ref<ShardState>, Ref<ShardState>>> split() const override;
   td::Result<td::BufferSlice> serialize() const override;
+  td::Status serialize_to_file(td::FileFd& fd, const vm::BagOfCells::LoadCell& load_cell) const override;
 };
 
 #if TD_MSVC
@@ -136,7 +139,7 @@ class MasterchainStateQ : public MasterchainState, public ShardStateQ {
   bool get_old_mc_block_id(ton::BlockSeqno seqno, ton::BlockIdExt& blkid,
                            ton::LogicalTime* end_lt = nullptr) const override;
   bool check_old_mc_block_id(const ton::BlockIdExt& blkid, bool strict = false) const override;
-  std::shared_ptr<block::ConfigInfo> get_config() const {
+  std::shared_ptr<const block::ConfigInfo> get_config() const {
     return config_;
   }
   td::Result<td::Ref<ConfigHolder>> get_config_holder() const override {
@@ -149,7 +152,7 @@ class MasterchainStateQ : public MasterchainState, public ShardStateQ {
 
  private:
   ZeroStateIdExt zerostate_id_;
-  std::shared_ptr<block::ConfigInfo> config_;
+  std::shared_ptr<const block::ConfigInfo> config_;
   std::shared_ptr<block::ValidatorSet> cur_validators_, next_validators_;
   MasterchainStateQ(const MasterchainStateQ& other) = default;
   td::Status mc_init();
@@ -31,6 +31,10 @@
 #include "vm/cells/MerkleProof.h"
 #include "vm/cells/MerkleUpdate.h"
 #include "common/errorlog.h"
+#include "td/utils/Metrics.h"
+#include "td/utils/parallel_for.h"
+
+#include <atomic>
 #include <ctime>
 
 namespace ton {
@@ -39,6 +43,8 @@ namespace validator {
 using td::Ref;
 using namespace std::literals::string_literals;
 
+TD_THREAD_LOCAL ValidateQuery::AccountCheck* ValidateQuery::account_check_;
+
 std::string ErrorCtx::as_string() const {
   std::string a;
   for (const auto& s : entries_) {
@@ -51,7 +57,7 @@ std::string ErrorCtx::as_string() const {
 ValidateQuery::ValidateQuery(ShardIdFull shard, UnixTime min_ts, BlockIdExt min_masterchain_block_id,
                              std::vector<BlockIdExt> prev, BlockCandidate candidate, Ref<ValidatorSet> validator_set,
                              td::actor::ActorId<ValidatorManager> manager, td::Timestamp timeout,
-                             td::Promise<ValidateCandidateResult> promise, bool is_fake)
+                             td::Promise<ValidateCandidateResult> promise, bool is_fake, td::uint32 threads)
     : shard_(shard)
     , id_(candidate.id)
     , min_ts(min_ts)
@@ -63,6 +69,7 @@ ValidateQuery::ValidateQuery(ShardIdFull shard, UnixTime min_ts, BlockIdExt min_
     , timeout(timeout)
     , main_promise(std::move(promise))
     , is_fake_(is_fake)
+    , threads_(std::max(threads, 1u))
     , shard_pfx_(shard_.shard)
     , shard_pfx_len_(ton::shard_prefix_length(shard_)) {
   proc_hash_.zero();
@@ -72,11 +79,21 @@ void ValidateQuery::alarm() {
   abort_query(td::Status::Error(ErrorCode::timeout, "timeout"));
 }
 
+namespace {
+void record_validation_time(double elapsed) {
+  static auto &validate_metric = td::get_metric<td::MetricHistogram>("validator_validate_us");
+  validate_metric.record_duration(elapsed);
+}
+}  // namespace
+
 void ValidateQuery::abort_query(td::Status error) {
   (void)fatal_error(std::move(error));
 }
 
 bool ValidateQuery::reject_query(std::string error, td::BufferSlice reason) {
+  if (account_check_) {
+    return defer_failure(AccountCheck::reject, std::move(error), std::move(reason));
+  }
   error = error_ctx() + error;
   LOG(ERROR) << "REJECT: aborting validation of block candidate for " << shard_.to_str() << " : " << error;
   if (main_promise) {
@@ -85,6 +102,9 @@ bool ValidateQuery::reject_query(std::string error, td::BufferSlice reason) {
                                       << " collated_data=" << block_candidate.collated_file_hash.to_hex());
     errorlog::ErrorLog::log_file(block_candidate.data.clone());
     errorlog::ErrorLog::log_file(block_candidate.collated_data.clone());
+    static auto &rejected_metric = td::get_metric<td::MetricCounter>("validator_rejected_total");
+    record_validation_time(timer_.elapsed());
+    rejected_metric.add();
     main_promise.set_result(CandidateReject{std::move(error), std::move(reason)});
   }
   stop();
@@ -97,6 +117,9 @@ bool ValidateQuery::reject_query(std::string err_msg, td::Status error, td::Buff
 }
 
 bool ValidateQuery::soft_reject_query(std::string error, td::BufferSlice reason) {
+  if (account_check_) {
+    return defer_failure(AccountCheck::soft_reject, std::move(error), std::move(reason));
+  }
   error = error_ctx() + error;
   LOG(ERROR) << "SOFT REJECT: aborting validation of block candidate for " << shard_.to_str() << " : " << error;
   if (main_promise) {
@@ -105,6 +128,9 @@ bool ValidateQuery::soft_reject_query(std::string error, td::BufferSlice reason)
                                       << " collated_data=" << block_candidate.collated_file_hash.to_hex());
     errorlog::ErrorLog::log_file(block_candidate.data.clone());
     errorlog::ErrorLog::log_file(block_candidate.collated_data.clone());
+    static auto &rejected_metric = td::get_metric<td::MetricCounter>("validator_rejected_total");
+    record_validation_time(timer_.elapsed());
+    rejected_metric.add();
     main_promise.set_result(CandidateReject{std::move(error), std::move(reason)});
   }
   stop();
@@ -113,6 +139,9 @@ bool ValidateQuery::soft_reject_query(std::string error, td::BufferSlice reason)
 
 bool ValidateQuery::fatal_error(td::Status error) {
   error.ensure_error();
+  if (account_check_) {
+    return defer_failure(AccountCheck::fatal, {}, {}, std::move(error));
+  }
   LOG(ERROR) << "aborting validation of block candidate for " << shard_.to_str() << " : " << error.to_string();
   if (main_promise) {
     auto c = error.code();
@@ -123,6 +152,9 @@ bool ValidateQuery::fatal_error(td::Status error) {
       errorlog::ErrorLog::log_file(block_candidate.data.clone());
       errorlog::ErrorLog::log_file(block_candidate.collated_data.clone());
     }
+    static auto &errors_metric = td::get_metric<td::MetricCounter>("validator_errors_total");
+    record_validation_time(timer_.elapsed());
+    errors_metric.add();
     main_promise(std::move(error));
   }
   stop();
@@ -142,8 +174,27 @@ bool ValidateQuery::fatal_error(std::string err_msg, int err_code) {
   return fatal_error(td::Status::Error(err_code, error_ctx() + err_msg));
 }
 
+// called instead of reporting an error from a check running on a worker thread (see run_account_checks())
+// only the first error is kept, as only the first one would be reported by the sequential checks
+bool ValidateQuery::defer_failure(AccountCheck::Failure failure, std::string error, td::BufferSlice reason,
+                                  td::Status status) {
+  auto& check = *account_check_;
+  LOG(DEBUG) << "check of AccountBlock for " << check.addr.to_hex()
+             << " failed : " << (status.is_error() ? status.to_string() : error);
+  if (check.failure == AccountCheck::none) {
+    check.failure = failure;
+    check.error = std::move(error);
+    check.reason = std::move(reason);
+    check.status = std::move(status);
+  }
+  return false;
+}
+
 void ValidateQuery::finish_query() {
   if (main_promise) {
+    static auto &accepted_metric = td::get_metric<td::MetricCounter>("validator_accepted_total");
+    record_validation_time(timer_.elapsed());
+    accepted_metric.add();
     main_promise.set_result(now_);
   }
   stop();
@@ -678,8 +729,8 @@ bool ValidateQuery::try_unpack_mc_state() {
     if (mc_state_root_.is_null()) {
       return fatal_error(-666, "latest masterchain state does not have a root cell");
     }
-    auto res = block::ConfigInfo::extract_config(
-        mc_state_root_,
+    auto res = block::ConfigInfoCache::get_default().extract_config(
+        mc_state_root_, mc_blkid_,
         block::ConfigInfo::needShardHashes | block::ConfigInfo::needLibraries | block::ConfigInfo::needValidatorSet |
             block::ConfigInfo::needWorkchainInfo | block::ConfigInfo::needStateExtraRoot |
             block::ConfigInfo::needCapabilities |
@@ -690,7 +741,6 @@ bool ValidateQuery::try_unpack_mc_state() {
     }
     config_ = res.move_as_ok();
     CHECK(config_);
-    config_->set_block_id_ext(mc_blkid_);
     ihr_enabled_ = config_->ihr_enabled();
     create_stats_enabled_ = config_->create_stats_enabled();
     if (config_->has_capabilities() && (config_->get_capabilities() & ~supported_capabilities())) {
@@ -1017,7 +1067,7 @@ bool ValidateQuery::compute_prev_state() {
 
 bool ValidateQuery::compute_next_state() {
   LOG(DEBUG) << "computing next state";
-  auto res = vm::MerkleUpdate::validate(state_update_);
+  auto res = vm::MerkleUpdate::validate(state_update_, static_cast<int>(threads_));
   if (res.is_error()) {
     return reject_query("state update is invalid: "s + res.move_as_error().to_string());
   }
@@ -1025,7 +1075,7 @@ bool ValidateQuery::compute_next_state() {
   if (res.is_error()) {
     return reject_query("state update cannot be applied: "s + res.move_as_error().to_string());
   }
-  state_root_ = vm::MerkleUpdate::apply(prev_state_root_, state_update_);
+  state_root_ = vm::MerkleUpdate::apply(prev_state_root_, state_update_, static_cast<int>(threads_));
   if (state_root_.is_null()) {
     return reject_query("cannot apply Merkle update from block to compute new state");
   }
@@ -2526,11 +2576,18 @@ bool ValidateQuery::precheck_one_account_block(td::ConstBitPtr acc_id, Ref<vm::C
 
 bool ValidateQuery::precheck_account_transactions() {
   LOG(INFO) << "pre-checking all AccountBlocks, and all transactions of all accounts";
+  bool parallel = prepare_parallel_account_checks();
+  std::vector<AccountCheck> checks;
   try {
     CHECK(account_blocks_dict_);
     if (!account_blocks_dict_->validate_check_extra(
-            [this](Ref<vm::CellSlice> value, Ref<vm::CellSlice> extra, td::ConstBitPtr key, int key_len) {
+            [this, parallel, &checks](Ref<vm::CellSlice> value, Ref<vm::CellSlice> extra, td::ConstBitPtr key,
+                                      int key_len) {
               CHECK(key_len == 256);
+              if (parallel) {
+                checks.emplace_back(key, std::move(value));
+                return true;
+              }
               return precheck_one_account_block(key, std::move(value)) ||
                      reject_query("invalid AccountBlock for account "s + key.to_hex(256) + " in the new block "s +
                                   id_.to_str());
@@ -2540,6 +2597,75 @@ bool ValidateQuery::precheck_account_transactions() {
   } catch (vm::VmError& err) {
     return reject_query("invalid ShardAccountBlocks dictionary: "s + err.get_msg());
   }
+  return !parallel || run_account_checks(checks, true);
+}
+
+// the dictionaries looked up by the checks of AccountBlocks are validated in advance,
+// so that the checks may run on several threads without modifying them
+bool ValidateQuery::prepare_parallel_account_checks() {
+  if (threads_ <= 1) {
+    return false;
+  }
+  if (is_masterchain()) {
+    config_->is_special_smartcontract(td::Bits256::zero());
+  }
+  return in_msg_dict_->validate() && out_msg_dict_->validate() && ps_.account_dict_->validate() &&
+         ns_.account_dict_->validate();
+}
+
+// runs precheck_one_account_block() or check_account_transactions() for all AccountBlocks on up to threads_ threads,
+// then reports the first failure and keeps the side effects of the preceding checks, as the sequential checks would
+bool ValidateQuery::run_account_checks(std::vector<AccountCheck>& checks, bool precheck) {
+  std::atomic<std::size_t> first_failed{checks.size()};
+  td::parallel_for(checks.size(), static_cast<int>(threads_), [&](std::size_t i) {
+    if (i >= first_failed) {
+      return;
+    }
+    auto& check = checks[i];
+    account_check_ = &check;
+    try {
+      check.passed = precheck ? precheck_one_account_block(check.addr.cbits(), check.acc_blk_root)
+                              : check_account_transactions(check.addr, check.acc_blk_root);
+    } catch (vm::VmError& err) {
+      defer_failure(AccountCheck::vm_error, err.get_msg());
+    } catch (vm::VmVirtError& err) {
+      defer_failure(AccountCheck::vm_virt_error, err.get_msg());
+    }
+    account_check_ = nullptr;
+    if (!check.passed) {
+      auto j = first_failed.load();
+      while (i < j && !first_failed.compare_exchange_weak(j, i)) {
+      }
+    }
+  });
+  for (auto& check : checks) {
+    if (!check.passed) {
+      switch (check.failure) {
+        case AccountCheck::reject:
+          return reject_query(std::move(check.error), std::move(check.reason));
+        case AccountCheck::soft_reject:
+          return soft_reject_query(std::move(check.error), std::move(check.reason));
+        case AccountCheck::fatal:
+          return fatal_error(std::move(check.status));
+        case AccountCheck::vm_error:
+          if (precheck) {
+            return reject_query("invalid ShardAccountBlocks dictionary: "s + check.error);
+          }
+          return fatal_error(-666, std::move(check.error));
+        case AccountCheck::vm_virt_error:
+          return fatal_error(-666, std::move(check.error));
+        default:
+          // the check failed without reporting an error; as in the sequential checks, the caller rejects the block
+          if (precheck) {
+            reject_query("invalid AccountBlock for account "s + check.addr.to_hex() + " in the new block "s +
+                         id_.to_str());
+          }
+          return false;
+      }
+    }
+    msg_proc_lt_.insert(msg_proc_lt_.end(), check.msg_proc_lt.begin(), check.msg_proc_lt.end());
+    lib_publishers_.insert(lib_publishers_.end(), check.lib_publishers.begin(), check.lib_publishers.end());
+  }
   return true;
 }
 
@@ -4157,7 +4283,7 @@ bool ValidateQuery::check_one_transaction(block::Account& account, ton::LogicalT
                                       << info.created_lt);
       }
       if (info.created_lt != start_lt_ || !is_special_in_msg(*in_descr_cs)) {
-        msg_proc_lt_.emplace_back(addr, lt, info.created_lt);
+        (account_check_ ? account_check_->msg_proc_lt : msg_proc_lt_).emplace_back(addr, lt, info.created_lt);
       }
       dest = std::move(info.dest);
       CHECK(money_imported.validate_unpack(info.value));
@@ -4593,11 +4719,21 @@ bool ValidateQuery::check_account_transactions(const StdSmcAddress& acc_addr, Re
 
 bool ValidateQuery::check_transactions() {
   LOG(INFO) << "checking all transactions";
-  return account_blocks_dict_->check_for_each_extra(
-      [this](Ref<vm::CellSlice> value, Ref<vm::CellSlice> extra, td::ConstBitPtr key, int key_len) {
+  if (!prepare_parallel_account_checks()) {
+    return account_blocks_dict_->check_for_each_extra(
+        [this](Ref<vm::CellSlice> value, Ref<vm::CellSlice> extra, td::ConstBitPtr key, int key_len) {
+          CHECK(key_len == 256);
+          return check_account_transactions(key, std::move(value));
+        });
+  }
+  std::vector<AccountCheck> checks;
+  account_blocks_dict_->check_for_each_extra(
+      [&checks](Ref<vm::CellSlice> value, Ref<vm::CellSlice> extra, td::ConstBitPtr key, int key_len) {
         CHECK(key_len == 256);
-        return check_account_transactions(key, std::move(value));
+        checks.emplace_back(key, std::move(value));
+        return true;
       });
+  return run_account_checks(checks, false);
 }
 
 // similar to Collator::update_account_public_libraries()
@@ -4610,7 +4746,7 @@ bool ValidateQuery::scan_account_libraries(Ref<vm::Cell> orig_libs, Ref<vm::Cell
                bool f = block::is_public_library(key, std::move(val1));
                bool g = block::is_public_library(key, val2);
                if (f != g) {
-                 lib_publishers_.emplace_back(key, addr, g);
+                 (account_check_ ? account_check_->lib_publishers : lib_publishers_).emplace_back(key, addr, g);
                }
                return true;
              },
@@ -26,6 +26,8 @@
 #include "block/transaction.h"
 #include "shard.hpp"
 #include "signature-set.hpp"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/Timer.h"
 #include <vector>
 #include <string>
 #include <map>
@@ -119,7 +121,7 @@ class ValidateQuery : public td::actor::Actor {
   ValidateQuery(ShardIdFull shard, UnixTime min_ts, BlockIdExt min_masterchain_block_id, std::vector<BlockIdExt> prev,
                 BlockCandidate candidate, td::Ref<ValidatorSet> validator_set,
                 td::actor::ActorId<ValidatorManager> manager, td::Timestamp timeout,
-                td::Promise<ValidateCandidateResult> promise, bool is_fake = false);
+                td::Promise<ValidateCandidateResult> promise, bool is_fake = false, td::uint32 threads = 1);
 
  private:
   int verbosity{3 * 1};
@@ -143,6 +145,7 @@ class ValidateQuery : public td::actor::Actor {
   bool is_key_block_{false};
   bool update_shard_cc_{false};
   bool is_fake_{false};
+  td::uint32 threads_{1};
   bool prev_key_block_exists_{false};
   bool debug_checks_{false};
   bool outq_cleanup_partial_{false};
@@ -174,7 +177,8 @@ class ValidateQuery : public td::actor::Actor {
   Ref<BlockSignatureSet> prev_signatures_;       // from McBlockExtra (UNCHECKED)
   Ref<vm::Cell> recover_create_msg_, mint_msg_;  // from McBlockExtra (UNCHECKED)
 
-  std::unique_ptr<block::ConfigInfo> config_, new_config_;
+  std::shared_ptr<const block::ConfigInfo> config_;
+  std::unique_ptr<block::ConfigInfo> new_config_;
   std::unique_ptr<block::ShardConfig> old_shard_conf_;  // from reference mc state
   std::unique_ptr<block::ShardConfig> new_shard_conf_;  // from shard_hashes_ in mc blocks
   Ref<block::WorkchainInfo> wc_info_;
@@ -230,7 +234,27 @@ class ValidateQuery : public td::actor::Actor {
 
   std::vector<std::tuple<Bits256, Bits256, bool>> lib_publishers_, lib_publishers2_;
 
+  // checks of one AccountBlock run on a worker thread; errors and side effects are kept here
+  // until the actor thread reports them in the order of the sequential checks
+  struct AccountCheck {
+    enum Failure { none, reject, soft_reject, fatal, vm_error, vm_virt_error };
+    AccountCheck(td::ConstBitPtr addr, Ref<vm::CellSlice> acc_blk_root)
+        : addr(addr), acc_blk_root(std::move(acc_blk_root)) {
+    }
+    td::Bits256 addr;
+    Ref<vm::CellSlice> acc_blk_root;
+    bool passed{false};
+    Failure failure{none};
+    std::string error;
+    td::Status status;
+    td::BufferSlice reason;
+    std::vector<std::tuple<Bits256, LogicalTime, LogicalTime>> msg_proc_lt;
+    std::vector<std::tuple<Bits256, Bits256, bool>> lib_publishers;
+  };
+  static TD_THREAD_LOCAL AccountCheck* account_check_;
+
   td::PerfWarningTimer perf_timer_{"validateblock", 0.1};
+  td::Timer timer_;
 
   static constexpr td::uint32 priority() {
     return 2;
@@ -254,6 +278,8 @@ class ValidateQuery : public td::actor::Actor {
   bool fatal_error(int err_code, std::string err_msg);
   bool fatal_error(int err_code, std::string err_msg, td::Status error);
   bool fatal_error(std::string err_msg, int err_code = -666);
+  bool defer_failure(AccountCheck::Failure failure, std::string error, td::BufferSlice reason = {},
+                     td::Status status = {});
 
   std::string error_ctx() const {
     return error_ctx_.as_string();
@@ -325,6 +351,8 @@ class ValidateQuery : public td::actor::Actor {
                                 unsigned& prev_trans_lt_len, ton::Bits256& acc_state_hash);
   bool precheck_one_account_block(td::ConstBitPtr acc_id, Ref<vm::CellSlice> acc_blk);
   bool precheck_account_transactions();
+  bool prepare_parallel_account_checks();
+  bool run_account_checks(std::vector<AccountCheck>& checks, bool precheck);
   Ref<vm::Cell> lookup_transaction(const ton::StdSmcAddress& addr, ton::LogicalTime lt) const;
   bool is_valid_transaction_ref(Ref<vm::Cell> trans_ref) const;
   bool precheck_one_message_queue_update(td::ConstBitPtr out_msg_id, Ref<vm::CellSlice> old_value,
@@ -21,6 +21,9 @@
 // #include "adnl/utils.hpp"
 #include "block/block.h"
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 
 namespace ton {
@@ -38,46 +41,53 @@ bool ValidatorSetQ::is_validator(NodeIdShort id) const {
   return find_validator(id);
 }
 
-td::Result<ValidatorWeight> ValidatorSetQ::check_signatures(RootHash root_hash, FileHash file_hash,
-                                                            td::Ref<BlockSignatureSet> signatures) const {
-  auto &sigs = signatures->signatures();
-
-  auto block = create_serialize_tl_object<ton_api::ton_blockId>(root_hash, file_hash);
-
-  ValidatorWeight weight = 0;
-
-  std::set<NodeIdShort> nodes;
-  for (auto &sig : sigs) {
-    if (nodes.count(sig.node) == 1) {
-      return td::Status::Error(ErrorCode::protoviolation, "duplicate node to sign");
+namespace {
+
+// Validator sets are recomputed for almost every query, while their members rarely change,
+// so decoded keys are kept in one cache shared by all sets
+class DecodedKeyCache {
+ public:
+  std::shared_ptr<const td::Ed25519::PreparedPublicKey> get(const td::Bits256 &key) {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      auto it = keys_.find(key);
+      if (it != keys_.end()) {
+        return it->second;
+      }
     }
-    nodes.insert(sig.node);
-
-    auto vdescr = find_validator(sig.node);
-    if (!vdescr) {
-      return td::Status::Error(ErrorCode::protoviolation, "unknown node to sign");
+    auto decoded = std::make_shared<const td::Ed25519::PreparedPublicKey>(key.as_slice());
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (keys_.size() >= max_size) {
+      keys_.clear();
     }
-
-    auto E = ValidatorFullId{vdescr->key}.create_encryptor().move_as_ok();
-    TRY_STATUS(E->check_signature(block.as_slice(), sig.signature.as_slice()));
-    weight += vdescr->weight;
+    keys_.emplace(key, decoded);
+    return decoded;
   }
 
-  if (weight * 3 <= total_weight_ * 2) {
-    return td::Status::Error(ErrorCode::protoviolation, "too small sig weight");
-  }
-  return weight;
+ private:
+  static constexpr size_t max_size = 4096;
+  std::mutex mutex_;
+  std::map<td::Bits256, std::shared_ptr<const td::Ed25519::PreparedPublicKey>> keys_;
+};
+
+DecodedKeyCache &decoded_keys() {
+  static DecodedKeyCache cache;
+  return cache;
 }
 
-td::Result<ValidatorWeight> ValidatorSetQ::check_approve_signatures(RootHash root_hash, FileHash file_hash,
-                                                                    td::Ref<BlockSignatureSet> signatures) const {
-  auto &sigs = signatures->signatures();
+}  // namespace
 
-  auto block = create_serialize_tl_object<ton_api::ton_blockIdApprove>(root_hash, file_hash);
+td::Result<ValidatorWeight> ValidatorSetQ::check_signatures_impl(td::Slice data,
+                                                                 td::Ref<BlockSignatureSet> signatures) const {
+  auto &sigs = signatures->signatures();
 
   ValidatorWeight weight = 0;
 
   std::set<NodeIdShort> nodes;
+  std::vector<std::shared_ptr<const td::Ed25519::PreparedPublicKey>> keys;
+  std::vector<td::Ed25519::BatchEntry> entries;
+  keys.reserve(sigs.size());
+  entries.reserve(sigs.size());
   for (auto &sig : sigs) {
     if (nodes.count(sig.node) == 1) {
       return td::Status::Error(ErrorCode::protoviolation, "duplicate node to sign");
@@ -89,10 +99,11 @@ td::Result<ValidatorWeight> ValidatorSetQ::check_approve_signatures(RootHash roo
       return td::Status::Error(ErrorCode::protoviolation, "unknown node to sign");
     }
 
-    auto E = ValidatorFullId{vdescr->key}.create_encryptor().move_as_ok();
-    TRY_STATUS(E->check_signature(block.as_slice(), sig.signature.as_slice()));
+    keys.push_back(decoded_keys().get(vdescr->key.as_bits256()));
+    entries.push_back({keys.back().get(), data, sig.signature.as_slice()});
     weight += vdescr->weight;
   }
+  TRY_STATUS_PREFIX(td::Ed25519::verify_batch(entries), "bad signature: ");
 
   if (weight * 3 <= total_weight_ * 2) {
     return td::Status::Error(ErrorCode::protoviolation, "too small sig weight");
@@ -100,6 +111,18 @@ td::Result<ValidatorWeight> ValidatorSetQ::check_approve_signatures(RootHash roo
   return weight;
 }
 
+td::Result<ValidatorWeight> ValidatorSetQ::check_signatures(RootHash root_hash, FileHash file_hash,
+                                                            td::Ref<BlockSignatureSet> signatures) const {
+  auto block = create_serialize_tl_object<ton_api::ton_blockId>(root_hash, file_hash);
+  return check_signatures_impl(block.as_slice(), std::move(signatures));
+}
+
+td::Result<ValidatorWeight> ValidatorSetQ::check_approve_signatures(RootHash root_hash, FileHash file_hash,
+                                                                    td::Ref<BlockSignatureSet> signatures) const {
+  auto block = create_serialize_tl_object<ton_api::ton_blockIdApprove>(root_hash, file_hash);
+  return check_signatures_impl(block.as_slice(), std::move(signatures));
+}
+
 ValidatorSetQ::ValidatorSetQ(CatchainSeqno cc_seqno, ShardIdFull from, std::vector<ValidatorDescr> nodes)
     : cc_seqno_(cc_seqno), for_(from), ids_(std::move(nodes)) {
   total_weight_ = 0;
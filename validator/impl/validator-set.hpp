@@ -64,6 +64,7 @@ class ValidatorSetQ : public ValidatorSet {
   std::vector<std::pair<NodeIdShort, size_t>> ids_map_;
 
   const ValidatorDescr* find_validator(const NodeIdShort& id) const;
+  td::Result<ValidatorWeight> check_signatures_impl(td::Slice data, td::Ref<BlockSignatureSet> signatures) const;
 };
 
 class ValidatorSetCompute {
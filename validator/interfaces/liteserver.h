@@ -19,14 +19,32 @@
 #pragma once
 
 #include "td/actor/actor.h"
+#include "ton/ton-types.h"
+#include "block.h"
+#include "shard.h"
 
 namespace ton {
 
 namespace validator {
 
+// data and state of a block, shared by all liteserver queries to this block
+struct LiteServerBlockContext : public td::CntObject {
+  BlockIdExt block_id;
+  td::Ref<BlockData> block;
+  td::Ref<ShardState> state;
+  td::Ref<vm::Cell> state_root_proof;  // Merkle proof of the state hash from the block header
+};
+
 class LiteServerCache : public td::actor::Actor {
  public:
   virtual ~LiteServerCache() = default;
+
+  // answers a liteserver query, reusing a cached answer to the same query if there is one
+  virtual void run_query(td::BufferSlice data, td::Promise<td::BufferSlice> promise) = 0;
+  // drops cached answers that may be changed by the new masterchain block
+  virtual void new_masterchain_block(BlockSeqno seqno) = 0;
+  // loads the data and the state of a block once for all queries to it
+  virtual void get_block_context(BlockIdExt block_id, td::Promise<td::Ref<LiteServerBlockContext>> promise) = 0;
 };
 
 }  // namespace validator
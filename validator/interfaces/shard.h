@@ -25,7 +25,9 @@
 #include "block.h"
 #include "message-queue.h"
 #include "vm/cells.h"
+#include "vm/boc.h"
 #include "proof.h"
+#include "td/utils/port/FileFd.h"
 
 namespace ton {
 
@@ -55,8 +57,13 @@ class ShardState : public td::CntObject {
   virtual td::Result<std::pair<td::Ref<ShardState>, td::Ref<ShardState>>> split() const = 0;
 
   virtual td::Result<td::BufferSlice> serialize() const = 0;
+  // the cells are loaded again with load_cell while written if it is set, instead of being kept in memory
+  virtual td::Status serialize_to_file(td::FileFd& fd, const vm::BagOfCells::LoadCell& load_cell) const = 0;
 };
 
+// writes a persistent state to a file; load_cell loads cells from the cell db, it may be empty
+using PersistentStateWriter = std::function<td::Status(td::FileFd& fd, const vm::BagOfCells::LoadCell& load_cell)>;
+
 class MasterchainState : virtual public ShardState {
  public:
   virtual ~MasterchainState() = default;
@@ -134,12 +134,13 @@ void ValidatorManagerImpl::sync_complete(td::Promise<td::Unit> promise) {
 
 void ValidatorManagerImpl::validate_fake(BlockCandidate candidate, std::vector<BlockIdExt> prev, BlockIdExt last,
                                          td::Ref<ValidatorSet> val_set) {
-  auto P = td::PromiseCreator::lambda([SelfId = actor_id(this), c = candidate.clone(), prev, last,
-                                       val_set](td::Result<ValidateCandidateResult> R) mutable {
+  auto P = td::PromiseCreator::lambda([SelfId = actor_id(this), c = candidate.clone(), prev, last, val_set,
+                                       started_at = td::Time::now()](td::Result<ValidateCandidateResult> R) mutable {
     if (R.is_ok()) {
       auto v = R.move_as_ok();
       v.visit(td::overloaded(
           [&](UnixTime ts) {
+            LOG(ERROR) << "validated block " << c.id << " in " << td::Time::now() - started_at << "s";
             td::actor::send_closure(SelfId, &ValidatorManagerImpl::write_fake, std::move(c), prev, last, val_set);
           },
           [&](CandidateReject reject) {
@@ -153,7 +154,7 @@ void ValidatorManagerImpl::validate_fake(BlockCandidate candidate, std::vector<B
   });
   auto shard = candidate.id.shard_full();
   run_validate_query(shard, 0, last, prev, std::move(candidate), std::move(val_set), actor_id(this),
-                     td::Timestamp::in(10.0), std::move(P), true /* fake */);
+                     td::Timestamp::in(10.0), std::move(P), true /* fake */, opts_->get_validation_threads());
 }
 
 void ValidatorManagerImpl::write_fake(BlockCandidate candidate, std::vector<BlockIdExt> prev, BlockIdExt last,
@@ -680,6 +681,13 @@ void ValidatorManagerImpl::store_persistent_state_file(BlockIdExt block_id, Bloc
                           std::move(promise));
 }
 
+void ValidatorManagerImpl::store_persistent_state_file_gen(BlockIdExt block_id, BlockIdExt masterchain_block_id,
+                                                           PersistentStateWriter write_data,
+                                                           td::Promise<td::Unit> promise) {
+  td::actor::send_closure(db_, &Db::store_persistent_state_file_gen, block_id, masterchain_block_id,
+                          std::move(write_data), std::move(promise));
+}
+
 void ValidatorManagerImpl::store_zero_state_file(BlockIdExt block_id, td::BufferSlice state,
                                                  td::Promise<td::Unit> promise) {
   td::actor::send_closure(db_, &Db::store_zero_state_file, block_id, std::move(state), std::move(promise));
@@ -882,7 +890,8 @@ void ValidatorManagerImpl::send_top_shard_block_description(td::Ref<ShardTopBloc
 }
 
 void ValidatorManagerImpl::start_up() {
-  db_ = create_db_actor(actor_id(this), db_root_);
+  set_state_update_threads(opts_->get_state_update_threads());
+  db_ = create_db_actor(actor_id(this), db_root_, opts_);
 
   auto P = td::PromiseCreator::lambda([SelfId = actor_id(this)](td::Result<ValidatorManagerInitResult> R) {
     R.ensure();
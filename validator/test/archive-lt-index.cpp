@@ -0,0 +1,147 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "validator/db/archive-lt-index.hpp"
+
+#include "ton/ton-shard.h"
+#include "td/db/MemoryKeyValue.h"
+#include "td/utils/Random.h"
+#include "td/utils/port/path.h"
+#include "td/utils/tests.h"
+
+#include <map>
+
+namespace {
+
+using namespace ton;
+using namespace ton::validator;
+
+// ltdb of a slice kept as ArchiveSlice::add_handle() keeps it: zerostates and blocks that do not follow the last block
+// of their shard get only a handle
+class TestLtDb {
+ public:
+  void add(BlockIdExt block_id, LogicalTime lt, UnixTime ts) {
+    bool added = block_id.seqno() != 0 && ArchiveLtDb::add_block(kv_, block_id, lt, ts);
+    kv_.set(ArchiveLtDb::block_info_key(block_id), PSLICE() << "handle " << block_id.to_str()).ensure();
+    blocks_[block_id] = added;
+    if (added) {
+      max_lt_ = std::max(max_lt_, lt);
+      max_ts_ = std::max(max_ts_, ts);
+      max_seqno_ = std::max(max_seqno_, block_id.seqno());
+    }
+  }
+
+  // adds count blocks following the given one, sometimes with an lt or unix time that is not greater
+  BlockIdExt add_chain(ShardIdFull shard, BlockSeqno seqno, LogicalTime lt, UnixTime ts, td::uint32 count) {
+    BlockIdExt block_id;
+    for (td::uint32 i = 0; i < count; i++) {
+      seqno += td::Random::fast(1, 2);
+      bool out_of_order = td::Random::fast(0, 15) == 0;
+      if (!out_of_order) {
+        lt += td::Random::fast(1, 1000);
+        ts += td::Random::fast(1, 5);
+      }
+      block_id = make_block_id(shard, seqno);
+      add(block_id, lt, ts);
+    }
+    return block_id;
+  }
+
+  static BlockIdExt make_block_id(ShardIdFull shard, BlockSeqno seqno) {
+    td::Bits256 root_hash, file_hash;
+    td::Random::secure_bytes(root_hash.as_slice());
+    td::Random::secure_bytes(file_hash.as_slice());
+    return BlockIdExt{shard.workchain, shard.shard, seqno, root_hash, file_hash};
+  }
+
+  void check(td::CSlice path) {
+    ArchiveLtIndex::write(path, ArchiveLtDb::read(kv_)).ensure();
+    auto index = ArchiveLtIndex::open(path).move_as_ok();
+
+    for (auto &it : blocks_) {
+      std::string value;
+      ASSERT_TRUE(kv_.get(ArchiveLtDb::block_info_key(it.first), value).move_as_ok() ==
+                  td::KeyValue::GetStatus::Ok);
+      auto R = index.get_handle(it.first);
+      // blocks outside of the ltdb are found only in the key-value index
+      ASSERT_EQ(it.second, R.is_ok());
+      if (R.is_ok()) {
+        ASSERT_EQ(value, R.ok().str());
+      }
+    }
+    ASSERT_TRUE(index.get_handle(make_block_id(ShardIdFull{masterchainId}, 1)).is_error());
+
+    for (int i = 0; i < 10000; i++) {
+      AccountIdPrefixFull account_id{td::Random::fast(0, 1) == 0 ? masterchainId : basechainId,
+                                     td::Random::fast_uint64()};
+      auto lt = static_cast<LogicalTime>(td::Random::fast(0, static_cast<int>(max_lt_ + 1000)));
+      auto ts = static_cast<UnixTime>(td::Random::fast(0, static_cast<int>(max_ts_ + 10)));
+      auto seqno = static_cast<BlockSeqno>(td::Random::fast(0, static_cast<int>(max_seqno_ + 2)));
+      check_lookup(index, account_id, [lt](const LtDbEntry &w) { return lt > w.lt ? 1 : lt == w.lt ? 0 : -1; }, false);
+      check_lookup(index, account_id, [ts](const LtDbEntry &w) { return ts > w.ts ? 1 : ts == w.ts ? 0 : -1; }, false);
+      check_lookup(
+          index, account_id, [seqno](const LtDbEntry &w) { return seqno > w.seqno ? 1 : seqno == w.seqno ? 0 : -1; },
+          true);
+    }
+  }
+
+ private:
+  void check_lookup(const ArchiveLtIndex &index, AccountIdPrefixFull account_id,
+                    const std::function<td::int32(const LtDbEntry &)> &compare, bool exact) {
+    auto R1 = ArchiveLtDb::lookup(kv_, account_id, compare, exact);
+    auto R2 = index.lookup(account_id, compare, exact);
+    ASSERT_EQ(R1.is_ok(), R2.is_ok());
+    if (R1.is_ok()) {
+      ASSERT_EQ(R1.ok().to_str(), R2.ok().to_str());
+    }
+  }
+
+  td::MemoryKeyValue kv_;
+  std::map<BlockIdExt, bool> blocks_;
+  LogicalTime max_lt_{0};
+  UnixTime max_ts_{0};
+  BlockSeqno max_seqno_{0};
+};
+
+}  // namespace
+
+TEST(ArchiveLtIndex, SameAsLtDb) {
+  for (int test = 0; test < 20; test++) {
+    TestLtDb db;
+    ShardIdFull mc{masterchainId};
+    ShardIdFull wc{basechainId};
+    db.add(TestLtDb::make_block_id(mc, 0), 0, 0);
+    db.add(TestLtDb::make_block_id(wc, 0), 0, 0);
+    db.add_chain(mc, 0, 1000, 100, td::Random::fast(1, 300));
+
+    // split and merge of the basechain; children go on from the seqno and lt of their parent
+    auto parent = db.add_chain(wc, 0, 1000, 100, td::Random::fast(0, 100));
+    std::vector<ShardIdFull> shards{shard_child(wc, true), shard_child(shard_child(wc, false), true),
+                                    shard_child(shard_child(wc, false), false)};
+    BlockSeqno seqno = parent.is_valid() ? parent.seqno() : 0;
+    for (auto &shard : shards) {
+      auto last = db.add_chain(shard, seqno, 1000 * (seqno + 1), 100 + seqno * 5, td::Random::fast(0, 200));
+      // a block with a seqno that is not greater than the last one
+      if (last.is_valid() && td::Random::fast(0, 1) == 0) {
+        db.add(TestLtDb::make_block_id(shard, last.seqno()), 1000000000, 1000000000);
+      }
+    }
+
+    auto path = PSTRING() << "archive-lt-index-test-" << test;
+    db.check(path);
+    td::unlink(path).ignore();
+  }
+}
@@ -0,0 +1,93 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "validator/impl/liteserver-answers.hpp"
+
+#include "td/utils/tests.h"
+
+namespace {
+
+using namespace ton;
+using namespace ton::validator;
+
+td::Bits256 make_key(int i) {
+  td::Bits256 key;
+  key.set_zero();
+  key.as_slice()[0] = static_cast<char>(i);
+  return key;
+}
+
+bool has(LiteServerAnswers &answers, int i) {
+  td::BufferSlice value;
+  return answers.get(make_key(i), value);
+}
+
+}  // namespace
+
+TEST(LiteServerAnswers, Lru) {
+  std::size_t answer_size = 1000;
+  LiteServerAnswers answers(4 * answer_size + 1000, 4);
+  for (int i = 0; i < 4; i++) {
+    answers.store(make_key(i), false, 1, td::BufferSlice(std::string(answer_size, static_cast<char>('a' + i))));
+  }
+  ASSERT_EQ(4u, answers.size());
+  td::BufferSlice value;
+  ASSERT_TRUE(answers.get(make_key(0), value));
+  ASSERT_EQ(std::string(answer_size, 'a'), value.as_slice().str());
+
+  // the answer 0 was just used, so the answer 1 is the oldest one
+  answers.store(make_key(4), false, 1, td::BufferSlice(answer_size));
+  ASSERT_TRUE(has(answers, 0));
+  ASSERT_TRUE(!has(answers, 1));
+  ASSERT_TRUE(has(answers, 2));
+  ASSERT_TRUE(has(answers, 4));
+  ASSERT_TRUE(answers.bytes() <= 4 * answer_size + 1000);
+
+  // storing the same key again replaces the answer
+  answers.store(make_key(2), false, 1, td::BufferSlice("new"));
+  ASSERT_TRUE(answers.get(make_key(2), value));
+  ASSERT_EQ("new", value.as_slice().str());
+  ASSERT_EQ(4u, answers.size());
+
+  // answers larger than the whole budget are not kept
+  answers.store(make_key(5), false, 1, td::BufferSlice(10 * answer_size));
+  ASSERT_TRUE(!has(answers, 5));
+  ASSERT_EQ(4u, answers.size());
+}
+
+TEST(LiteServerAnswers, Expiry) {
+  LiteServerAnswers answers(1 << 20, 4);
+  answers.store(make_key(0), true, 10, td::BufferSlice("last block"));
+  answers.store(make_key(1), false, 10, td::BufferSlice("block"));
+  answers.store(make_key(2), false, 12, td::BufferSlice("later block"));
+
+  // answers about the last masterchain block are dropped by the next one
+  answers.new_masterchain_block(11);
+  ASSERT_TRUE(!has(answers, 0));
+  ASSERT_TRUE(has(answers, 1));
+  ASSERT_TRUE(has(answers, 2));
+
+  answers.new_masterchain_block(13);
+  ASSERT_TRUE(has(answers, 1));
+
+  // other answers are kept during the next few masterchain blocks
+  answers.new_masterchain_block(14);
+  ASSERT_TRUE(!has(answers, 1));
+  ASSERT_TRUE(has(answers, 2));
+  answers.new_masterchain_block(16);
+  ASSERT_EQ(0u, answers.size());
+  ASSERT_EQ(0u, answers.bytes());
+}
@@ -0,0 +1,45 @@
+/*
+    This file is part of TON Blockchain Library.
+
+    TON Blockchain Library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    TON Blockchain Library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with TON Blockchain Library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "validator/db/package.hpp"
+
+#include "td/utils/port/path.h"
+#include "td/utils/tests.h"
+
+TEST(Package, ReadEntries) {
+  std::string path = "tmp-package-test.pack";
+  td::unlink(path).ignore();
+  auto pack = ton::Package::open(path, false, true).move_as_ok();
+
+  // around the sizes read at once: 1KB for the header and the filename, 64KB more for the data
+  std::vector<std::pair<std::string, std::string>> entries;
+  std::vector<td::uint64> offsets;
+  for (size_t fname_size : {0, 10, 1016, 1017, 5000}) {
+    for (size_t data_size : {0, 1, 1000, 1024, 65536, 65536 + 1008, 65536 + 2000, 300000}) {
+      entries.emplace_back(std::string(fname_size, static_cast<char>('a' + fname_size % 26)),
+                           std::string(data_size, static_cast<char>('a' + (fname_size + data_size) % 26)));
+      offsets.push_back(pack.append(entries.back().first, entries.back().second, false));
+    }
+  }
+  for (size_t i = 0; i < entries.size(); i++) {
+    auto entry = pack.read(offsets[i]).move_as_ok();
+    ASSERT_EQ(entries[i].first, entry.first);
+    ASSERT_EQ(entries[i].second, entry.second.as_slice().str());
+  }
+  ASSERT_TRUE(pack.read(pack.size()).is_error());
+
+  td::unlink(path).ignore();
+}
@@ -108,6 +108,21 @@ struct ValidatorManagerOptionsImpl : public ValidatorManagerOptions {
   BlockSeqno sync_upto() const override {
     return sync_upto_;
   }
+  td::uint32 get_collator_threads() const override {
+    return collator_threads_;
+  }
+  td::uint32 get_validation_threads() const override {
+    return validation_threads_;
+  }
+  td::uint32 get_state_update_threads() const override {
+    return state_update_threads_;
+  }
+  td::uint32 get_max_open_archive_slices() const override {
+    return max_open_archive_slices_;
+  }
+  td::uint64 get_archive_index_memory() const override {
+    return archive_index_memory_;
+  }
 
   void set_zero_block_id(BlockIdExt block_id) override {
     zero_block_id_ = block_id;
@@ -154,6 +169,21 @@ struct ValidatorManagerOptionsImpl : public ValidatorManagerOptions {
   void set_sync_upto(BlockSeqno seqno) override {
     sync_upto_ = seqno;
   }
+  void set_collator_threads(td::uint32 value) override {
+    collator_threads_ = value;
+  }
+  void set_validation_threads(td::uint32 value) override {
+    validation_threads_ = value;
+  }
+  void set_state_update_threads(td::uint32 value) override {
+    state_update_threads_ = value;
+  }
+  void set_max_open_archive_slices(td::uint32 value) override {
+    max_open_archive_slices_ = value;
+  }
+  void set_archive_index_memory(td::uint64 value) override {
+    archive_index_memory_ = value;
+  }
 
   ValidatorManagerOptionsImpl *make_copy() const override {
     return new ValidatorManagerOptionsImpl(*this);
@@ -193,6 +223,11 @@ struct ValidatorManagerOptionsImpl : public ValidatorManagerOptions {
   std::map<CatchainSeqno, std::pair<BlockSeqno, td::uint32>> unsafe_catchain_rotates_;
   BlockSeqno truncate_{0};
   BlockSeqno sync_upto_{0};
+  td::uint32 collator_threads_{1};
+  td::uint32 validation_threads_{1};
+  td::uint32 state_update_threads_{1};
+  td::uint32 max_open_archive_slices_{0};
+  td::uint64 archive_index_memory_{0};
 };
 
 }  // namespace validator
@@ -72,6 +72,16 @@ struct ValidatorManagerOptions : public td::CntObject {
   virtual bool need_db_truncate() const = 0;
   virtual BlockSeqno get_truncate_seqno() const = 0;
   virtual BlockSeqno sync_upto() const = 0;
+  // number of threads executing transactions during collation, 1 means sequential collation
+  virtual td::uint32 get_collator_threads() const = 0;
+  // number of threads checking transactions of a block candidate, 1 means sequential validation
+  virtual td::uint32 get_validation_threads() const = 0;
+  // number of threads applying Merkle updates of large blocks to shard states, 1 means sequential application
+  virtual td::uint32 get_state_update_threads() const = 0;
+  // maximal number of archive slices with open index and package files, 0 means no limit
+  virtual td::uint32 get_max_open_archive_slices() const = 0;
+  // total memtable memory of archive slice indexes in bytes, 0 means RocksDB defaults
+  virtual td::uint64 get_archive_index_memory() const = 0;
 
   virtual void set_zero_block_id(BlockIdExt block_id) = 0;
   virtual void set_init_block_id(BlockIdExt block_id) = 0;
@@ -89,6 +99,11 @@ struct ValidatorManagerOptions : public td::CntObject {
   virtual void add_unsafe_catchain_rotate(BlockSeqno seqno, CatchainSeqno cc_seqno, td::uint32 value) = 0;
   virtual void truncate_db(BlockSeqno seqno) = 0;
   virtual void set_sync_upto(BlockSeqno seqno) = 0;
+  virtual void set_collator_threads(td::uint32 value) = 0;
+  virtual void set_validation_threads(td::uint32 value) = 0;
+  virtual void set_state_update_threads(td::uint32 value) = 0;
+  virtual void set_max_open_archive_slices(td::uint32 value) = 0;
+  virtual void set_archive_index_memory(td::uint64 value) = 0;
 
   static td::Ref<ValidatorManagerOptions> create(
       BlockIdExt zero_block_id, BlockIdExt init_block_id,